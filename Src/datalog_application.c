@@ -28,16 +28,29 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "datalog_application.h"
+#include "datalog_busprof.h"
+#include "datalog_cardtest.h"
+#include "datalog_crc.h"
+#include "datalog_download.h"
+#include "datalog_file.h"
+#include "datalog_record.h"
+#include "datalog_recover.h"
+#include "datalog_regrec.h"
+#include "datalog_writer.h"
 #include "main.h"
+#include "cmsis_os.h"
 #include "usbd_cdc_interface.h"
 #include "string.h"
 #include "SensorTile.h"
 #include <math.h>
+#include <stdlib.h>
     
 /* FatFs includes component */
 #include "ff_gen_drv.h"
 #include "sd_diskio.h"
 
+#include "datalog_block.h"
+
 /* Includes ------------------------------------------------------------------*/
 
 /* Private typedef -----------------------------------------------------------*/
@@ -50,22 +63,117 @@ typedef struct displayFloatToInt_s {
 /* Private define ------------------------------------------------------------*/
 #define MAX_BUF_SIZE 256  
 
+#if defined(DATALOG_SD_BINARY)
+  #define DATALOG_SD_FILE_EXT ".bin"
+#elif defined(DATALOG_SD_REGISTERS)
+  #define DATALOG_SD_FILE_EXT ".reg"
+#else
+  #define DATALOG_SD_FILE_EXT ".csv"
+#endif
+#if defined(DATALOG_SD_BINARY) && defined(DATALOG_SD_REGISTERS)
+  #error "Define only one of DATALOG_SD_BINARY and DATALOG_SD_REGISTERS"
+#endif
+#define DATALOG_SD_FILE_PREFIX "SensorTile_Log_N"
+#define DATALOG_SD_FILE_NAME_SIZE (32)
+
+#if defined(DATALOG_SD_ROTATE_SIZE) || defined(DATALOG_SD_ROTATE_PERIOD_MS)
+  #define DATALOG_SD_ROTATE
+#endif
+#if defined(DATALOG_SD_ROTATE_SIZE) && defined(DATALOG_SD_PREALLOCATE_SIZE)
+  #if DATALOG_SD_ROTATE_SIZE >= DATALOG_SD_PREALLOCATE_SIZE
+    #error "DATALOG_SD_ROTATE_SIZE must leave room in DATALOG_SD_PREALLOCATE_SIZE for the end of the log"
+  #endif
+#endif
+
+/* Log files checked by the recovery at start: the one written when the
+   power was lost and the next one, maybe already created */
+#define DATALOG_SD_RECOVER_FILES (2)
+
+/* Commands to LogWrite_Thread, queued with the buffers to write */
+#define LOG_WRITE_PREPARE  (1U)   /* create the next log file */
+#define LOG_WRITE_SWITCH   (2U)   /* close the log file, go on in the next one */
+#define LOG_WRITE_CLOSE    (3U)   /* close the log file, delete the unused next one */
+
+/* Channels read from each sensor */
+#define DATALOG_ACC_CHANNELS   ((1u << DATALOG_CH_ACC_X) | (1u << DATALOG_CH_ACC_Y) | (1u << DATALOG_CH_ACC_Z))
+#define DATALOG_GYRO_CHANNELS  ((1u << DATALOG_CH_GYRO_X) | (1u << DATALOG_CH_GYRO_Y) | (1u << DATALOG_CH_GYRO_Z))
+#define DATALOG_MAG_CHANNELS   ((1u << DATALOG_CH_MAG_X) | (1u << DATALOG_CH_MAG_Y) | (1u << DATALOG_CH_MAG_Z))
+
+#if defined(DATALOG_SD_LAYOUT_COLUMNAR)
+  #define DATALOG_SD_LAYOUT DATALOG_LAYOUT_COLUMNAR
+#else
+  #define DATALOG_SD_LAYOUT DATALOG_LAYOUT_ROW
+#endif
+
+#if defined(DATALOG_SD_PREALLOCATE_SIZE)
+  #define DATALOG_SD_PREALLOCATE DATALOG_SD_PREALLOCATE_SIZE
+#else
+  #define DATALOG_SD_PREALLOCATE 0
+#endif
+
+#if (DATALOG_SD_WRITE_BUFFER_SIZE % 512) != 0 || (DATALOG_SD_WRITE_BUFFERS < 2)
+  #error "DATALOG_SD_WRITE_BUFFER_SIZE must be a multiple of 512 bytes, with at least 2 buffers"
+#endif
+
 /* Private variables ---------------------------------------------------------*/
 static volatile uint8_t PushButtonDetected = 0;
 
 static BSP_MOTION_SENSOR_Event_Status_t MotionStatus;
 
+/* Log data buffers, written by LogWrite_Thread */
+static uint32_t LogWriteBuffers[DATALOG_SD_WRITE_BUFFERS * DATALOG_SD_WRITE_BUFFER_SIZE / sizeof(uint32_t)];
+static DATALOG_Writer_t LogWriter;
+static volatile uint8_t LogWriteError;
+static osThreadId LogWriteThreadId = NULL;
+static osMessageQId LogWriteQueueId = NULL;
+osMessageQDef(LogWriteQueue, DATALOG_SD_WRITE_BUFFERS, uint32_t);
+static osSemaphoreId LogWriteFreeId = NULL;    /* buffers free, besides the one filling */
+osSemaphoreDef(LogWriteFree);
+static osSemaphoreId LogWriteClosedId = NULL;  /* released once LOG_WRITE_CLOSE is done */
+osSemaphoreDef(LogWriteClosed);
+static uint32_t LogWriteSizes[DATALOG_SD_WRITE_BUFFERS];  /* bytes queued in each buffer */
+
+/* Log file written and the next one, created by LogWrite_Thread in advance
+   so a rotation does not wait for f_open and the preallocation */
+static DATALOG_File_t LogFiles[2];
+static DATALOG_File_t *LogFile = &LogFiles[0];
+static DATALOG_File_t *LogNextFile = &LogFiles[1];
+static volatile uint8_t LogNextReady;
+static uint8_t LogNextPending;          /* create it after the next buffer */
+static uint32_t LogFileIndex;           /* N of the log file written */
+static uint32_t LogFileBytes;           /* bytes appended to it */
+static uint32_t LogFileStartMs;
+static uint32_t LogSyncBytes;           /* written since the last sync */
+static uint32_t LogSyncMs;
+
 /* Private function prototypes -----------------------------------------------*/
 static void MX_DataLogTerminal_Init(void);
+static uint8_t LogWrite_Full(void *ctx, uint8_t *buffer, uint32_t size);
+static uint8_t LogWrite_Close(void);
+static void LogWrite_Thread(void const *argument);
+static uint8_t LogStream_Begin(void);
+static void LogStream_End(void);
+static uint8_t LogFile_Create(DATALOG_File_t *f, uint32_t index);
+static uint32_t LogFile_NextIndex(void);
+static uint32_t LogFile_Recover(uint32_t index);
+static uint8_t LogFile_Sync(uint32_t size);
+static uint8_t Download_Write(const uint8_t *buf, uint32_t size);
+static void Download_Wait(void);
     
 FRESULT res;                                          /* FatFs function common result code */
 uint32_t byteswritten, bytesread;                     /* File write/read counts */
 FATFS SDFatFs;                                        /* File system object for SD card logical drive */
-FIL MyFile;                                           /* File object */
 char SDPath[4];                                       /* SD card logical drive path */
     
 volatile uint8_t SD_Log_Enabled = 0;
 
+#if defined(DATALOG_SD_BINARY)
+static uint32_t LogBlockBuffer[DATALOG_SD_BLOCK_SIZE / sizeof(uint32_t)]; /* word aligned block */
+static DATALOG_Block_t LogBlock;
+static DATALOG_IndexEntry_t LogIndexEntries[DATALOG_SD_INDEX_ENTRIES];
+static DATALOG_Index_t LogIndex;
+#endif
+
 char newLine[] = "\r\n";
 
 extern volatile uint8_t no_H_HTS221;
@@ -78,6 +186,9 @@ extern volatile uint8_t no_T_HTS221;
   */
 void DATALOG_SD_Init(void)
 {
+  /* Block CRCs of the binary log */
+  DATALOG_CRC_Init();
+  
   if(FATFS_LinkDriver(&SD_Driver, SDPath) == 0)
   {
     /* Register the file system object to the FatFs module */
@@ -102,41 +213,406 @@ void DATALOG_SD_Init(void)
   */
 uint8_t DATALOG_SD_Log_Enable(void)
 {
-  static uint16_t sdcard_file_counter = 0;
-  char header[] = "T [ms],AccX [mg],AccY [mg],AccZ [mg],GyroX [mdps],GyroY [mdps],GyroZ [mdps],MagX [mgauss],MagY [mgauss],MagZ [mgauss],P [mB],T [C],H [%]\r\n";
-  uint32_t byteswritten; /* written byte count */
-  char file_name[30] = {0};
-  
   /* SD SPI CS Config */
   SD_IO_CS_Init();
   
-  sprintf(file_name, "%s%.3d%s", "SensorTile_Log_N", sdcard_file_counter, ".csv");
-  sdcard_file_counter++;
-
-  HAL_Delay(100);
-
-  if(f_open(&MyFile, (char const*)file_name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+  /* The write task and its objects are created by the first log and kept
+     (configTOTAL_HEAP_SIZE accounts for them). Without heap the log does
+     not start; what was created is kept for the next try */
+  if(LogWriteQueueId == NULL)
+  {
+    LogWriteQueueId = osMessageCreate(osMessageQ(LogWriteQueue), NULL);
+  }
+  if(LogWriteFreeId == NULL)
+  {
+    LogWriteFreeId = osSemaphoreCreate(osSemaphore(LogWriteFree), DATALOG_SD_WRITE_BUFFERS - 1);
+  }
+  if(LogWriteClosedId == NULL)
+  {
+    LogWriteClosedId = osSemaphoreCreate(osSemaphore(LogWriteClosed), 1);
+    if(LogWriteClosedId != NULL)
+    {
+      osSemaphoreWait(LogWriteClosedId, 0);
+    }
+  }
+  if((LogWriteThreadId == NULL) && (LogWriteQueueId != NULL) && (LogWriteFreeId != NULL) &&
+     (LogWriteClosedId != NULL))
+  {
+    osThreadDef(LOG_WRITE, LogWrite_Thread, osPriorityBelowNormal, 0, configMINIMAL_STACK_SIZE*4);
+    LogWriteThreadId = osThreadCreate(osThread(LOG_WRITE), NULL);
+  }
+  if(LogWriteThreadId == NULL)
   {
-    sdcard_file_counter--;
     return 0;
   }
+  DATALOG_Writer_Init(&LogWriter, (uint8_t*)LogWriteBuffers, DATALOG_SD_WRITE_BUFFER_SIZE,
+                      DATALOG_SD_WRITE_BUFFERS, LogWrite_Full, NULL);
+  LogWriteError = 0;
   
-  if(f_write(&MyFile, (const void*)&header, sizeof(header)-1, (void *)&byteswritten) != FR_OK)
+  /* Go on after the logs already on the card, restoring the data of a log
+     cut by a power loss */
+  LogFileIndex = LogFile_Recover(LogFile_NextIndex());
+  if(!LogFile_Create(LogFile, LogFileIndex))
   {
     return 0;
   }
+  
+  LogNextReady = 0;
+  LogSyncBytes = 0;
+  LogSyncMs = HAL_GetTick();
+#if defined(DATALOG_SD_ROTATE)
+  osMessagePut(LogWriteQueueId, LOG_WRITE_PREPARE, osWaitForever);
+#endif
+  return LogStream_Begin();
+}
+
+/**
+  * @brief  Start the log data of a new file: CSV header, first block and
+  *         empty time index of a binary log, or header of a register
+  *         recording
+  * @retval 1 on success, 0 on error
+  */
+static uint8_t LogStream_Begin(void)
+{
+#if !defined(DATALOG_SD_BINARY) && !defined(DATALOG_SD_REGISTERS)
+  char header[MAX_BUF_SIZE];
+  int size;
+#endif
+  
+  LogFileBytes = 0;
+  LogFileStartMs = HAL_GetTick();
+#if defined(DATALOG_SD_BINARY)
+  DATALOG_Block_Init(&LogBlock, (uint8_t*)LogBlockBuffer, DATALOG_SD_BLOCK_SIZE, DATALOG_SD_LAYOUT,
+                     DATALOG_Record_ChannelMask(), 0);
+  DATALOG_Index_Init(&LogIndex, LogIndexEntries, DATALOG_SD_INDEX_ENTRIES);
   return 1;
+#elif defined(DATALOG_SD_REGISTERS)
+  return DATALOG_RegRec_Begin();
+#else
+  size = DATALOG_Record_CsvHeader(header, sizeof(header));
+  return (size >= 0) && DATALOG_SD_writeBuf(header, size);
+#endif
+}
+
+/**
+  * @brief  End the log data of a file: partially filled block and time index
+  *         footer of a binary log
+  * @retval None
+  */
+static void LogStream_End(void)
+{
+#if defined(DATALOG_SD_BINARY)
+  uint16_t first = 0;
+  
+  /* Flush the partially filled block */
+  if(LogBlock.count > 0)
+  {
+    DATALOG_SD_writeBuf((char*)DATALOG_Block_Seal(&LogBlock), LogBlock.size);
+    DATALOG_Index_Add(&LogIndex, LogBlock.buffer);
+    DATALOG_Block_Next(&LogBlock);
+  }
+  
+  /* Time index footer, at least one block to mark a cleanly closed log */
+  do
+  {
+    first += DATALOG_Index_Seal(&LogIndex, &LogBlock, first);
+    DATALOG_SD_writeBuf((char*)LogBlock.buffer, LogBlock.size);
+    DATALOG_Block_Next(&LogBlock);
+  } while(first < LogIndex.count);
+#endif
 }
 
+/**
+  * @brief  Append data to the log file. It is only copied to the write
+  *         buffers, unless a buffer fills up and the previous one is still
+  *         being written
+  * @param  s: data to append
+  * @param  size: number of bytes
+  * @retval 1 on success, 0 if a write to the card failed
+  */
 uint8_t DATALOG_SD_writeBuf(char *s, uint32_t size)
 {
-  uint32_t byteswritten;
+  LogFileBytes += size;
+  return DATALOG_Writer_Write(&LogWriter, s, size) && !LogWriteError;
+}
+
+/**
+  * @brief  Go on in the next log file once the current one reaches
+  *         DATALOG_SD_ROTATE_SIZE bytes or DATALOG_SD_ROTATE_PERIOD_MS. Call
+  *         it between two records: the next file is already created, so the
+  *         switch only queues the end of the current file.
+  * @retval 1 on success, 0 if a write to the card failed
+  */
+uint8_t DATALOG_SD_Rotate(void)
+{
+#if defined(DATALOG_SD_ROTATE)
+  uint8_t due = 0;
+  uint8_t ret;
+  
+#if defined(DATALOG_SD_ROTATE_SIZE)
+  due |= (LogFileBytes >= DATALOG_SD_ROTATE_SIZE);
+#endif
+#if defined(DATALOG_SD_ROTATE_PERIOD_MS)
+  due |= ((HAL_GetTick() - LogFileStartMs) >= DATALOG_SD_ROTATE_PERIOD_MS);
+#endif
+  
+  /* Without a next file (card full) the log goes on in this one */
+  if(!due || !LogNextReady)
+  {
+    return 1;
+  }
+  
+  LogStream_End();
+  LogNextReady = 0;
+  ret = DATALOG_Writer_Submit(&LogWriter);
+  osMessagePut(LogWriteQueueId, LOG_WRITE_SWITCH, osWaitForever);
+  return LogStream_Begin() && ret && !LogWriteError;
+#else
+  return 1;
+#endif
+}
+
+/**
+  * @brief  Hand a full buffer to LogWrite_Thread, then wait for the next
+  *         one to be free
+  * @retval 0 if a previous write failed
+  */
+static uint8_t LogWrite_Full(void *ctx, uint8_t *buffer, uint32_t size)
+{
+  (void)ctx;
+  LogWriteSizes[(buffer - LogWriter.buffers) / LogWriter.size] = size;
+  osMessagePut(LogWriteQueueId, (uintptr_t)buffer, osWaitForever);
+  osSemaphoreWait(LogWriteFreeId, osWaitForever);
+  return !LogWriteError;
+}
+
+/**
+  * @brief  Write the full buffers to the log file, in order, and run the
+  *         file commands queued with them, so only this task uses FatFs
+  *         while logging
+  * @param  argument not used
+  * @retval None
+  */
+static void LogWrite_Thread(void const *argument)
+{
+  osEvent evt;
+  DATALOG_File_t *f;
+  uint32_t n;
+  (void)argument;
   
-  if(f_write(&MyFile, s, size, (void *)&byteswritten) != FR_OK)
+  for(;;)
+  {
+    evt = osMessageGet(LogWriteQueueId, osWaitForever);
+    if(evt.status != osEventMessage)
+    {
+      continue;
+    }
+    
+    switch(evt.value.v)
+    {
+    case LOG_WRITE_PREPARE:
+      LogNextPending = 0;
+      LogNextReady = LogFile_Create(LogNextFile, LogFileIndex + 1);
+      break;
+      
+    case LOG_WRITE_SWITCH:
+      if(!DATALOG_File_Close(LogFile))
+      {
+        LogWriteError = 1;
+      }
+      f = LogFile;
+      LogFile = LogNextFile;
+      LogNextFile = f;
+      LogFileIndex++;
+      LogSyncBytes = 0;
+      LogSyncMs = HAL_GetTick();
+      /* The buffers queued after the switch go first, the next file is
+         created once the first one is written */
+      LogNextPending = 1;
+      break;
+      
+    case LOG_WRITE_CLOSE:
+      if(!DATALOG_File_Close(LogFile))
+      {
+        LogWriteError = 1;
+      }
+      LogNextPending = 0;
+      if(LogNextReady)
+      {
+        char file_name[DATALOG_SD_FILE_NAME_SIZE];
+        
+        LogNextReady = 0;
+        DATALOG_File_Close(LogNextFile);
+        sprintf(file_name, "%s%.3lu%s", DATALOG_SD_FILE_PREFIX, (unsigned long)(LogFileIndex + 1), DATALOG_SD_FILE_EXT);
+        f_unlink(file_name);
+      }
+      osSemaphoreRelease(LogWriteClosedId);
+      break;
+      
+    default:
+      n = LogWriteSizes[((uint8_t*)evt.value.p - LogWriter.buffers) / LogWriter.size];
+      if(!DATALOG_File_Write(LogFile, (const uint8_t*)evt.value.p, n))
+      {
+        LogWriteError = 1;
+      }
+      osSemaphoreRelease(LogWriteFreeId);
+      if(!LogFile_Sync(n))
+      {
+        LogWriteError = 1;
+      }
+      if(LogNextPending)
+      {
+        LogNextPending = 0;
+        LogNextReady = LogFile_Create(LogNextFile, LogFileIndex + 1);
+      }
+      break;
+    }
+  }
+}
+
+/**
+  * @brief  Queue the partially filled buffer and the end of the log, then
+  *         wait for LogWrite_Thread to close the file
+  * @retval 1 on success, 0 if a write failed
+  */
+static uint8_t LogWrite_Close(void)
+{
+  DATALOG_Writer_Submit(&LogWriter);
+  osMessagePut(LogWriteQueueId, LOG_WRITE_CLOSE, osWaitForever);
+  osSemaphoreWait(LogWriteClosedId, osWaitForever);
+  return !LogWriteError;
+}
+
+/**
+  * @brief  Create log file N, preallocated
+  * @param  f: log file
+  * @param  index: N
+  * @retval 1 on success, 0 if the file could not be created
+  */
+static uint8_t LogFile_Create(DATALOG_File_t *f, uint32_t index)
+{
+  char file_name[DATALOG_SD_FILE_NAME_SIZE];
+  
+  sprintf(file_name, "%s%.3lu%s", DATALOG_SD_FILE_PREFIX, (unsigned long)index, DATALOG_SD_FILE_EXT);
+  return DATALOG_File_Open(f, file_name, DATALOG_SD_PREALLOCATE);
+}
+
+/**
+  * @brief  Record the data written in the directory entry every
+  *         DATALOG_SD_SYNC_SIZE bytes or DATALOG_SD_SYNC_PERIOD_MS, which
+  *         bounds the data lost with the power. Checked after each buffer.
+  * @param  size: bytes just written
+  * @retval 1 on success, 0 on error
+  */
+static uint8_t LogFile_Sync(uint32_t size)
+{
+  uint8_t due = 0;
+  
+  LogSyncBytes += size;
+#if defined(DATALOG_SD_SYNC_SIZE)
+  due |= (LogSyncBytes >= DATALOG_SD_SYNC_SIZE);
+#endif
+#if defined(DATALOG_SD_SYNC_PERIOD_MS)
+  due |= ((HAL_GetTick() - LogSyncMs) >= DATALOG_SD_SYNC_PERIOD_MS);
+#endif
+  if(!due)
+  {
+    return 1;
+  }
+  LogSyncBytes = 0;
+  LogSyncMs = HAL_GetTick();
+  return DATALOG_File_Sync(LogFile);
+}
+
+/**
+  * @brief  Recover the last log files before index, left unclosed by a power
+  *         loss: the data after their last sync is added back and their
+  *         unused preallocated space freed. A closed log is left as is. The
+  *         last one is deleted if still empty, the next file created in
+  *         advance or a log cut before its first sync, and its N reused.
+  * @param  index: N of the next log file
+  * @retval N of the next log file
+  */
+static uint32_t LogFile_Recover(uint32_t index)
+{
+  /* Not on the stack of the calling task, FILINFO holds the long file name */
+  static FILINFO info;
+  char file_name[DATALOG_SD_FILE_NAME_SIZE];
+  FSIZE_t recovered;
+  uint32_t n;
+  
+  for(n = (index > DATALOG_SD_RECOVER_FILES) ? index - DATALOG_SD_RECOVER_FILES : 0; n < index; n++)
+  {
+    sprintf(file_name, "%s%.3lu%s", DATALOG_SD_FILE_PREFIX, (unsigned long)n, DATALOG_SD_FILE_EXT);
+    /* The write buffers are free before the log starts */
+    DATALOG_Recover(file_name, (uint8_t*)LogWriteBuffers, sizeof(LogWriteBuffers), &recovered);
+  }
+  
+  /* file_name is the last log */
+  if((index > 0) && (f_stat(file_name, &info) == FR_OK) && (info.fsize == 0) && (f_unlink(file_name) == FR_OK))
+  {
+    index--;
+  }
+  return index;
+}
+
+/**
+  * @brief  First N after the log files on the card, so a new session does
+  *         not overwrite the logs of the previous ones
+  * @retval N of the next log file
+  */
+static uint32_t LogFile_NextIndex(void)
+{
+  /* Not on the stack of the calling task, FILINFO holds the long file name */
+  static DIR dir;
+  static FILINFO info;
+  const uint32_t prefix = sizeof(DATALOG_SD_FILE_PREFIX) - 1;
+  uint32_t next = 0;
+  
+  if(f_opendir(&dir, SDPath) != FR_OK)
   {
     return 0;
   }
+  while((f_readdir(&dir, &info) == FR_OK) && (info.fname[0] != 0))
+  {
+    if(strncmp(info.fname, DATALOG_SD_FILE_PREFIX, prefix) == 0)
+    {
+      char *end;
+      uint32_t n = strtoul(&info.fname[prefix], &end, 10);
+      
+      if((end != &info.fname[prefix]) && (n >= next))
+      {
+        next = n + 1;
+      }
+    }
+  }
+  f_closedir(&dir);
+  return next;
+}
+
+/**
+  * @brief  Append a sample to the binary log, writing the block when full
+  * @param  data: sample to log
+  * @retval 1 on success, 0 if the block could not be written
+  */
+uint8_t DATALOG_SD_writeRecord(T_SensorsData *data)
+{
+#if defined(DATALOG_SD_BINARY)
+  uint32_t rec[DATALOG_RECORD_SIZE / sizeof(uint32_t)];
+  
+  DATALOG_Record_Encode(data, (uint8_t*)rec);
+  if(DATALOG_Block_Append(&LogBlock, (uint8_t*)rec))
+  {
+    uint8_t ret = DATALOG_SD_writeBuf((char*)DATALOG_Block_Seal(&LogBlock), LogBlock.size);
+    DATALOG_Index_Add(&LogIndex, LogBlock.buffer);
+    DATALOG_Block_Next(&LogBlock);
+    return ret;
+  }
   return 1;
+#else
+  (void)data;
+  return 0;
+#endif
 }
 
 
@@ -147,7 +623,8 @@ uint8_t DATALOG_SD_writeBuf(char *s, uint32_t size)
   */
 void DATALOG_SD_Log_Disable(void)
 {
-  f_close(&MyFile);
+  LogStream_End();
+  LogWrite_Close();
   
   /* SD SPI Config */
   SD_IO_CS_DeInit();
@@ -158,6 +635,62 @@ void DATALOG_SD_DeInit(void)
   FATFS_UnLinkDriver(SDPath);
 }
 
+/**
+  * @brief  Characterize the SD card, writing the report file. The write
+  *         buffers hold the test data, so the log must be stopped
+  * @param  None
+  * @retval 1 on success, 0 on error
+  */
+uint8_t DATALOG_SD_CardTest(void)
+{
+  uint8_t ret;
+  
+  SD_IO_CS_Init();
+  ret = DATALOG_CardTest_Run((const uint8_t*)LogWriteBuffers, sizeof(LogWriteBuffers), DATALOG_SD_CARDTEST_SIZE);
+  SD_IO_CS_DeInit();
+  return ret;
+}
+
+/**
+  * @brief  Serve a log download session of the host over the USB CDC port.
+  *         The write buffers hold the file data read, so the log must be
+  *         stopped
+  * @param  None
+  * @retval 1 if the host ended the session, 0 on timeout
+  */
+uint8_t DATALOG_SD_Download(void)
+{
+  static const DATALOG_DL_Link_t link = { CDC_Read, Download_Write, HAL_GetTick, Download_Wait };
+  uint8_t ret;
+  
+  SD_IO_CS_Init();
+  ret = DATALOG_Download_Session(&link, SDPath, (uint8_t*)LogWriteBuffers, sizeof(LogWriteBuffers),
+                                 DATALOG_USB_DOWNLOAD_CHUNK);
+  SD_IO_CS_DeInit();
+  return ret;
+}
+
+/**
+  * @brief  Send download frames, waiting for the host to read them
+  * @param  buf: data to send
+  * @param  size: number of bytes
+  * @retval 1 if sent, 0 if the host stopped reading
+  */
+static uint8_t Download_Write(const uint8_t *buf, uint32_t size)
+{
+  return CDC_Write(buf, size, DATALOG_DL_ACK_TIMEOUT_MS);
+}
+
+/**
+  * @brief  Let the other tasks run while the download waits for the host
+  * @param  None
+  * @retval None
+  */
+static void Download_Wait(void)
+{
+  osDelay(1);
+}
+
 /**
   * @brief  Write New Line to file
   * @param  None
@@ -165,18 +698,19 @@ void DATALOG_SD_DeInit(void)
   */
 void DATALOG_SD_NewLine(void)
 {
-  uint32_t byteswritten; /* written byte count */
-  f_write(&MyFile, (const void*)&newLine, 2, (void *)&byteswritten);
+  DATALOG_SD_writeBuf(newLine, 2);
 }
 
  
 int32_t getSensorsData( T_SensorsData *mptr)
 {
   int32_t ret = BSP_ERROR_NONE;
+  uint16_t channels = DATALOG_Record_ChannelMask();
   mptr->ms_counter = HAL_GetTick();
   
-  /* Get Data from Sensors */  
-  if ( BSP_MOTION_SENSOR_GetAxes(LSM6DSM_0, MOTION_ACCELERO, &mptr->acc ) == BSP_ERROR_COMPONENT_FAILURE )
+  /* Get Data from the sensors of the logged channels */  
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_ACC);
+  if ( (channels & DATALOG_ACC_CHANNELS) && BSP_MOTION_SENSOR_GetAxes(LSM6DSM_0, MOTION_ACCELERO, &mptr->acc ) == BSP_ERROR_COMPONENT_FAILURE )
   {
     mptr->acc.x = 0;
     mptr->acc.y = 0;
@@ -184,7 +718,8 @@ int32_t getSensorsData( T_SensorsData *mptr)
     ret = BSP_ERROR_COMPONENT_FAILURE;
   }
   
-  if ( BSP_MOTION_SENSOR_GetAxes(LSM6DSM_0, MOTION_GYRO, &mptr->gyro ) == BSP_ERROR_COMPONENT_FAILURE )
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_GYRO);
+  if ( (channels & DATALOG_GYRO_CHANNELS) && BSP_MOTION_SENSOR_GetAxes(LSM6DSM_0, MOTION_GYRO, &mptr->gyro ) == BSP_ERROR_COMPONENT_FAILURE )
   {
     mptr->gyro.x = 0;
     mptr->gyro.y = 0;
@@ -192,7 +727,8 @@ int32_t getSensorsData( T_SensorsData *mptr)
     ret = BSP_ERROR_COMPONENT_FAILURE;
   }
   
-  if ( BSP_MOTION_SENSOR_GetAxes(LSM303AGR_MAG_0, MOTION_MAGNETO, &mptr->mag ) == BSP_ERROR_COMPONENT_FAILURE )
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_MAG);
+  if ( (channels & DATALOG_MAG_CHANNELS) && BSP_MOTION_SENSOR_GetAxes(LSM303AGR_MAG_0, MOTION_MAGNETO, &mptr->mag ) == BSP_ERROR_COMPONENT_FAILURE )
   {
     mptr->mag.x = 0;
     mptr->mag.y = 0;
@@ -200,30 +736,36 @@ int32_t getSensorsData( T_SensorsData *mptr)
     ret = BSP_ERROR_COMPONENT_FAILURE;
   }
   
-  if ( BSP_ENV_SENSOR_GetValue(LPS22HB_0, ENV_PRESSURE, &mptr->pressure ) == BSP_ERROR_COMPONENT_FAILURE )
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_PRESS);
+  if ( (channels & (1u << DATALOG_CH_PRESS)) && BSP_ENV_SENSOR_GetValue(LPS22HB_0, ENV_PRESSURE, &mptr->pressure ) == BSP_ERROR_COMPONENT_FAILURE )
   {
     mptr->pressure = 0.0f;
     ret = BSP_ERROR_COMPONENT_FAILURE;
   }
 
-  if(!no_T_HTS221)
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_TEMP);
+  if(channels & (1u << DATALOG_CH_TEMP))
   {
-    if ( BSP_ENV_SENSOR_GetValue(HTS221_0, ENV_TEMPERATURE, &mptr->temperature ) == BSP_ERROR_COMPONENT_FAILURE )
+    if(!no_T_HTS221)
     {
-      mptr->temperature = 0.0f;
-      ret = BSP_ERROR_COMPONENT_FAILURE;
+      if ( BSP_ENV_SENSOR_GetValue(HTS221_0, ENV_TEMPERATURE, &mptr->temperature ) == BSP_ERROR_COMPONENT_FAILURE )
+      {
+        mptr->temperature = 0.0f;
+        ret = BSP_ERROR_COMPONENT_FAILURE;
+      }
     }
-  }
-  else
-  {
-    if ( BSP_ENV_SENSOR_GetValue(LPS22HB_0, ENV_TEMPERATURE, &mptr->temperature ) == BSP_ERROR_COMPONENT_FAILURE )
+    else
     {
-      mptr->temperature = 0.0f;
-      ret = BSP_ERROR_COMPONENT_FAILURE;
+      if ( BSP_ENV_SENSOR_GetValue(LPS22HB_0, ENV_TEMPERATURE, &mptr->temperature ) == BSP_ERROR_COMPONENT_FAILURE )
+      {
+        mptr->temperature = 0.0f;
+        ret = BSP_ERROR_COMPONENT_FAILURE;
+      }
     }
   }
   
-  if(!no_H_HTS221)
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_HUM);
+  if((channels & (1u << DATALOG_CH_HUM)) && !no_H_HTS221)
   {
     if ( BSP_ENV_SENSOR_GetValue(HTS221_0, ENV_HUMIDITY, &mptr->humidity ) == BSP_ERROR_COMPONENT_FAILURE )
     {
@@ -231,6 +773,7 @@ int32_t getSensorsData( T_SensorsData *mptr)
       ret = BSP_ERROR_COMPONENT_FAILURE;
     }
   }
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_OTHER);
   return ret;
 }
 
@@ -259,7 +802,9 @@ void floatToInt( float in, int32_t *out_int, int32_t *out_dec, int32_t dec_prec
 int32_t DoubleTap(void)
 {
   int32_t ret = 0;
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_TAP);
   BSP_MOTION_SENSOR_Get_Event_Status(LSM6DSM_0, &MotionStatus);
+  DATALOG_BUSPROF_ENTER(DATALOG_BUSPROF_OTHER);
   if (MotionStatus.DoubleTapStatus==1)
   {
     ret = 1;
@@ -306,6 +851,14 @@ void MX_DataLogTerminal_Init(void)
   BSP_ENV_SENSOR_SetOutputDataRate(LPS22HB_0, ENV_PRESSURE, LPS22HB_ODR);
             
   BSP_MOTION_SENSOR_Enable_Double_Tap_Detection(LSM6DSM_0, BSP_MOTION_SENSOR_INT2_PIN);
+
+#if defined(DATALOG_BUS_PROFILE)
+  DATALOG_BusProf_Attach();
+#endif
+#if defined(DATALOG_SD_REGISTERS)
+  /* Outside the profiler: the bus times do not include the recording */
+  DATALOG_RegRec_Attach();
+#endif
 }
 
 /**
@@ -67,10 +67,109 @@ extern "C" {
 #define TEMPERATURE_ODR 12.5f
 #define HUMIDITY_ODR 12.5f
 
+/* SD card log file format: CSV text, binary blocks (see datalog_format.h)
+   or the raw bytes read from the sensor output registers, for the replay of
+   tools/native (see datalog_regformat.h) */
+#define DATALOG_SD_CSV
+//#define DATALOG_SD_BINARY
+//#define DATALOG_SD_REGISTERS
+
+/* Binary log blocks: row layout or one column per channel, and block size in
+   bytes (multiple of 512). Columnar logs let the host read a single channel,
+   bigger blocks make that cheaper */
+#define DATALOG_SD_LAYOUT_ROW
+//#define DATALOG_SD_LAYOUT_COLUMNAR
+#define DATALOG_SD_BLOCK_SIZE  (4096)
+/* Time index written at the end of binary logs, 8 bytes of RAM per entry.
+   The index gets sparser as the log grows to always fit in these entries */
+#define DATALOG_SD_INDEX_ENTRIES  (256)
+/* The log file is preallocated contiguous with this size when the log
+   starts and the write buffers go straight to its sectors, without
+   FatFs cluster allocation or directory updates. The file is shrunk to the
+   data on close; a log outgrowing it goes on with normal FatFs writes.
+   Comment out to always write through FatFs */
+#define DATALOG_SD_PREALLOCATE_SIZE  (64UL * 1024UL * 1024UL)
+/* Log file rotation: the log goes on in the next SensorTile_Log_NXXX file
+   once the current one holds DATALOG_SD_ROTATE_SIZE bytes (below
+   DATALOG_SD_PREALLOCATE_SIZE, which also holds the end of the log) or is
+   DATALOG_SD_ROTATE_PERIOD_MS old. The next file is created and
+   preallocated in advance by the write task, once the first buffer of the
+   current one is written. Comment out both to keep one
+   file per log */
+#define DATALOG_SD_ROTATE_SIZE  (63UL * 1024UL * 1024UL)
+//#define DATALOG_SD_ROTATE_PERIOD_MS  (60UL * 60UL * 1000UL)
+/* The data written is recorded in the directory entry of the log file
+   every DATALOG_SD_SYNC_SIZE bytes or DATALOG_SD_SYNC_PERIOD_MS, at most
+   what a power loss can take; the recovery at the next log start adds
+   back the valid binary blocks or complete CSV lines written after the
+   last sync. Comment out
+   both to only record the data when the log is closed */
+#define DATALOG_SD_SYNC_SIZE       (1024UL * 1024UL)
+#define DATALOG_SD_SYNC_PERIOD_MS  (10000UL)
+/* The log data is copied into DATALOG_SD_WRITE_BUFFERS buffers of
+   DATALOG_SD_WRITE_BUFFER_SIZE bytes (multiple of 512, up to the card
+   allocation unit). A full buffer is written whole by a separate task
+   while the next one fills */
+#define DATALOG_SD_WRITE_BUFFER_SIZE  (8192)
+#define DATALOG_SD_WRITE_BUFFERS      (2)
+/* SD card characterization (DATALOG_SD_CardTest): bytes written for each
+   write size, from 512 bytes to all the write buffers. It reports the
+   throughput, the worst write latency and the allocation unit in
+   SD_Card_Report.txt. Define DATALOG_SD_CARDTEST_AT_BOOT to run it once
+   when the SD card log starts up */
+#define DATALOG_SD_CARDTEST_SIZE  (4UL * 1024UL * 1024UL)
+//#define DATALOG_SD_CARDTEST_AT_BOOT
+/* Log download over the USB CDC port in USB_Datalog mode (see
+   datalog_download.h): the host tool st_logfetch lists the SD card files
+   and reads them in CRC checked chunks of DATALOG_USB_DOWNLOAD_CHUNK bytes
+   (multiple of 4), read from the card in the write buffers. Sampling stops
+   from the request magic received to the end of the session. Define to
+   enable it, what the host sends is ignored otherwise */
+//#define DATALOG_USB_DOWNLOAD
+#define DATALOG_USB_DOWNLOAD_CHUNK  (4096)
+/* Live preview over the USB CDC port while the SD card logs
+   (SDCARD_Datalog): DATALOG_USB_PREVIEW_HZ lines per second, each one the
+   last sample of its period (DATALOG_USB_PREVIEW_DECIMATE) or the min..max
+   of each channel over the period (DATALOG_USB_PREVIEW_ENVELOPE). The write
+   task only keeps the sample or the min / max; a low priority task formats
+   and sends the lines, and a period still waiting for the USB host when the
+   next one ends is dropped. Define to enable it, the USB stays off in
+   SDCARD_Datalog mode otherwise */
+//#define DATALOG_USB_PREVIEW
+#define DATALOG_USB_PREVIEW_ENVELOPE
+//#define DATALOG_USB_PREVIEW_DECIMATE
+#define DATALOG_USB_PREVIEW_HZ  (5)
+/* Microbenchmark of the driver conversions and of the record formatting
+   (see datalog_bench.h): in USB_Datalog mode, once the sensors are set up
+   and before sampling starts, each one is timed DATALOG_BENCH_ITERATIONS
+   times with the DWT cycle counter against a RAM copy of the sensor
+   registers, and the report is sent when the host opens the CDC port.
+   Comment out for the normal firmware */
+//#define DATALOG_BENCH
+#define DATALOG_BENCH_ITERATIONS  (1000)
+/* Sensor bus profiler (see datalog_busprof.h): every register read and
+   write of the component drivers is counted by register and by BSP call
+   of getSensorsData, with its time on the bus. Every
+   DATALOG_BUS_PROFILE_SAMPLES samples the counts, per sample averages and
+   the timeline of the last sample (DATALOG_BUS_PROFILE_TRACE transactions
+   at most) are sent over the USB CDC port as "busprof:" lines. Takes about
+   9 KB of RAM; comment out for the normal firmware */
+//#define DATALOG_BUS_PROFILE
+#define DATALOG_BUS_PROFILE_SAMPLES  (500)
+#define DATALOG_BUS_PROFILE_TRACE    (32)
+/* Register recording (DATALOG_SD_REGISTERS, see datalog_regrec.h): the
+   reads of a sample are gathered in a frame of at most
+   DATALOG_SD_REGISTERS_FRAME_SIZE bytes (multiple of 4), in a ring of
+   DATALOG_SD_REGISTERS_FRAMES frames the write task empties into the log.
+   A sample finding the ring full is dropped */
+#define DATALOG_SD_REGISTERS_FRAME_SIZE  (128)
+#define DATALOG_SD_REGISTERS_FRAMES      (32)
+
 typedef enum
 {
   USB_Datalog = 0,
-  SDCARD_Datalog
+  SDCARD_Datalog,
+  USB_MassStorage
 } LogInterface_TypeDef;
 
 
@@ -93,9 +192,13 @@ void floatToInt( float in, int32_t *out_int, int32_t *out_dec, int32_t dec_prec
 void DATALOG_SD_Init(void);
 uint8_t DATALOG_SD_Log_Enable(void);
 uint8_t DATALOG_SD_writeBuf(char *s, uint32_t size);
+uint8_t DATALOG_SD_writeRecord(T_SensorsData *data);
+uint8_t DATALOG_SD_Rotate(void);
 void DATALOG_SD_Log_Disable(void);
 void DATALOG_SD_DeInit(void);
 void DATALOG_SD_NewLine(void);
+uint8_t DATALOG_SD_CardTest(void);
+uint8_t DATALOG_SD_Download(void);
 int32_t getSensorsData( T_SensorsData *mptr);
 
 void MX_X_CUBE_MEMS1_Init(void);
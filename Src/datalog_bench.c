@@ -0,0 +1,472 @@
+/**
+  ******************************************************************************
+  * @file    datalog_bench.c
+  * @brief   Microbenchmark of the hot paths of a sample: the component driver
+  *          conversions, getSensorsData, the record formatting of the write
+  *          task and floatToInt. The bus of each sensor is replaced by a RAM
+  *          copy of its registers for the run, so only the processor time of
+  *          the drivers is measured; each call is timed with the DWT cycle
+  *          counter, interrupts masked, and the cost of the measurement
+  *          itself is subtracted.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_bench.h"
+#include "datalog_record.h"
+#include "usbd_cdc_interface.h"
+#include "cmsis_os.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(DATALOG_BENCH)
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_REGS         (128)
+#define BENCH_LINE_SIZE    (128)
+/* Poll period of the CDC port until the host opens it */
+#define BENCH_WAIT_MS      (100)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Register file of a sensor behind the fake bus, and its real bus */
+typedef struct
+{
+  uint8_t Regs[BENCH_REGS];
+  uint8_t Mask;             /* address bits, without the multi-byte flags */
+  int32_t (*ReadReg)(uint16_t, uint16_t, uint8_t *, uint16_t);
+  int32_t (*WriteReg)(uint16_t, uint16_t, uint8_t *, uint16_t);
+} Bench_Bus_t;
+
+typedef enum
+{
+  BENCH_LSM6DSM = 0,
+  BENCH_LSM303AGR_MAG,
+  BENCH_HTS221,
+  BENCH_LPS22HB,
+  BENCH_BUSES
+} Bench_Device_t;
+
+typedef struct
+{
+  const char *Name;
+  void (*Call)(void);
+} Bench_Case_t;
+
+/* Private variables ---------------------------------------------------------*/
+extern void *MotionCompObj[];
+extern void *EnvCompObj[];
+
+static Bench_Bus_t BenchBus[BENCH_BUSES];
+
+/* Sample of the formatting cases, from getSensorsData */
+static T_SensorsData BenchData;
+static char BenchText[256];
+static uint8_t BenchRecord[DATALOG_RECORD_SIZE];
+static volatile float BenchFloat = -1013.2547f;
+
+/* Results go to volatile sinks, so the calls are not optimized away */
+static volatile int32_t BenchSink;
+static volatile float BenchSinkF;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Bench_Attach(Bench_Device_t Device, int32_t (**ReadReg)(uint16_t, uint16_t, uint8_t *, uint16_t),
+                         int32_t (**WriteReg)(uint16_t, uint16_t, uint8_t *, uint16_t), uint16_t Address,
+                         uint8_t Mask);
+static void Bench_Detach(Bench_Device_t Device, int32_t (**ReadReg)(uint16_t, uint16_t, uint8_t *, uint16_t),
+                         int32_t (**WriteReg)(uint16_t, uint16_t, uint8_t *, uint16_t));
+static void Bench_Measure(DATALOG_Bench_Result_t *Result, const Bench_Case_t *Case, uint32_t Overhead);
+
+static void Bench_Nop(void);
+static void Bench_AccGetAxes(void);
+static void Bench_GyroGetAxes(void);
+static void Bench_MagGetAxes(void);
+static void Bench_GetHumidity(void);
+static void Bench_GetTemperature(void);
+static void Bench_GetPressure(void);
+static void Bench_GetSensorsData(void);
+static void Bench_FormatText(void);
+static void Bench_FormatCsv(void);
+static void Bench_Encode(void);
+static void Bench_FloatToInt(void);
+
+static const Bench_Case_t BenchCases[DATALOG_BENCH_CASES] =
+{
+  {"LSM6DSM_ACC_GetAxes", Bench_AccGetAxes},
+  {"LSM6DSM_GYRO_GetAxes", Bench_GyroGetAxes},
+  {"LSM303AGR_MAG_GetAxes", Bench_MagGetAxes},
+  {"HTS221_HUM_GetHumidity", Bench_GetHumidity},
+  {"HTS221_TEMP_GetTemperature", Bench_GetTemperature},
+  {"LPS22HB_PRESS_GetPressure", Bench_GetPressure},
+  {"getSensorsData", Bench_GetSensorsData},
+  {"DATALOG_Record_FormatText", Bench_FormatText},
+  {"DATALOG_Record_FormatCsv", Bench_FormatCsv},
+  {"DATALOG_Record_Encode", Bench_Encode},
+  {"floatToInt", Bench_FloatToInt},
+};
+
+/* Fake bus ------------------------------------------------------------------*/
+
+/**
+  * @brief  Read from the register file, with address auto-increment
+  * @param  Device: sensor
+  * @param  Reg: register address, with the multi-byte flags of the driver
+  * @param  pData: bytes read
+  * @param  Length: number of bytes
+  * @retval 0
+  */
+static int32_t Bench_BusRead(Bench_Device_t Device, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  Bench_Bus_t *bus = &BenchBus[Device];
+  uint16_t i;
+
+  for(i = 0; i < Length; i++)
+  {
+    pData[i] = bus->Regs[(Reg + i) & bus->Mask];
+  }
+  return 0;
+}
+
+/**
+  * @brief  Write to the register file, with address auto-increment
+  * @param  Device: sensor
+  * @param  Reg: register address, with the multi-byte flags of the driver
+  * @param  pData: bytes written
+  * @param  Length: number of bytes
+  * @retval 0
+  */
+static int32_t Bench_BusWrite(Bench_Device_t Device, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  Bench_Bus_t *bus = &BenchBus[Device];
+  uint16_t i;
+
+  for(i = 0; i < Length; i++)
+  {
+    bus->Regs[(Reg + i) & bus->Mask] = pData[i];
+  }
+  return 0;
+}
+
+static int32_t Bench_LSM6DSM_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusRead(BENCH_LSM6DSM, Reg, pData, Length);
+}
+
+static int32_t Bench_LSM6DSM_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusWrite(BENCH_LSM6DSM, Reg, pData, Length);
+}
+
+static int32_t Bench_LSM303AGR_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusRead(BENCH_LSM303AGR_MAG, Reg, pData, Length);
+}
+
+static int32_t Bench_LSM303AGR_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusWrite(BENCH_LSM303AGR_MAG, Reg, pData, Length);
+}
+
+static int32_t Bench_HTS221_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusRead(BENCH_HTS221, Reg, pData, Length);
+}
+
+static int32_t Bench_HTS221_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusWrite(BENCH_HTS221, Reg, pData, Length);
+}
+
+static int32_t Bench_LPS22HB_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusRead(BENCH_LPS22HB, Reg, pData, Length);
+}
+
+static int32_t Bench_LPS22HB_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  (void)Addr;
+  return Bench_BusWrite(BENCH_LPS22HB, Reg, pData, Length);
+}
+
+/**
+  * @brief  Copy the registers of a sensor through its real bus, then put the
+  *         register file in its place
+  * @param  Device: sensor
+  * @param  ReadReg, WriteReg: bus functions of the component object
+  * @param  Address: bus address of the component object
+  * @param  Mask: register address bits
+  * @retval None
+  */
+static void Bench_Attach(Bench_Device_t Device, int32_t (**ReadReg)(uint16_t, uint16_t, uint8_t *, uint16_t),
+                         int32_t (**WriteReg)(uint16_t, uint16_t, uint8_t *, uint16_t), uint16_t Address,
+                         uint8_t Mask)
+{
+  static int32_t (*const read[BENCH_BUSES])(uint16_t, uint16_t, uint8_t *, uint16_t) =
+  {
+    Bench_LSM6DSM_ReadReg, Bench_LSM303AGR_ReadReg, Bench_HTS221_ReadReg, Bench_LPS22HB_ReadReg
+  };
+  static int32_t (*const write[BENCH_BUSES])(uint16_t, uint16_t, uint8_t *, uint16_t) =
+  {
+    Bench_LSM6DSM_WriteReg, Bench_LSM303AGR_WriteReg, Bench_HTS221_WriteReg, Bench_LPS22HB_WriteReg
+  };
+  Bench_Bus_t *bus = &BenchBus[Device];
+  uint16_t reg;
+
+  /* One register at a time: no multi-byte flag to set */
+  memset(bus->Regs, 0, sizeof(bus->Regs));
+  for(reg = 0; reg <= Mask; reg++)
+  {
+    (void)(*ReadReg)(Address, reg, &bus->Regs[reg], 1);
+  }
+  bus->Mask = Mask;
+  bus->ReadReg = *ReadReg;
+  bus->WriteReg = *WriteReg;
+  *ReadReg = read[Device];
+  *WriteReg = write[Device];
+}
+
+/**
+  * @brief  Give a sensor its real bus back
+  * @param  Device: sensor
+  * @param  ReadReg, WriteReg: bus functions of the component object
+  * @retval None
+  */
+static void Bench_Detach(Bench_Device_t Device, int32_t (**ReadReg)(uint16_t, uint16_t, uint8_t *, uint16_t),
+                         int32_t (**WriteReg)(uint16_t, uint16_t, uint8_t *, uint16_t))
+{
+  *ReadReg = BenchBus[Device].ReadReg;
+  *WriteReg = BenchBus[Device].WriteReg;
+}
+
+/* Cases ---------------------------------------------------------------------*/
+
+static void Bench_Nop(void)
+{
+}
+
+static void Bench_AccGetAxes(void)
+{
+  LSM6DSM_Axes_t axes;
+
+  (void)LSM6DSM_ACC_GetAxes((LSM6DSM_Object_t *)MotionCompObj[LSM6DSM_0], &axes);
+  BenchSink = axes.x;
+}
+
+static void Bench_GyroGetAxes(void)
+{
+  LSM6DSM_Axes_t axes;
+
+  (void)LSM6DSM_GYRO_GetAxes((LSM6DSM_Object_t *)MotionCompObj[LSM6DSM_0], &axes);
+  BenchSink = axes.x;
+}
+
+static void Bench_MagGetAxes(void)
+{
+  LSM303AGR_Axes_t axes;
+
+  (void)LSM303AGR_MAG_GetAxes((LSM303AGR_MAG_Object_t *)MotionCompObj[LSM303AGR_MAG_0], &axes);
+  BenchSink = axes.x;
+}
+
+static void Bench_GetHumidity(void)
+{
+  float value;
+
+  (void)HTS221_HUM_GetHumidity((HTS221_Object_t *)EnvCompObj[HTS221_0], &value);
+  BenchSinkF = value;
+}
+
+static void Bench_GetTemperature(void)
+{
+  float value;
+
+  (void)HTS221_TEMP_GetTemperature((HTS221_Object_t *)EnvCompObj[HTS221_0], &value);
+  BenchSinkF = value;
+}
+
+static void Bench_GetPressure(void)
+{
+  float value;
+
+  (void)LPS22HB_PRESS_GetPressure((LPS22HB_Object_t *)EnvCompObj[LPS22HB_0], &value);
+  BenchSinkF = value;
+}
+
+static void Bench_GetSensorsData(void)
+{
+  BenchSink = getSensorsData(&BenchData);
+}
+
+static void Bench_FormatText(void)
+{
+  BenchSink = DATALOG_Record_FormatText(&BenchData, BenchText, sizeof(BenchText));
+}
+
+static void Bench_FormatCsv(void)
+{
+  BenchSink = DATALOG_Record_FormatCsv(&BenchData, BenchText, sizeof(BenchText));
+}
+
+static void Bench_Encode(void)
+{
+  DATALOG_Record_Encode(&BenchData, BenchRecord);
+  BenchSink = BenchRecord[0];
+}
+
+static void Bench_FloatToInt(void)
+{
+  int32_t d1, d2;
+
+  floatToInt(BenchFloat, &d1, &d2, 2);
+  BenchSink = d1 + d2;
+}
+
+/**
+  * @brief  Time DATALOG_BENCH_ITERATIONS calls of a case
+  * @param  Result: timings
+  * @param  Case: function
+  * @param  Overhead: cycles of an empty call, subtracted
+  * @retval None
+  */
+static void Bench_Measure(DATALOG_Bench_Result_t *Result, const Bench_Case_t *Case, uint32_t Overhead)
+{
+  uint32_t primask;
+  uint32_t start;
+  uint32_t cycles;
+  uint32_t i;
+
+  Result->Name = Case->Name;
+  Result->Calls = 0;
+  Result->MinCycles = UINT32_MAX;
+  Result->MaxCycles = 0;
+  Result->TotalCycles = 0;
+  for(i = 0; i < DATALOG_BENCH_ITERATIONS; i++)
+  {
+    primask = __get_PRIMASK();
+    __disable_irq();
+    start = DWT->CYCCNT;
+    Case->Call();
+    cycles = DWT->CYCCNT - start;
+    __set_PRIMASK(primask);
+
+    cycles = (cycles > Overhead) ? (cycles - Overhead) : 0U;
+    Result->Calls++;
+    Result->TotalCycles += cycles;
+    if(cycles < Result->MinCycles)
+    {
+      Result->MinCycles = cycles;
+    }
+    if(cycles > Result->MaxCycles)
+    {
+      Result->MaxCycles = cycles;
+    }
+  }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Run the benchmark. The sensors must be set up
+  *         (MX_X_CUBE_MEMS1_Init) and not sampled meanwhile
+  * @param  Results: timings of each case
+  * @param  Size: capacity of Results, DATALOG_BENCH_CASES for all of them
+  * @retval Number of results
+  */
+uint32_t DATALOG_Bench_Run(DATALOG_Bench_Result_t *Results, uint32_t Size)
+{
+  static const Bench_Case_t nop = {"", Bench_Nop};
+  LSM6DSM_Object_t *lsm6dsm = (LSM6DSM_Object_t *)MotionCompObj[LSM6DSM_0];
+  LSM303AGR_MAG_Object_t *lsm303agr = (LSM303AGR_MAG_Object_t *)MotionCompObj[LSM303AGR_MAG_0];
+  HTS221_Object_t *hts221 = (HTS221_Object_t *)EnvCompObj[HTS221_0];
+  LPS22HB_Object_t *lps22hb = (LPS22HB_Object_t *)EnvCompObj[LPS22HB_0];
+  DATALOG_Bench_Result_t overhead;
+  uint32_t count = (Size < DATALOG_BENCH_CASES) ? Size : DATALOG_BENCH_CASES;
+  uint32_t i;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  /* The HTS221 keeps its multi-byte flags (bit 6 on SPI) out of the mask */
+  Bench_Attach(BENCH_LSM6DSM, &lsm6dsm->IO.ReadReg, &lsm6dsm->IO.WriteReg, lsm6dsm->IO.Address, 0x7F);
+  Bench_Attach(BENCH_LSM303AGR_MAG, &lsm303agr->IO.ReadReg, &lsm303agr->IO.WriteReg, lsm303agr->IO.Address, 0x7F);
+  Bench_Attach(BENCH_HTS221, &hts221->IO.ReadReg, &hts221->IO.WriteReg, hts221->IO.Address, 0x3F);
+  Bench_Attach(BENCH_LPS22HB, &lps22hb->IO.ReadReg, &lps22hb->IO.WriteReg, lps22hb->IO.Address, 0x7F);
+
+  (void)getSensorsData(&BenchData);
+  Bench_Measure(&overhead, &nop, 0);
+  for(i = 0; i < count; i++)
+  {
+    Bench_Measure(&Results[i], &BenchCases[i], overhead.MinCycles);
+  }
+
+  Bench_Detach(BENCH_LPS22HB, &lps22hb->IO.ReadReg, &lps22hb->IO.WriteReg);
+  Bench_Detach(BENCH_HTS221, &hts221->IO.ReadReg, &hts221->IO.WriteReg);
+  Bench_Detach(BENCH_LSM303AGR_MAG, &lsm303agr->IO.ReadReg, &lsm303agr->IO.WriteReg);
+  Bench_Detach(BENCH_LSM6DSM, &lsm6dsm->IO.ReadReg, &lsm6dsm->IO.WriteReg);
+  return count;
+}
+
+/**
+  * @brief  Report line of a case: cycles per call, and the mean in us at
+  *         the core clock
+  * @param  Result: timings
+  * @param  out: text buffer
+  * @param  size: size of the buffer
+  * @retval Length of the text, -1 if the buffer is too small
+  */
+int DATALOG_Bench_Format(const DATALOG_Bench_Result_t *Result, char *out, uint32_t size)
+{
+  uint32_t mean = (Result->Calls != 0U) ? (uint32_t)(Result->TotalCycles / Result->Calls) : 0U;
+  uint32_t ns = (uint32_t)((uint64_t)mean * 1000000000ULL / SystemCoreClock);
+  int len;
+
+  len = snprintf(out, size, "%-27s min %7lu  mean %7lu  max %7lu cycles  %5lu.%03lu us\r\n", Result->Name,
+                 (unsigned long)Result->MinCycles, (unsigned long)mean, (unsigned long)Result->MaxCycles,
+                 (unsigned long)(ns / 1000U), (unsigned long)(ns % 1000U));
+  return ((len < 0) || ((uint32_t)len >= size)) ? -1 : len;
+}
+
+/**
+  * @brief  Run the benchmark, then send the report over the USB CDC port
+  *         once the host opens it
+  * @param  None
+  * @retval None
+  */
+void DATALOG_Bench_Report(void)
+{
+  static DATALOG_Bench_Result_t results[DATALOG_BENCH_CASES];
+  char line[BENCH_LINE_SIZE];
+  uint32_t count;
+  uint32_t i;
+  int len;
+
+  count = DATALOG_Bench_Run(results, DATALOG_BENCH_CASES);
+  while(!CDC_IsOpen())
+  {
+    osDelay(BENCH_WAIT_MS);
+  }
+
+  len = snprintf(line, sizeof(line), "bench: %lu calls per function, %lu MHz\r\n",
+                 (unsigned long)DATALOG_BENCH_ITERATIONS, (unsigned long)(SystemCoreClock / 1000000U));
+  if(len > 0)
+  {
+    CDC_Fill_Buffer((uint8_t *)line, (uint32_t)len);
+  }
+  for(i = 0; i < count; i++)
+  {
+    len = DATALOG_Bench_Format(&results[i], line, sizeof(line));
+    if(len > 0)
+    {
+      CDC_Fill_Buffer((uint8_t *)line, (uint32_t)len);
+    }
+  }
+}
+
+#endif /* DATALOG_BENCH */
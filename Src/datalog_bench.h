@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    datalog_bench.h
+  * @brief   Header for datalog_bench.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_BENCH_H
+#define __DATALOG_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_application.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Timings of one benchmarked function, in DWT cycles without the
+   measurement overhead */
+typedef struct
+{
+  const char *Name;
+  uint32_t Calls;
+  uint32_t MinCycles;
+  uint32_t MaxCycles;
+  uint64_t TotalCycles;
+} DATALOG_Bench_Result_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define DATALOG_BENCH_CASES  (11)
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t DATALOG_Bench_Run(DATALOG_Bench_Result_t *Results, uint32_t Size);
+int DATALOG_Bench_Format(const DATALOG_Bench_Result_t *Result, char *out, uint32_t size);
+void DATALOG_Bench_Report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_BENCH_H */
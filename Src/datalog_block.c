@@ -0,0 +1,278 @@
+/**
+  ******************************************************************************
+  * @file    datalog_block.c
+  * @brief   This file packs sensor records into fixed size binary log blocks.
+  *          It has no hardware dependency, so the host tools build it too.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_block.h"
+#include "datalog_crc.h"
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Offset of the column of the n-th channel of the record */
+static uint32_t ColumnOffset(const DATALOG_Block_t *blk, uint32_t n)
+{
+  return DATALOG_BLOCK_HEADER_SIZE + DATALOG_COLUMN_TABLE_SIZE + n * blk->capacity * DATALOG_CHANNEL_SIZE;
+}
+
+static uint32_t RecordTimestamp(const DATALOG_Block_t *blk, uint32_t idx)
+{
+  uint32_t ms;
+
+  /* The timestamp is always the first channel */
+  if(blk->layout == DATALOG_LAYOUT_COLUMNAR)
+  {
+    memcpy(&ms, &blk->buffer[ColumnOffset(blk, 0) + idx * DATALOG_CHANNEL_SIZE], sizeof(ms));
+  }
+  else
+  {
+    memcpy(&ms, &blk->buffer[DATALOG_BLOCK_HEADER_SIZE + idx * blk->record_size], sizeof(ms));
+  }
+  return ms;
+}
+
+/* Append the CRC-32 of the block, hdr must be complete */
+static void SealCrc(DATALOG_Block_t *blk)
+{
+  uint32_t crc;
+
+  ((DATALOG_BlockHeader_t *)blk->buffer)->flags |= DATALOG_FLAG_CRC32;
+  crc = DATALOG_CRC32(blk->buffer, blk->size - DATALOG_BLOCK_TRAILER_SIZE);
+  memcpy(&blk->buffer[blk->size - DATALOG_BLOCK_TRAILER_SIZE], &crc, sizeof(crc));
+}
+
+/**
+  * @brief  Prepare an empty block
+  * @param  blk: block to initialize
+  * @param  buffer: size bytes used to store the block
+  * @param  size: block size in bytes, multiple of DATALOG_SECTOR_SIZE
+  * @param  layout: DATALOG_LAYOUT_ROW or DATALOG_LAYOUT_COLUMNAR
+  * @param  channel_mask: channels stored in a record, must include DATALOG_CH_MS
+  * @param  sequence: sequence number of the block inside the file
+  * @retval None
+  */
+void DATALOG_Block_Init(DATALOG_Block_t *blk, uint8_t *buffer, uint32_t size, uint8_t layout,
+                        uint16_t channel_mask, uint32_t sequence)
+{
+  uint32_t channel;
+
+  blk->buffer = buffer;
+  blk->size = size;
+  blk->layout = layout;
+  blk->sequence = sequence;
+  blk->count = 0;
+  blk->channel_mask = (channel_mask & DATALOG_CHANNEL_MASK_ALL) | (1u << DATALOG_CH_MS);
+  blk->channel_count = 0;
+  for(channel = 0; channel < DATALOG_CHANNEL_COUNT; channel++)
+  {
+    if(blk->channel_mask & (1u << channel))
+    {
+      blk->channel_count++;
+    }
+  }
+  blk->record_size = blk->channel_count * DATALOG_CHANNEL_SIZE;
+  blk->capacity = (layout == DATALOG_LAYOUT_COLUMNAR) ? DATALOG_COLUMN_CAPACITY(size, blk->record_size)
+                                                      : DATALOG_ROW_CAPACITY(size, blk->record_size);
+}
+
+/**
+  * @brief  Add a record to the block
+  * @param  blk: block being filled
+  * @param  rec: record_size bytes, the channels of the mask in id order
+  * @retval 1 if the block is full and must be sealed, 0 otherwise
+  */
+uint8_t DATALOG_Block_Append(DATALOG_Block_t *blk, const uint8_t *rec)
+{
+  uint32_t n;
+
+  if(blk->layout == DATALOG_LAYOUT_COLUMNAR)
+  {
+    /* Scatter the record, one word in each column */
+    for(n = 0; n < blk->channel_count; n++)
+    {
+      memcpy(&blk->buffer[ColumnOffset(blk, n) + blk->count * DATALOG_CHANNEL_SIZE],
+             rec + n * DATALOG_CHANNEL_SIZE, DATALOG_CHANNEL_SIZE);
+    }
+  }
+  else
+  {
+    memcpy(&blk->buffer[DATALOG_BLOCK_HEADER_SIZE + blk->count * blk->record_size], rec, blk->record_size);
+  }
+  blk->count++;
+
+  return (blk->count >= blk->capacity) ? 1 : 0;
+}
+
+/**
+  * @brief  Fill in the block header, clear the unused payload and append the CRC
+  * @param  blk: block to seal
+  * @retval Pointer to the blk->size bytes to be written
+  */
+uint8_t *DATALOG_Block_Seal(DATALOG_Block_t *blk)
+{
+  DATALOG_BlockHeader_t *hdr = (DATALOG_BlockHeader_t *)blk->buffer;
+  uint32_t used;
+  uint32_t channel;
+  uint32_t n;
+
+  memset(hdr, 0, DATALOG_BLOCK_HEADER_SIZE);
+  hdr->magic = DATALOG_BLOCK_MAGIC;
+  hdr->version = DATALOG_BLOCK_VERSION;
+  hdr->sequence = blk->sequence;
+  hdr->record_count = blk->count;
+  hdr->record_size = blk->record_size;
+  hdr->layout = blk->layout;
+  hdr->channel_count = blk->channel_count;
+  hdr->block_sectors = blk->size / DATALOG_SECTOR_SIZE;
+  hdr->channel_mask = blk->channel_mask;
+  if(blk->count > 0)
+  {
+    hdr->first_ms = RecordTimestamp(blk, 0);
+    hdr->last_ms = RecordTimestamp(blk, blk->count - 1);
+  }
+
+  if(blk->layout == DATALOG_LAYOUT_COLUMNAR)
+  {
+    DATALOG_ColumnTable_t *table = (DATALOG_ColumnTable_t *)&blk->buffer[DATALOG_BLOCK_HEADER_SIZE];
+
+    hdr->header_size = DATALOG_BLOCK_HEADER_SIZE + DATALOG_COLUMN_TABLE_SIZE;
+    memset(table, 0, DATALOG_COLUMN_TABLE_SIZE);
+    for(channel = 0, n = 0; channel < DATALOG_CHANNEL_COUNT; channel++)
+    {
+      if(blk->channel_mask & (1u << channel))
+      {
+        table->offset[channel] = ColumnOffset(blk, n);
+        memset(&blk->buffer[table->offset[channel] + blk->count * DATALOG_CHANNEL_SIZE], 0,
+               (blk->capacity - blk->count) * DATALOG_CHANNEL_SIZE);
+        n++;
+      }
+    }
+    used = ColumnOffset(blk, blk->channel_count);
+  }
+  else
+  {
+    hdr->header_size = DATALOG_BLOCK_HEADER_SIZE;
+    used = DATALOG_BLOCK_HEADER_SIZE + blk->count * blk->record_size;
+  }
+
+  memset(&blk->buffer[used], 0, blk->size - used);
+  SealCrc(blk);
+  return blk->buffer;
+}
+
+/**
+  * @brief  Start the next block of the file, reusing the same buffer
+  * @param  blk: block that has been sealed and written
+  * @retval None
+  */
+void DATALOG_Block_Next(DATALOG_Block_t *blk)
+{
+  blk->sequence++;
+  blk->count = 0;
+}
+
+/**
+  * @brief  Prepare an empty time index
+  * @param  idx: index to initialize
+  * @param  entries: storage for capacity entries
+  * @param  capacity: number of entries, rounded down to an even number
+  * @retval None
+  */
+void DATALOG_Index_Init(DATALOG_Index_t *idx, DATALOG_IndexEntry_t *entries, uint16_t capacity)
+{
+  idx->entries = entries;
+  idx->capacity = capacity & ~1u;
+  idx->count = 0;
+  idx->stride = 1;
+}
+
+/**
+  * @brief  Record a sealed data block in the index
+  * @param  idx: time index of the file
+  * @param  block: sealed block, before DATALOG_Block_Next reuses its buffer
+  * @retval None
+  */
+void DATALOG_Index_Add(DATALOG_Index_t *idx, const uint8_t *block)
+{
+  const DATALOG_BlockHeader_t *hdr = (const DATALOG_BlockHeader_t *)block;
+  uint16_t i;
+  uint16_t kept;
+
+  if((idx->capacity == 0) || (hdr->record_count == 0) || ((hdr->sequence & (idx->stride - 1)) != 0))
+  {
+    return;
+  }
+
+  if(idx->count >= idx->capacity)
+  {
+    /* Keep the entries on the doubled stride */
+    idx->stride <<= 1;
+    kept = 0;
+    for(i = 0; i < idx->count; i++)
+    {
+      if((idx->entries[i].block & (idx->stride - 1)) == 0)
+      {
+        idx->entries[kept++] = idx->entries[i];
+      }
+    }
+    idx->count = kept;
+    if((hdr->sequence & (idx->stride - 1)) != 0)
+    {
+      return;
+    }
+  }
+
+  idx->entries[idx->count].first_ms = hdr->first_ms;
+  idx->entries[idx->count].block = hdr->sequence;
+  idx->count++;
+}
+
+/**
+  * @brief  Fill the block buffer with an index footer block
+  * @param  idx: time index of the file
+  * @param  blk: block positioned after the last data block, its buffer is
+  *         overwritten. Call DATALOG_Block_Next after writing it.
+  * @param  first: first index entry to store in this block
+  * @retval Number of entries stored, write blocks until first reaches idx->count
+  */
+uint16_t DATALOG_Index_Seal(const DATALOG_Index_t *idx, DATALOG_Block_t *blk, uint16_t first)
+{
+  DATALOG_BlockHeader_t *hdr = (DATALOG_BlockHeader_t *)blk->buffer;
+  uint32_t count = DATALOG_INDEX_CAPACITY(blk->size);
+  uint32_t used;
+
+  if(first >= idx->count)
+  {
+    count = 0;
+  }
+  else if(count > (uint32_t)(idx->count - first))
+  {
+    count = idx->count - first;
+  }
+
+  memset(hdr, 0, DATALOG_BLOCK_HEADER_SIZE);
+  hdr->magic = DATALOG_BLOCK_MAGIC;
+  hdr->version = DATALOG_BLOCK_VERSION;
+  hdr->header_size = DATALOG_BLOCK_HEADER_SIZE;
+  hdr->sequence = blk->sequence;
+  hdr->record_count = count;
+  hdr->record_size = DATALOG_INDEX_ENTRY_SIZE;
+  hdr->layout = DATALOG_LAYOUT_INDEX;
+  hdr->block_sectors = blk->size / DATALOG_SECTOR_SIZE;
+  if(count > 0)
+  {
+    hdr->first_ms = idx->entries[first].first_ms;
+    hdr->last_ms = idx->entries[first + count - 1].first_ms;
+    memcpy(&blk->buffer[DATALOG_BLOCK_HEADER_SIZE], &idx->entries[first], count * DATALOG_INDEX_ENTRY_SIZE);
+  }
+
+  used = DATALOG_BLOCK_HEADER_SIZE + count * DATALOG_INDEX_ENTRY_SIZE;
+  memset(&blk->buffer[used], 0, blk->size - used);
+  SealCrc(blk);
+  blk->count = 0;
+  return count;
+}
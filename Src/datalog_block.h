@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file    datalog_block.h
+  * @brief   Header for datalog_block.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_BLOCK_H
+#define __DATALOG_BLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_format.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Block being filled with records. The buffer is provided by the
+  *         caller, it must be 4 byte aligned and hold a whole block.
+  */
+typedef struct
+{
+  uint8_t  *buffer;
+  uint32_t size;          /* block size in bytes, multiple of DATALOG_SECTOR_SIZE */
+  uint32_t sequence;
+  uint16_t count;
+  uint16_t capacity;      /* records that fit in the block with this layout */
+  uint8_t  layout;        /* DATALOG_LAYOUT_xxx */
+  uint8_t  channel_count;
+  uint16_t channel_mask;  /* channels of a record, DATALOG_CH_MS is mandatory */
+  uint16_t record_size;   /* channel_count * DATALOG_CHANNEL_SIZE */
+} DATALOG_Block_t;
+
+/**
+  * @brief  Sparse time index of the data blocks written so far. One entry is
+  *         kept every stride blocks; when the entries are full every other
+  *         one is dropped and the stride doubles, so any log length fits in
+  *         a fixed amount of RAM.
+  */
+typedef struct
+{
+  DATALOG_IndexEntry_t *entries;
+  uint16_t capacity;      /* even number of entries */
+  uint16_t count;
+  uint32_t stride;        /* blocks between two entries, power of 2 */
+} DATALOG_Index_t;
+
+/* Exported functions ------------------------------------------------------- */
+void DATALOG_Block_Init(DATALOG_Block_t *blk, uint8_t *buffer, uint32_t size, uint8_t layout,
+                        uint16_t channel_mask, uint32_t sequence);
+uint8_t DATALOG_Block_Append(DATALOG_Block_t *blk, const uint8_t *rec);
+uint8_t *DATALOG_Block_Seal(DATALOG_Block_t *blk);
+void DATALOG_Block_Next(DATALOG_Block_t *blk);
+
+void DATALOG_Index_Init(DATALOG_Index_t *idx, DATALOG_IndexEntry_t *entries, uint16_t capacity);
+void DATALOG_Index_Add(DATALOG_Index_t *idx, const uint8_t *block);
+uint16_t DATALOG_Index_Seal(const DATALOG_Index_t *idx, DATALOG_Block_t *blk, uint16_t first);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_BLOCK_H */
@@ -0,0 +1,447 @@
+/**
+  ******************************************************************************
+  * @file    datalog_busprof.c
+  * @brief   Sensor bus profiler. Each component object gets an interposer
+  *          on its stmdev_ctx_t: every read_reg / write_reg of the driver is
+  *          counted by register address and by call site (the BSP call of
+  *          getSensorsData in progress, see DATALOG_BUSPROF_ENTER) and
+  *          timestamped with the DWT cycle counter. All sensors are on SPI,
+  *          so each transaction is one chip select assertion and carries one
+  *          address byte before its data.
+  *          The counts of DATALOG_BUS_PROFILE_SAMPLES samples form a period:
+  *          the sampling task fills one period while the write task reports
+  *          the previous one, with the timeline of its last sample.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_busprof.h"
+#include "usbd_cdc_interface.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(DATALOG_BUS_PROFILE)
+
+/* Private define ------------------------------------------------------------*/
+#define BUSPROF_REGS       (128)
+#define BUSPROF_LINE_SIZE  (128)
+
+/* Private types -------------------------------------------------------------*/
+typedef enum
+{
+  BUSPROF_LSM6DSM = 0,
+  BUSPROF_LSM303AGR_MAG,
+  BUSPROF_HTS221,
+  BUSPROF_LPS22HB,
+  BUSPROF_DEVICES
+} BusProf_Device_t;
+
+/* Interposer of a component object: its original bus */
+typedef struct
+{
+  stmdev_ctx_t Bus;
+  uint8_t Device;
+} BusProf_Ctx_t;
+
+typedef struct
+{
+  uint32_t Calls;           /* BSP calls that used the bus */
+  uint32_t Reads;
+  uint32_t Writes;
+  uint32_t Bytes;           /* with the address bytes */
+  uint64_t Cycles;          /* time in the bus functions */
+} BusProf_Site_t;
+
+typedef struct
+{
+  uint16_t Reads;
+  uint16_t Writes;
+  uint32_t Bytes;
+} BusProf_Reg_t;
+
+typedef struct
+{
+  uint32_t Start;           /* DWT cycles */
+  uint32_t Cycles;
+  uint16_t Length;
+  uint8_t Device;
+  uint8_t Reg;
+  uint8_t Write;
+  uint8_t Site;
+} BusProf_Trace_t;
+
+typedef struct
+{
+  BusProf_Site_t Sites[DATALOG_BUSPROF_SITES];
+  BusProf_Reg_t Regs[BUSPROF_DEVICES][BUSPROF_REGS];
+  BusProf_Trace_t Trace[DATALOG_BUS_PROFILE_TRACE];
+  uint32_t TraceCount;      /* transactions since the last sample, may exceed the trace */
+  uint32_t Samples;
+  uint32_t StartMs;
+  uint32_t EndMs;
+} BusProf_Period_t;
+
+/* Private variables ---------------------------------------------------------*/
+extern void *MotionCompObj[];
+extern void *EnvCompObj[];
+
+static BusProf_Ctx_t BusProfCtx[BUSPROF_DEVICES];
+
+/* One period fills while the write task reports the other one */
+static BusProf_Period_t Periods[2];
+static uint8_t Fill;
+static volatile uint8_t Pending;
+
+static uint8_t CurrentSite = DATALOG_BUSPROF_OTHER;
+static uint8_t SiteUsed;
+
+static const char *const BusProfDevice[BUSPROF_DEVICES] = {"lsm6dsm", "lsm303agr", "hts221", "lps22hb"};
+static const char *const BusProfSite[DATALOG_BUSPROF_SITES] =
+{
+  "other", "acc", "gyro", "mag", "press", "temp", "hum", "tap"
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static int32_t BusProf_Read(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
+static int32_t BusProf_Write(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
+static void BusProf_Count(const BusProf_Ctx_t *ctx, uint8_t Reg, uint16_t Length, uint8_t Write, uint32_t Start);
+static void BusProf_Interpose(BusProf_Device_t Device, stmdev_ctx_t *Ctx);
+static void BusProf_Reset(BusProf_Period_t *p);
+static uint32_t BusProf_Us(uint64_t Cycles);
+static void BusProf_CdcPrint(void *Context, const char *line, uint32_t size);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Put the interposer on the bus of each sensor found. The sensors
+  *         must be set up: their initialization is not counted
+  * @param  None
+  * @retval None
+  */
+void DATALOG_BusProf_Attach(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  BusProf_Reset(&Periods[Fill]);
+  if(MotionCompObj[LSM6DSM_0] != NULL)
+  {
+    BusProf_Interpose(BUSPROF_LSM6DSM, &((LSM6DSM_Object_t *)MotionCompObj[LSM6DSM_0])->Ctx);
+  }
+  if(MotionCompObj[LSM303AGR_MAG_0] != NULL)
+  {
+    BusProf_Interpose(BUSPROF_LSM303AGR_MAG, &((LSM303AGR_MAG_Object_t *)MotionCompObj[LSM303AGR_MAG_0])->Ctx);
+  }
+  if(EnvCompObj[HTS221_0] != NULL)
+  {
+    BusProf_Interpose(BUSPROF_HTS221, &((HTS221_Object_t *)EnvCompObj[HTS221_0])->Ctx);
+  }
+  if(EnvCompObj[LPS22HB_0] != NULL)
+  {
+    BusProf_Interpose(BUSPROF_LPS22HB, &((LPS22HB_Object_t *)EnvCompObj[LPS22HB_0])->Ctx);
+  }
+}
+
+/**
+  * @brief  Charge the next transactions to a call site
+  * @param  Site: call site, DATALOG_BUSPROF_OTHER once the call returned
+  * @retval None
+  */
+void DATALOG_BusProf_Enter(DATALOG_BusProf_Site_t Site)
+{
+  CurrentSite = (uint8_t)Site;
+  SiteUsed = 0;
+}
+
+/**
+  * @brief  End of a logged sample, from the sampling task. Hands the period
+  *         over when it has DATALOG_BUS_PROFILE_SAMPLES samples, unless the
+  *         previous one is still being reported: its counts then go on.
+  * @param  None
+  * @retval 1 if a period is ready for DATALOG_BusProf_Report, 0 otherwise
+  */
+uint8_t DATALOG_BusProf_Sample(void)
+{
+  BusProf_Period_t *p = &Periods[Fill];
+
+  p->Samples++;
+  if((p->Samples < DATALOG_BUS_PROFILE_SAMPLES) || Pending)
+  {
+    /* The trace keeps the transactions of the last sample */
+    p->TraceCount = 0;
+    return 0;
+  }
+
+  p->EndMs = HAL_GetTick();
+  Pending = 1;
+  Fill ^= 1;
+  BusProf_Reset(&Periods[Fill]);
+  return 1;
+}
+
+/**
+  * @brief  Report the period handed over by DATALOG_BusProf_Sample and free
+  *         it. With none, the current counts are reported as they are (end
+  *         of a run, no sampling)
+  * @param  Print: output of the lines
+  * @param  Context: passed to Print
+  * @retval None
+  */
+void DATALOG_BusProf_Report(DATALOG_BusProf_Print_t Print, void *Context)
+{
+  const BusProf_Period_t *p = Pending ? &Periods[Fill ^ 1] : &Periods[Fill];
+  uint32_t endMs = Pending ? p->EndMs : HAL_GetTick();
+  uint32_t samples = (p->Samples != 0U) ? p->Samples : 1U;
+  uint32_t transactions = 0;
+  uint32_t bytes = 0;
+  uint64_t cycles = 0;
+  uint32_t first;
+  uint32_t count;
+  char line[BUSPROF_LINE_SIZE];
+  uint32_t i;
+  uint32_t reg;
+  int len;
+
+  for(i = 0; i < DATALOG_BUSPROF_SITES; i++)
+  {
+    transactions += p->Sites[i].Reads + p->Sites[i].Writes;
+    bytes += p->Sites[i].Bytes;
+    cycles += p->Sites[i].Cycles;
+  }
+
+  len = snprintf(line, sizeof(line), "busprof: %lu samples in %lu ms, %lu transactions, %lu bytes, %lu us on the bus\r\n",
+                 (unsigned long)p->Samples, (unsigned long)(endMs - p->StartMs), (unsigned long)transactions,
+                 (unsigned long)bytes, (unsigned long)BusProf_Us(cycles));
+  if(len > 0)
+  {
+    Print(Context, line, (uint32_t)len);
+  }
+  len = snprintf(line, sizeof(line), "busprof: per sample %lu.%02lu transactions (CS), %lu.%02lu bytes, %lu us\r\n",
+                 (unsigned long)(transactions / samples), (unsigned long)((transactions % samples) * 100U / samples),
+                 (unsigned long)(bytes / samples), (unsigned long)((bytes % samples) * 100U / samples),
+                 (unsigned long)BusProf_Us(cycles / samples));
+  if(len > 0)
+  {
+    Print(Context, line, (uint32_t)len);
+  }
+
+  /* Call sites */
+  for(i = 0; i < DATALOG_BUSPROF_SITES; i++)
+  {
+    const BusProf_Site_t *s = &p->Sites[i];
+
+    if(s->Calls == 0U)
+    {
+      continue;
+    }
+    len = snprintf(line, sizeof(line), "busprof: site %-5s %7lu calls %7lu reads %7lu writes %8lu bytes %8lu us\r\n",
+                   BusProfSite[i], (unsigned long)s->Calls, (unsigned long)s->Reads, (unsigned long)s->Writes,
+                   (unsigned long)s->Bytes, (unsigned long)BusProf_Us(s->Cycles));
+    if(len > 0)
+    {
+      Print(Context, line, (uint32_t)len);
+    }
+  }
+
+  /* Registers */
+  for(i = 0; i < BUSPROF_DEVICES; i++)
+  {
+    for(reg = 0; reg < BUSPROF_REGS; reg++)
+    {
+      const BusProf_Reg_t *r = &p->Regs[i][reg];
+
+      if((r->Reads == 0U) && (r->Writes == 0U))
+      {
+        continue;
+      }
+      len = snprintf(line, sizeof(line), "busprof: reg %-9s 0x%02lX %7lu reads %7lu writes %8lu bytes\r\n",
+                     BusProfDevice[i], (unsigned long)reg, (unsigned long)r->Reads, (unsigned long)r->Writes,
+                     (unsigned long)r->Bytes);
+      if(len > 0)
+      {
+        Print(Context, line, (uint32_t)len);
+      }
+    }
+  }
+
+  /* Timeline of the last sample */
+  count = (p->TraceCount < DATALOG_BUS_PROFILE_TRACE) ? p->TraceCount : DATALOG_BUS_PROFILE_TRACE;
+  first = (count != 0U) ? p->Trace[0].Start : 0U;
+  for(i = 0; i < count; i++)
+  {
+    const BusProf_Trace_t *t = &p->Trace[i];
+
+    len = snprintf(line, sizeof(line), "busprof: at %6lu us %-9s %s 0x%02X %3u bytes %5lu us %s\r\n",
+                   (unsigned long)BusProf_Us(t->Start - first), BusProfDevice[t->Device], t->Write ? "w" : "r",
+                   t->Reg, t->Length, (unsigned long)BusProf_Us(t->Cycles), BusProfSite[t->Site]);
+    if(len > 0)
+    {
+      Print(Context, line, (uint32_t)len);
+    }
+  }
+
+  Pending = 0;
+}
+
+/**
+  * @brief  Report the period handed over over the USB CDC port, if a host
+  *         has it open, from the write task
+  * @param  None
+  * @retval None
+  */
+void DATALOG_BusProf_Send(void)
+{
+  DATALOG_BusProf_Report(BusProf_CdcPrint, NULL);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Interposed read_reg
+  * @param  Handle: interposer of the component object
+  * @param  Reg: register address
+  * @param  pData: bytes read
+  * @param  Length: number of bytes
+  * @retval Result of the original bus function
+  */
+static int32_t BusProf_Read(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length)
+{
+  const BusProf_Ctx_t *ctx = (const BusProf_Ctx_t *)Handle;
+  uint32_t start = DWT->CYCCNT;
+  int32_t ret;
+
+  ret = ctx->Bus.read_reg(ctx->Bus.handle, Reg, pData, Length);
+  BusProf_Count(ctx, Reg, Length, 0, start);
+  return ret;
+}
+
+/**
+  * @brief  Interposed write_reg
+  * @param  Handle: interposer of the component object
+  * @param  Reg: register address
+  * @param  pData: bytes written
+  * @param  Length: number of bytes
+  * @retval Result of the original bus function
+  */
+static int32_t BusProf_Write(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length)
+{
+  const BusProf_Ctx_t *ctx = (const BusProf_Ctx_t *)Handle;
+  uint32_t start = DWT->CYCCNT;
+  int32_t ret;
+
+  ret = ctx->Bus.write_reg(ctx->Bus.handle, Reg, pData, Length);
+  BusProf_Count(ctx, Reg, Length, 1, start);
+  return ret;
+}
+
+/**
+  * @brief  Count a transaction in the period filled
+  * @param  ctx: interposer
+  * @param  Reg: register address
+  * @param  Length: number of data bytes
+  * @param  Write: 1 for a write
+  * @param  Start: DWT cycles when it started
+  * @retval None
+  */
+static void BusProf_Count(const BusProf_Ctx_t *ctx, uint8_t Reg, uint16_t Length, uint8_t Write, uint32_t Start)
+{
+  BusProf_Period_t *p = &Periods[Fill];
+  BusProf_Site_t *s = &p->Sites[CurrentSite];
+  BusProf_Reg_t *r = &p->Regs[ctx->Device][Reg & (BUSPROF_REGS - 1)];
+  uint32_t cycles = DWT->CYCCNT - Start;
+  BusProf_Trace_t *t;
+
+  if(!SiteUsed)
+  {
+    SiteUsed = 1;
+    s->Calls++;
+  }
+  if(Write)
+  {
+    s->Writes++;
+    r->Writes++;
+  }
+  else
+  {
+    s->Reads++;
+    r->Reads++;
+  }
+  s->Bytes += Length + 1U;
+  s->Cycles += cycles;
+  r->Bytes += Length + 1U;
+
+  if(p->TraceCount < DATALOG_BUS_PROFILE_TRACE)
+  {
+    t = &p->Trace[p->TraceCount];
+    t->Start = Start;
+    t->Cycles = cycles;
+    t->Length = Length;
+    t->Device = ctx->Device;
+    t->Reg = Reg;
+    t->Write = Write;
+    t->Site = CurrentSite;
+  }
+  p->TraceCount++;
+}
+
+/**
+  * @brief  Route the bus of a component object through the interposer
+  * @param  Device: sensor
+  * @param  Ctx: bus of the component object
+  * @retval None
+  */
+static void BusProf_Interpose(BusProf_Device_t Device, stmdev_ctx_t *Ctx)
+{
+  BusProf_Ctx_t *ctx = &BusProfCtx[Device];
+
+  /* Already attached */
+  if(Ctx->read_reg == BusProf_Read)
+  {
+    return;
+  }
+  ctx->Bus = *Ctx;
+  ctx->Device = (uint8_t)Device;
+  Ctx->read_reg = BusProf_Read;
+  Ctx->write_reg = BusProf_Write;
+  Ctx->handle = ctx;
+}
+
+/**
+  * @brief  Empty a period, starting now
+  * @param  p: period
+  * @retval None
+  */
+static void BusProf_Reset(BusProf_Period_t *p)
+{
+  memset(p, 0, sizeof(*p));
+  p->StartMs = HAL_GetTick();
+  SiteUsed = 0;
+}
+
+/**
+  * @brief  DWT cycles in us at the core clock
+  * @param  Cycles: cycles
+  * @retval us
+  */
+static uint32_t BusProf_Us(uint64_t Cycles)
+{
+  return (uint32_t)(Cycles * 1000000ULL / SystemCoreClock);
+}
+
+/**
+  * @brief  Report line to the USB CDC port
+  * @param  Context: not used
+  * @param  line: text
+  * @param  size: length of the text
+  * @retval None
+  */
+static void BusProf_CdcPrint(void *Context, const char *line, uint32_t size)
+{
+  (void)Context;
+  if(CDC_IsOpen())
+  {
+    CDC_Fill_Buffer((uint8_t *)line, size);
+  }
+}
+
+#endif /* DATALOG_BUS_PROFILE */
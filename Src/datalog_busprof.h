@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file    datalog_busprof.h
+  * @brief   Header for datalog_busprof.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_BUSPROF_H
+#define __DATALOG_BUSPROF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_application.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Call sites the bus transactions are charged to: the BSP calls of a sample
+   in getSensorsData, the double tap poll, and everything else */
+typedef enum
+{
+  DATALOG_BUSPROF_OTHER = 0,
+  DATALOG_BUSPROF_ACC,
+  DATALOG_BUSPROF_GYRO,
+  DATALOG_BUSPROF_MAG,
+  DATALOG_BUSPROF_PRESS,
+  DATALOG_BUSPROF_TEMP,
+  DATALOG_BUSPROF_HUM,
+  DATALOG_BUSPROF_TAP,
+  DATALOG_BUSPROF_SITES
+} DATALOG_BusProf_Site_t;
+
+/* Output of a report line */
+typedef void (*DATALOG_BusProf_Print_t)(void *Context, const char *line, uint32_t size);
+
+/* Exported macro ------------------------------------------------------------*/
+#if defined(DATALOG_BUS_PROFILE)
+#define DATALOG_BUSPROF_ENTER(site)  DATALOG_BusProf_Enter(site)
+#else
+#define DATALOG_BUSPROF_ENTER(site)  do { } while(0)
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+void DATALOG_BusProf_Attach(void);
+void DATALOG_BusProf_Enter(DATALOG_BusProf_Site_t Site);
+uint8_t DATALOG_BusProf_Sample(void);
+void DATALOG_BusProf_Report(DATALOG_BusProf_Print_t Print, void *Context);
+void DATALOG_BusProf_Send(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_BUSPROF_H */
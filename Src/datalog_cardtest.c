@@ -0,0 +1,240 @@
+/**
+  ******************************************************************************
+  * @file    datalog_cardtest.c
+  * @brief   This file characterizes the SD card: it writes a scratch file
+  *          with the log write path for increasing write sizes and reports
+  *          the sustained throughput, the worst write latency and the
+  *          spacing of the long busy stalls, which gives the card allocation
+  *          unit. The report is written to DATALOG_CARDTEST_REPORT.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_cardtest.h"
+#include "datalog_file.h"
+#include "SensorTile_sd.h"
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+/* A write is a stall when it takes this many times the average write, and
+   at least DATALOG_CARDTEST_STALL_MIN_US */
+#define DATALOG_CARDTEST_STALL_FACTOR   4U
+#define DATALOG_CARDTEST_STALL_MIN_US   1000U
+#define DATALOG_CARDTEST_MAX_PASSES     8U
+#define DATALOG_CARDTEST_LINE_SIZE      96U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t size;          /* bytes per write */
+  uint32_t kbps;          /* sustained throughput, kB/s */
+  uint32_t worst_us;      /* longest write */
+  uint32_t stalls;
+  uint32_t stall_period;  /* average bytes between two stalls, 0 without stalls */
+} CardTest_Pass_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* Not on the stack of the calling task, FIL holds a sector buffer */
+static CardTest_Pass_t CardTestPasses[DATALOG_CARDTEST_MAX_PASSES];
+static SD_WriteStats CardTestStats;
+static DATALOG_File_t CardTestFile;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t CardTest_Pass(CardTest_Pass_t *pass, SD_WriteStats *stats, const uint8_t *buffer,
+                             uint32_t test_size);
+static uint8_t CardTest_Report(const CardTest_Pass_t *passes, uint32_t count, const SD_WriteStats *stats);
+static uint8_t CardTest_Print(FIL *file, char *line, int size);
+
+/**
+  * @brief  Characterize the card with writes of 512 bytes up to buffer_size
+  *         (doubling), each pass writing test_size bytes of a contiguous
+  *         scratch file, deleted afterwards. The card must be mounted and
+  *         the log stopped.
+  * @param  buffer: data written, 4 byte aligned
+  * @param  buffer_size: largest write size, multiple of 512
+  * @param  test_size: bytes written by each pass, multiple of buffer_size
+  * @retval 1 if the report was written, 0 on error
+  */
+uint8_t DATALOG_CardTest_Run(const uint8_t *buffer, uint32_t buffer_size, uint32_t test_size)
+{
+  uint32_t count = 0;
+  uint32_t size;
+
+  for(size = 512; (size <= buffer_size) && (count < DATALOG_CARDTEST_MAX_PASSES); size *= 2)
+  {
+    CardTestPasses[count].size = size;
+    if(!CardTest_Pass(&CardTestPasses[count], &CardTestStats, buffer, test_size))
+    {
+      f_unlink(DATALOG_CARDTEST_SCRATCH);
+      return 0;
+    }
+    count++;
+  }
+
+  if(count == 0)
+  {
+    return 0;
+  }
+  /* Histogram of the largest writes, the ones the log uses */
+  return CardTest_Report(CardTestPasses, count, &CardTestStats);
+}
+
+/**
+  * @brief  Write test_size bytes to a new scratch file, pass->size at a time
+  * @param  pass: write size in, results out
+  * @param  stats: latencies of the writes
+  * @param  buffer: data written
+  * @param  test_size: bytes to write
+  * @retval 1 on success, 0 if the scratch file could not be written
+  */
+static uint8_t CardTest_Pass(CardTest_Pass_t *pass, SD_WriteStats *stats, const uint8_t *buffer,
+                             uint32_t test_size)
+{
+  DATALOG_File_t *file = &CardTestFile;
+  uint32_t offset;
+  uint32_t last_stall = 0;
+  uint32_t spacing = 0;
+  uint32_t ms;
+
+  /* Preallocated, so each write is one command to contiguous sectors */
+  if(!DATALOG_File_Open(file, DATALOG_CARDTEST_SCRATCH, test_size))
+  {
+    return 0;
+  }
+  if(!file->expanded)
+  {
+    DATALOG_File_Close(file);
+    return 0;
+  }
+
+  pass->worst_us = 0;
+  pass->stalls = 0;
+  BSP_SD_ResetWriteStats();
+  ms = HAL_GetTick();
+  for(offset = 0; offset < test_size; offset += pass->size)
+  {
+    if(!DATALOG_File_Write(file, buffer, pass->size))
+    {
+      DATALOG_File_Close(file);
+      return 0;
+    }
+
+    BSP_SD_GetWriteStats(stats);
+    if((stats->Total.Count > 1) && (stats->LastUs >= DATALOG_CARDTEST_STALL_MIN_US) &&
+       ((uint64_t)stats->LastUs * (stats->Total.Count - 1) >
+        (uint64_t)DATALOG_CARDTEST_STALL_FACTOR * (stats->Total.TotalUs - stats->LastUs)))
+    {
+      if(pass->stalls > 0)
+      {
+        spacing += offset - last_stall;
+      }
+      last_stall = offset;
+      pass->stalls++;
+    }
+    if(stats->LastUs > pass->worst_us)
+    {
+      pass->worst_us = stats->LastUs;
+    }
+  }
+  ms = HAL_GetTick() - ms;
+
+  DATALOG_File_Close(file);
+  if(f_unlink(DATALOG_CARDTEST_SCRATCH) != FR_OK)
+  {
+    return 0;
+  }
+
+  pass->kbps = test_size / (ms > 0 ? ms : 1);
+  pass->stall_period = (pass->stalls > 1) ? spacing / (pass->stalls - 1) : 0;
+  return 1;
+}
+
+/**
+  * @brief  Write the report file
+  * @param  passes: results of each write size
+  * @param  count: number of passes
+  * @param  stats: latencies of the last pass
+  * @retval 1 on success, 0 on error
+  */
+static uint8_t CardTest_Report(const CardTest_Pass_t *passes, uint32_t count, const SD_WriteStats *stats)
+{
+  FIL *file = &CardTestFile.file;
+  SD_CardInfo info;
+  char line[DATALOG_CARDTEST_LINE_SIZE];
+  uint8_t ret = 1;
+  uint32_t au = 0;
+  uint32_t i;
+
+  if(f_open(file, DATALOG_CARDTEST_REPORT, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+  {
+    return 0;
+  }
+
+  for(i = 0; i < count; i++)
+  {
+    ret &= CardTest_Print(file, line, snprintf(line, sizeof(line),
+                          "write %6lu B: %3lu.%03lu MB/s, worst %7lu us, %4lu stalls, every %7lu KiB\r\n",
+                          (unsigned long)passes[i].size, (unsigned long)(passes[i].kbps / 1000),
+                          (unsigned long)(passes[i].kbps % 1000), (unsigned long)passes[i].worst_us,
+                          (unsigned long)passes[i].stalls, (unsigned long)(passes[i].stall_period / 1024)));
+  }
+
+  /* Geometry reported by the card registers, to compare with the estimate */
+  if(BSP_SD_GetCardInfo(&info) == MSD_OK)
+  {
+    ret &= CardTest_Print(file, line, snprintf(line, sizeof(line),
+                          "card allocation unit: %lu KiB (0: not reported), erase sector: %lu KiB\r\n",
+                          (unsigned long)(info.AUBlockNbr / 2), (unsigned long)(info.EraseBlockNbr / 2)));
+  }
+
+  /* The card reorganizes its flash about once per allocation unit written */
+  if(passes[count - 1].stall_period > 0)
+  {
+    au = 512;
+    while(au < passes[count - 1].stall_period)
+    {
+      au *= 2;
+    }
+    ret &= CardTest_Print(file, line, snprintf(line, sizeof(line),
+                          "estimated allocation unit: %lu KiB\r\n", (unsigned long)(au / 1024)));
+  }
+
+  ret &= CardTest_Print(file, line, snprintf(line, sizeof(line),
+                        "latency of the %lu B writes (us): response busy total\r\n",
+                        (unsigned long)passes[count - 1].size));
+  for(i = 0; i < SD_LATENCY_BUCKETS; i++)
+  {
+    if(stats->Total.Hist[i] + stats->Busy.Hist[i] + stats->Response.Hist[i] == 0)
+    {
+      continue;
+    }
+    ret &= CardTest_Print(file, line, snprintf(line, sizeof(line), "%8lu..%8lu: %6lu %6lu %6lu\r\n",
+                          (i == 0) ? 0UL : (1UL << i), (2UL << i) - 1,
+                          (unsigned long)stats->Response.Hist[i], (unsigned long)stats->Busy.Hist[i],
+                          (unsigned long)stats->Total.Hist[i]));
+  }
+
+  if(f_close(file) != FR_OK)
+  {
+    ret = 0;
+  }
+  return ret;
+}
+
+/**
+  * @brief  Append a formatted line to the report
+  * @param  file: report file
+  * @param  line: text, DATALOG_CARDTEST_LINE_SIZE bytes
+  * @param  size: snprintf result
+  * @retval 1 on success, 0 on error
+  */
+static uint8_t CardTest_Print(FIL *file, char *line, int size)
+{
+  UINT written;
+
+  if((size < 0) || ((uint32_t)size >= DATALOG_CARDTEST_LINE_SIZE))
+  {
+    return 0;
+  }
+  return (f_write(file, line, (UINT)size, &written) == FR_OK) && (written == (UINT)size);
+}
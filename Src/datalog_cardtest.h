@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file    datalog_cardtest.h
+  * @brief   Header for datalog_cardtest.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_CARDTEST_H
+#define __DATALOG_CARDTEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DATALOG_CARDTEST_SCRATCH  "SD_Test.tmp"
+#define DATALOG_CARDTEST_REPORT   "SD_Card_Report.txt"
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t DATALOG_CardTest_Run(const uint8_t *buffer, uint32_t buffer_size, uint32_t test_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_CARDTEST_H */
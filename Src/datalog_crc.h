@@ -0,0 +1,27 @@
+/**
+  ******************************************************************************
+  * @file    datalog_crc.h
+  * @brief   Header for datalog_crc.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_CRC_H
+#define __DATALOG_CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions ------------------------------------------------------- */
+void DATALOG_CRC_Init(void);
+uint32_t DATALOG_CRC32(const uint8_t *data, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_CRC_H */
@@ -0,0 +1,353 @@
+/**
+  ******************************************************************************
+  * @file    datalog_download.c
+  * @brief   This file serves the log download requests of a host over a
+  *          serial link (see datalog_download.h): the listing of the log
+  *          directory and the CRC checked chunks of a file, read from the
+  *          card several chunks at a time. It only uses FatFs and the link
+  *          callbacks, so the host tools run it on a card image behind a
+  *          pseudo terminal too.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_download.h"
+#include "datalog_crc.h"
+#include "ff.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define DOWNLOAD_PATH_SIZE  (8U + _MAX_LFN + 1U)
+
+/* Private variables ---------------------------------------------------------*/
+static const DATALOG_DL_Link_t *Link;
+/* Not on the stack of the calling task, FIL holds a sector buffer and
+   FILINFO the long file name */
+static FIL DownloadFile;
+static DIR DownloadDir;
+static FILINFO DownloadInfo;
+static char DownloadPath[DOWNLOAD_PATH_SIZE];
+/* File name sent in an ENTRY frame, word aligned and zero padded for the CRC */
+static uint32_t DownloadName[(_MAX_LFN + 4U) / 4U];
+/* Request being received, frame header sent */
+static DATALOG_DL_Header_t DownloadRx;
+static uint32_t DownloadRxSize;
+static DATALOG_DL_Header_t DownloadTx;
+/* Request that stopped a READ, served next */
+static DATALOG_DL_Header_t DownloadPending;
+static uint8_t DownloadPendingValid;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t Download_Receive(DATALOG_DL_Header_t *req);
+static uint8_t Download_Send(uint8_t type, uint32_t file, uint32_t arg, uint32_t count, const uint8_t *data,
+                             uint32_t size);
+static FRESULT Download_Find(const char *dir, uint32_t file);
+static uint8_t Download_List(const char *dir, uint32_t chunk_size);
+static uint8_t Download_Read(const char *dir, const DATALOG_DL_Header_t *req, uint8_t *buffer,
+                             uint32_t buffer_size, uint32_t chunk_size);
+
+/**
+  * @brief  Serve the requests of the host until it ends the session or
+  *         sends nothing for DATALOG_DL_IDLE_MS. The log must be stopped.
+  * @param  link: serial link to the host
+  * @param  dir: directory of the log files ending with '/', e.g. the
+  *         FatFs drive path
+  * @param  buffer: file data read, 4 byte aligned
+  * @param  buffer_size: size of buffer, a multiple of chunk_size; the chunks
+  *         it holds are read from the card at once
+  * @param  chunk_size: payload bytes of a CHUNK frame, a multiple of 4
+  * @retval 1 if the host ended the session, 0 on timeout
+  */
+uint8_t DATALOG_Download_Session(const DATALOG_DL_Link_t *link, const char *dir, uint8_t *buffer,
+                                 uint32_t buffer_size, uint32_t chunk_size)
+{
+  DATALOG_DL_Header_t req;
+  uint32_t ms;
+
+  if((chunk_size == 0U) || ((chunk_size % 4U) != 0U) || (chunk_size > DATALOG_DL_PAYLOAD_MAX) ||
+     (buffer_size < chunk_size) || (strlen(dir) > 8U))
+  {
+    return 0;
+  }
+  Link = link;
+  DownloadRxSize = 0;
+  DownloadPendingValid = 0;
+  ms = link->GetTick();
+
+  for(;;)
+  {
+    if(!Download_Receive(&req))
+    {
+      if(link->GetTick() - ms >= DATALOG_DL_IDLE_MS)
+      {
+        return 0;
+      }
+      link->Wait();
+      continue;
+    }
+
+    switch(req.type)
+    {
+    case DATALOG_DL_REQ_LIST:
+      Download_List(dir, chunk_size);
+      break;
+
+    case DATALOG_DL_REQ_READ:
+      Download_Read(dir, &req, buffer, buffer_size - (buffer_size % chunk_size), chunk_size);
+      break;
+
+    case DATALOG_DL_REQ_END:
+      return 1;
+
+    default:
+      /* ACK of a READ already over */
+      break;
+    }
+    ms = link->GetTick();
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Get the next request: the bytes received are scanned for a
+  *         header with the magic and a valid CRC, skipping anything else
+  * @param  req: request received
+  * @retval 1 if a request was received, 0 if none is complete yet
+  */
+static uint8_t Download_Receive(DATALOG_DL_Header_t *req)
+{
+  uint8_t *rx = (uint8_t*)&DownloadRx;
+
+  if(DownloadPendingValid)
+  {
+    *req = DownloadPending;
+    DownloadPendingValid = 0;
+    return 1;
+  }
+
+  for(;;)
+  {
+    if(DownloadRxSize < DATALOG_DL_HEADER_SIZE)
+    {
+      uint32_t n = Link->Read(&rx[DownloadRxSize], DATALOG_DL_HEADER_SIZE - DownloadRxSize);
+
+      if(n == 0U)
+      {
+        return 0;
+      }
+      DownloadRxSize += n;
+      continue;
+    }
+
+    if((DownloadRx.magic == DATALOG_DL_MAGIC) && (DownloadRx.size == 0U) &&
+       (DownloadRx.crc == DATALOG_CRC32(rx, DATALOG_DL_HEADER_CRC_SIZE)))
+    {
+      *req = DownloadRx;
+      DownloadRxSize = 0;
+      return 1;
+    }
+    /* Not a request: resynchronize one byte further */
+    DownloadRxSize--;
+    memmove(rx, &rx[1], DownloadRxSize);
+  }
+}
+
+/**
+  * @brief  Send a frame
+  * @param  type: DATALOG_DL_FRM_x
+  * @param  file, arg, count: header fields
+  * @param  data: payload, 4 byte aligned and zero padded to a multiple of
+  *         4 bytes for the CRC
+  * @param  size: payload bytes
+  * @retval 1 if the frame was sent, 0 if the host stopped reading
+  */
+static uint8_t Download_Send(uint8_t type, uint32_t file, uint32_t arg, uint32_t count, const uint8_t *data,
+                             uint32_t size)
+{
+  DownloadTx.magic = DATALOG_DL_MAGIC;
+  DownloadTx.type = type;
+  DownloadTx.window = 0;
+  DownloadTx.file = file;
+  DownloadTx.arg = arg;
+  DownloadTx.count = count;
+  DownloadTx.size = size;
+  DownloadTx.data_crc = (size > 0U) ? DATALOG_CRC32(data, (size + 3U) & ~3U) : 0U;
+  DownloadTx.crc = DATALOG_CRC32((const uint8_t*)&DownloadTx, DATALOG_DL_HEADER_CRC_SIZE);
+
+  return Link->Write((const uint8_t*)&DownloadTx, DATALOG_DL_HEADER_SIZE) &&
+         ((size == 0U) || Link->Write(data, size));
+}
+
+/**
+  * @brief  Find a file of the listing, setting DownloadPath
+  * @param  dir: directory of the log files
+  * @param  file: file number in the listing, directories are skipped
+  * @retval FatFs result, FR_NO_FILE past the last file
+  */
+static FRESULT Download_Find(const char *dir, uint32_t file)
+{
+  FRESULT fr = f_opendir(&DownloadDir, dir);
+  uint32_t n = 0;
+
+  while(fr == FR_OK)
+  {
+    fr = f_readdir(&DownloadDir, &DownloadInfo);
+    if((fr == FR_OK) && (DownloadInfo.fname[0] == 0))
+    {
+      fr = FR_NO_FILE;
+    }
+    else if((fr == FR_OK) && !(DownloadInfo.fattrib & AM_DIR) && (n++ == file))
+    {
+      strcpy(DownloadPath, dir);
+      strcat(DownloadPath, DownloadInfo.fname);
+      break;
+    }
+  }
+  f_closedir(&DownloadDir);
+  return fr;
+}
+
+/**
+  * @brief  Send the listing of the log directory
+  * @param  dir: directory of the log files
+  * @param  chunk_size: reported in LIST_END
+  * @retval 1 if the listing was sent, 0 otherwise
+  */
+static uint8_t Download_List(const char *dir, uint32_t chunk_size)
+{
+  FRESULT fr = f_opendir(&DownloadDir, dir);
+  uint32_t n = 0;
+
+  if(fr != FR_OK)
+  {
+    return Download_Send(DATALOG_DL_FRM_ERROR, 0, (uint32_t)fr, 0, NULL, 0);
+  }
+  while((f_readdir(&DownloadDir, &DownloadInfo) == FR_OK) && (DownloadInfo.fname[0] != 0))
+  {
+    uint32_t len = (uint32_t)strlen(DownloadInfo.fname);
+
+    if(DownloadInfo.fattrib & AM_DIR)
+    {
+      continue;
+    }
+    memset(DownloadName, 0, sizeof(DownloadName));
+    memcpy(DownloadName, DownloadInfo.fname, len);
+    if(!Download_Send(DATALOG_DL_FRM_ENTRY, n, (uint32_t)DownloadInfo.fsize, 0, (const uint8_t*)DownloadName, len))
+    {
+      f_closedir(&DownloadDir);
+      return 0;
+    }
+    n++;
+  }
+  f_closedir(&DownloadDir);
+  return Download_Send(DATALOG_DL_FRM_LIST_END, 0, chunk_size, n, NULL, 0);
+}
+
+/**
+  * @brief  Send the chunks of a READ request, keeping at most its window
+  *         of chunks ahead of the ACKs. The buffer is filled by one f_read:
+  *         its whole sectors go straight from the card, in multiple block
+  *         commands of up to a cluster.
+  * @param  dir: directory of the log files
+  * @param  req: READ request
+  * @param  buffer: file data, 4 byte aligned
+  * @param  buffer_size: multiple of chunk_size
+  * @param  chunk_size: payload bytes of a CHUNK frame
+  * @retval 1 if the frames were sent, 0 otherwise
+  */
+static uint8_t Download_Read(const char *dir, const DATALOG_DL_Header_t *req, uint8_t *buffer,
+                             uint32_t buffer_size, uint32_t chunk_size)
+{
+  DATALOG_DL_Header_t ack;
+  FRESULT fr;
+  uint32_t chunks, start, next, end, acked, ms;
+  uint32_t window = (req->window > 0U) ? req->window : 1U;
+  uint32_t first = 0, count = 0;  /* chunks in the buffer */
+  UINT bytes = 0;
+
+  fr = Download_Find(dir, req->file);
+  if(fr == FR_OK)
+  {
+    fr = f_open(&DownloadFile, DownloadPath, FA_READ);
+  }
+  if(fr != FR_OK)
+  {
+    return Download_Send(DATALOG_DL_FRM_ERROR, req->file, (uint32_t)fr, 0, NULL, 0);
+  }
+
+  chunks = (uint32_t)((f_size(&DownloadFile) + chunk_size - 1U) / chunk_size);
+  start = (req->arg < chunks) ? req->arg : chunks;
+  end = (req->count < chunks - start) ? start + req->count : chunks;
+  next = start;
+  acked = start;
+  ms = Link->GetTick();
+
+  while(next < end)
+  {
+    /* Take the ACKs in, and wait for them while the window is full */
+    for(;;)
+    {
+      if(Download_Receive(&ack))
+      {
+        if(ack.type != DATALOG_DL_REQ_ACK)
+        {
+          /* The host gave up this READ */
+          DownloadPending = ack;
+          DownloadPendingValid = 1;
+          end = next;
+          break;
+        }
+        if((ack.file == req->file) && (ack.arg >= acked) && (ack.arg < next))
+        {
+          acked = ack.arg + 1U;
+          ms = Link->GetTick();
+        }
+        continue;
+      }
+      if((next - acked < window) || (Link->GetTick() - ms >= DATALOG_DL_ACK_TIMEOUT_MS))
+      {
+        break;
+      }
+      Link->Wait();
+    }
+    if((next - acked >= window) || (next == end))
+    {
+      break;
+    }
+
+    if(next >= first + count)
+    {
+      uint32_t n = buffer_size / chunk_size;
+      FSIZE_t ofs = (FSIZE_t)next * chunk_size;
+
+      if(n > end - next)
+      {
+        n = end - next;
+      }
+      if(((f_tell(&DownloadFile) != ofs) && (f_lseek(&DownloadFile, ofs) != FR_OK)) ||
+         (f_read(&DownloadFile, buffer, n * chunk_size, &bytes) != FR_OK) || (bytes == 0U))
+      {
+        Download_Send(DATALOG_DL_FRM_ERROR, req->file, (uint32_t)FR_DISK_ERR, 0, NULL, 0);
+        break;
+      }
+      /* Zero padding of the last chunk for its CRC */
+      memset(&buffer[bytes], 0, ((bytes + 3U) & ~3U) - bytes);
+      first = next;
+      count = (bytes + chunk_size - 1U) / chunk_size;
+    }
+
+    {
+      uint32_t ofs = (next - first) * chunk_size;
+      uint32_t size = ((uint32_t)bytes - ofs < chunk_size) ? (uint32_t)bytes - ofs : chunk_size;
+
+      if(!Download_Send(DATALOG_DL_FRM_CHUNK, req->file, next, 0, &buffer[ofs], size))
+      {
+        break;
+      }
+    }
+    next++;
+  }
+  f_close(&DownloadFile);
+  return Download_Send(DATALOG_DL_FRM_READ_END, req->file, start, next - start, NULL, 0);
+}
@@ -0,0 +1,105 @@
+/**
+  ******************************************************************************
+  * @file    datalog_download.h
+  * @brief   Header for datalog_download.c module: log download protocol
+  *          over a serial link (the USB CDC port of the firmware). The wire
+  *          format is shared with the host tools, so this header must only
+  *          depend on the C standard library.
+  ******************************************************************************
+  * @attention
+  *
+  * Every message is a DATALOG_DL_Header_t followed by size payload bytes.
+  * The host sends requests without payload; the device answers with frames:
+  *  - LIST: one ENTRY frame per file of the log directory, whose payload is
+  *    the file name, then LIST_END with the number of files and the chunk
+  *    size. Files are named by their number in the listing.
+  *  - READ: CHUNK frames of the chunks [arg, arg + count) of the file, then
+  *    READ_END with the number of chunks sent. At most window chunks are
+  *    sent ahead of the last ACK, so a slow host is never overrun.
+  *  - ACK: the host received the chunk arg, valid or not.
+  *  - END: the session is over, the device goes back to sampling.
+  * A chunk lost or corrupt is not sent again by the device: the host asks
+  * for the chunks it misses with another READ. Errors are reported with an
+  * ERROR frame, arg being the FatFs result. Both CRCs are the CRC-32 of
+  * datalog_crc.c; the payload one is computed as if it was zero padded to a
+  * multiple of 4 bytes. All values are little endian.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_DOWNLOAD_H
+#define __DATALOG_DOWNLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DATALOG_DL_MAGIC          ((uint16_t)0x4C44)   /* "DL" */
+
+/* Requests of the host */
+#define DATALOG_DL_REQ_LIST       ((uint8_t)0x01)
+#define DATALOG_DL_REQ_READ       ((uint8_t)0x02)
+#define DATALOG_DL_REQ_ACK        ((uint8_t)0x03)
+#define DATALOG_DL_REQ_END        ((uint8_t)0x04)
+
+/* Frames of the device */
+#define DATALOG_DL_FRM_ENTRY      ((uint8_t)0x81)
+#define DATALOG_DL_FRM_LIST_END   ((uint8_t)0x82)
+#define DATALOG_DL_FRM_CHUNK      ((uint8_t)0x83)
+#define DATALOG_DL_FRM_READ_END   ((uint8_t)0x84)
+#define DATALOG_DL_FRM_ERROR      ((uint8_t)0x85)
+
+/* Largest payload of a frame, a host skips anything bigger as garbage */
+#define DATALOG_DL_PAYLOAD_MAX    ((uint32_t)65536)
+/* The device ends a session without request for this long */
+#define DATALOG_DL_IDLE_MS        ((uint32_t)2000)
+/* A READ stopped by a full window is given up without ACK for this long */
+#define DATALOG_DL_ACK_TIMEOUT_MS ((uint32_t)1000)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint16_t magic;       /* DATALOG_DL_MAGIC */
+  uint8_t  type;        /* DATALOG_DL_REQ_x or DATALOG_DL_FRM_x */
+  uint8_t  window;      /* READ: chunks sent ahead of the ACKs, 1 to 255 */
+  uint32_t file;        /* file number in the listing */
+  uint32_t arg;         /* READ, ACK, CHUNK: chunk number. ENTRY: file size.
+                           LIST_END: chunk size. ERROR: FatFs result */
+  uint32_t count;       /* READ: chunks asked. READ_END: chunks sent.
+                           LIST_END: number of files */
+  uint32_t size;        /* payload bytes after the header */
+  uint32_t data_crc;    /* CRC-32 of the payload, 0 without payload */
+  uint32_t crc;         /* CRC-32 of the header bytes before it */
+} DATALOG_DL_Header_t;
+
+#define DATALOG_DL_HEADER_SIZE    ((uint32_t)sizeof(DATALOG_DL_Header_t))
+#define DATALOG_DL_HEADER_CRC_SIZE ((uint32_t)(sizeof(DATALOG_DL_Header_t) - sizeof(uint32_t)))
+
+/**
+  * @brief  Serial link to the host, the USB CDC port on the target.
+  *         Read returns the bytes received so far without waiting; Write
+  *         returns 1 once all the bytes are queued, 0 if the host stopped
+  *         reading; Wait gives the CPU away for about a millisecond.
+  */
+typedef struct
+{
+  uint32_t (*Read)(uint8_t *buf, uint32_t size);
+  uint8_t  (*Write)(const uint8_t *buf, uint32_t size);
+  uint32_t (*GetTick)(void);
+  void     (*Wait)(void);
+} DATALOG_DL_Link_t;
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t DATALOG_Download_Session(const DATALOG_DL_Link_t *link, const char *dir, uint8_t *buffer,
+                                 uint32_t buffer_size, uint32_t chunk_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_DOWNLOAD_H */
@@ -0,0 +1,264 @@
+/**
+  ******************************************************************************
+  * @file    datalog_file.c
+  * @brief   This file writes the log file on the FatFs volume. It only uses
+  *          FatFs and its disk I/O layer, so the host tools build it on a
+  *          disk image too.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_file.h"
+#include "datalog_format.h"
+#include "diskio.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Free areas tried for an allocation unit aligned start */
+#define DATALOG_FILE_ALIGN_TRIES  8U
+
+/* Private function prototypes -----------------------------------------------*/
+#if _USE_EXPAND
+static void File_AlignStart(FIL *fp, FSIZE_t size, DWORD au);
+#endif
+static FRESULT File_SeekData(DATALOG_File_t *f);
+
+/**
+  * @brief  Create the log file, replacing an existing one
+  * @param  f: log file
+  * @param  name: file name
+  * @param  prealloc: bytes to preallocate contiguously (multiple of 512),
+  *         0 to always write through FatFs
+  * @retval 1 on success, 0 if the file could not be created
+  */
+uint8_t DATALOG_File_Open(DATALOG_File_t *f, const char *name, FSIZE_t prealloc)
+{
+  memset(f, 0, sizeof(*f));
+  f->au = 1;
+  if(f_open(&f->file, name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+  {
+    return 0;
+  }
+
+#if _USE_EXPAND
+  /* Contiguous clusters: the data sectors follow the first one. The
+     directory entry records an empty file owning the clusters, so a log cut
+     by a power loss keeps the data synced and nothing else. Without enough
+     contiguous space the log is written through FatFs */
+  if(prealloc > 0)
+  {
+    FATFS *fs = f->file.obj.fs;
+    DWORD au = 1;
+
+    /* The card writes fastest in whole allocation units (GET_BLOCK_SIZE):
+       start the file on one and keep each write command inside one */
+    if((disk_ioctl(fs->drv, GET_BLOCK_SIZE, &au) == RES_OK) && (au > 1))
+    {
+      f->au = au;
+      File_AlignStart(&f->file, prealloc, au);
+    }
+    if(f_expand(&f->file, prealloc, 1) != FR_OK)
+    {
+      return 1;
+    }
+    f->file.obj.objsize = 0;
+    if(f_sync(&f->file) != FR_OK)
+    {
+      /* Give the clusters back: f_truncate only frees past the file size */
+      f->file.obj.objsize = prealloc;
+      f_truncate(&f->file);
+      f_close(&f->file);
+      f_unlink(name);
+      return 0;
+    }
+
+    f->expanded = 1;
+    f->sector = fs->database + (DWORD)fs->csize * (f->file.obj.sclust - 2);
+    f->end = f->sector + (DWORD)(prealloc / DATALOG_SECTOR_SIZE);
+
+    /* Clear the first sector, a recovery scan must not take stale card data
+       for the start of the log. The file buffer holds no sector yet */
+    memset(f->file.buf, 0, sizeof(f->file.buf));
+    if(disk_write(fs->drv, f->file.buf, f->sector, 1) != RES_OK)
+    {
+      return 0;
+    }
+  }
+#else
+  (void)prealloc;
+#endif
+  return 1;
+}
+
+/**
+  * @brief  Append to the log file, straight to the preallocated sectors while
+  *         possible
+  * @param  f: log file
+  * @param  buf: data to write
+  * @param  size: number of bytes
+  * @retval 1 on success, 0 on error
+  */
+uint8_t DATALOG_File_Write(DATALOG_File_t *f, const uint8_t *buf, uint32_t size)
+{
+  UINT byteswritten;
+
+  if(f->sector != 0)
+  {
+    UINT count = size / DATALOG_SECTOR_SIZE;
+
+    if((size % DATALOG_SECTOR_SIZE == 0) && (f->sector + count <= f->end))
+    {
+      while(count > 0)
+      {
+        UINT n = count;
+
+        /* Split at the allocation unit boundary */
+        if((f->au > 1) && (f->au - f->sector % f->au < n))
+        {
+          n = f->au - f->sector % f->au;
+        }
+        if(disk_write(f->file.obj.fs->drv, buf, f->sector, n) != RES_OK)
+        {
+          return 0;
+        }
+        f->sector += n;
+        f->written += (FSIZE_t)n * DATALOG_SECTOR_SIZE;
+        buf += n * DATALOG_SECTOR_SIZE;
+        count -= n;
+      }
+      return 1;
+    }
+
+    /* Preallocated area full, or unaligned end of a CSV log: go on through
+       FatFs from there */
+    if(File_SeekData(f) != FR_OK)
+    {
+      return 0;
+    }
+    f->sector = 0;
+  }
+  if((f_write(&f->file, buf, size, &byteswritten) != FR_OK) || (byteswritten != size))
+  {
+    return 0;
+  }
+  return 1;
+}
+
+/**
+  * @brief  Record the data written so far in the directory entry, so it
+  *         survives a power loss
+  * @param  f: log file
+  * @retval 1 on success, 0 on error
+  */
+uint8_t DATALOG_File_Sync(DATALOG_File_t *f)
+{
+  /* Raw writes: moving the file pointer to the end of the data follows the
+     preallocated cluster chain and extends the file size */
+  if((f->sector != 0) && (f_lseek(&f->file, f->written) != FR_OK))
+  {
+    return 0;
+  }
+  return f_sync(&f->file) == FR_OK;
+}
+
+/**
+  * @brief  Close the log file, releasing the unused preallocated space
+  * @param  f: log file
+  * @retval 1 on success, 0 on error
+  */
+uint8_t DATALOG_File_Close(DATALOG_File_t *f)
+{
+  uint8_t ret = 1;
+
+  if(f->expanded)
+  {
+    if((f->sector != 0) && (File_SeekData(f) != FR_OK))
+    {
+      ret = 0;
+    }
+    if(f_truncate(&f->file) != FR_OK)
+    {
+      ret = 0;
+    }
+    f->expanded = 0;
+    f->sector = 0;
+  }
+  if(f_close(&f->file) != FR_OK)
+  {
+    ret = 0;
+  }
+  return ret;
+}
+
+/**
+  * @brief  Move the FatFs file pointer to the end of the data written raw.
+  *         The file size covers the whole preallocated area, so f_truncate
+  *         frees what follows the data.
+  * @param  f: preallocated log file
+  * @retval FatFs result
+  */
+static FRESULT File_SeekData(DATALOG_File_t *f)
+{
+  FRESULT res;
+
+  /* Seeking past the file size follows the preallocated cluster chain */
+  res = f_lseek(&f->file, f->written + (FSIZE_t)(f->end - f->sector) * DATALOG_SECTOR_SIZE);
+  if(res == FR_OK)
+  {
+    res = f_lseek(&f->file, f->written);
+  }
+  return res;
+}
+
+#if _USE_EXPAND
+/**
+  * @brief  Point the FatFs allocation hint at the first cluster starting an
+  *         allocation unit and followed by enough free clusters, so f_expand
+  *         places the file there. Without one, the hint is left to f_expand.
+  * @param  fp: empty file
+  * @param  size: bytes to preallocate
+  * @param  au: allocation unit in sectors
+  * @retval None
+  */
+static void File_AlignStart(FIL *fp, FSIZE_t size, DWORD au)
+{
+  FATFS *fs = fp->obj.fs;
+  DWORD clst = fs->last_clst + 1;
+  uint32_t tries;
+
+  if((clst < 2) || (clst >= fs->n_fatent))
+  {
+    clst = 2;
+  }
+  for(tries = 0; tries < DATALOG_FILE_ALIGN_TRIES; tries++)
+  {
+    DWORD sector = fs->database + (DWORD)fs->csize * (clst - 2);
+    DWORD skip = (au - sector % au) % au;
+
+    /* No cluster starts on a boundary when the data area is misaligned */
+    if(skip % fs->csize != 0)
+    {
+      return;
+    }
+    clst += skip / fs->csize;
+    if(clst >= fs->n_fatent)
+    {
+      clst = 2;
+      continue;
+    }
+
+    /* Search only: the hint is left just before the free area found */
+    fs->last_clst = clst;
+    if(f_expand(fp, size, 0) != FR_OK)
+    {
+      return;
+    }
+    if(fs->last_clst + 1 == clst)
+    {
+      fs->last_clst = clst;
+      return;
+    }
+    clst = fs->last_clst + 1;
+  }
+}
+#endif
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    datalog_file.h
+  * @brief   Header for datalog_file.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_FILE_H
+#define __DATALOG_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ff.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Log file open for writing. When preallocated, the data goes
+  *         straight to the contiguous sectors of the file, without FatFs
+  *         cluster allocation or directory updates; the directory entry
+  *         records the data written up to the last DATALOG_File_Sync.
+  */
+typedef struct
+{
+  FIL      file;
+  uint8_t  expanded;  /* file preallocated, to be truncated on close */
+  DWORD    sector;    /* next sector to write, 0 once written through FatFs */
+  DWORD    end;       /* first sector after the preallocated area */
+  FSIZE_t  written;   /* bytes written to the preallocated area */
+  DWORD    au;        /* allocation unit of the card in sectors, a write
+                         command never crosses its boundaries */
+} DATALOG_File_t;
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t DATALOG_File_Open(DATALOG_File_t *f, const char *name, FSIZE_t prealloc);
+uint8_t DATALOG_File_Write(DATALOG_File_t *f, const uint8_t *buf, uint32_t size);
+uint8_t DATALOG_File_Sync(DATALOG_File_t *f);
+uint8_t DATALOG_File_Close(DATALOG_File_t *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_FILE_H */
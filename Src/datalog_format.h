@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @file    datalog_format.h
+  * @brief   On-disk layout of the binary SensorTile log files.
+  *          This header is shared by the firmware and the host tools, so it
+  *          must only depend on the C standard library.
+  ******************************************************************************
+  * @attention
+  *
+  * A binary log is a sequence of fixed size blocks. Every block starts with a
+  * DATALOG_BlockHeader_t followed by the records, in one of two layouts:
+  *  - DATALOG_LAYOUT_ROW: the records are stored one after the other.
+  *  - DATALOG_LAYOUT_COLUMNAR: the header is followed by a table with the
+  *    offset of each channel column, then every channel stores the values of
+  *    all the records contiguously. A reader interested in a single channel
+  *    only needs the header and one column of every block.
+  * Unused payload bytes are zero filled, so a block can always be located at
+  * (index * block size) without scanning the file. The block size is the
+  * same for the whole file and is recorded in every header.
+  * When the log is closed, one or more DATALOG_LAYOUT_INDEX blocks are
+  * appended after the data blocks. Their payload is a sparse time index,
+  * DATALOG_IndexEntry_t sorted by block, so a reader can seek to a time
+  * without scanning the file. A log without this footer was not closed
+  * cleanly; its index can be rebuilt from the data block headers.
+  * Blocks with DATALOG_FLAG_CRC32 end with the CRC-32 (IEEE 802.3, as zlib)
+  * of all the preceding bytes of the block, so a reader can detect and skip
+  * a corrupt block.
+  * Records hold the channels of the header channel_mask, in channel id order,
+  * so channels disabled in the firmware take no space (see datalog_schema.hpp).
+  * All values are stored little endian.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_FORMAT_H
+#define __DATALOG_FORMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DATALOG_BLOCK_MAGIC       ((uint32_t)0x424C5453)  /* "STLB" */
+#define DATALOG_BLOCK_VERSION     ((uint16_t)3)
+
+/* Blocks are a multiple of the SD sector size */
+#define DATALOG_SECTOR_SIZE       ((uint32_t)512)
+/* Default size of one log block in bytes, also the size used by version 1 */
+#define DATALOG_BLOCK_SIZE        ((uint32_t)4096)
+#define DATALOG_BLOCK_SIZE_MAX    ((uint32_t)65536)
+
+/* Header flags */
+#define DATALOG_FLAG_CRC32        ((uint16_t)0x0001)   /* CRC-32 trailer in the last 4 bytes */
+#define DATALOG_BLOCK_TRAILER_SIZE ((uint32_t)4)
+
+/* Payload layouts */
+#define DATALOG_LAYOUT_ROW        ((uint8_t)0)   /* records stored one after the other */
+#define DATALOG_LAYOUT_COLUMNAR   ((uint8_t)1)   /* one column chunk per channel */
+#define DATALOG_LAYOUT_INDEX      ((uint8_t)2)   /* time index footer, no records */
+
+/* Every channel is stored as a 32 bit value (int32_t or float) */
+#define DATALOG_CHANNEL_COUNT     ((uint8_t)13)
+#define DATALOG_CHANNEL_SIZE      ((uint32_t)4)
+/* Size of a record holding all the channels */
+#define DATALOG_RECORD_SIZE       ((uint32_t)(DATALOG_CHANNEL_COUNT * DATALOG_CHANNEL_SIZE))
+
+/* Channel identifiers: bit of the channel mask and position in DATALOG_Record_t */
+#define DATALOG_CH_MS             0
+#define DATALOG_CH_ACC_X          1
+#define DATALOG_CH_ACC_Y          2
+#define DATALOG_CH_ACC_Z          3
+#define DATALOG_CH_GYRO_X         4
+#define DATALOG_CH_GYRO_Y         5
+#define DATALOG_CH_GYRO_Z         6
+#define DATALOG_CH_MAG_X          7
+#define DATALOG_CH_MAG_Y          8
+#define DATALOG_CH_MAG_Z          9
+#define DATALOG_CH_PRESS          10
+#define DATALOG_CH_TEMP           11
+#define DATALOG_CH_HUM            12
+#define DATALOG_CHANNEL_MASK_ALL  ((uint16_t)((1u << DATALOG_CHANNEL_COUNT) - 1))
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  One sample of all the logged channels, in the same order as the
+  *         columns of the CSV log.
+  */
+typedef struct
+{
+  uint32_t ms_counter;    /* T [ms]        */
+  int32_t  acc[3];        /* Acc [mg]      */
+  int32_t  gyro[3];       /* Gyro [mdps]   */
+  int32_t  mag[3];        /* Mag [mgauss]  */
+  float    pressure;      /* P [mB]        */
+  float    temperature;   /* T [degC]      */
+  float    humidity;      /* H [%]         */
+} DATALOG_Record_t;
+
+/**
+  * @brief  Header at the start of every log block.
+  */
+typedef struct
+{
+  uint32_t magic;         /* DATALOG_BLOCK_MAGIC */
+  uint16_t version;       /* DATALOG_BLOCK_VERSION */
+  uint16_t header_size;   /* offset of the payload from the start of the block */
+  uint32_t sequence;      /* block number inside the file, starting from 0 */
+  uint32_t first_ms;      /* timestamp of the first record */
+  uint32_t last_ms;       /* timestamp of the last record */
+  uint16_t record_count;  /* number of valid records in the payload */
+  uint16_t record_size;   /* size of a record in bytes */
+  uint8_t  layout;        /* DATALOG_LAYOUT_xxx */
+  uint8_t  channel_count; /* number of channels in a record */
+  uint16_t block_sectors; /* block size in sectors, 0 means DATALOG_BLOCK_SIZE */
+  uint16_t channel_mask;  /* channels in a record, 0 means all (versions 1 and 2) */
+  uint16_t flags;         /* DATALOG_FLAG_xxx */
+} DATALOG_BlockHeader_t;
+
+/**
+  * @brief  Columnar layout: offset of each column from the start of the block,
+  *         indexed by channel id, 0 for channels not in the log.
+  *         Stored right after the header, padded to a multiple of 4 bytes.
+  */
+typedef struct
+{
+  uint16_t offset[DATALOG_CHANNEL_COUNT];
+  uint16_t padding;
+} DATALOG_ColumnTable_t;
+
+/**
+  * @brief  Time index footer: timestamp of the first record of a data block.
+  *         In a DATALOG_LAYOUT_INDEX block record_count is the number of
+  *         entries, record_size is DATALOG_INDEX_ENTRY_SIZE, channel_count is
+  *         0 and first_ms / last_ms are the times of the first / last entry.
+  */
+typedef struct
+{
+  uint32_t first_ms;      /* first_ms of the data block */
+  uint32_t block;         /* sequence number of the data block */
+} DATALOG_IndexEntry_t;
+
+#define DATALOG_BLOCK_HEADER_SIZE    ((uint32_t)sizeof(DATALOG_BlockHeader_t))
+#define DATALOG_COLUMN_TABLE_SIZE    ((uint32_t)sizeof(DATALOG_ColumnTable_t))
+#define DATALOG_INDEX_ENTRY_SIZE     ((uint32_t)sizeof(DATALOG_IndexEntry_t))
+
+/* Number of records of rec_size bytes that fit in a block of the given size */
+#define DATALOG_PAYLOAD_SIZE(size)               ((size) - DATALOG_BLOCK_HEADER_SIZE - DATALOG_BLOCK_TRAILER_SIZE)
+#define DATALOG_ROW_CAPACITY(size, rec_size)     (DATALOG_PAYLOAD_SIZE(size) / (rec_size))
+#define DATALOG_COLUMN_CAPACITY(size, rec_size)  ((DATALOG_PAYLOAD_SIZE(size) - DATALOG_COLUMN_TABLE_SIZE) / (rec_size))
+#define DATALOG_INDEX_CAPACITY(size)             (DATALOG_PAYLOAD_SIZE(size) / DATALOG_INDEX_ENTRY_SIZE)
+
+#ifdef __cplusplus
+static_assert(sizeof(DATALOG_Record_t) == DATALOG_RECORD_SIZE, "unexpected record padding");
+static_assert(sizeof(DATALOG_BlockHeader_t) == 32, "unexpected block header padding");
+static_assert((DATALOG_COLUMN_TABLE_SIZE % 4) == 0, "column table must keep the columns word aligned");
+static_assert((DATALOG_BLOCK_SIZE % DATALOG_SECTOR_SIZE) == 0, "block size must be a multiple of the sector size");
+#else
+_Static_assert(sizeof(DATALOG_Record_t) == DATALOG_RECORD_SIZE, "unexpected record padding");
+_Static_assert(sizeof(DATALOG_BlockHeader_t) == 32, "unexpected block header padding");
+_Static_assert((DATALOG_COLUMN_TABLE_SIZE % 4) == 0, "column table must keep the columns word aligned");
+_Static_assert((DATALOG_BLOCK_SIZE % DATALOG_SECTOR_SIZE) == 0, "block size must be a multiple of the sector size");
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_FORMAT_H */
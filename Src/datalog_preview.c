@@ -0,0 +1,163 @@
+/**
+  ******************************************************************************
+  * @file    datalog_preview.c
+  * @brief   Live preview of the SD card log over the USB CDC port. The write
+  *          task hands each sample to DATALOG_Preview_Add, which only keeps
+  *          the last sample or the min / max of the preview period; the
+  *          preview task, below the SD write task, formats and sends one
+  *          line per period.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_preview.h"
+#include "datalog_record.h"
+#include "usbd_cdc_interface.h"
+#include "cmsis_os.h"
+
+#if defined(DATALOG_USB_PREVIEW)
+
+#if defined(DATALOG_USB_PREVIEW_ENVELOPE) == defined(DATALOG_USB_PREVIEW_DECIMATE)
+#error "Define one of DATALOG_USB_PREVIEW_ENVELOPE and DATALOG_USB_PREVIEW_DECIMATE"
+#endif
+
+/* Private define ------------------------------------------------------------*/
+
+/* Samples per preview line, at least one */
+#define PREVIEW_SAMPLES  ((1000U / DATA_PERIOD_MS) > DATALOG_USB_PREVIEW_HZ ? \
+                          ((1000U / DATA_PERIOD_MS) / DATALOG_USB_PREVIEW_HZ) : 1U)
+
+#define PREVIEW_SIGNAL     (0x0001)
+#define PREVIEW_LINE_SIZE  (512)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Samples of one preview period */
+typedef struct
+{
+#if defined(DATALOG_USB_PREVIEW_ENVELOPE)
+  DATALOG_Record_t min;
+  DATALOG_Record_t max;
+#else
+  T_SensorsData last;
+#endif
+  uint32_t samples;
+} Preview_Period_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* One period fills while the preview task formats the other one */
+static Preview_Period_t Periods[2];
+static uint8_t Fill;                /* period filled by the write task */
+static volatile uint8_t Pending;    /* the other period is owned by the preview task */
+static uint32_t Dropped;
+static osThreadId PreviewThreadId = NULL;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Preview_Thread(void const *argument);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Create the preview task, its stack is part of
+  *         configTOTAL_HEAP_SIZE
+  * @param  None
+  * @retval 1 on success, 0 if the task could not be created
+  */
+uint8_t DATALOG_Preview_Init(void)
+{
+  /* Below the SD write task: the preview only runs when the card is idle */
+  osThreadDef(PREVIEW, Preview_Thread, osPriorityLow, 0, configMINIMAL_STACK_SIZE*4);
+  PreviewThreadId = osThreadCreate(osThread(PREVIEW), NULL);
+  return (PreviewThreadId != NULL);
+}
+
+/**
+  * @brief  Take a logged sample into the current preview period, and hand
+  *         the period to the preview task when it is complete. Never waits.
+  * @param  data: sample, only read during the call
+  * @retval None
+  */
+void DATALOG_Preview_Add(const T_SensorsData *data)
+{
+  Preview_Period_t *p = &Periods[Fill];
+
+  if(PreviewThreadId == NULL)
+  {
+    return;
+  }
+
+#if defined(DATALOG_USB_PREVIEW_ENVELOPE)
+  DATALOG_Record_Envelope(data, &p->min, &p->max, p->samples == 0);
+#else
+  if(p->samples == PREVIEW_SAMPLES - 1)
+  {
+    p->last = *data;
+  }
+#endif
+
+  if(++p->samples < PREVIEW_SAMPLES)
+  {
+    return;
+  }
+
+  /* Nobody to send it to, or the previous line is still being sent */
+  if(!CDC_IsOpen() || Pending)
+  {
+    p->samples = 0;
+    Dropped++;
+    return;
+  }
+
+  Pending = 1;
+  Fill ^= 1;
+  Periods[Fill].samples = 0;
+  osSignalSet(PreviewThreadId, PREVIEW_SIGNAL);
+}
+
+/**
+  * @brief  Preview periods dropped because no host read them in time
+  * @param  None
+  * @retval Number of periods
+  */
+uint32_t DATALOG_Preview_Dropped(void)
+{
+  return Dropped;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Format and send the periods handed by DATALOG_Preview_Add
+  * @param  argument not used
+  * @retval None
+  */
+static void Preview_Thread(void const *argument)
+{
+  (void) argument;
+  static char line[PREVIEW_LINE_SIZE];
+  const Preview_Period_t *p;
+  int size;
+
+  for (;;)
+  {
+    osSignalWait(PREVIEW_SIGNAL, osWaitForever);
+
+    /* Fill does not move while Pending is set */
+    p = &Periods[Fill ^ 1];
+#if defined(DATALOG_USB_PREVIEW_ENVELOPE)
+    size = DATALOG_Record_FormatEnvelope(&p->min, &p->max, line, sizeof(line));
+#else
+    size = DATALOG_Record_FormatText(&p->last, line, sizeof(line));
+#endif
+    /* The text is out of the period, the next one can be handed over */
+    Pending = 0;
+
+    if(size > 0)
+    {
+      CDC_Fill_Buffer((uint8_t *)line, size);
+    }
+  }
+}
+
+#endif /* DATALOG_USB_PREVIEW */
@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * @file    datalog_preview.h
+  * @brief   Header for datalog_preview.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_PREVIEW_H
+#define __DATALOG_PREVIEW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_application.h"
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t DATALOG_Preview_Init(void);
+void DATALOG_Preview_Add(const T_SensorsData *data);
+uint32_t DATALOG_Preview_Dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_PREVIEW_H */
@@ -0,0 +1,156 @@
+/**
+  ******************************************************************************
+  * @file    datalog_record.cpp
+  * @brief   Channels logged by the firmware, and their binary and text
+  *          encodings generated from that list.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_record.h"
+#include "datalog_schema.hpp"
+
+using namespace datalog;
+
+/* Private types -------------------------------------------------------------*/
+
+/* Logged channels, in channel id order. Removing a channel from this list
+   removes it from the SD records, the CSV columns and the USB stream, and
+   skips reading a sensor whose channels are all removed */
+using LogChannels = ChannelList<TimestampMs,
+                                AccX, AccY, AccZ,
+                                GyroX, GyroY, GyroZ,
+                                MagX, MagY, MagZ,
+                                Pressure, Temperature, Humidity>;
+
+static_assert(LogChannels::contains<TimestampMs>(), "the timestamp is mandatory");
+static_assert(LogChannels::id_ordered(), "list the channels in id order");
+static_assert(LogChannels::record_size == LogChannels::count * DATALOG_CHANNEL_SIZE, "log channels are 32 bit");
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Terminate the text and return its length, or -1 if it did not fit */
+static int Finish(char *out, char *p, char *end, const char *suffix)
+{
+  const std::size_t len = std::strlen(suffix);
+
+  if((p == end) || (std::size_t(end - p) <= len))
+  {
+    return -1;
+  }
+  std::memcpy(p, suffix, len + 1);
+  return int(p + len - out);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Channels of the log records
+  * @retval Channel mask for the block header
+  */
+uint16_t DATALOG_Record_ChannelMask(void)
+{
+  return LogChannels::mask;
+}
+
+/**
+  * @brief  Size of a binary record
+  * @retval Size in bytes
+  */
+uint32_t DATALOG_Record_Size(void)
+{
+  return LogChannels::record_size;
+}
+
+/**
+  * @brief  Pack the logged channels of a sample
+  * @param  data: sample
+  * @param  out: DATALOG_Record_Size() bytes
+  * @retval None
+  */
+void DATALOG_Record_Encode(const T_SensorsData *data, uint8_t *out)
+{
+  LogChannels::encode(*data, out);
+}
+
+/**
+  * @brief  CSV header line with the titles of the logged channels
+  * @param  out: text buffer
+  * @param  size: size of the buffer
+  * @retval Length of the text, -1 if the buffer is too small
+  */
+int DATALOG_Record_CsvHeader(char *out, uint32_t size)
+{
+  char *p = out;
+  char *end = out + size;
+
+  for(const auto &desc : LogChannels::descriptors)
+  {
+    const std::size_t len = std::strlen(desc.title);
+    if(std::size_t(end - p) <= len + 1)
+    {
+      return -1;
+    }
+    if(p != out)
+    {
+      *p++ = ',';
+    }
+    std::memcpy(p, desc.title, len);
+    p += len;
+  }
+  return Finish(out, p, end, "\r\n");
+}
+
+/**
+  * @brief  CSV line of a sample
+  * @param  data: sample
+  * @param  out: text buffer
+  * @param  size: size of the buffer
+  * @retval Length of the text, -1 if the buffer is too small
+  */
+int DATALOG_Record_FormatCsv(const T_SensorsData *data, char *out, uint32_t size)
+{
+  return Finish(out, LogChannels::format(*data, out, out + size, ", "), out + size, "\r\n");
+}
+
+/**
+  * @brief  Human readable text of a sample, for the USB terminal, in the
+  *         layout of the original firmware
+  * @param  data: sample
+  * @param  out: text buffer
+  * @param  size: size of the buffer
+  * @retval Length of the text, -1 if the buffer is too small
+  */
+int DATALOG_Record_FormatText(const T_SensorsData *data, char *out, uint32_t size)
+{
+  return Finish(out, LogChannels::format_text(*data, out, out + size), out + size, "\r\n");
+}
+
+/**
+  * @brief  Widen the min / max of the logged channels to take a sample in
+  * @param  data: sample
+  * @param  min: lowest values, in DATALOG_Record_t order
+  * @param  max: highest values, in DATALOG_Record_t order
+  * @param  first: 1 to start min and max from the sample
+  * @retval None
+  */
+void DATALOG_Record_Envelope(const T_SensorsData *data, DATALOG_Record_t *min, DATALOG_Record_t *max,
+                             uint8_t first)
+{
+  LogChannels::envelope(*data, *min, *max, first != 0);
+}
+
+/**
+  * @brief  Human readable text of the min / max of the logged channels, for
+  *         the USB terminal
+  * @param  min: lowest values
+  * @param  max: highest values
+  * @param  out: text buffer
+  * @param  size: size of the buffer
+  * @retval Length of the text, -1 if the buffer is too small
+  */
+int DATALOG_Record_FormatEnvelope(const DATALOG_Record_t *min, const DATALOG_Record_t *max, char *out,
+                                  uint32_t size)
+{
+  return Finish(out, LogChannels::format_envelope(*min, *max, out, out + size, ", "), out + size, "\r\n");
+}
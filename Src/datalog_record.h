@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    datalog_record.h
+  * @brief   Header for datalog_record.cpp module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_RECORD_H
+#define __DATALOG_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_application.h"
+#include "datalog_format.h"
+
+/* Exported functions ------------------------------------------------------- */
+uint16_t DATALOG_Record_ChannelMask(void);
+uint32_t DATALOG_Record_Size(void);
+void DATALOG_Record_Encode(const T_SensorsData *data, uint8_t *out);
+int DATALOG_Record_CsvHeader(char *out, uint32_t size);
+int DATALOG_Record_FormatCsv(const T_SensorsData *data, char *out, uint32_t size);
+int DATALOG_Record_FormatText(const T_SensorsData *data, char *out, uint32_t size);
+void DATALOG_Record_Envelope(const T_SensorsData *data, DATALOG_Record_t *min, DATALOG_Record_t *max,
+                             uint8_t first);
+int DATALOG_Record_FormatEnvelope(const DATALOG_Record_t *min, const DATALOG_Record_t *max, char *out,
+                                  uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_RECORD_H */
@@ -0,0 +1,369 @@
+/**
+  ******************************************************************************
+  * @file    datalog_recover.c
+  * @brief   This file recovers a log file cut by a power loss. Its directory
+  *          entry only records the data written up to the last sync, the
+  *          rest is still in the preallocated clusters: the binary blocks
+  *          found there with the expected sequence numbers, a valid CRC and
+  *          continuous timestamps, or the complete CSV lines of text with
+  *          continuous timestamps, are added back to the file, then the
+  *          unused clusters are freed. It only uses FatFs and its disk I/O
+  *          layer, so the host tools run it on a card image too.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_recover.h"
+#include "datalog_crc.h"
+#include "datalog_format.h"
+#include "diskio.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Fragments of the cluster chain mapped, a preallocated log has one */
+#define DATALOG_RECOVER_FRAGMENTS  (8U)
+
+/* Private variables ---------------------------------------------------------*/
+/* Not on the stack of the calling task, FIL holds a sector buffer */
+static FIL RecoverFile;
+/* Cluster link map: its size, (clusters, first cluster) of each fragment, 0 */
+static DWORD RecoverMap[2 * DATALOG_RECOVER_FRAGMENTS + 2];
+
+/* Private function prototypes -----------------------------------------------*/
+static FSIZE_t Recover_ChainSize(const FATFS *fs);
+static DWORD Recover_Sector(const FATFS *fs, FSIZE_t ofs);
+static uint8_t Recover_Read(const FATFS *fs, FSIZE_t ofs, uint8_t *buffer, uint32_t size);
+static uint8_t Recover_Valid(const uint8_t *block, uint32_t size, uint32_t sequence, uint32_t *last_ms,
+                             uint8_t check_time);
+static FSIZE_t Recover_Scan(const FATFS *fs, FSIZE_t size, FSIZE_t chain, uint8_t *buffer,
+                            uint32_t buffer_size);
+static FSIZE_t Recover_ScanCsv(const FATFS *fs, FSIZE_t size, FSIZE_t chain, uint8_t *buffer,
+                               uint32_t buffer_size);
+
+/**
+  * @brief  Recover a log file: add back the valid blocks or CSV lines
+  *         written after its recorded size and free the clusters left after
+  *         them. A closed log only gets its unused clusters freed.
+  * @param  name: log file
+  * @param  buffer: one block, 4 byte aligned
+  * @param  buffer_size: size of buffer, at least 512 bytes; binary logs with
+  *         larger blocks are not scanned
+  * @param  recovered: set to the number of bytes added back
+  * @retval 1 on success, 0 on error
+  */
+uint8_t DATALOG_Recover(const char *name, uint8_t *buffer, uint32_t buffer_size, FSIZE_t *recovered)
+{
+  FIL *file = &RecoverFile;
+  FSIZE_t size;
+  FSIZE_t chain = 0;
+  FSIZE_t end;
+  uint8_t ret = 1;
+
+  *recovered = 0;
+  if(f_open(file, name, FA_READ | FA_WRITE) != FR_OK)
+  {
+    return 0;
+  }
+  size = f_size(file);
+
+  /* The whole cluster chain, beyond the file size for a log cut by a power loss */
+  RecoverMap[0] = sizeof(RecoverMap) / sizeof(RecoverMap[0]);
+  file->cltbl = RecoverMap;
+  if(f_lseek(file, CREATE_LINKMAP) == FR_OK)
+  {
+    chain = Recover_ChainSize(file->obj.fs);
+  }
+  file->cltbl = NULL;
+
+  if(chain > size)
+  {
+    end = Recover_Scan(file->obj.fs, size, chain, buffer, buffer_size);
+    if(end == size)
+    {
+      end = Recover_ScanCsv(file->obj.fs, size, chain, buffer, buffer_size);
+    }
+
+    /* Seeking past the file size follows the chain and extends the file;
+       f_truncate then frees the clusters after the data */
+    if((f_lseek(file, chain) != FR_OK) || (f_lseek(file, end) != FR_OK) || (f_truncate(file) != FR_OK))
+    {
+      ret = 0;
+    }
+    else
+    {
+      *recovered = end - size;
+    }
+  }
+
+  if(f_close(file) != FR_OK)
+  {
+    ret = 0;
+  }
+  return ret;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Bytes in the clusters of the link map
+  * @param  fs: volume of the file
+  * @retval Size of the cluster chain
+  */
+static FSIZE_t Recover_ChainSize(const FATFS *fs)
+{
+  const DWORD *tbl;
+  FSIZE_t clusters = 0;
+
+  for(tbl = &RecoverMap[1]; *tbl != 0; tbl += 2)
+  {
+    clusters += tbl[0];
+  }
+  return clusters * fs->csize * DATALOG_SECTOR_SIZE;
+}
+
+/**
+  * @brief  Card sector holding a file offset, from the link map
+  * @param  fs: volume of the file
+  * @param  ofs: file offset
+  * @retval Sector, 0 past the cluster chain
+  */
+static DWORD Recover_Sector(const FATFS *fs, FSIZE_t ofs)
+{
+  const DWORD *tbl;
+  DWORD cl = (DWORD)(ofs / DATALOG_SECTOR_SIZE / fs->csize);
+
+  for(tbl = &RecoverMap[1]; *tbl != 0; tbl += 2)
+  {
+    if(cl < tbl[0])
+    {
+      return fs->database + (DWORD)fs->csize * (tbl[1] + cl - 2) + (DWORD)(ofs / DATALOG_SECTOR_SIZE % fs->csize);
+    }
+    cl -= tbl[0];
+  }
+  return 0;
+}
+
+/**
+  * @brief  Read file data past the file size, straight from the card
+  * @param  fs: volume of the file
+  * @param  ofs: file offset, multiple of 512
+  * @param  buffer: data read
+  * @param  size: bytes to read, multiple of 512
+  * @retval 1 on success, 0 on error
+  */
+static uint8_t Recover_Read(const FATFS *fs, FSIZE_t ofs, uint8_t *buffer, uint32_t size)
+{
+  while(size > 0)
+  {
+    DWORD sector = Recover_Sector(fs, ofs);
+    /* The sectors of a cluster are contiguous */
+    UINT count = fs->csize - (UINT)(ofs / DATALOG_SECTOR_SIZE % fs->csize);
+
+    if(count > size / DATALOG_SECTOR_SIZE)
+    {
+      count = size / DATALOG_SECTOR_SIZE;
+    }
+    if((sector == 0) || (disk_read(fs->drv, buffer, sector, count) != RES_OK))
+    {
+      return 0;
+    }
+    ofs += (FSIZE_t)count * DATALOG_SECTOR_SIZE;
+    buffer += count * DATALOG_SECTOR_SIZE;
+    size -= count * DATALOG_SECTOR_SIZE;
+  }
+  return 1;
+}
+
+/**
+  * @brief  Check a block written by this firmware at the given position
+  * @param  block: block data, 4 byte aligned
+  * @param  size: block size
+  * @param  sequence: expected sequence number
+  * @param  last_ms: last timestamp of the previous data block, updated
+  * @param  check_time: 0 for the first block scanned, without a previous one
+  * @retval 1 if the block is valid
+  */
+static uint8_t Recover_Valid(const uint8_t *block, uint32_t size, uint32_t sequence, uint32_t *last_ms,
+                             uint8_t check_time)
+{
+  const DATALOG_BlockHeader_t *hdr = (const DATALOG_BlockHeader_t *)block;
+  uint32_t crc;
+
+  if((hdr->magic != DATALOG_BLOCK_MAGIC) || (hdr->version != DATALOG_BLOCK_VERSION) ||
+     (hdr->sequence != sequence) || ((uint32_t)hdr->block_sectors * DATALOG_SECTOR_SIZE != size) ||
+     !(hdr->flags & DATALOG_FLAG_CRC32))
+  {
+    return 0;
+  }
+  memcpy(&crc, &block[size - DATALOG_BLOCK_TRAILER_SIZE], sizeof(crc));
+  if(DATALOG_CRC32(block, size - DATALOG_BLOCK_TRAILER_SIZE) != crc)
+  {
+    return 0;
+  }
+
+  /* A stale block of an older log can match the sequence, not the time */
+  if(hdr->layout != DATALOG_LAYOUT_INDEX)
+  {
+    if(check_time && ((hdr->first_ms < *last_ms) || (hdr->first_ms - *last_ms > DATALOG_RECOVER_MAX_GAP_MS)))
+    {
+      return 0;
+    }
+    *last_ms = hdr->last_ms;
+  }
+  return 1;
+}
+
+/**
+  * @brief  Find the end of the valid blocks following the recorded size
+  * @param  fs: volume of the file
+  * @param  size: recorded file size
+  * @param  chain: size of the cluster chain
+  * @param  buffer: one block, 4 byte aligned
+  * @param  buffer_size: size of buffer
+  * @retval End of the log data, size when nothing can be added
+  */
+static FSIZE_t Recover_Scan(const FATFS *fs, FSIZE_t size, FSIZE_t chain, uint8_t *buffer,
+                            uint32_t buffer_size)
+{
+  const DATALOG_BlockHeader_t *hdr = (const DATALOG_BlockHeader_t *)buffer;
+  uint32_t block_size;
+  uint32_t last_ms = 0;
+  FSIZE_t ofs;
+
+  /* Binary logs only, the first block gives the block size */
+  if(!Recover_Read(fs, 0, buffer, DATALOG_SECTOR_SIZE) || (hdr->magic != DATALOG_BLOCK_MAGIC))
+  {
+    return size;
+  }
+  block_size = (uint32_t)hdr->block_sectors * DATALOG_SECTOR_SIZE;
+  if((block_size == 0) || (block_size > buffer_size))
+  {
+    return size;
+  }
+
+  /* The last block recorded whole gives the time of the next one */
+  ofs = size - size % block_size;
+  if(ofs > 0)
+  {
+    if(!Recover_Read(fs, ofs - block_size, buffer, block_size) ||
+       !Recover_Valid(buffer, block_size, (uint32_t)((ofs - block_size) / block_size), &last_ms, 0))
+    {
+      return size;
+    }
+  }
+
+  while((ofs + block_size <= chain) && Recover_Read(fs, ofs, buffer, block_size) &&
+        Recover_Valid(buffer, block_size, (uint32_t)(ofs / block_size), &last_ms, ofs > 0))
+  {
+    ofs += block_size;
+  }
+  return (ofs > size) ? ofs : size;
+}
+
+/**
+  * @brief  Find the end of the complete CSV lines following the recorded
+  *         size. The text written after it goes on up to the first byte
+  *         that is not printable ASCII or a line end: 0x00 or 0xFF of an
+  *         erased card, or stale data. Each line starts with its timestamp,
+  *         which must follow the previous one as for the binary blocks
+  * @param  fs: volume of the file
+  * @param  size: recorded file size
+  * @param  chain: size of the cluster chain
+  * @param  buffer: data read, 4 byte aligned
+  * @param  buffer_size: size of buffer, at least 512 bytes
+  * @retval End of the last complete line, size when nothing can be added
+  */
+static FSIZE_t Recover_ScanCsv(const FATFS *fs, FSIZE_t size, FSIZE_t chain, uint8_t *buffer,
+                               uint32_t buffer_size)
+{
+  FSIZE_t end = size;
+  FSIZE_t ofs;
+  FSIZE_t line = 0;        /* start of the current line */
+  uint32_t last_ms = 0;
+  uint32_t ms = 0;
+  uint8_t has_time = 0;    /* last_ms holds the time of a previous line */
+  uint8_t in_line = 1;     /* line start known: from the file start or a line end */
+  uint8_t in_time = 1;     /* reading the timestamp digits of the line */
+  uint8_t digits = 0;
+
+  buffer_size -= buffer_size % DATALOG_SECTOR_SIZE;
+  if(buffer_size == 0)
+  {
+    return size;
+  }
+
+  /* From the sector before the one holding the recorded size: the last line
+     started before it gives the time of the next one. A line is far shorter
+     than a sector, so that sector holds a line end */
+  ofs = size - size % DATALOG_SECTOR_SIZE;
+  if(ofs >= DATALOG_SECTOR_SIZE)
+  {
+    ofs -= DATALOG_SECTOR_SIZE;
+    in_line = (ofs == 0);
+  }
+
+  while(ofs < chain)
+  {
+    uint32_t count = (chain - ofs < buffer_size) ? (uint32_t)(chain - ofs) : buffer_size;
+    uint32_t i;
+
+    if(!Recover_Read(fs, ofs, buffer, count))
+    {
+      return end;
+    }
+    for(i = 0; i < count; i++, ofs++)
+    {
+      uint8_t c = buffer[i];
+
+      if(ofs >= size)
+      {
+        /* The text written after the recorded size */
+        if((c != '\r') && (c != '\n') && ((c < 0x20) || (c > 0x7E)))
+        {
+          return end;
+        }
+        if(c == '\n')
+        {
+          end = ofs + 1;
+        }
+      }
+
+      if(in_line && in_time)
+      {
+        if((c >= '0') && (c <= '9') && (digits < 10))
+        {
+          ms = ms * 10U + (uint32_t)(c - '0');
+          digits++;
+          continue;
+        }
+        in_time = 0;
+        if(digits > 0)
+        {
+          /* A stale line of an older log can be text, not with this time */
+          if((line >= size) && has_time &&
+             ((ms < last_ms) || (ms - last_ms > DATALOG_RECOVER_MAX_GAP_MS)))
+          {
+            return end;
+          }
+          last_ms = ms;
+          has_time = 1;
+        }
+        else if((line >= size) && has_time)
+        {
+          /* Only the header line, at the file start, has no timestamp */
+          return end;
+        }
+      }
+
+      if(c == '\n')
+      {
+        line = ofs + 1;
+        in_line = 1;
+        in_time = 1;
+        digits = 0;
+        ms = 0;
+      }
+    }
+  }
+  return end;
+}
@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    datalog_recover.h
+  * @brief   Header for datalog_recover.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_RECOVER_H
+#define __DATALOG_RECOVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ff.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* A data block following the last valid one by more than this is stale */
+#define DATALOG_RECOVER_MAX_GAP_MS  (10000U)
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t DATALOG_Recover(const char *name, uint8_t *buffer, uint32_t buffer_size, FSIZE_t *recovered);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_RECOVER_H */
@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    datalog_regformat.h
+  * @brief   On-disk layout of the sensor register recordings
+  *          (DATALOG_SD_REGISTERS). This header is shared by the firmware and
+  *          the host tools, so it must only depend on the C standard library.
+  ******************************************************************************
+  * @attention
+  *
+  * A register recording holds the bytes the component drivers read from the
+  * output registers of the sensors, so the host can feed the same raw data to
+  * the drivers again (tools/native). The file starts with a
+  * DATALOG_RegHeader_t, then a sequence of frames: the first one
+  * (DATALOG_REGREC_FLAG_CONST) holds the factory calibration registers the
+  * drivers read once, every other one the reads of one sample of
+  * getSensorsData. A frame is a DATALOG_RegFrame_t followed by its entries:
+  * two bytes (DATALOG_REGREC_ENTRY, register address) then the bytes read
+  * from that address on, auto-incremented.
+  * The control registers are not recorded: the drivers write them again when
+  * the recording is played back.
+  * A file cut by a power loss ends at the first frame without
+  * DATALOG_REGREC_SYNC or running past the end of the file.
+  * All values are stored little endian.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_REGFORMAT_H
+#define __DATALOG_REGFORMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DATALOG_REGREC_MAGIC      ((uint32_t)0x52525453)  /* "STRR" */
+#define DATALOG_REGREC_VERSION    ((uint16_t)1)
+#define DATALOG_REGREC_SYNC       ((uint8_t)0xA5)
+
+/* Frame flags */
+#define DATALOG_REGREC_FLAG_CONST      ((uint8_t)0x01)   /* calibration registers, not a sample */
+#define DATALOG_REGREC_FLAG_TRUNCATED  ((uint8_t)0x02)   /* reads of the sample left out, frame full */
+#define DATALOG_REGREC_FLAG_GAP        ((uint8_t)0x04)   /* samples lost before this one */
+
+/* Sensors, in the top 2 bits of the first entry byte */
+#define DATALOG_REGREC_LSM6DSM        ((uint8_t)0)
+#define DATALOG_REGREC_LSM303AGR_MAG  ((uint8_t)1)
+#define DATALOG_REGREC_HTS221         ((uint8_t)2)
+#define DATALOG_REGREC_LPS22HB        ((uint8_t)3)
+#define DATALOG_REGREC_DEVICES        ((uint8_t)4)
+
+/* Register addresses are 7 bit */
+#define DATALOG_REGREC_REGS           ((uint32_t)128)
+
+/* Entry: sensor and number of bytes, register address, bytes */
+#define DATALOG_REGREC_ENTRY_HEADER   ((uint32_t)2)
+#define DATALOG_REGREC_ENTRY_MAX      ((uint32_t)63)
+#define DATALOG_REGREC_ENTRY(dev, len)  ((uint8_t)(((dev) << 6) | ((len) & 0x3FU)))
+#define DATALOG_REGREC_DEVICE(b)        ((uint8_t)((b) >> 6))
+#define DATALOG_REGREC_LENGTH(b)        ((uint8_t)((b) & 0x3FU))
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Header at the start of a register recording.
+  */
+typedef struct
+{
+  uint32_t magic;         /* DATALOG_REGREC_MAGIC */
+  uint16_t version;       /* DATALOG_REGREC_VERSION */
+  uint16_t header_size;   /* offset of the first frame */
+  uint32_t start_ms;      /* firmware time when the file was started */
+  uint16_t period_ms;     /* sampling period of the firmware */
+  uint16_t channel_mask;  /* channels read by getSensorsData (see datalog_format.h) */
+} DATALOG_RegHeader_t;
+
+/**
+  * @brief  Header of a frame, followed by size bytes of entries.
+  */
+typedef struct
+{
+  uint8_t  sync;          /* DATALOG_REGREC_SYNC */
+  uint8_t  flags;         /* DATALOG_REGREC_FLAG_xxx */
+  uint16_t size;          /* bytes of entries after this header */
+  uint32_t ms_counter;    /* time of the sample, as in the log records */
+} DATALOG_RegFrame_t;
+
+#define DATALOG_REGREC_HEADER_SIZE  ((uint32_t)sizeof(DATALOG_RegHeader_t))
+#define DATALOG_REGREC_FRAME_SIZE   ((uint32_t)sizeof(DATALOG_RegFrame_t))
+
+#ifdef __cplusplus
+static_assert(sizeof(DATALOG_RegHeader_t) == 16, "unexpected register recording header padding");
+static_assert(sizeof(DATALOG_RegFrame_t) == 8, "unexpected register frame padding");
+#else
+_Static_assert(sizeof(DATALOG_RegHeader_t) == 16, "unexpected register recording header padding");
+_Static_assert(sizeof(DATALOG_RegFrame_t) == 8, "unexpected register frame padding");
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_REGFORMAT_H */
@@ -0,0 +1,309 @@
+/**
+  ******************************************************************************
+  * @file    datalog_regrec.c
+  * @brief   Sensor register recording (DATALOG_SD_REGISTERS). Each component
+  *          object gets an interposer on its stmdev_ctx_t, as the bus
+  *          profiler: the bytes the drivers read from the output registers
+  *          of a sensor are appended to the frame of the sample in progress,
+  *          written in place in a ring of DATALOG_SD_REGISTERS_FRAMES frames.
+  *          The sampling task closes the frame after getSensorsData, the
+  *          write task copies the closed frames to the SD card log in place
+  *          of the records. When the write task is behind, the sample is
+  *          dropped and the next frame flagged (DATALOG_REGREC_FLAG_GAP).
+  *          The file layout is described in datalog_regformat.h.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_regrec.h"
+#include "datalog_record.h"
+#include <string.h>
+
+#if defined(DATALOG_SD_REGISTERS)
+
+/* Private define ------------------------------------------------------------*/
+#define REGREC_FRAME_WORDS  (DATALOG_SD_REGISTERS_FRAME_SIZE / sizeof(uint32_t))
+
+#if (DATALOG_SD_REGISTERS_FRAME_SIZE % 4) != 0 || (DATALOG_SD_REGISTERS_FRAME_SIZE < 32) || (DATALOG_SD_REGISTERS_FRAMES < 2)
+  #error "DATALOG_SD_REGISTERS_FRAME_SIZE must be a multiple of 4 bytes, at least 32, with at least 2 frames"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/* Interposer of a component object: its original bus */
+typedef struct
+{
+  stmdev_ctx_t Bus;
+  uint8_t Device;
+} RegRec_Ctx_t;
+
+/* Registers recorded, First to Last */
+typedef struct
+{
+  uint8_t First;
+  uint8_t Last;
+} RegRec_Range_t;
+
+/* Private variables ---------------------------------------------------------*/
+extern void *MotionCompObj[];
+extern void *EnvCompObj[];
+
+/* Status and output registers of a sample, by DATALOG_REGREC_xxx sensor */
+static const RegRec_Range_t RegRecOutputs[DATALOG_REGREC_DEVICES] =
+{
+  { LSM6DSM_STATUS_REG,     LSM6DSM_OUTZ_H_XL      },
+  { LSM303AGR_STATUS_REG_M, LSM303AGR_OUTZ_H_REG_M },
+  { HTS221_STATUS_REG,      HTS221_TEMP_OUT_H      },
+  { LPS22HB_STATUS,         LPS22HB_TEMP_OUT_H     }
+};
+
+/* Factory calibration, read by the driver at each conversion */
+static const RegRec_Range_t RegRecHts221Calibration = { HTS221_H0_RH_X2, HTS221_T1_OUT_H };
+
+static RegRec_Ctx_t RegRecCtx[DATALOG_REGREC_DEVICES];
+
+/* Frames of the samples; the sampling task fills the one at RegRecHead */
+static uint32_t RegRecRing[DATALOG_SD_REGISTERS_FRAMES][REGREC_FRAME_WORDS];
+static volatile uint32_t RegRecHead;
+static volatile uint32_t RegRecTail;
+static uint8_t RegRecGap;
+
+/* Calibration frame, written at the start of each file */
+static uint32_t RegRecConst[REGREC_FRAME_WORDS];
+
+static DATALOG_RegRec_Stats_t RegRecStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static int32_t RegRec_Read(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
+static int32_t RegRec_Write(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length);
+static void RegRec_Add(DATALOG_RegFrame_t *Frame, uint8_t Device, uint8_t Reg, const uint8_t *pData, uint16_t Length);
+static void RegRec_Interpose(uint8_t Device, stmdev_ctx_t *Ctx);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Put the interposer on the bus of each sensor found and read the
+  *         calibration registers. The sensors must be set up
+  * @param  None
+  * @retval None
+  */
+void DATALOG_RegRec_Attach(void)
+{
+  DATALOG_RegFrame_t *cal = (DATALOG_RegFrame_t *)RegRecConst;
+  uint8_t buf[DATALOG_REGREC_ENTRY_MAX];
+  uint8_t length;
+
+  memset(RegRecRing[RegRecHead], 0, DATALOG_REGREC_FRAME_SIZE);
+  memset(cal, 0, DATALOG_REGREC_FRAME_SIZE);
+  cal->sync = DATALOG_REGREC_SYNC;
+  cal->flags = DATALOG_REGREC_FLAG_CONST;
+  cal->ms_counter = HAL_GetTick();
+
+  if(EnvCompObj[HTS221_0] != NULL)
+  {
+    stmdev_ctx_t *ctx = &((HTS221_Object_t *)EnvCompObj[HTS221_0])->Ctx;
+
+    /* Through the original bus, before the interposer */
+    length = RegRecHts221Calibration.Last - RegRecHts221Calibration.First + 1U;
+    if(ctx->read_reg(ctx->handle, RegRecHts221Calibration.First, buf, length) == 0)
+    {
+      RegRec_Add(cal, DATALOG_REGREC_HTS221, RegRecHts221Calibration.First, buf, length);
+    }
+    RegRec_Interpose(DATALOG_REGREC_HTS221, ctx);
+  }
+  if(MotionCompObj[LSM6DSM_0] != NULL)
+  {
+    RegRec_Interpose(DATALOG_REGREC_LSM6DSM, &((LSM6DSM_Object_t *)MotionCompObj[LSM6DSM_0])->Ctx);
+  }
+  if(MotionCompObj[LSM303AGR_MAG_0] != NULL)
+  {
+    RegRec_Interpose(DATALOG_REGREC_LSM303AGR_MAG, &((LSM303AGR_MAG_Object_t *)MotionCompObj[LSM303AGR_MAG_0])->Ctx);
+  }
+  if(EnvCompObj[LPS22HB_0] != NULL)
+  {
+    RegRec_Interpose(DATALOG_REGREC_LPS22HB, &((LPS22HB_Object_t *)EnvCompObj[LPS22HB_0])->Ctx);
+  }
+}
+
+/**
+  * @brief  End of a sample, from the sampling task: the frame filled is
+  *         handed to the write task, or dropped if the ring is full
+  * @param  ms_counter: time of the sample
+  * @retval None
+  */
+void DATALOG_RegRec_Sample(uint32_t ms_counter)
+{
+  uint32_t head = RegRecHead;
+  uint32_t next = (head + 1U) % DATALOG_SD_REGISTERS_FRAMES;
+  DATALOG_RegFrame_t *f = (DATALOG_RegFrame_t *)RegRecRing[head];
+
+  RegRecStats.Samples++;
+  if(f->flags & DATALOG_REGREC_FLAG_TRUNCATED)
+  {
+    RegRecStats.Truncated++;
+  }
+
+  if(next == RegRecTail)
+  {
+    RegRecStats.Lost++;
+    RegRecGap = 1;
+  }
+  else
+  {
+    f->sync = DATALOG_REGREC_SYNC;
+    f->ms_counter = ms_counter;
+    if(RegRecGap)
+    {
+      f->flags |= DATALOG_REGREC_FLAG_GAP;
+      RegRecGap = 0;
+    }
+    RegRecHead = next;
+    f = (DATALOG_RegFrame_t *)RegRecRing[next];
+  }
+  f->flags = 0;
+  f->size = 0;
+}
+
+/**
+  * @brief  Start the log data of a new file: header and calibration frame
+  * @param  None
+  * @retval 1 on success, 0 if a write to the card failed
+  */
+uint8_t DATALOG_RegRec_Begin(void)
+{
+  const DATALOG_RegFrame_t *cal = (const DATALOG_RegFrame_t *)RegRecConst;
+  DATALOG_RegHeader_t header;
+
+  header.magic = DATALOG_REGREC_MAGIC;
+  header.version = DATALOG_REGREC_VERSION;
+  header.header_size = (uint16_t)DATALOG_REGREC_HEADER_SIZE;
+  header.start_ms = HAL_GetTick();
+  header.period_ms = (uint16_t)DATA_PERIOD_MS;
+  header.channel_mask = DATALOG_Record_ChannelMask();
+
+  return DATALOG_SD_writeBuf((char *)&header, sizeof(header)) &&
+         DATALOG_SD_writeBuf((char *)RegRecConst, DATALOG_REGREC_FRAME_SIZE + cal->size);
+}
+
+/**
+  * @brief  Append the frames closed by the sampling task to the log, from
+  *         the write task
+  * @param  None
+  * @retval 1 on success, 0 if a write to the card failed
+  */
+uint8_t DATALOG_RegRec_Write(void)
+{
+  uint8_t ret = 1;
+
+  while(RegRecTail != RegRecHead)
+  {
+    const DATALOG_RegFrame_t *f = (const DATALOG_RegFrame_t *)RegRecRing[RegRecTail];
+
+    if(!DATALOG_SD_writeBuf((char *)f, DATALOG_REGREC_FRAME_SIZE + f->size))
+    {
+      ret = 0;
+    }
+    RegRecTail = (RegRecTail + 1U) % DATALOG_SD_REGISTERS_FRAMES;
+  }
+  return ret;
+}
+
+/**
+  * @brief  Frames recorded since power up
+  * @param  Stats: counters
+  * @retval None
+  */
+void DATALOG_RegRec_GetStats(DATALOG_RegRec_Stats_t *Stats)
+{
+  *Stats = RegRecStats;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Interposed read_reg: the reads starting in the output registers
+  *         are recorded
+  * @param  Handle: interposer of the component object
+  * @param  Reg: register address
+  * @param  pData: bytes read
+  * @param  Length: number of bytes
+  * @retval Result of the original bus function
+  */
+static int32_t RegRec_Read(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length)
+{
+  const RegRec_Ctx_t *ctx = (const RegRec_Ctx_t *)Handle;
+  const RegRec_Range_t *out = &RegRecOutputs[ctx->Device];
+  int32_t ret;
+
+  ret = ctx->Bus.read_reg(ctx->Bus.handle, Reg, pData, Length);
+  if((ret == 0) && (Reg >= out->First) && (Reg <= out->Last))
+  {
+    RegRec_Add((DATALOG_RegFrame_t *)RegRecRing[RegRecHead], ctx->Device, Reg, pData, Length);
+  }
+  return ret;
+}
+
+/**
+  * @brief  Interposed write_reg
+  * @param  Handle: interposer of the component object
+  * @param  Reg: register address
+  * @param  pData: bytes written
+  * @param  Length: number of bytes
+  * @retval Result of the original bus function
+  */
+static int32_t RegRec_Write(void *Handle, uint8_t Reg, uint8_t *pData, uint16_t Length)
+{
+  const RegRec_Ctx_t *ctx = (const RegRec_Ctx_t *)Handle;
+
+  return ctx->Bus.write_reg(ctx->Bus.handle, Reg, pData, Length);
+}
+
+/**
+  * @brief  Append a read to a frame; a read that does not fit is left out
+  *         and the frame flagged
+  * @param  Frame: frame filled
+  * @param  Device: DATALOG_REGREC_xxx sensor
+  * @param  Reg: register address
+  * @param  pData: bytes read
+  * @param  Length: number of bytes, only the first DATALOG_REGREC_ENTRY_MAX are kept
+  * @retval None
+  */
+static void RegRec_Add(DATALOG_RegFrame_t *Frame, uint8_t Device, uint8_t Reg, const uint8_t *pData, uint16_t Length)
+{
+  uint8_t *entry = (uint8_t *)Frame + DATALOG_REGREC_FRAME_SIZE + Frame->size;
+  uint32_t length = (Length < DATALOG_REGREC_ENTRY_MAX) ? Length : DATALOG_REGREC_ENTRY_MAX;
+
+  if(DATALOG_REGREC_FRAME_SIZE + Frame->size + DATALOG_REGREC_ENTRY_HEADER + length > DATALOG_SD_REGISTERS_FRAME_SIZE)
+  {
+    Frame->flags |= DATALOG_REGREC_FLAG_TRUNCATED;
+    return;
+  }
+  entry[0] = DATALOG_REGREC_ENTRY(Device, length);
+  entry[1] = Reg;
+  memcpy(&entry[DATALOG_REGREC_ENTRY_HEADER], pData, length);
+  Frame->size += (uint16_t)(DATALOG_REGREC_ENTRY_HEADER + length);
+}
+
+/**
+  * @brief  Route the bus of a component object through the interposer
+  * @param  Device: DATALOG_REGREC_xxx sensor
+  * @param  Ctx: bus of the component object
+  * @retval None
+  */
+static void RegRec_Interpose(uint8_t Device, stmdev_ctx_t *Ctx)
+{
+  RegRec_Ctx_t *ctx = &RegRecCtx[Device];
+
+  /* Already attached */
+  if(Ctx->read_reg == RegRec_Read)
+  {
+    return;
+  }
+  ctx->Bus = *Ctx;
+  ctx->Device = Device;
+  Ctx->read_reg = RegRec_Read;
+  Ctx->write_reg = RegRec_Write;
+  Ctx->handle = ctx;
+}
+
+#endif /* DATALOG_SD_REGISTERS */
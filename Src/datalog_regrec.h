@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    datalog_regrec.h
+  * @brief   Header for datalog_regrec.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_REGREC_H
+#define __DATALOG_REGREC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_application.h"
+#include "datalog_regformat.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Samples;         /* frames closed */
+  uint32_t Lost;            /* frames dropped, the write task was behind */
+  uint32_t Truncated;       /* frames with reads left out */
+} DATALOG_RegRec_Stats_t;
+
+/* Exported functions ------------------------------------------------------- */
+void DATALOG_RegRec_Attach(void);
+void DATALOG_RegRec_Sample(uint32_t ms_counter);
+uint8_t DATALOG_RegRec_Begin(void);
+uint8_t DATALOG_RegRec_Write(void);
+void DATALOG_RegRec_GetStats(DATALOG_RegRec_Stats_t *Stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_REGREC_H */
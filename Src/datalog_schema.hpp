@@ -0,0 +1,346 @@
+/**
+  ******************************************************************************
+  * @file    datalog_schema.hpp
+  * @brief   Compile time description of the logged channels, shared by the
+  *          firmware and the host tools. Header only, C++17.
+  ******************************************************************************
+  * @attention
+  *
+  * Every channel that can be logged is a type giving its identifier (the bit
+  * of the block header channel_mask), value type, name and text format. A log
+  * record is a ChannelList of some of these types: its size, packed layout
+  * and channel mask are constants, and its encode / format functions only
+  * touch the listed channels, so a channel left out of the list costs no
+  * record bytes and no cycles.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_SCHEMA_HPP
+#define __DATALOG_SCHEMA_HPP
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_format.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace datalog {
+
+enum class ChannelType : std::uint8_t { U32, I32, F32 };
+
+/**
+  * @brief  Run time description of a channel
+  */
+struct ChannelDesc
+{
+  std::uint8_t id;          /* DATALOG_CH_xxx, bit of the channel mask */
+  const char  *name;        /* short identifier, used for file names */
+  const char  *title;       /* CSV column title */
+  ChannelType  type;
+  std::uint8_t width;       /* minimum width of the text (F32 only) */
+  std::uint8_t decimals;    /* digits after the point (F32 only) */
+};
+
+template <typename T> constexpr ChannelType channel_type_of();
+template <> constexpr ChannelType channel_type_of<std::uint32_t>() { return ChannelType::U32; }
+template <> constexpr ChannelType channel_type_of<std::int32_t>() { return ChannelType::I32; }
+template <> constexpr ChannelType channel_type_of<float>() { return ChannelType::F32; }
+
+/**
+  * @brief  Base of the channel types. Id is the position of the value in a
+  *         DATALOG_Record_t, get(r) / set(r) access the field of a full record.
+  */
+template <std::uint8_t Id, typename T, std::uint8_t Width = 0, std::uint8_t Decimals = 0>
+struct Channel
+{
+  using value_type = T;
+  static constexpr std::uint8_t id = Id;
+  static constexpr std::uint16_t mask = std::uint16_t(1u << Id);
+  static constexpr std::uint8_t width = Width;
+  static constexpr std::uint8_t decimals = Decimals;
+
+  static_assert(Id < DATALOG_CHANNEL_COUNT, "channel id out of range");
+
+  static T get(const DATALOG_Record_t &r)
+  {
+    T v;
+    std::memcpy(&v, reinterpret_cast<const std::uint8_t *>(&r) + Id * DATALOG_CHANNEL_SIZE, sizeof(v));
+    return v;
+  }
+  static void set(DATALOG_Record_t &r, T v)
+  {
+    std::memcpy(reinterpret_cast<std::uint8_t *>(&r) + Id * DATALOG_CHANNEL_SIZE, &v, sizeof(v));
+  }
+};
+
+/* Sample sources (the firmware T_SensorsData) need ms_counter, pressure,
+   temperature, humidity and acc / gyro / mag with x, y, z members.
+   Label and Line place the channel in the USB terminal text, which keeps
+   the labels and lines of the original firmware */
+#define DATALOG_CHANNEL(Type, Id, T, W, D, Name, Title, Label, Line, Expr)    \
+  struct Type : Channel<Id, T, W, D>                                          \
+  {                                                                           \
+    static constexpr const char *name = Name;                                 \
+    static constexpr const char *title = Title;                               \
+    static constexpr const char *label = Label;                               \
+    static constexpr std::uint8_t line = Line;                                \
+    using Channel<Id, T, W, D>::get;                                          \
+    template <typename S> static T get(const S &s) { return T(Expr); }        \
+  }
+
+DATALOG_CHANNEL(TimestampMs, DATALOG_CH_MS,     std::uint32_t, 0, 0, "t_ms",        "T [ms]",            "TimeStamp: ", 0, s.ms_counter);
+DATALOG_CHANNEL(AccX,        DATALOG_CH_ACC_X,  std::int32_t,  0, 0, "acc_x",       "AccX [mg]",         "Acc_X: ",     1, s.acc.x);
+DATALOG_CHANNEL(AccY,        DATALOG_CH_ACC_Y,  std::int32_t,  0, 0, "acc_y",       "AccY [mg]",         "Acc_Y: ",     1, s.acc.y);
+DATALOG_CHANNEL(AccZ,        DATALOG_CH_ACC_Z,  std::int32_t,  0, 0, "acc_z",       "AccZ [mg]",         "Acc_Z :",     1, s.acc.z);
+DATALOG_CHANNEL(GyroX,       DATALOG_CH_GYRO_X, std::int32_t,  0, 0, "gyro_x",      "GyroX [mdps]",      "Gyro_X:",     2, s.gyro.x);
+DATALOG_CHANNEL(GyroY,       DATALOG_CH_GYRO_Y, std::int32_t,  0, 0, "gyro_y",      "GyroY [mdps]",      "Gyro_Y:",     2, s.gyro.y);
+DATALOG_CHANNEL(GyroZ,       DATALOG_CH_GYRO_Z, std::int32_t,  0, 0, "gyro_z",      "GyroZ [mdps]",      "Gyro_Z:",     2, s.gyro.z);
+DATALOG_CHANNEL(MagX,        DATALOG_CH_MAG_X,  std::int32_t,  0, 0, "mag_x",       "MagX [mgauss]",     "Magn_X:",     3, s.mag.x);
+DATALOG_CHANNEL(MagY,        DATALOG_CH_MAG_Y,  std::int32_t,  0, 0, "mag_y",       "MagY [mgauss]",     "Magn_Y:",     3, s.mag.y);
+DATALOG_CHANNEL(MagZ,        DATALOG_CH_MAG_Z,  std::int32_t,  0, 0, "mag_z",       "MagZ [mgauss]",     "Magn_Z:",     3, s.mag.z);
+DATALOG_CHANNEL(Pressure,    DATALOG_CH_PRESS,  float,         5, 2, "pressure",    "P [mB]",            "Press:",      4, s.pressure);
+DATALOG_CHANNEL(Temperature, DATALOG_CH_TEMP,   float,         5, 2, "temperature", "T [\xB0" "C]",      "Temp:",       4, s.temperature);
+DATALOG_CHANNEL(Humidity,    DATALOG_CH_HUM,    float,         4, 1, "humidity",    "H [%]",             "Hum:",        4, s.humidity);
+
+#undef DATALOG_CHANNEL
+
+template <typename Ch>
+constexpr ChannelDesc descriptor()
+{
+  return ChannelDesc{Ch::id, Ch::name, Ch::title, channel_type_of<typename Ch::value_type>(), Ch::width, Ch::decimals};
+}
+
+/**
+  * @brief  Print one value as text in [p, end), returns the end of the text
+  *         or end if it does not fit. Same format as the original CSV log.
+  */
+template <typename Ch>
+char *format_value(char *p, char *end, typename Ch::value_type v)
+{
+  int n;
+  if constexpr (std::is_same_v<typename Ch::value_type, float>)
+  {
+    n = std::snprintf(p, std::size_t(end - p), "%*.*f", int(Ch::width), int(Ch::decimals), double(v));
+  }
+  else if constexpr (std::is_signed_v<typename Ch::value_type>)
+  {
+    n = std::snprintf(p, std::size_t(end - p), "%ld", long(v));
+  }
+  else
+  {
+    n = std::snprintf(p, std::size_t(end - p), "%lu", static_cast<unsigned long>(v));
+  }
+  return (n < 0 || n >= end - p) ? end : p + n;
+}
+
+/**
+  * @brief  Record made of the listed channels, packed in list order
+  */
+template <typename... Ch>
+struct ChannelList
+{
+  static constexpr std::size_t count = sizeof...(Ch);
+  static constexpr std::size_t record_size = (std::size_t(0) + ... + sizeof(typename Ch::value_type));
+  static constexpr std::uint16_t mask = (std::uint16_t(0) | ... | Ch::mask);
+  static constexpr std::array<ChannelDesc, count> descriptors = {{descriptor<Ch>()...}};
+
+  /* Records are unpacked in channel id order, see unpack_record */
+  static constexpr bool id_ordered()
+  {
+    for (std::size_t i = 1; i < count; i++)
+    {
+      if (descriptors[i - 1].id >= descriptors[i].id)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static_assert(count > 0, "empty channel list");
+
+  /* Position of channel C in the record */
+  template <typename C>
+  static constexpr std::size_t offset()
+  {
+    std::size_t off = 0;
+    bool found = false;
+    ((found = found || std::is_same_v<C, Ch>, off += found ? 0 : sizeof(typename Ch::value_type)), ...);
+    return off;
+  }
+
+  template <typename C>
+  static constexpr bool contains() { return (std::is_same_v<C, Ch> || ...); }
+
+  /* Pack the listed channels of a sample */
+  template <typename S>
+  static void encode(const S &sample, std::uint8_t *out)
+  {
+    ((store(out + offset<Ch>(), Ch::get(sample))), ...);
+  }
+
+  /* Read channel C of a packed record */
+  template <typename C>
+  static typename C::value_type decode(const std::uint8_t *rec)
+  {
+    static_assert(contains<C>(), "channel not in the list");
+    typename C::value_type v;
+    std::memcpy(&v, rec + offset<C>(), sizeof(v));
+    return v;
+  }
+
+  /* Expand a packed record into a full record, absent channels are left as they are */
+  static void decode(const std::uint8_t *rec, DATALOG_Record_t &out)
+  {
+    ((Ch::set(out, decode<Ch>(rec))), ...);
+  }
+
+  /* Print the channels of a sample separated by sep. Returns the end of
+     the text, end if it does not fit */
+  template <typename S>
+  static char *format(const S &sample, char *p, char *end, const char *sep)
+  {
+    bool first = true;
+    auto one = [&](auto value, auto *tag) {
+      using C = std::remove_pointer_t<decltype(tag)>;
+      if (!first)
+      {
+        p = append(p, end, sep);
+      }
+      first = false;
+      p = format_value<C>(p, end, value);
+    };
+    (one(Ch::get(sample), static_cast<Ch *>(nullptr)), ...);
+    return p;
+  }
+
+  /* Print the channels of a sample as the USB terminal text: each one after
+     its label, the channels of a line separated by ", ", the lines by
+     "\r\n ". Returns the end of the text, end if it does not fit */
+  template <typename S>
+  static char *format_text(const S &sample, char *p, char *end)
+  {
+    int line = -1;
+    auto one = [&](auto value, auto *tag) {
+      using C = std::remove_pointer_t<decltype(tag)>;
+      if (line >= 0)
+      {
+        p = append(p, end, (line == C::line) ? ", " : "\r\n ");
+      }
+      line = C::line;
+      p = format_value<C>(append(p, end, C::label), end, value);
+    };
+    (one(Ch::get(sample), static_cast<Ch *>(nullptr)), ...);
+    return p;
+  }
+
+  /* Print channel id of a sample, p is returned if the channel is not listed */
+  template <typename S>
+  static char *format_channel(std::uint8_t id, const S &sample, char *p, char *end)
+  {
+    (void)((Ch::id == id && (p = format_value<Ch>(p, end, Ch::get(sample)), true)) || ...);
+    return p;
+  }
+
+  /* Widen [min, max] of each listed channel to take a sample in, or start
+     them from it if first is set. Only compares, nothing is formatted */
+  template <typename S>
+  static void envelope(const S &sample, DATALOG_Record_t &min, DATALOG_Record_t &max, bool first)
+  {
+    ((widen<Ch>(Ch::get(sample), min, max, first)), ...);
+  }
+
+  /* Print the listed channels as "name: min..max" separated by sep.
+     Returns the end of the text, end if it does not fit */
+  static char *format_envelope(const DATALOG_Record_t &min, const DATALOG_Record_t &max, char *p, char *end,
+                               const char *sep)
+  {
+    bool first = true;
+    auto one = [&](auto *tag) {
+      using C = std::remove_pointer_t<decltype(tag)>;
+      if (!first)
+      {
+        p = append(p, end, sep);
+      }
+      first = false;
+      p = append(append(p, end, C::name), end, ": ");
+      p = format_value<C>(p, end, C::get(min));
+      p = append(p, end, "..");
+      p = format_value<C>(p, end, C::get(max));
+    };
+    (one(static_cast<Ch *>(nullptr)), ...);
+    return p;
+  }
+
+private:
+  template <typename C>
+  static void widen(typename C::value_type v, DATALOG_Record_t &min, DATALOG_Record_t &max, bool first)
+  {
+    if (first || v < C::get(min))
+    {
+      C::set(min, v);
+    }
+    if (first || v > C::get(max))
+    {
+      C::set(max, v);
+    }
+  }
+
+  static char *append(char *p, char *end, const char *text)
+  {
+    const std::size_t len = std::strlen(text);
+    if (std::size_t(end - p) <= len)
+    {
+      return end;
+    }
+    std::memcpy(p, text, len);
+    return p + len;
+  }
+
+  template <typename T>
+  static void store(std::uint8_t *p, T v) { std::memcpy(p, &v, sizeof(v)); }
+};
+
+/** Every channel a log can hold, in DATALOG_Record_t order */
+using AllChannels = ChannelList<TimestampMs, AccX, AccY, AccZ, GyroX, GyroY, GyroZ,
+                                MagX, MagY, MagZ, Pressure, Temperature, Humidity>;
+
+static_assert(AllChannels::record_size == DATALOG_RECORD_SIZE, "DATALOG_Record_t and AllChannels differ");
+static_assert(AllChannels::count == DATALOG_CHANNEL_COUNT, "DATALOG_Record_t and AllChannels differ");
+
+/**
+  * @brief  Expand a record packed with the channels of mask (in id order)
+  *         into a full record, absent channels are zero. For logs written
+  *         by another configuration than the reader's.
+  */
+inline void unpack_record(std::uint16_t mask, const std::uint8_t *rec, DATALOG_Record_t &out)
+{
+  if (mask == AllChannels::mask)
+  {
+    std::memcpy(&out, rec, DATALOG_RECORD_SIZE);
+    return;
+  }
+  std::uint8_t *dst = reinterpret_cast<std::uint8_t *>(&out);
+  for (std::uint32_t id = 0; id < DATALOG_CHANNEL_COUNT; id++)
+  {
+    if (mask & (1u << id))
+    {
+      std::memcpy(dst + id * DATALOG_CHANNEL_SIZE, rec, DATALOG_CHANNEL_SIZE);
+      rec += DATALOG_CHANNEL_SIZE;
+    }
+    else
+    {
+      std::memset(dst + id * DATALOG_CHANNEL_SIZE, 0, DATALOG_CHANNEL_SIZE);
+    }
+  }
+}
+
+} // namespace datalog
+
+#endif /* __DATALOG_SCHEMA_HPP */
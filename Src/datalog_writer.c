@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    datalog_writer.c
+  * @brief   This file gathers the log data into large buffers written whole
+  *          to the SD card. It has no hardware dependency, so the host tools
+  *          build it too.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "datalog_writer.h"
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t *FillBuffer(const DATALOG_Writer_t *w)
+{
+  return &w->buffers[(uint32_t)w->fill * w->size];
+}
+
+/* Move to the next buffer, the caller owns the current one */
+static void NextBuffer(DATALOG_Writer_t *w)
+{
+  w->fill = (uint8_t)((w->fill + 1) % w->count);
+  w->used = 0;
+}
+
+/**
+  * @brief  Prepare an empty writer
+  * @param  w: writer to initialize
+  * @param  buffers: count * size bytes, 4 byte aligned
+  * @param  size: bytes per buffer
+  * @param  count: number of buffers
+  * @param  full: called with each filled buffer
+  * @param  ctx: passed to full
+  * @retval None
+  */
+void DATALOG_Writer_Init(DATALOG_Writer_t *w, uint8_t *buffers, uint32_t size, uint8_t count,
+                         DATALOG_WriterFull_t full, void *ctx)
+{
+  w->buffers = buffers;
+  w->size = size;
+  w->count = count;
+  w->fill = 0;
+  w->used = 0;
+  w->full = full;
+  w->ctx = ctx;
+}
+
+/**
+  * @brief  Append data to the log, handing each filled buffer to w->full
+  * @param  w: writer
+  * @param  data: bytes to append
+  * @param  size: number of bytes
+  * @retval 1 on success, 0 if w->full reported an error (the data is
+  *         still consumed)
+  */
+uint8_t DATALOG_Writer_Write(DATALOG_Writer_t *w, const void *data, uint32_t size)
+{
+  const uint8_t *src = (const uint8_t *)data;
+  uint8_t ret = 1;
+
+  while(size > 0)
+  {
+    uint32_t n = w->size - w->used;
+
+    if(n > size)
+    {
+      n = size;
+    }
+    memcpy(&FillBuffer(w)[w->used], src, n);
+    w->used += n;
+    src += n;
+    size -= n;
+
+    if(w->used == w->size)
+    {
+      uint8_t *buffer = FillBuffer(w);
+
+      NextBuffer(w);
+      if(!w->full(w->ctx, buffer, w->size))
+      {
+        ret = 0;
+      }
+    }
+  }
+  return ret;
+}
+
+/**
+  * @brief  Take the partially filled buffer, to write the end of the log
+  * @param  w: writer
+  * @param  size: set to the number of bytes in the buffer (may be 0)
+  * @retval The buffer, owned by the caller until the next write
+  */
+uint8_t *DATALOG_Writer_Take(DATALOG_Writer_t *w, uint32_t *size)
+{
+  uint8_t *buffer = FillBuffer(w);
+
+  *size = w->used;
+  NextBuffer(w);
+  return buffer;
+}
+
+/**
+  * @brief  Hand the partially filled buffer to w->full, to end a file; the
+  *         data written after goes to the next buffer
+  * @param  w: writer
+  * @retval 1 on success or with nothing to hand over, 0 if w->full
+  *         reported an error
+  */
+uint8_t DATALOG_Writer_Submit(DATALOG_Writer_t *w)
+{
+  uint8_t *buffer;
+  uint32_t size = w->used;
+
+  if(size == 0)
+  {
+    return 1;
+  }
+  buffer = FillBuffer(w);
+  NextBuffer(w);
+  return w->full(w->ctx, buffer, size);
+}
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    datalog_writer.h
+  * @brief   Header for datalog_writer.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DATALOG_WRITER_H
+#define __DATALOG_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Called with each filled buffer. It must return once the next
+  *         buffer can be overwritten; 0 reports a write error.
+  */
+typedef uint8_t (*DATALOG_WriterFull_t)(void *ctx, uint8_t *buffer, uint32_t size);
+
+/**
+  * @brief  Log data copied into count buffers of size bytes used in turn,
+  *         so the device always gets whole buffers (whole sectors when size
+  *         is a multiple of the sector size). The buffers are provided by
+  *         the caller, count * size bytes, 4 byte aligned.
+  */
+typedef struct
+{
+  uint8_t  *buffers;
+  uint32_t size;          /* bytes per buffer */
+  uint8_t  count;         /* number of buffers, at least 2 to overlap copy and write */
+  uint8_t  fill;          /* buffer being filled */
+  uint32_t used;          /* bytes in the buffer being filled */
+  DATALOG_WriterFull_t full;
+  void     *ctx;
+} DATALOG_Writer_t;
+
+/* Exported functions ------------------------------------------------------- */
+void DATALOG_Writer_Init(DATALOG_Writer_t *w, uint8_t *buffers, uint32_t size, uint8_t count,
+                         DATALOG_WriterFull_t full, void *ctx);
+uint8_t DATALOG_Writer_Write(DATALOG_Writer_t *w, const void *data, uint32_t size);
+uint8_t *DATALOG_Writer_Take(DATALOG_Writer_t *w, uint32_t *size);
+uint8_t DATALOG_Writer_Submit(DATALOG_Writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATALOG_WRITER_H */
@@ -49,6 +49,13 @@
 #include "main.h"
 #include "cmsis_os.h"
 #include "datalog_application.h"
+#include "datalog_record.h"
+#include "datalog_preview.h"
+#include "datalog_bench.h"
+#include "datalog_busprof.h"
+#include "datalog_regrec.h"
+#include "datalog_download.h"
+#include "sd_diskio.h"
     
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -56,6 +63,9 @@
 #define DATAQUEUE_SIZE     ((uint32_t)100)
 
 #define DATALOG_CMD_STARTSTOP  (0x00000007)
+#define DATALOG_CMD_CARDTEST   (0x00000008)
+#define DATALOG_CMD_DOWNLOAD   (0x00000009)
+#define DATALOG_CMD_BUSPROF    (0x0000000A)
     
 typedef enum
 {
@@ -78,10 +88,12 @@ osSemaphoreDef(readDataSem);
 
 /* LoggingInterface = USB_Datalog  --> Send sensors data via USB */
 /* LoggingInterface = SDCARD_Datalog  --> Save sensors data on SDCard (enable with double tap) */
+/* LoggingInterface = USB_MassStorage --> Expose the SDCard to the USB host to copy the logs */
 LogInterface_TypeDef LoggingInterface = USB_Datalog;
 
 USBD_HandleTypeDef  USBD_Device;
 static volatile uint8_t MEMSInterrupt = 0;
+static volatile uint8_t DownloadQueued = 0;
 volatile uint8_t no_H_HTS221 = 0;
 volatile uint8_t no_T_HTS221 = 0;
 
@@ -115,7 +127,7 @@ int main(void)
   /* Configure the System clock to 80 MHz */
   SystemClock_Config();
   
-  if(LoggingInterface == USB_Datalog)
+  if(LoggingInterface != SDCARD_Datalog)
   {
     /* Initialize LED */
     BSP_LED_Init(LED1);
@@ -126,7 +138,12 @@ int main(void)
   HAL_PWREx_EnableVddUSB();
   HAL_PWREx_EnableVddIO2();
   
+#if defined(DATALOG_USB_PREVIEW)
+  /* The SD card log also sends its preview over the CDC port */
+  if(LoggingInterface != USB_MassStorage) /* Configure the USB */
+#else
   if(LoggingInterface == USB_Datalog) /* Configure the USB */
+#endif
   {
     /*** USB CDC Configuration ***/
     /* Init Device Library */
@@ -135,12 +152,49 @@ int main(void)
     USBD_RegisterClass(&USBD_Device, USBD_CDC_CLASS);
     /* Add Interface callbacks for AUDIO and CDC Class */
     USBD_CDC_RegisterInterface(&USBD_Device, &USBD_CDC_fops);
+    /* Several tasks send, each one takes the tx buffer in turn */
+    if(!CDC_TxLock_Init())
+    {
+      Error_Handler();
+    }
     /* Start Device Process */
     USBD_Start(&USBD_Device);
   }
+
+  if(LoggingInterface == USB_Datalog)
+  {
+#if defined(DATALOG_USB_DOWNLOAD)
+    /* The host downloads the SD card files over the CDC port */
+    DATALOG_SD_Init();
+#endif
+  }
+  else if(LoggingInterface == USB_MassStorage) /* Configure the USB MSC */
+  {
+    /*** USB MSC Configuration ***/
+    if(!USBD_Storage_Init(&SD_Driver))
+    {
+      Error_Handler();
+    }
+    USBD_Init(&USBD_Device, &MSC_Desc, 0);
+    USBD_RegisterClass(&USBD_Device, USBD_MSC_CLASS);
+    USBD_MSC_RegisterStorage(&USBD_Device, &USBD_Storage_fops);
+    USBD_Start(&USBD_Device);
+    BSP_LED_On(LED1);
+    
+    /* The SCSI commands read and write the card from the USB interrupt:
+       the RTOS is not started, so the SD driver polls instead of waiting
+       on the RTOS, and no sensor is read */
+    for (;;);
+  }
   else /* Configure the SDCard */
   {
     DATALOG_SD_Init();
+#if defined(DATALOG_USB_PREVIEW)
+    if(!DATALOG_Preview_Init())
+    {
+      Error_Handler();
+    }
+#endif
   }
   
   /* Thread 1 definition */
@@ -185,10 +239,24 @@ static void GetData_Thread(void const *argument)
   /* COnfigure LSM6DSM Double Tap interrupt*/  
   LSM6DSM_Sensor_IO_ITConfig();
   
+#if defined(DATALOG_BENCH)
+  /* Sampling starts once the host has the report */
+  if(LoggingInterface == USB_Datalog)
+  {
+    DATALOG_Bench_Report();
+  }
+#endif
+  
   if(LoggingInterface == USB_Datalog)
   {
     dataTimerStart();
   }
+#if defined(DATALOG_SD_CARDTEST_AT_BOOT)
+  else
+  {
+    osMessagePut(dataQueue_id, DATALOG_CMD_CARDTEST, osWaitForever);
+  }
+#endif
   
   for (;;)
   {
@@ -218,11 +286,25 @@ static void GetData_Thread(void const *argument)
       {
         if(getSensorsData(mptr) == BSP_ERROR_NONE)
         {
+#if defined(DATALOG_SD_REGISTERS)
+          /* Before the record: the write task logs the frame when it gets it */
+          if(LoggingInterface == SDCARD_Datalog)
+          {
+            DATALOG_RegRec_Sample(mptr->ms_counter);
+          }
+#endif
           /* Push the new memory Block in the Data Queue */
-          if(osMessagePut(dataQueue_id, (uint32_t)mptr, osWaitForever) != osOK)
+          if(osMessagePut(dataQueue_id, (uintptr_t)mptr, osWaitForever) != osOK)
           {
             Error_Handler();
           }     
+#if defined(DATALOG_BUS_PROFILE)
+          /* The write task reports the period after its last sample */
+          if(DATALOG_BusProf_Sample())
+          {
+            osMessagePut(dataQueue_id, DATALOG_CMD_BUSPROF, osWaitForever);
+          }
+#endif
         }
         else
         {
@@ -283,32 +365,63 @@ static void WriteData_Thread(void const *argument)
           }
         }
       }
+      else if(evt.value.v == DATALOG_CMD_CARDTEST)
+      {
+        if(!SD_Log_Enabled)
+        {
+          DATALOG_SD_CardTest();
+        }
+      }
+      else if(evt.value.v == DATALOG_CMD_DOWNLOAD)
+      {
+        /* No sampling during the session, the data queue would overflow */
+        dataTimerStop();
+        DATALOG_SD_Download();
+        DownloadQueued = 0;
+        dataTimerStart();
+      }
+#if defined(DATALOG_BUS_PROFILE)
+      else if(evt.value.v == DATALOG_CMD_BUSPROF)
+      {
+        DATALOG_BusProf_Send();
+      }
+#endif
       else
       {
         rptr = evt.value.p;
 
         if(LoggingInterface == USB_Datalog)
         {
-          size = sprintf(data_s, "TimeStamp: %ld\r\n Acc_X: %d, Acc_Y: %d, Acc_Z :%d\r\n Gyro_X:%d, Gyro_Y:%d, Gyro_Z:%d\r\n Magn_X:%d, Magn_Y:%d, Magn_Z:%d\r\n Press:%5.2f, Temp:%5.2f, Hum:%4.1f\r\n",
-                       rptr->ms_counter,
-                       (int)rptr->acc.x, (int)rptr->acc.y, (int)rptr->acc.z,
-                       (int)rptr->gyro.x, (int)rptr->gyro.y, (int)rptr->gyro.z,
-                       (int)rptr->mag.x, (int)rptr->mag.y, (int)rptr->mag.z,
-                       rptr->pressure, rptr->temperature, rptr->humidity);
+          /* Nothing is formatted while no host has the port open */
+          size = CDC_IsOpen() ? DATALOG_Record_FormatText(rptr, data_s, sizeof(data_s)) : 0;
           osPoolFree(sensorPool_id, rptr);      // free memory allocated for message
-          BSP_LED_Toggle(LED1);
-          CDC_Fill_Buffer(( uint8_t * )data_s, size);
+          if(size > 0)
+          {
+            BSP_LED_Toggle(LED1);
+            CDC_Fill_Buffer(( uint8_t * )data_s, size);
+          }
         }
         else
         {
-          size = sprintf(data_s, "%ld, %d, %d, %d, %d, %d, %d, %d, %d, %d, %5.2f, %5.2f, %4.1f\r\n",
-                       rptr->ms_counter,
-                       (int)rptr->acc.x, (int)rptr->acc.y, (int)rptr->acc.z,
-                       (int)rptr->gyro.x, (int)rptr->gyro.y, (int)rptr->gyro.z,
-                       (int)rptr->mag.x, (int)rptr->mag.y, (int)rptr->mag.z,
-                       rptr->pressure, rptr->temperature, rptr->humidity);
+#if defined(DATALOG_USB_PREVIEW)
+          DATALOG_Preview_Add(rptr);
+#endif
+#if defined(DATALOG_SD_BINARY)
+          DATALOG_SD_writeRecord(rptr);
           osPoolFree(sensorPool_id, rptr);      // free memory allocated for message
-          DATALOG_SD_writeBuf(data_s, size);
+#elif defined(DATALOG_SD_REGISTERS)
+          /* The record only paces the write task, its frame is the data */
+          osPoolFree(sensorPool_id, rptr);      // free memory allocated for message
+          DATALOG_RegRec_Write();
+#else
+          size = DATALOG_Record_FormatCsv(rptr, data_s, sizeof(data_s));
+          osPoolFree(sensorPool_id, rptr);      // free memory allocated for message
+          if(size > 0)
+          {
+            DATALOG_SD_writeBuf(data_s, size);
+          }
+#endif
+          DATALOG_SD_Rotate();
         }
       }
     }
@@ -316,6 +429,34 @@ static void WriteData_Thread(void const *argument)
 }
 
 
+#if defined(DATALOG_USB_DOWNLOAD)
+/**
+  * @brief  Data received over the USB CDC port, from the USB interrupt:
+  *         queue a download session once a request magic is received,
+  *         unless one is queued or running. Other bytes are dropped and
+  *         the sampling goes on
+  * @param  None
+  * @retval None
+  */
+void CDC_ReceiveCallback(void)
+{
+  /* Little endian, the first bytes of a request header */
+  static const uint8_t magic[2] = { (uint8_t)DATALOG_DL_MAGIC, (uint8_t)(DATALOG_DL_MAGIC >> 8) };
+  
+  /* Only the USB_Datalog mode serves downloads, the SD card log may be running */
+  if(!DownloadQueued && (dataQueue_id != NULL) && (LoggingInterface == USB_Datalog) &&
+     CDC_Seek(magic, sizeof(magic)))
+  {
+    DownloadQueued = 1;
+    if(osMessagePut(dataQueue_id, DATALOG_CMD_DOWNLOAD, 0) != osOK)
+    {
+      DownloadQueued = 0;
+    }
+  }
+}
+#endif
+
+
 void dataTimer_Callback(void const *arg)
 { 
   osSemaphoreRelease(readDataSem_id);
@@ -326,9 +467,11 @@ void dataTimerStart(void)
 {
   osStatus  status;
  
-  // Create periodic timer
+  // Create periodic timer once, later calls only restart it
   exec = 1;
-  sensorTimId = osTimerCreate(osTimer(SensorTimer), osTimerPeriodic, &exec);
+  if (sensorTimId == NULL)  {
+    sensorTimId = osTimerCreate(osTimer(SensorTimer), osTimerPeriodic, &exec);
+  }
   if (sensorTimId)  {
     status = osTimerStart (sensorTimId, DATA_PERIOD_MS);                // start timer
     if (status != osOK)  {
@@ -37,6 +37,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "SensorTile.h"
+#include <string.h>
 
 
 /** @addtogroup BSP
@@ -88,6 +89,7 @@
 
 SPI_HandleTypeDef SPI_SD_Handle;
 DMA_HandleTypeDef hdma_tx;
+DMA_HandleTypeDef hdma_rx;
 
 GPIO_TypeDef* GPIO_PORT[LEDn] = {LED1_GPIO_PORT, LEDSWD_GPIO_PORT};
 const uint32_t GPIO_PIN[LEDn] = {LED1_PIN, LEDSWD_PIN};
@@ -123,6 +125,7 @@ void                      SD_IO_WriteDummy(void);
 void                      SD_IO_WriteByte(uint8_t Data);
 uint8_t                   SD_IO_ReadByte(void);
 void                      SD_IO_WriteDMA(uint8_t *pData, uint16_t Size);
+void                      SD_IO_ReadDMA(uint8_t *pData, uint16_t Size);
 
 /**
 * @}
@@ -318,10 +321,29 @@ static void SD_IO_SPI_MspInit(SPI_HandleTypeDef *hspi)
   /* Associate the initialized DMA handle to the the SPI handle */
   __HAL_LINKDMA(hspi, hdmatx, hdma_tx);
   
+  /* Configure the DMA handler for Reception process */
+  hdma_rx.Instance                 = DMA2_Channel1;
+  hdma_rx.Init.Request             = DMA_REQUEST_3;
+  hdma_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  hdma_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_rx.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  hdma_rx.Init.Mode                = DMA_NORMAL;
+  hdma_rx.Init.Priority            = DMA_PRIORITY_HIGH;
+  
+  HAL_DMA_Init(&hdma_rx);
+  
+  __HAL_LINKDMA(hspi, hdmarx, hdma_rx);
+  
   /*##-4- Configure the NVIC for DMA #########################################*/ 
-  /* NVIC configuration for DMA transfer complete interrupt (SPI1_TX) */
-  HAL_NVIC_SetPriority(DMA2_Channel2_IRQn, 2, 1);
+  /* NVIC configuration for DMA transfer complete interrupt (SPI3_TX) */
+  HAL_NVIC_SetPriority(DMA2_Channel2_IRQn, SENSORTILE_SD_DMA_IRQ_PRIO, 1);
   HAL_NVIC_EnableIRQ(DMA2_Channel2_IRQn);
+  
+  /* NVIC configuration for DMA transfer complete interrupt (SPI3_RX) */
+  HAL_NVIC_SetPriority(DMA2_Channel1_IRQn, SENSORTILE_SD_DMA_IRQ_PRIO, 1);
+  HAL_NVIC_EnableIRQ(DMA2_Channel1_IRQn);
     
 }
 
@@ -552,6 +574,26 @@ void SD_IO_WriteDMA(uint8_t *pData, uint16_t Size)
   
 }
 
+/**
+  * @brief  Reads a block by DMA from the SD.
+  * @param  pData: buffer receiving the Size bytes read.
+  * @param  Size: number of bytes to read.
+  * @note   The buffer is filled with dummy bytes and sent as the TX stream:
+  *         the TX DMA always reads a byte before the RX DMA overwrites it.
+  *         Completion is reported by HAL_SPI_TxRxCpltCallback.
+  * @retval None
+  */
+void SD_IO_ReadDMA(uint8_t *pData, uint16_t Size)
+{
+  memset(pData, SENSORTILE_SD_DUMMY_BYTE, Size);
+  
+  if(HAL_SPI_TransmitReceive_DMA(&SPI_SD_Handle, pData, pData, Size) != HAL_OK)
+  {
+    /* Transfer error in reception process */
+    while(1);
+  }
+}
+
 /**
   * @brief  Reads a byte from the SD.
   * @param  None
@@ -155,6 +155,15 @@ typedef enum
    conditions (interrupts routines ...). */   
 #define SENSORTILE_SD_SPI_TIMEOUT_MAX                   1000
 
+/* DMA interrupts of the SD SPI. The completion callbacks may release an RTOS
+   semaphore, so the priority must not be above (numerically lower than)
+   configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY */
+#define SENSORTILE_SD_DMA_IRQ_PRIO                      5
+/* Longest DMA block transfer and card programming time (write busy, up to
+   250 ms for SDHC and 500 ms for SDXC) before giving up, in ms */
+#define SENSORTILE_SD_TRANSFER_TIMEOUT_MS               100
+#define SENSORTILE_SD_BUSY_TIMEOUT_MS                   500
+
 /**
   * @}
   */ 
@@ -52,6 +52,10 @@ from/to this memory.
 
 /* Includes ------------------------------------------------------------------*/
 #include "SensorTile_sd.h"
+#include <string.h>
+#if (USE_SD_RTOS_WAIT == 1U)
+#include "cmsis_os.h"
+#endif
 
 /** @addtogroup BSP
   * @{
@@ -83,6 +87,8 @@ from/to this memory.
   */
 #define SD_DUMMY_BYTE   0xFF
 #define SD_NO_RESPONSE_EXPECTED 0x80
+#define SD_BUSY_SPIN_BYTES      64    /* busy polls before the task sleeps, ~25 us */
+#define SD_DATA_RESPONSE_BYTES  16    /* bytes read for the data response of a block */
 /**
   * @}
   */
@@ -112,9 +118,23 @@ enum {
 __IO uint8_t SdStatus = SD_PRESENT;
 __IO uint8_t SD_CardType = STD_CAPACITY_SD_CARD_V1_1;
 
+extern SPI_HandleTypeDef SPI_SD_Handle;
+
 /* transfer state */
 __IO uint32_t wTransferState = TRANSFER_WAIT;
 
+#if (USE_SD_RTOS_WAIT == 1U)
+/* released by the SPI DMA callbacks */
+osSemaphoreDef(SdTransferSem);
+static osSemaphoreId SdTransferSemId = NULL;
+#endif
+
+#if (USE_SD_LATENCY_STATS == 1U)
+static SD_WriteStats SdWriteStats;
+/* DWT cycle count at the last data response of a write */
+static uint32_t SdDataResponseCycles;
+#endif
+
 
 /**
   * @}
@@ -123,10 +143,21 @@ __IO uint32_t wTransferState = TRANSFER_WAIT;
 /* Private function prototypes -----------------------------------------------*/
 static uint8_t SD_GetCIDRegister(SD_CID* Cid);
 static uint8_t SD_GetCSDRegister(SD_CSD* Csd);
+static uint8_t SD_GetAUSize(uint32_t *AUBlockNbr);
 static SD_Info SD_GetDataResponse(void);
 static uint8_t SD_GoIdleState(void);
 static uint8_t SD_SendCmd(uint8_t Cmd, uint32_t Arg, uint8_t Crc, uint8_t Response);
 static uint8_t SD_SendCmd_wResp(uint8_t Cmd, uint32_t Arg, uint8_t Crc);
+static uint8_t SD_WriteSingleBlock(uint8_t *pData, uint32_t Sector);
+static uint8_t SD_WriteMultiBlocks(uint8_t *pData, uint32_t Sector, uint32_t NumberOfBlocks);
+static SD_Info SD_WriteDataBlock(uint8_t Token, uint8_t *pData);
+static uint8_t SD_ReadDataBlock(uint8_t *pData);
+static uint32_t SD_WaitTransfer(void);
+static uint8_t SD_WaitReady(void);
+static uint8_t SD_TimedOut(uint32_t StartCycles, uint32_t TimeoutMs);
+#if (USE_SD_LATENCY_STATS == 1U)
+static void SD_WriteStatsAdd(uint32_t StartCycles);
+#endif
 
 /** @defgroup SENSORTILE_SD_Private_Function_Prototypes SENSORTILE_SD Private Function Prototypes
   * @{
@@ -150,6 +181,18 @@ static uint8_t SD_SendCmd_wResp(uint8_t Cmd, uint32_t Arg, uint8_t Crc);
   */
 uint8_t BSP_SD_Init(void)
 { 
+#if (USE_SD_RTOS_WAIT == 1U)
+  if (SdTransferSemId == NULL)
+  {
+    SdTransferSemId = osSemaphoreCreate(osSemaphore(SdTransferSem), 1);
+    /* A binary semaphore is created available */
+    osSemaphoreWait(SdTransferSemId, 0);
+  }
+#endif
+  /* Cycle counter of the timeouts and of the write latency statistics */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  
   /* Configure SPI in Low Speed mode for initialization */
   SD_IO_Init_LS();
   
@@ -194,13 +237,23 @@ uint8_t BSP_SD_GetCardInfo(SD_CardInfo *pCardInfo)
   pCardInfo->CardCapacity *= pCardInfo->CardBlockSize;
   pCardInfo->LogBlockSize= BLOCK_SIZE;
   pCardInfo->LogBlockNbr= (pCardInfo->CardCapacity)/BLOCK_SIZE;
+  
+  /* Erase geometry: the CSD erase sector (SECTOR_SIZE + 1 write blocks) and
+     the allocation unit, the area the card reorganizes as a whole */
+  pCardInfo->EraseBlockNbr = pCardInfo->Csd.EraseGrMul + 1U;
+  if (SD_GetAUSize(&pCardInfo->AUBlockNbr) != MSD_OK)
+  {
+    pCardInfo->AUBlockNbr = 0;
+  }
 
   /* Returns the reponse */
   return status;
 }
 
 /**
-  * @brief  Reads block(s) from a specified address in an SD card, in polling mode. 
+  * @brief  Reads block(s) from a specified address in an SD card. A single
+  *         block is read with CMD17, several blocks with one CMD18; the data
+  *         is received by DMA.
   * @param  pData: Pointer to the buffer that will contain the data to transmit
   * @param  ReadAddr: Address from where data is to be read  
   * @param  BlockSize: SD card data block size, that should be 512
@@ -209,67 +262,56 @@ uint8_t BSP_SD_GetCardInfo(SD_CardInfo *pCardInfo)
   */
 uint8_t BSP_SD_ReadBlocks(uint32_t* p32Data, uint64_t Sector, uint32_t NumberOfBlocks, uint32_t timeout)
 {
-  uint32_t counter = 0, offset = 0;
-  uint8_t rvalue = MSD_ERROR;
+  uint8_t rvalue = MSD_OK;
   uint8_t *pData = (uint8_t *)p32Data;
-  
+  uint8_t multiple = (NumberOfBlocks > 1);
   
   uint16_t BlockSize=BLOCK_SIZE;
-  /* Send CMD16 (SD_CMD_SET_BLOCKLEN) to set the size of the block and 
-     Check if the SD acknowledged the set block length command: R1 response (0x00: no errors) */
-  if (SD_IO_WriteCmd(SD_CMD_SET_BLOCKLEN, BlockSize, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
-  {
-    return MSD_ERROR;
-  }
-
+  
+  /* The waits use SENSORTILE_SD_TRANSFER_TIMEOUT_MS and _BUSY_TIMEOUT_MS */
+  (void)timeout;
+  
   if(SD_CardType != HIGH_CAPACITY_SD_CARD)
   {
+    /* Send CMD16 (SD_CMD_SET_BLOCKLEN) to set the size of the block and 
+       Check if the SD acknowledged the set block length command: R1 response (0x00: no errors).
+       SDHC cards always use 512 byte blocks */
+    if (SD_IO_WriteCmd(SD_CMD_SET_BLOCKLEN, BlockSize, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
+    {
+      return MSD_ERROR;
+    }
     Sector *= 512;
   }
   
-  /* Data transfer */
-  while (NumberOfBlocks--)
+  /* Send dummy byte: 8 Clock pulses of delay */
+  SD_IO_WriteDummy();
+  
+  /* Send CMD17 (SD_CMD_READ_SINGLE_BLOCK) or CMD18 (SD_CMD_READ_MULT_BLOCK) */
+  /* Check if the SD acknowledged the read block command: R1 response (0x00: no errors) */
+  if (SD_IO_WriteCmd(multiple ? SD_CMD_READ_MULT_BLOCK : SD_CMD_READ_SINGLE_BLOCK,
+                     (uint32_t)Sector, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
   {
-    /* Send dummy byte: 8 Clock pulses of delay */
     SD_IO_WriteDummy();
-
-    /* Send CMD17 (SD_CMD_READ_SINGLE_BLOCK) to read one block */
-    /* Check if the SD acknowledged the read block command: R1 response (0x00: no errors) */
-    if (SD_IO_WriteCmd(SD_CMD_READ_SINGLE_BLOCK, Sector + offset, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
-    {
-      return MSD_ERROR;
-    }
-
-    /* Now look for the data token to signify the start of the data */
-    if (SD_IO_WaitResponse(SD_START_DATA_SINGLE_BLOCK_READ) == HAL_OK)
+    return MSD_ERROR;
+  }
+  
+  /* Data transfer, stopped at the first block that does not come */
+  while (NumberOfBlocks-- && rvalue == MSD_OK)
+  {
+    rvalue = SD_ReadDataBlock(pData);
+    pData += BlockSize;
+  }
+  
+  if (multiple)
+  {
+    /* Send CMD12 (SD_CMD_STOP_TRANSMISSION): the card answers after a stuff
+       byte, then may be busy */
+    if (SD_IO_WriteCmd(SD_CMD_STOP_TRANSMISSION, 0, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
     {
-      /* Read the SD block data : read NumByteToRead data */
-      for (counter = 0; counter < BlockSize; counter++)
-      {
-        /* Read the pointed data */
-        *pData = SD_IO_ReadByte();
-        /* Point to the next location where the byte read will be saved */
-        pData++;
-      }
-      
-      /* Set next write address */
-      if(SD_CardType != HIGH_CAPACITY_SD_CARD)
-      {
-        offset += BlockSize;
-      }
-      else
-      {
-        offset += 1;
-      }
-      /* get CRC bytes (not really needed by us, but required by SD) */
-      SD_IO_ReadByte();
-      SD_IO_ReadByte();
-      /* Set response value to success */
-      rvalue = MSD_OK;
+      rvalue = MSD_ERROR;
     }
-    else
+    if (SD_WaitReady() != MSD_OK)
     {
-      /* Set response value to failure */
       rvalue = MSD_ERROR;
     }
   }
@@ -280,8 +322,36 @@ uint8_t BSP_SD_ReadBlocks(uint32_t* p32Data, uint64_t Sector, uint32_t NumberOfB
   return rvalue;
 }
 
+/**
+  * @brief  Receives one data block of a read transaction.
+  * @param  pData: Pointer to the BLOCK_SIZE bytes to receive
+  * @retval SD status
+  */
+static uint8_t SD_ReadDataBlock(uint8_t *pData)
+{
+  /* Now look for the data token to signify the start of the data */
+  if (SD_IO_WaitResponse(SD_START_DATA_SINGLE_BLOCK_READ) != HAL_OK)
+  {
+    return MSD_ERROR;
+  }
+  
+  SD_IO_ReadDMA(pData, BLOCK_SIZE);
+  
+  if (SD_WaitTransfer() != TRANSFER_COMPLETE)
+  {
+    return MSD_ERROR;
+  }
+  
+  /* get CRC bytes (not really needed by us, but required by SD) */
+  SD_IO_ReadByte();
+  SD_IO_ReadByte();
+  return MSD_OK;
+}
+
 /**
   * @brief  Writes block(s) to a specified address in an SD card, in polling mode. 
+  *         A single block is written with CMD24, several blocks with one
+  *         CMD25 so the card programs them without a command in between.
   * @param  pData: Pointer to the buffer that will contain the data to transmit
   * @param  WriteAddr: Address from where data is to be written  
   * @param  BlockSize: SD card data block size, that should be 512
@@ -290,11 +360,16 @@ uint8_t BSP_SD_ReadBlocks(uint32_t* p32Data, uint64_t Sector, uint32_t NumberOfB
   */
 uint8_t BSP_SD_WriteBlocks(uint32_t* p32Data, uint64_t Sector, uint32_t NumberOfBlocks, uint32_t timeout )
 {
-  uint32_t offset = 0;
-  uint8_t rvalue = MSD_ERROR;
+  uint8_t rvalue;
   uint8_t *pData = (uint8_t *)p32Data;
   
   uint16_t BlockSize=BLOCK_SIZE;
+#if (USE_SD_LATENCY_STATS == 1U)
+  uint32_t start = DWT->CYCCNT;
+#endif
+  
+  /* The waits use SENSORTILE_SD_TRANSFER_TIMEOUT_MS and _BUSY_TIMEOUT_MS */
+  (void)timeout;
   
   SENSORTILE_SD_CS_HIGH();
   
@@ -303,64 +378,279 @@ uint8_t BSP_SD_WriteBlocks(uint32_t* p32Data, uint64_t Sector, uint32_t NumberOf
     Sector *= BlockSize;
   }
   
-  /* Data transfer */
-  while (NumberOfBlocks--)
+  if (NumberOfBlocks > 1)
   {
-    
-    /* Send CMD24 (SD_CMD_WRITE_SINGLE_BLOCK) to write blocks  and
-    Check if the SD acknowledged the write block command: R1 response (0x00: no errors) */
-    if (SD_IO_WriteCmd(SD_CMD_WRITE_SINGLE_BLOCK, Sector + offset, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
+    rvalue = SD_WriteMultiBlocks(pData, (uint32_t)Sector, NumberOfBlocks);
+  }
+  else
+  {
+    rvalue = SD_WriteSingleBlock(pData, (uint32_t)Sector);
+  }
+  
+#if (USE_SD_LATENCY_STATS == 1U)
+  if (rvalue == MSD_OK)
+  {
+    SD_WriteStatsAdd(start);
+  }
+#endif
+  return rvalue;
+}
+
+/**
+  * @brief  Writes one block with CMD24.
+  * @param  pData: Pointer to the BLOCK_SIZE bytes to write
+  * @param  Sector: Address of the block (byte address for SDSC cards)
+  * @retval SD status
+  */
+static uint8_t SD_WriteSingleBlock(uint8_t *pData, uint32_t Sector)
+{
+  uint8_t rvalue = MSD_ERROR;
+  
+  /* Send CMD24 (SD_CMD_WRITE_SINGLE_BLOCK) to write blocks  and
+  Check if the SD acknowledged the write block command: R1 response (0x00: no errors) */
+  if (SD_IO_WriteCmd(SD_CMD_WRITE_SINGLE_BLOCK, Sector, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
+  {
+    return MSD_ERROR;
+  }
+  
+  /* Read data response */
+  if (SD_WriteDataBlock(SD_START_DATA_SINGLE_BLOCK_WRITE, pData) == SD_DATA_OK)
+  {
+    /* Set response value to success */
+    rvalue = MSD_OK;
+  }
+  
+  /* Send dummy byte: 8 Clock pulses of delay */
+  SD_IO_WriteDummy();
+  
+  
+  /* Returns the reponse */
+  return rvalue;
+}
+
+/**
+  * @brief  Writes consecutive blocks with a single CMD25 transaction.
+  * @param  pData: Pointer to the NumberOfBlocks * BLOCK_SIZE bytes to write
+  * @param  Sector: Address of the first block (byte address for SDSC cards)
+  * @param  NumberOfBlocks: Number of SD blocks to write
+  * @retval SD status
+  */
+static uint8_t SD_WriteMultiBlocks(uint8_t *pData, uint32_t Sector, uint32_t NumberOfBlocks)
+{
+  uint8_t rvalue = MSD_OK;
+  
+  /* Send ACMD23 (SET_WR_BLK_ERASE_COUNT) so the card can pre-erase the blocks.
+     Only a hint: the write goes on if the card refuses it */
+  if (SD_SendCmd(SD_CMD_APP_CMD, 0, 0xFF, SD_RESPONSE_NO_ERROR) == MSD_OK)
+  {
+    SD_SendCmd(SD_CMD_SD_APP_SET_WR_BLK_ERASE_COUNT, NumberOfBlocks, 0xFF, SD_RESPONSE_NO_ERROR);
+  }
+  
+  /* Send CMD25 (SD_CMD_WRITE_MULT_BLOCK) and check the R1 response (0x00: no errors) */
+  if (SD_IO_WriteCmd(SD_CMD_WRITE_MULT_BLOCK, Sector, 0xFF, SD_RESPONSE_NO_ERROR) != HAL_OK)
+  {
+    SD_IO_WriteDummy();
+    return MSD_ERROR;
+  }
+  
+  /* Data transfer, stopped at the first rejected block */
+  while (NumberOfBlocks-- && rvalue == MSD_OK)
+  {
+    if (SD_WriteDataBlock(SD_START_DATA_MULTIPLE_BLOCK_WRITE, pData) != SD_DATA_OK)
     {
-      return MSD_ERROR;
+      rvalue = MSD_ERROR;
     }
-    
-    /* Send dummy byte */
-    SD_IO_WriteByte(SD_DUMMY_BYTE);
-    
-    /* Send the data token to signify the start of the data */
-    SD_IO_WriteByte(SD_START_DATA_SINGLE_BLOCK_WRITE);
-    
-    SD_IO_WriteDMA((uint8_t*)pData, BlockSize);	
-    pData+= BLOCK_SIZE;
-    
-    while (wTransferState == TRANSFER_WAIT)
-    {
-    } 
-    wTransferState = TRANSFER_WAIT;
-    
-    /* Set next write address */
-    if(SD_CardType != HIGH_CAPACITY_SD_CARD)
+    pData += BLOCK_SIZE;
+  }
+  
+  /* Send the Stop Tran token, also after an error to leave the receive state.
+     The card answers busy after one byte until the last block is programmed */
+  SD_IO_WriteByte(SD_STOP_DATA_MULTIPLE_BLOCK_WRITE);
+  SD_IO_ReadByte();
+  if (SD_WaitReady() != MSD_OK)
+  {
+    rvalue = MSD_ERROR;
+  }
+  
+  /* Send dummy byte: 8 Clock pulses of delay */
+  SD_IO_WriteDummy();
+  
+  return rvalue;
+}
+
+/**
+  * @brief  Sends one data block of a write transaction and waits for the card
+  *         to program it.
+  * @param  Token: Start token, SD_START_DATA_SINGLE_BLOCK_WRITE or
+  *         SD_START_DATA_MULTIPLE_BLOCK_WRITE
+  * @param  pData: Pointer to the BLOCK_SIZE bytes to send
+  * @retval The SD data response, SD_DATA_OK if the block was accepted
+  */
+static SD_Info SD_WriteDataBlock(uint8_t Token, uint8_t *pData)
+{
+  /* Send dummy byte */
+  SD_IO_WriteByte(SD_DUMMY_BYTE);
+  
+  /* Send the data token to signify the start of the data */
+  SD_IO_WriteByte(Token);
+  
+  SD_IO_WriteDMA(pData, BLOCK_SIZE);
+  
+  if (SD_WaitTransfer() != TRANSFER_COMPLETE)
+  {
+    return SD_DATA_OTHER_ERROR;
+  }
+  
+  /* Put CRC bytes (not really needed by us, but required by SD) */
+  SD_IO_ReadByte();
+  SD_IO_ReadByte();
+  
+  /* Read data response, waits while the card is busy */
+  return SD_GetDataResponse();
+}
+
+/**
+  * @brief  Waits for the end of the DMA transfer started by SD_IO_WriteDMA or
+  *         SD_IO_ReadDMA. The calling task sleeps once the scheduler runs.
+  * @param  None
+  * @retval TRANSFER_COMPLETE, or TRANSFER_ERROR on a DMA error or a timeout
+  */
+static uint32_t SD_WaitTransfer(void)
+{
+  uint32_t state;
+  uint32_t start = DWT->CYCCNT;
+  
+  while (wTransferState == TRANSFER_WAIT)
+  {
+#if (USE_SD_RTOS_WAIT == 1U)
+    /* Loop on wTransferState: a release left by a transfer waited for before
+       the scheduler started must not end the wait */
+    if (SdTransferSemId != NULL && osKernelRunning())
     {
-      offset += BlockSize;
+      osSemaphoreWait(SdTransferSemId, SENSORTILE_SD_TRANSFER_TIMEOUT_MS);
     }
-    else
+#endif
+    if (SD_TimedOut(start, SENSORTILE_SD_TRANSFER_TIMEOUT_MS))
     {
-      offset += 1;
+      HAL_SPI_Abort(&SPI_SD_Handle);
+      break;
     }
-    
-    /* Put CRC bytes (not really needed by us, but required by SD) */
-    SD_IO_ReadByte();
-    SD_IO_ReadByte();
-    
-    /* Read data response */
-    if (SD_GetDataResponse() == SD_DATA_OK)
+  }
+  
+  state = (wTransferState == TRANSFER_COMPLETE) ? TRANSFER_COMPLETE : TRANSFER_ERROR;
+  wTransferState = TRANSFER_WAIT;
+  return state;
+}
+
+/**
+  * @brief  Waits while the card holds its output low (busy programming).
+  *         Short waits are polled, longer ones poll once per RTOS tick so the
+  *         other tasks run during the card programming time.
+  * @param  None
+  * @retval SD status, MSD_ERROR if the card is still busy after
+  *         SENSORTILE_SD_BUSY_TIMEOUT_MS
+  */
+static uint8_t SD_WaitReady(void)
+{
+  uint32_t n;
+  uint32_t start = DWT->CYCCNT;
+  
+  for (n = 0; SD_IO_ReadByte() == 0; n++)
+  {
+    if (SD_TimedOut(start, SENSORTILE_SD_BUSY_TIMEOUT_MS))
     {
-      /* Set response value to success */
-      rvalue = MSD_OK;
+      return MSD_ERROR;
     }
-    else
+#if (USE_SD_RTOS_WAIT == 1U)
+    if (n >= SD_BUSY_SPIN_BYTES && osKernelRunning())
     {
-      /* Set response value to failure */
-      rvalue = MSD_ERROR;
+      osDelay(1);
     }
-    
-  }  
-  /* Send dummy byte: 8 Clock pulses of delay */
-  SD_IO_WriteDummy();
+#endif
+  }
+  return MSD_OK;
+}
+
+/**
+  * @brief  Checks a timeout on the DWT cycle counter rather than HAL_GetTick:
+  *         in USB_MassStorage mode the driver runs in the USB interrupt,
+  *         above SysTick, where the tick does not advance. The counter wraps
+  *         after 2^32 cycles, 53 s at 80 MHz.
+  * @param  StartCycles: DWT cycle count at the start of the wait
+  * @param  TimeoutMs: timeout in ms
+  * @retval 1 once TimeoutMs have elapsed, 0 otherwise
+  */
+static uint8_t SD_TimedOut(uint32_t StartCycles, uint32_t TimeoutMs)
+{
+  return (DWT->CYCCNT - StartCycles) > TimeoutMs * (SystemCoreClock / 1000U);
+}
+
+#if (USE_SD_LATENCY_STATS == 1U)
+/**
+  * @brief  Counts a latency in its log2 histogram bucket.
+  * @param  Hist: histogram
+  * @param  Us: latency in microseconds
+  * @retval None
+  */
+static void SD_LatencyAdd(SD_LatencyHist *Hist, uint32_t Us)
+{
+  uint32_t bucket = 0;
   
+  while ((Us >> bucket) > 1U && bucket < SD_LATENCY_BUCKETS - 1U)
+  {
+    bucket++;
+  }
+  Hist->Hist[bucket]++;
+  Hist->Count++;
+  Hist->TotalUs += Us;
+  if (Us > Hist->MaxUs)
+  {
+    Hist->MaxUs = Us;
+  }
+}
+
+/**
+  * @brief  Records the phases of a successful write command.
+  * @param  StartCycles: DWT cycle count when the command was sent
+  * @retval None
+  */
+static void SD_WriteStatsAdd(uint32_t StartCycles)
+{
+  uint32_t end = DWT->CYCCNT;
+  uint32_t cycles_per_us = SystemCoreClock / 1000000U;
   
-  /* Returns the reponse */
-  return rvalue;
+  SD_LatencyAdd(&SdWriteStats.Response, (SdDataResponseCycles - StartCycles) / cycles_per_us);
+  SD_LatencyAdd(&SdWriteStats.Busy, (end - SdDataResponseCycles) / cycles_per_us);
+  SdWriteStats.LastUs = (end - StartCycles) / cycles_per_us;
+  SD_LatencyAdd(&SdWriteStats.Total, SdWriteStats.LastUs);
+}
+#endif
+
+/**
+  * @brief  Copies the write latency statistics (all zero without
+  *         USE_SD_LATENCY_STATS).
+  * @param  pStats: statistics since the last BSP_SD_ResetWriteStats
+  * @retval None
+  */
+void BSP_SD_GetWriteStats(SD_WriteStats *pStats)
+{
+#if (USE_SD_LATENCY_STATS == 1U)
+  *pStats = SdWriteStats;
+#else
+  memset(pStats, 0, sizeof(*pStats));
+#endif
+}
+
+/**
+  * @brief  Clears the write latency statistics.
+  * @param  None
+  * @retval None
+  */
+void BSP_SD_ResetWriteStats(void)
+{
+#if (USE_SD_LATENCY_STATS == 1U)
+  memset(&SdWriteStats, 0, sizeof(SdWriteStats));
+#endif
 }
 
 
@@ -373,8 +663,49 @@ uint8_t BSP_SD_WriteBlocks(uint32_t* p32Data, uint64_t Sector, uint32_t NumberOf
   */
 void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
 {
+  (void)hspi;
   /* Transfer in transmission/reception process is complete */
   wTransferState = TRANSFER_COMPLETE;
+#if (USE_SD_RTOS_WAIT == 1U)
+  if (SdTransferSemId != NULL)
+  {
+    osSemaphoreRelease(SdTransferSemId);
+  }
+#endif
+}
+
+/**
+  * @brief  TxRx Transfer completed callback, end of a DMA block read.
+  * @param  hspi: SPI handle
+  * @retval None
+  */
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  (void)hspi;
+  wTransferState = TRANSFER_COMPLETE;
+#if (USE_SD_RTOS_WAIT == 1U)
+  if (SdTransferSemId != NULL)
+  {
+    osSemaphoreRelease(SdTransferSemId);
+  }
+#endif
+}
+
+/**
+  * @brief  SPI error callback.
+  * @param  hspi: SPI handle
+  * @retval None
+  */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+  (void)hspi;
+  wTransferState = TRANSFER_ERROR;
+#if (USE_SD_RTOS_WAIT == 1U)
+  if (SdTransferSemId != NULL)
+  {
+    osSemaphoreRelease(SdTransferSemId);
+  }
+#endif
 }
 
 /**
@@ -511,6 +842,64 @@ uint8_t SD_GetCSDRegister(SD_CSD* Csd)
   return rvalue;
 }
 
+/**
+  * @brief  Read the allocation unit size (AU_SIZE) of the SD status register.
+  *         The SD status is a 64 byte data block sent after the R2 response
+  *         of ACMD13.
+  * @param  AUBlockNbr: set to the allocation unit in blocks, 0 if the card
+  *         does not report it
+  * @retval SD status
+  */
+static uint8_t SD_GetAUSize(uint32_t *AUBlockNbr)
+{
+  /* AU_SIZE codes: 16 KB to 4 MB in powers of 2, then 8, 12, 16, 24, 32 and 64 MB */
+  static const uint32_t au_blocks[16] =
+  {
+    0, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 24576, 32768, 49152, 65536, 131072
+  };
+  uint32_t counter;
+  uint8_t au_code = 0;
+  uint8_t rvalue = MSD_ERROR;
+  
+  *AUBlockNbr = 0;
+  
+  /* Send CMD55 (SD_CMD_APP_CMD) before any ACMD command */
+  if (SD_SendCmd(SD_CMD_APP_CMD, 0, 0xFF, SD_RESPONSE_NO_ERROR) != MSD_OK)
+  {
+    return MSD_ERROR;
+  }
+  
+  /* Send ACMD13 (SD_STATUS): R2 response, R1 followed by a second status byte */
+  if (SD_IO_WriteCmd(SD_CMD_SD_APP_STATUS, 0, 0xFF, SD_RESPONSE_NO_ERROR) == HAL_OK)
+  {
+    SD_IO_ReadByte();
+    if (SD_IO_WaitResponse(SD_START_DATA_SINGLE_BLOCK_READ) == HAL_OK)
+    {
+      for (counter = 0; counter < 64; counter++)
+      {
+        uint8_t value = SD_IO_ReadByte();
+        
+        /* AU_SIZE, SD status bits [431:428] */
+        if (counter == 10)
+        {
+          au_code = value >> 4;
+        }
+      }
+      
+      /* Get CRC bytes (not really needed by us, but required by SD) */
+      SD_IO_WriteByte(SD_DUMMY_BYTE);
+      SD_IO_WriteByte(SD_DUMMY_BYTE);
+      
+      rvalue = MSD_OK;
+    }
+  }
+  /* Send dummy byte: 8 Clock pulses of delay */
+  SD_IO_WriteDummy();
+  
+  *AUBlockNbr = au_blocks[au_code];
+  return rvalue;
+}
+
 /**
   * @brief  Read the CID card register.
   *         Reading the contents of the CID register in SPI mode is a simple 
@@ -651,9 +1040,15 @@ static uint8_t SD_SendCmd(uint8_t Cmd, uint32_t Arg, uint8_t Crc, uint8_t Respon
 static SD_Info SD_GetDataResponse(void)
 {
   SD_Info response, rvalue= SD_DATA_OTHER_ERROR;
+  uint32_t n = 0;
   
   while (rvalue != SD_DATA_OK)
   {
+    /* The response follows the CRC: a card that does not send it lost the block */
+    if (n++ >= SD_DATA_RESPONSE_BYTES)
+    {
+      return SD_DATA_OTHER_ERROR;
+    }
     
     /* Read response */
     response = (SD_Info)SD_IO_ReadByte();
@@ -685,8 +1080,14 @@ static SD_Info SD_GetDataResponse(void)
     
   }
 
+#if (USE_SD_LATENCY_STATS == 1U)
+  SdDataResponseCycles = DWT->CYCCNT;
+#endif
   /* Wait null data */
-  while (SD_IO_ReadByte() == 0);
+  if (SD_WaitReady() != MSD_OK)
+  {
+    return SD_DATA_WRITE_ERROR;
+  }
   /* Return response */
   return response;
   
@@ -118,8 +118,8 @@ typedef struct
   __IO uint8_t  MaxWrCurrentVDDMin;   /* Max. write current @ VDD min */
   __IO uint8_t  MaxWrCurrentVDDMax;   /* Max. write current @ VDD max */
   __IO uint8_t  DeviceSizeMul;        /* Device size multiplier */
-  __IO uint8_t  EraseGrSize;          /* Erase group size */
-  __IO uint8_t  EraseGrMul;           /* Erase group size multiplier */
+  __IO uint8_t  EraseGrSize;          /* Erase group size (SD: ERASE_BLK_EN) */
+  __IO uint8_t  EraseGrMul;           /* Erase group size multiplier (SD: SECTOR_SIZE, erase sector in write blocks - 1) */
   __IO uint8_t  WrProtectGrSize;      /* Write protect group size */
   __IO uint8_t  WrProtectGrEnable;    /* Write protect group enable */
   __IO uint8_t  ManDeflECC;           /* Manufacturer default ECC */
@@ -172,8 +172,31 @@ typedef struct
   uint32_t LogBlockNbr;                  /*!< Specifies the Card logical Capacity in blocks   */
 
   uint32_t LogBlockSize;                 /*!< Specifies logical block size in bytes           */
+  uint32_t EraseBlockNbr;                /*!< Erase sector in blocks, from the CSD            */
+  uint32_t AUBlockNbr;                   /*!< Allocation unit in blocks, from the SD status;
+                                              0 if the card does not report it               */
 } SD_CardInfo;
 
+/** 
+  * @brief SD write latency statistics, USE_SD_LATENCY_STATS
+  */
+#define SD_LATENCY_BUCKETS        24    /* bucket n: [2^n, 2^(n+1)) us, bucket 0 also 0 us */
+typedef struct
+{
+  uint32_t Count;
+  uint32_t MaxUs;
+  uint64_t TotalUs;
+  uint32_t Hist[SD_LATENCY_BUCKETS];
+} SD_LatencyHist;
+
+typedef struct
+{
+  SD_LatencyHist Response;  /*!< write command sent to the data response of the last block */
+  SD_LatencyHist Busy;      /*!< data response of the last block to the end of the busy     */
+  SD_LatencyHist Total;     /*!< whole write command                                         */
+  uint32_t LastUs;          /*!< duration of the last write command                          */
+} SD_WriteStats;
+
 /**
   * @}
   */
@@ -198,7 +221,7 @@ typedef struct
 #define SD_START_DATA_SINGLE_BLOCK_READ    0xFE  /* Data token start byte, Start Single Block Read */
 #define SD_START_DATA_MULTIPLE_BLOCK_READ  0xFE  /* Data token start byte, Start Multiple Block Read */
 #define SD_START_DATA_SINGLE_BLOCK_WRITE   0xFE  /* Data token start byte, Start Single Block Write */
-#define SD_START_DATA_MULTIPLE_BLOCK_WRITE 0xFD  /* Data token start byte, Start Multiple Block Write */
+#define SD_START_DATA_MULTIPLE_BLOCK_WRITE 0xFC  /* Data token start byte, Start Multiple Block Write */
 #define SD_STOP_DATA_MULTIPLE_BLOCK_WRITE  0xFD  /* Data toke stop byte, Stop Multiple Block Write */
 
 /**
@@ -274,6 +297,8 @@ typedef struct
 #define SD_CMD_SD_APP_STATUS                       ((uint8_t)13)  /*!< (ACMD13) Sends the SD status.                                                              */
 #define SD_CMD_SD_APP_SEND_NUM_WRITE_BLOCKS        ((uint8_t)22)  /*!< (ACMD22) Sends the number of the written (without errors) write blocks. Responds with 
                                                                        32bit+CRC data block.                                                                      */
+#define SD_CMD_SD_APP_SET_WR_BLK_ERASE_COUNT       ((uint8_t)23)  /*!< (ACMD23) Sets the number of write blocks to be pre-erased before writing, used to speed up 
+                                                                       the following CMD25.                                                                       */
 #define SD_CMD_SD_APP_OP_COND                      ((uint8_t)41)  /*!< (ACMD41) Sends host capacity support information (HCS) and asks the accessed card to 
                                                                        send its operating condition register (OCR) content in the response on the CMD line.       */
 #define SD_CMD_SD_APP_SET_CLR_CARD_DETECT          ((uint8_t)42)  /*!< (ACMD42) Connects/Disconnects the 50 KOhm pull-up resistor on CD/DAT3 (pin 1) of the card. */
@@ -303,6 +328,8 @@ uint8_t BSP_SD_WriteBlocks(uint32_t* p32Data, uint64_t Sector, uint32_t NumberOf
 uint8_t BSP_SD_Erase(uint32_t StartAddr, uint32_t EndAddr);
 uint8_t BSP_SD_GetCardState(void);
 uint8_t BSP_SD_GetCardInfo(SD_CardInfo *pCardInfo);
+void BSP_SD_GetWriteStats(SD_WriteStats *pStats);
+void BSP_SD_ResetWriteStats(void);
    
 /* Link functions for SD Card peripheral*/
 void                    SD_IO_Init(void); /*high speed*/
@@ -315,6 +342,7 @@ uint8_t SD_IO_WriteCmd_wResp(uint8_t Cmd, uint32_t Arg, uint8_t Crc);
 HAL_StatusTypeDef       SD_IO_WaitResponse(uint8_t Response);
 void                    SD_IO_WriteDummy(void);
 void SD_IO_WriteDMA(uint8_t *pData, uint16_t Size);
+void SD_IO_ReadDMA(uint8_t *pData, uint16_t Size);
 
 #ifdef __cplusplus
 }
@@ -92,7 +92,13 @@
 #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
 #define configMAX_PRIORITIES                    ( 7 )
 #define configMINIMAL_STACK_SIZE                ( ( uint16_t ) 128 )
-#define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( 13 * 1024 ) )
+/* heap_4, 13 KB for the objects of the original firmware (idle and timer
+   tasks, the two sensor tasks with 2 KB of stack each, the 5 KB sample pool,
+   the queues, semaphores and timer), plus 2.5 KB for the SD log write task
+   of datalog_application.c (2 KB of stack, its TCB, queue and semaphores)
+   and 2.25 KB for the task of datalog_preview.c (DATALOG_USB_PREVIEW), and
+   the mutex of the USB CDC tx buffer (usbd_cdc_interface.c) */
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( ( 13 * 1024 ) + 2560 + 2304 + 96 ) )
 #define configMAX_TASK_NAME_LEN                 ( 16 )
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_16_BIT_TICKS                  0
@@ -58,6 +58,15 @@ extern "C" {
 #define USE_MOTION_SENSOR_LSM303AGR_MAG_0  1U
 #define USE_ENV_SENSOR_HTS221_0            1U
 #define USE_ENV_SENSOR_LPS22HB_0           1U
+
+/* SD card driver: 1U to block the calling task on the DMA completion and
+   while the card is busy programming, instead of spinning. Only once the
+   scheduler runs, the card is initialized and mounted before */
+#define USE_SD_RTOS_WAIT                   1U
+
+/* SD card driver: 1U to time every write command with the DWT cycle counter
+   into log2 latency histograms (BSP_SD_GetWriteStats) */
+#define USE_SD_LATENCY_STATS               1U
   
 #define BSP_LSM6DSM_INT2_GPIO_PORT           GPIOA
 #define BSP_LSM6DSM_INT2_GPIO_CLK_ENABLE()   __GPIOA_CLK_ENABLE()
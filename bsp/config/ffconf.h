@@ -91,7 +91,7 @@
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
-#define	_USE_EXPAND		0
+#define	_USE_EXPAND		1
 /* This option switches f_expand function. (0:Disable or 1:Enable) */
 
 
@@ -284,7 +284,9 @@
 /      can be opened simultaneously under file lock control. Note that the file
 /      lock control is independent of re-entrancy. */
 
+#ifndef _FS_REENTRANT	/* the host disk image build has no RTOS */
 #define _FS_REENTRANT	1
+#endif
 
 #if _FS_REENTRANT
 #include "cmsis_os.h"
@@ -66,6 +66,8 @@ extern "C" {
 #include "usbd_desc.h"
 #include "usbd_cdc.h"
 #include "usbd_cdc_interface.h"
+#include "usbd_msc.h"
+#include "usbd_storage.h"
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
@@ -129,19 +129,12 @@ DSTATUS SD_status(BYTE lun)
 DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 {
   DRESULT res = RES_ERROR;
-  uint32_t timeout = 100000;
 
+  /* Returns once the card is ready again, the wait lets the other tasks run */
   if(BSP_SD_ReadBlocks((uint32_t*)buff, 
                        (uint32_t) (sector), 
                        count, SD_DATATIMEOUT) == MSD_OK)
   {
-    while(BSP_SD_GetCardState()!= MSD_OK)
-    {
-      if (timeout-- == 0)
-      {
-        return RES_ERROR;
-      }
-    }
     res = RES_OK;
   }
   
@@ -160,19 +153,13 @@ DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 {
   DRESULT res = RES_ERROR;
-  uint32_t timeout = 100000;
 
+  /* Returns once the card has programmed the data, the wait lets the other
+     tasks run */
   if(BSP_SD_WriteBlocks((uint32_t*)buff, 
                         (uint32_t)(sector), 
                         count, SD_DATATIMEOUT) == MSD_OK)
   {
-    while(BSP_SD_GetCardState()!= MSD_OK)
-    {
-      if (timeout-- == 0)
-      {
-        return RES_ERROR;
-      }
-    }    
     res = RES_OK;
   }
   
@@ -216,10 +203,11 @@ DRESULT SD_ioctl(BYTE lun, BYTE cmd, void *buff)
     res = RES_OK;
     break;
   
-  /* Get erase block size in unit of sector (DWORD) */
+  /* Get erase block size in unit of sector (DWORD): the allocation unit,
+     or the CSD erase sector when the card does not report it */
   case GET_BLOCK_SIZE :
     BSP_SD_GetCardInfo(&CardInfo);
-    *(DWORD*)buff = CardInfo.LogBlockSize;
+    *(DWORD*)buff = (CardInfo.AUBlockNbr != 0) ? CardInfo.AUBlockNbr : CardInfo.EraseBlockNbr;
     res = RES_OK;
     break;
   
@@ -49,7 +49,6 @@
 /* Private functions ---------------------------------------------------------*/
 
 extern PCD_HandleTypeDef hpcd;
-extern TIM_HandleTypeDef TimHandle;
 extern SPI_HandleTypeDef SPI_SD_Handle;
 
 /******************************************************************************/
@@ -155,24 +154,24 @@ void OTG_FS_IRQHandler(void)
 }
 
 /**
-  * @brief  This function handles DMA Tx interrupt request.
+  * @brief  This function handles DMA Rx interrupt request.
   * @param  None
   * @retval None
   */
-void DMA2_Channel2_IRQHandler(void)
+void DMA2_Channel1_IRQHandler(void)
 {
-  HAL_DMA_IRQHandler(SPI_SD_Handle.hdmatx);
+  HAL_DMA_IRQHandler(SPI_SD_Handle.hdmarx);
 }
+
 /**
-  * @brief  This function handles TIM interrupt request.
+  * @brief  This function handles DMA Tx interrupt request.
   * @param  None
   * @retval None
   */
-void TIM3_IRQHandler(void)
+void DMA2_Channel2_IRQHandler(void)
 {
-  HAL_TIM_IRQHandler(&TimHandle);
+  HAL_DMA_IRQHandler(SPI_SD_Handle.hdmatx);
 }
-
 /**
   * @brief  This function handles External line 7 interrupt request
   * @param  None
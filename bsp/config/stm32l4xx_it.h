@@ -59,9 +59,9 @@ void UsageFault_Handler(void);
 void DebugMon_Handler(void);
 void SysTick_Handler(void);
 void OTG_FS_IRQHandler(void);
-void TIM3_IRQHandler(void);
 void AUDIO_IN_DFSDM_DMA_1st_CH_IRQHandler(void);
 void EXTI2_IRQHandler(void);
+void DMA2_Channel1_IRQHandler(void);
 void DMA2_Channel2_IRQHandler(void);
 void TIM1_CC_IRQHandler(void);
 
@@ -47,12 +47,22 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "usbd_cdc_interface.h"
+#include "usbd_cdc_txring.h"
 #include "main.h"
+#include "cmsis_os.h"
+#include <stdio.h>
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 #define APP_RX_DATA_SIZE  2048
-#define APP_TX_DATA_SIZE  2048
+#define APP_TX_DATA_SIZE  2048  /* power of 2 */
+#define APP_TX_REPORT_SIZE  48  /* overrun report line */
+
+#if defined(CDC_TX_BLOCK_MS)
+  #define APP_TX_BLOCK_MS  CDC_TX_BLOCK_MS
+#else
+  #define APP_TX_BLOCK_MS  0U
+#endif
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
@@ -67,18 +77,18 @@ USBD_CDC_LineCodingTypeDef LineCoding =
 uint8_t UserRxBuffer[APP_RX_DATA_SIZE];/* Received Data over USB are stored in this buffer */
 uint8_t UserTxBuffer[APP_TX_DATA_SIZE];/* Received Data over UART (CDC interface) are stored in this buffer */
 uint8_t UserRxBuffer2[APP_RX_DATA_SIZE];/* Received Data over USB are stored in this buffer */
-uint8_t UserTxBuffer2[APP_TX_DATA_SIZE];/* Received Data over UART (CDC interface) are stored in this buffer */
 uint32_t BuffLength;
-uint32_t UserTxBufPtrIn = 0;/* Increment this pointer or roll it back to
-                               start address when data are received over USART */
-uint32_t UserTxBufPtrOut = 0; /* Increment this pointer or roll it back to
-                                 start address when data are sent over USB */
+static CDC_TxRing_t UserTxRing;        /* Data to send, in UserTxBuffer */
+static CDC_TxOverrun_t UserTxOverrun;  /* Data lost since power up */
+static uint32_t UserTxReported;        /* UserTxOverrun.Dropped in the last report */
+static volatile uint8_t UserTxOpen;    /* DTR set by the host */
+static osMutexId UserTxLockId = NULL;  /* one task at a time writes the ring */
+osMutexDef(UserTxLock);
 
 volatile uint8_t USB_RxBuffer[USB_RxBufferDim];
 volatile uint16_t USB_RxBufferStart_idx = 0;
+static volatile uint16_t USB_RxBufferRead_idx = 0;  /* next byte for CDC_Read */
 
-/* TIM handler declaration */
-TIM_HandleTypeDef  TimHandle;
 /* USB handler declaration */
 extern USBD_HandleTypeDef  USBD_Device;
 
@@ -87,16 +97,21 @@ static int8_t CDC_Itf_Init     (void);
 static int8_t CDC_Itf_DeInit   (void);
 static int8_t CDC_Itf_Control  (uint8_t cmd, uint8_t* pbuf, uint16_t length);
 static int8_t CDC_Itf_Receive  (uint8_t* pbuf, uint32_t *Len);
+static int8_t CDC_Itf_TransmitCplt(uint8_t* pbuf, uint32_t *Len, uint8_t epnum);
 
-static void Error_Handler(void);
-static void TIM_Config(void);
+static uint8_t CDC_Itf_Transmit(uint8_t* pbuf, uint32_t Len);
+static uint8_t CDC_Itf_Write(const uint8_t* pbuf, uint32_t Len, uint32_t Timeout);
+static uint8_t CDC_Itf_Report(void);
+static void CDC_Itf_Lock(void);
+static void CDC_Itf_Unlock(void);
 
 USBD_CDC_ItfTypeDef USBD_CDC_fops = 
 {
   CDC_Itf_Init,
   CDC_Itf_DeInit,
   CDC_Itf_Control,
-  CDC_Itf_Receive
+  CDC_Itf_Receive,
+  CDC_Itf_TransmitCplt
 };
 
 /* Private functions ---------------------------------------------------------*/
@@ -109,28 +124,13 @@ USBD_CDC_ItfTypeDef USBD_CDC_fops =
   */
 static int8_t CDC_Itf_Init(void)
 {
-  /*##-2- Enable TIM peripherals Clock #######################################*/
-  TIMx_CLK_ENABLE();
-  
-   /*##-3- Configure the NVIC for TIMx ########################################*/
-  /* Set Interrupt Group Priority */
-  HAL_NVIC_SetPriority(TIMx_IRQn, 0x6, 0);
-  
-  /* Enable the TIMx global Interrupt */
-  HAL_NVIC_EnableIRQ(TIMx_IRQn);
-  
-  /*##-3- Configure the TIM Base generation  #################################*/
-  TIM_Config();
-  
-  /*##-4- Start the TIM Base generation in interrupt mode ####################*/
-  /* Start Channel1 */
-  if(HAL_TIM_Base_Start_IT(&TimHandle) != HAL_OK)
+  /*##-1- Set Application Buffers ############################################*/
+  /* The data left from a previous connection is sent first */
+  if(UserTxRing.buffer == NULL)
   {
-    /* Starting Error */
-    Error_Handler();
+    CDC_TxRing_Init(&UserTxRing, UserTxBuffer, APP_TX_DATA_SIZE, CDC_Itf_Transmit);
   }
-  
-  /*##-5- Set Application Buffers ############################################*/
+  UserTxRing.sending = 0;
   USBD_CDC_SetTxBuffer(&USBD_Device, UserTxBuffer, 0);
   USBD_CDC_SetRxBuffer(&USBD_Device, UserRxBuffer);
 
@@ -145,6 +145,8 @@ static int8_t CDC_Itf_Init(void)
   */
 static int8_t CDC_Itf_DeInit(void)
 {
+  /* Unplugged: no one reads until the port is opened again */
+  UserTxOpen = 0;
   return (USBD_OK);
 }
 
@@ -203,7 +205,8 @@ static int8_t CDC_Itf_Control (uint8_t cmd, uint8_t* pbuf, uint16_t length)
     break;
 
   case CDC_SET_CONTROL_LINE_STATE:
-    /* Add your code here */
+    /* No data stage, pbuf is the setup request: DTR is bit 0 of wValue */
+    UserTxOpen = (uint8_t)(((USBD_SetupReqTypedef *)(void *)pbuf)->wValue & 0x01U);
     break;
 
   case CDC_SEND_BREAK:
@@ -218,59 +221,288 @@ static int8_t CDC_Itf_Control (uint8_t cmd, uint8_t* pbuf, uint16_t length)
 }
 
 /**
-  * @brief  Fill the usb tx buffer
+  * @brief  Fill the usb tx buffer and start sending it if the IN endpoint
+  *         is idle; otherwise the end of the transfer in flight sends it.
+  *         When data was lost since the last call, a line reporting the
+  *         overrun counters goes first: "#overrun,<calls>,<bytes>".
   * @param  Buf: pointer to the tx buffer
   * @param  TotalLen: number of bytes to be sent
-  * @retval Result of the operation: USBD_OK if all operations are OK
+  * @retval Result of the operation: USBD_OK if all operations are OK,
+  *         USBD_BUSY if the host did not read in time (the data is dropped),
+  *         USBD_FAIL if the port is not open
   */
 uint8_t CDC_Fill_Buffer(uint8_t* Buf, uint32_t TotalLen)
 {
-  uint16_t i;
+  uint8_t ret = USBD_OK;
   
-  for (i = 0; i < TotalLen; i++)
+  if(!CDC_IsOpen())
   {
-    UserTxBuffer[UserTxBufPtrIn] = Buf[i];
-    UserTxBufPtrIn = (UserTxBufPtrIn + 1) % APP_RX_DATA_SIZE;
+    return (USBD_FAIL);
   }
-  return (USBD_OK);
+  
+  /* The report goes right before the data, and the counters have one writer */
+  CDC_Itf_Lock();
+  if(((UserTxOverrun.Dropped != UserTxReported) && !CDC_Itf_Report()) ||
+     !CDC_Itf_Write(Buf, TotalLen, APP_TX_BLOCK_MS))
+  {
+    UserTxOverrun.Dropped++;
+    UserTxOverrun.DroppedBytes += TotalLen;
+    ret = USBD_BUSY;
+  }
+  CDC_Itf_Unlock();
+  return ret;
 }
 
 /**
-  * @brief  TIM period elapsed callback
-  * @param  htim: TIM handle
-  * @retval None
+  * @brief  Send data of any size, waiting for the host to read it. Unlike
+  *         CDC_Fill_Buffer nothing is added to the stream and nothing is
+  *         counted as overrun: the binary protocol of the caller checks
+  *         what it receives.
+  * @param  Buf: data to send
+  * @param  TotalLen: number of bytes
+  * @param  Timeout: ms to wait for room in the tx buffer, for each piece
+  * @retval 1 if all the data was appended, 0 if the host stopped reading
+  */
+uint8_t CDC_Write(const uint8_t* Buf, uint32_t TotalLen, uint32_t Timeout)
+{
+  while(TotalLen > 0U)
+  {
+    uint32_t len = (TotalLen < APP_TX_DATA_SIZE / 2U) ? TotalLen : APP_TX_DATA_SIZE / 2U;
+    uint8_t written;
+    
+    if(!CDC_IsOpen())
+    {
+      return 0;
+    }
+    CDC_Itf_Lock();
+    written = CDC_Itf_Write(Buf, len, Timeout);
+    CDC_Itf_Unlock();
+    if(!written)
+    {
+      return 0;
+    }
+    Buf += len;
+    TotalLen -= len;
+  }
+  return 1;
+}
+
+/**
+  * @brief  Take the data received from the host
+  * @param  Buf: destination
+  * @param  Len: size of Buf
+  * @retval Number of bytes copied, 0 if nothing was received. The receive
+  *         buffer keeps the last USB_RxBufferDim bytes, older ones are lost
+  */
+uint32_t CDC_Read(uint8_t* Buf, uint32_t Len)
+{
+  uint32_t n = 0;
+  uint16_t end = USB_RxBufferStart_idx;
+  
+  while((n < Len) && (USB_RxBufferRead_idx != end))
+  {
+    Buf[n++] = USB_RxBuffer[USB_RxBufferRead_idx];
+    USB_RxBufferRead_idx = (uint16_t)((USB_RxBufferRead_idx + 1U) % USB_RxBufferDim);
+  }
+  return n;
+}
+
+/**
+  * @brief  Drop the data received before the first occurrence of a pattern,
+  *         so CDC_Read starts with it. Without it, only the last Len - 1
+  *         bytes are kept, the start of a pattern still being received.
+  *         Only call it while nothing else reads the data.
+  * @param  Pattern: bytes searched
+  * @param  Len: size of Pattern, 1 to USB_RxBufferDim
+  * @retval 1 if the pattern was received, 0 otherwise
   */
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+uint8_t CDC_Seek(const uint8_t* Pattern, uint32_t Len)
 {
-  uint32_t buffptr;
-  uint32_t buffsize;
+  uint16_t end = USB_RxBufferStart_idx;
+  uint32_t avail = (uint32_t)((end + USB_RxBufferDim - USB_RxBufferRead_idx) % USB_RxBufferDim);
+  uint32_t i;
   
-  if(UserTxBufPtrOut != UserTxBufPtrIn)
+  while(avail >= Len)
   {
-    if(UserTxBufPtrOut > UserTxBufPtrIn) /* Rollback */
+    for(i = 0; (i < Len) && (USB_RxBuffer[(USB_RxBufferRead_idx + i) % USB_RxBufferDim] == Pattern[i]); i++)
     {
-      buffsize = APP_RX_DATA_SIZE - UserTxBufPtrOut;
     }
-    else 
+    if(i == Len)
     {
-      buffsize = UserTxBufPtrIn - UserTxBufPtrOut;
+      return 1;
     }
-    
-    buffptr = UserTxBufPtrOut;
-    
-    USBD_CDC_SetTxBuffer(&USBD_Device, (uint8_t*)&UserTxBuffer[buffptr], buffsize);
+    USB_RxBufferRead_idx = (uint16_t)((USB_RxBufferRead_idx + 1U) % USB_RxBufferDim);
+    avail--;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Data received from the host, called from the USB interrupt.
+  *         The application overrides it to get CDC_Read going.
+  * @param  None
+  * @retval None
+  */
+__weak void CDC_ReceiveCallback(void)
+{
+}
+
+/**
+  * @brief  Create the lock of the tasks writing to the tx buffer. Call it
+  *         before the scheduler starts, CDC_Itf_Init runs in the USB
+  *         interrupt
+  * @param  None
+  * @retval 1 on success, 0 if the mutex could not be created
+  */
+uint8_t CDC_TxLock_Init(void)
+{
+  if(UserTxLockId == NULL)
+  {
+    UserTxLockId = osMutexCreate(osMutex(UserTxLock));
+  }
+  return (UserTxLockId != NULL);
+}
+
+/**
+  * @brief  Check if a host reads the data
+  * @param  None
+  * @retval 1 if the port is open, 0 otherwise: CDC_Fill_Buffer discards
+  *         the data, the caller can skip producing it
+  */
+uint8_t CDC_IsOpen(void)
+{
+#if defined(CDC_TX_WAIT_DTR)
+  return (UserTxRing.buffer != NULL) && UserTxOpen;
+#else
+  return (UserTxRing.buffer != NULL);
+#endif
+}
+
+/**
+  * @brief  Get the overrun counters
+  * @param  overrun: data lost since power up
+  * @retval None
+  */
+void CDC_GetOverrun(CDC_TxOverrun_t *overrun)
+{
+  *overrun = UserTxOverrun;
+}
 
-    if(USBD_CDC_TransmitPacket(&USBD_Device) == USBD_OK)
+/**
+  * @brief  Append data to the tx buffer, all or nothing, and send it if the
+  *         IN endpoint is idle. A full buffer is retried every ms until the
+  *         host reads it or the time is up. Several tasks write (the USB or
+  *         preview output, the reports of the bus profiler or of the
+  *         benchmarks) and the ring has a single writer: call it with
+  *         CDC_Itf_Lock held. The copy runs with the interrupts enabled, the
+  *         transfer completion only reads the write index, published after
+  *         the data; only starting a transfer masks them.
+  * @param  pbuf: data to send
+  * @param  Len: number of bytes
+  * @param  Timeout: ms to wait for room, 0 to drop the data at once
+  * @retval 1 if the data was appended, 0 if it was dropped
+  */
+static uint8_t CDC_Itf_Write(const uint8_t* pbuf, uint32_t Len, uint32_t Timeout)
+{
+  uint32_t primask;
+  uint32_t written;
+  uint32_t start = HAL_GetTick();
+  
+  for(;;)
+  {
+    written = CDC_TxRing_Write(&UserTxRing, pbuf, Len);
+    if(written == Len)
+    {
+      /* Masks the USB interrupt, its transfer completion starts transfers */
+      primask = __get_PRIMASK();
+      __disable_irq();
+      CDC_TxRing_Kick(&UserTxRing);
+      __set_PRIMASK(primask);
+      return 1;
+    }
+    if((Timeout == 0U) || (Len > APP_TX_DATA_SIZE) || !CDC_IsOpen() || (HAL_GetTick() - start >= Timeout))
     {
-      UserTxBufPtrOut += buffsize;
-      if (UserTxBufPtrOut == APP_RX_DATA_SIZE)
-      {
-        UserTxBufPtrOut = 0;
-      }
+      return 0;
     }
+    osDelay(1);
+  }
+}
+
+/**
+  * @brief  Send the overrun counters in the data stream
+  * @param  None
+  * @retval 1 if the report was appended, 0 if it was dropped
+  */
+static uint8_t CDC_Itf_Report(void)
+{
+  char line[APP_TX_REPORT_SIZE];
+  int len = snprintf(line, sizeof(line), "#overrun,%lu,%lu\r\n",
+                     (unsigned long)UserTxOverrun.Dropped, (unsigned long)UserTxOverrun.DroppedBytes);
+  
+  if((len < 0) || ((uint32_t)len >= sizeof(line)) || !CDC_Itf_Write((const uint8_t*)line, (uint32_t)len, APP_TX_BLOCK_MS))
+  {
+    return 0;
+  }
+  UserTxReported = UserTxOverrun.Dropped;
+  return 1;
+}
+
+/**
+  * @brief  Take the tx buffer for the calling task. Without the lock (not
+  *         created) the application has a single writer
+  * @param  None
+  * @retval None
+  */
+static void CDC_Itf_Lock(void)
+{
+  if(UserTxLockId != NULL)
+  {
+    osMutexWait(UserTxLockId, osWaitForever);
+  }
+}
+
+/**
+  * @brief  Give the tx buffer back
+  * @param  None
+  * @retval None
+  */
+static void CDC_Itf_Unlock(void)
+{
+  if(UserTxLockId != NULL)
+  {
+    osMutexRelease(UserTxLockId);
   }
 }
 
+/**
+  * @brief  Start an IN transfer from the tx buffer
+  * @param  pbuf: data to send
+  * @param  Len: number of bytes
+  * @retval 0 if the transfer started
+  */
+static uint8_t CDC_Itf_Transmit(uint8_t* pbuf, uint32_t Len)
+{
+  USBD_CDC_SetTxBuffer(&USBD_Device, pbuf, Len);
+  return USBD_CDC_TransmitPacket(&USBD_Device);
+}
+
+/**
+  * @brief  CDC_Itf_TransmitCplt
+  *         The IN transfer is complete: send the data written meanwhile
+  * @param  pbuf: data sent
+  * @param  Len: number of bytes sent
+  * @param  epnum: IN endpoint
+  * @retval Result of the operation: USBD_OK
+  */
+static int8_t CDC_Itf_TransmitCplt(uint8_t* pbuf, uint32_t *Len, uint8_t epnum)
+{
+  (void)pbuf;
+  (void)Len;
+  (void)epnum;
+  CDC_TxRing_Complete(&UserTxRing);
+  return (USBD_OK);
+}
+
 
 /**
   * @brief  CDC_Itf_DataRx
@@ -305,46 +537,9 @@ static int8_t CDC_Itf_Receive(uint8_t* Buf, uint32_t *Len)
 
   /* Initiate next USB packet transfer */
   USBD_CDC_ReceivePacket(&USBD_Device);
+  CDC_ReceiveCallback();
   return (USBD_OK);
 }
 
 
-/**
-  * @brief  TIM_Config: Configure TIMx timer
-  * @param  None.
-  * @retval None.
-  */
-static void TIM_Config(void)
-{  
-  /* Set TIMx instance */
-  TimHandle.Instance = TIMx;
-  
-  /* Initialize TIM3 peripheral as follow:
-       + Period = 10000 - 1
-       + Prescaler = ((SystemCoreClock/2)/10000) - 1
-       + ClockDivision = 0
-       + Counter direction = Up
-  */
-  TimHandle.Init.Period = (CDC_POLLING_INTERVAL*1000) - 1;
-  TimHandle.Init.Prescaler = 80-1;
-  TimHandle.Init.ClockDivision = 0;
-  TimHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
-  if(HAL_TIM_Base_Init(&TimHandle) != HAL_OK)
-  {
-    /* Initialization Error */
-    Error_Handler();
-  }
-}
-
-
-/**
-  * @brief  This function is executed in case of error occurrence.
-  * @param  None
-  * @retval None
-  */
-static void Error_Handler(void)
-{
-  /* Add your own code here */
-}
-
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
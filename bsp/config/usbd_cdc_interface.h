@@ -53,28 +53,36 @@
 #include "usbd_cdc.h"
 
 /* Exported types ------------------------------------------------------------*/
+/* Data CDC_Fill_Buffer could not send because the host did not read it */
+typedef struct
+{
+  uint32_t Dropped;       /* CDC_Fill_Buffer calls whose data was lost */
+  uint32_t DroppedBytes;
+} CDC_TxOverrun_t;
+
 /* Exported constants --------------------------------------------------------*/
 #define USB_RxBufferDim                         2048
 
-/* Definition for TIMx clock resources */
-#define TIMx                             TIM3
-#define TIMx_CLK_ENABLE                  __HAL_RCC_TIM3_CLK_ENABLE
-#define TIMx_FORCE_RESET()               __HAL_RCC_USART3_FORCE_RESET()
-#define TIMx_RELEASE_RESET()             __HAL_RCC_USART3_RELEASE_RESET()
-
-/* Definition for TIMx's NVIC */
-#define TIMx_IRQn                        TIM3_IRQn
-#define TIMx_IRQHandler                  TIM3_IRQHandler
-
-/* Periodically, the state of the buffer "UserTxBuffer" is checked.
-   The period depends on CDC_POLLING_INTERVAL */
-#define CDC_POLLING_INTERVAL             5 /* in ms. The max is 65 and the min is 1 */
+/* With the tx buffer full, CDC_Fill_Buffer waits up to CDC_TX_BLOCK_MS for
+   the host to read before dropping the data. Comment out to drop at once,
+   so the calling task never waits */
+#define CDC_TX_BLOCK_MS  (20U)
+/* Only send data while the host has the port open (DTR set), as terminals
+   and serial libraries do. Comment out for hosts that never set DTR */
+#define CDC_TX_WAIT_DTR
 
 extern USBD_CDC_ItfTypeDef  USBD_CDC_fops;
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 uint8_t CDC_Fill_Buffer(uint8_t* Buf, uint32_t TotalLen);
+uint8_t CDC_Write(const uint8_t* Buf, uint32_t TotalLen, uint32_t Timeout);
+uint32_t CDC_Read(uint8_t* Buf, uint32_t Len);
+uint8_t CDC_Seek(const uint8_t* Pattern, uint32_t Len);
+void CDC_ReceiveCallback(void);
+uint8_t CDC_TxLock_Init(void);
+uint8_t CDC_IsOpen(void);
+void CDC_GetOverrun(CDC_TxOverrun_t *overrun);
 
 #endif /* __USBD_CDC_IF_H */
 
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_txring.c
+  * @brief   Transmit ring of the USB CDC interface, written with bulk copies
+  *          and sent from the transfer completion instead of a timer poll.
+  *          It has no hardware dependency, so the host tools build it too.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_txring.h"
+#include <string.h>
+
+/* Private macro -------------------------------------------------------------*/
+/* The data must be in the buffer before the completion interrupt sees it */
+#define CDC_TXRING_BARRIER()  __asm volatile ("" ::: "memory")
+
+/**
+  * @brief  Prepare an empty ring
+  * @param  r: ring to initialize
+  * @param  buffer: size bytes
+  * @param  size: buffer size, power of 2
+  * @param  start: starts an IN transfer
+  * @retval None
+  */
+void CDC_TxRing_Init(CDC_TxRing_t *r, uint8_t *buffer, uint32_t size, CDC_TxStart_t start)
+{
+  r->buffer = buffer;
+  r->size = size;
+  r->in = 0;
+  r->out = 0;
+  r->sending = 0;
+  r->start = start;
+}
+
+/**
+  * @brief  Append data, all or nothing. Only one task may write at a
+  *         time: usbd_cdc_interface.c holds a mutex around it. The
+  *         completion only reads the write index, updated after the copy.
+  * @param  r: ring
+  * @param  data: bytes to send
+  * @param  size: number of bytes
+  * @retval size, or 0 if there is not enough room
+  */
+uint32_t CDC_TxRing_Write(CDC_TxRing_t *r, const uint8_t *data, uint32_t size)
+{
+  uint32_t in = r->in;
+  uint32_t ofs = in & (r->size - 1);
+  uint32_t n;
+
+  if(size > r->size - (in - r->out))
+  {
+    return 0;
+  }
+
+  /* Up to the end of the buffer, then from its start */
+  n = r->size - ofs;
+  if(n > size)
+  {
+    n = size;
+  }
+  memcpy(&r->buffer[ofs], data, n);
+  memcpy(r->buffer, &data[n], size - n);
+
+  CDC_TXRING_BARRIER();
+  r->in = in + size;
+  return size;
+}
+
+/**
+  * @brief  Send the contiguous pending data, unless a transfer is in flight.
+  *         Call it with the transfer completion masked.
+  * @param  r: ring
+  * @retval None
+  */
+void CDC_TxRing_Kick(CDC_TxRing_t *r)
+{
+  uint32_t out = r->out;
+  uint32_t pending = r->in - out;
+  uint32_t ofs = out & (r->size - 1);
+  uint32_t n;
+
+  if((r->sending != 0) || (pending == 0))
+  {
+    return;
+  }
+
+  /* The part after the end of the buffer goes with the next transfer */
+  n = r->size - ofs;
+  if(n > pending)
+  {
+    n = pending;
+  }
+  r->sending = n;
+  if(r->start(&r->buffer[ofs], n) != 0)
+  {
+    /* Not connected or busy: the next write tries again */
+    r->sending = 0;
+  }
+}
+
+/**
+  * @brief  Release the data of the completed transfer and send the next
+  * @param  r: ring
+  * @retval None
+  */
+void CDC_TxRing_Complete(CDC_TxRing_t *r)
+{
+  r->out += r->sending;
+  r->sending = 0;
+  CDC_TxRing_Kick(r);
+}
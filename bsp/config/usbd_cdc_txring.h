@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_txring.h
+  * @brief   Header for usbd_cdc_txring.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_TXRING_H
+#define __USBD_CDC_TXRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Starts the IN transfer of size bytes, returns 0 once started
+  */
+typedef uint8_t (*CDC_TxStart_t)(uint8_t *data, uint32_t size);
+
+/**
+  * @brief  Transmit ring of the CDC interface. The application appends data
+  *         with CDC_TxRing_Write; the contiguous pending data is sent in one
+  *         transfer as soon as the previous transfer completes. The indexes
+  *         run free, the buffer size is a power of 2.
+  */
+typedef struct
+{
+  uint8_t           *buffer;
+  uint32_t          size;
+  volatile uint32_t in;       /* bytes written, moved by the application */
+  volatile uint32_t out;      /* bytes sent, moved by the transfer completion */
+  volatile uint32_t sending;  /* bytes of the transfer in flight, 0 when idle */
+  CDC_TxStart_t     start;
+} CDC_TxRing_t;
+
+/* Exported functions ------------------------------------------------------- */
+void CDC_TxRing_Init(CDC_TxRing_t *r, uint8_t *buffer, uint32_t size, CDC_TxStart_t start);
+uint32_t CDC_TxRing_Write(CDC_TxRing_t *r, const uint8_t *data, uint32_t size);
+void CDC_TxRing_Kick(CDC_TxRing_t *r);
+void CDC_TxRing_Complete(CDC_TxRing_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_TXRING_H */
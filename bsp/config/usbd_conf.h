@@ -64,6 +64,8 @@
 #define USBD_SUPPORT_USER_STRING              0 
 #define USBD_SELF_POWERED                     1
 #define USBD_DEBUG_LEVEL                      0
+/* Mass storage: bytes per SD card command of a SCSI read or write */
+#define MSC_MEDIA_PACKET                      4096U
 
 /* Exported macro ------------------------------------------------------------*/
 /* Memory management macros */   
@@ -62,6 +62,7 @@
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 extern USBD_DescriptorsTypeDef VCP_Desc;
+extern USBD_DescriptorsTypeDef MSC_Desc;
 
 #endif /* __USBD_DESC_H */
  
@@ -0,0 +1,183 @@
+/**
+  ******************************************************************************
+  * @file    usbd_storage.c
+  * @brief   USB mass storage media: LUN 0 is the disk of a FatFs disk I/O
+  *          driver, the SD card (sd_diskio.c) on the target, so each SCSI
+  *          READ(10) or WRITE(10) packet of MSC_MEDIA_PACKET bytes is one
+  *          multiple block command to the card. The host tools run the same
+  *          code on a disk image (image_diskio.c).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_storage.h"
+
+/* Private define ------------------------------------------------------------*/
+#define STORAGE_LUN_NBR  1U
+#define STORAGE_BLK_SIZ  512U
+
+/* Private variables ---------------------------------------------------------*/
+static const Diskio_drvTypeDef *StorageDriver = NULL;
+
+/* USB Mass storage Standard Inquiry Data */
+static int8_t STORAGE_Inquirydata[] = {
+  /* LUN 0 */
+  0x00,         /* direct access block device */
+  0x80,         /* removable medium */
+  0x02,         /* SPC-2 */
+  0x02,         /* response data format */
+  (STANDARD_INQUIRY_DATA_LEN - 5),
+  0x00,
+  0x00,
+  0x00,
+  'S', 'T', 'M', ' ', ' ', ' ', ' ', ' ', /* Manufacturer : 8 bytes */
+  'S', 'e', 'n', 's', 'o', 'r', 'T', 'i', /* Product      : 16 Bytes */
+  'l', 'e', ' ', 'S', 'D', ' ', ' ', ' ',
+  '1', '.', '0', '0',                     /* Version      : 4 Bytes */
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static int8_t STORAGE_Init(uint8_t lun);
+static int8_t STORAGE_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *block_size);
+static int8_t STORAGE_IsReady(uint8_t lun);
+static int8_t STORAGE_IsWriteProtected(uint8_t lun);
+static int8_t STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+static int8_t STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+static int8_t STORAGE_GetMaxLun(void);
+
+USBD_StorageTypeDef USBD_Storage_fops =
+{
+  STORAGE_Init,
+  STORAGE_GetCapacity,
+  STORAGE_IsReady,
+  STORAGE_IsWriteProtected,
+  STORAGE_Read,
+  STORAGE_Write,
+  STORAGE_GetMaxLun,
+  STORAGE_Inquirydata,
+};
+
+/**
+  * @brief  Select the disk of the mass storage and initialize it. The log
+  *         must be stopped: the USB host then owns the file system.
+  * @param  drv: FatFs disk I/O driver
+  * @retval 1 if the disk is ready, 0 otherwise
+  */
+uint8_t USBD_Storage_Init(const Diskio_drvTypeDef *drv)
+{
+  StorageDriver = drv;
+  return (drv->disk_initialize(0) & STA_NOINIT) == 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Initializes the storage unit, when the host configures the device
+  * @param  lun: Logical unit number
+  * @retval Status (0 : OK / -1 : Error)
+  */
+static int8_t STORAGE_Init(uint8_t lun)
+{
+  /* USBD_Storage_Init already did. Not retried here, in the USB interrupt:
+     the card initialization waits on HAL_Delay, and the tick does not
+     advance there */
+  if((StorageDriver == NULL) || (StorageDriver->disk_status(lun) & STA_NOINIT))
+  {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Returns the medium capacity.
+  * @param  lun: Logical unit number
+  * @param  block_num: Number of total block number
+  * @param  block_size: Block size
+  * @retval Status (0: OK / -1: Error)
+  */
+static int8_t STORAGE_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
+{
+  DWORD count;
+  WORD size;
+
+  if((StorageDriver == NULL) ||
+     (StorageDriver->disk_ioctl(lun, GET_SECTOR_COUNT, &count) != RES_OK) ||
+     (StorageDriver->disk_ioctl(lun, GET_SECTOR_SIZE, &size) != RES_OK) ||
+     (size != STORAGE_BLK_SIZ))
+  {
+    return -1;
+  }
+  /* Number of blocks, READ CAPACITY reports the last one */
+  *block_num = count;
+  *block_size = size;
+  return 0;
+}
+
+/**
+  * @brief  Checks whether the medium is ready.
+  * @param  lun: Logical unit number
+  * @retval Status (0: OK / -1: Error)
+  */
+static int8_t STORAGE_IsReady(uint8_t lun)
+{
+  if((StorageDriver == NULL) || (StorageDriver->disk_status(lun) & STA_NOINIT))
+  {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Checks whether the medium is write protected.
+  * @param  lun: Logical unit number
+  * @retval Status (0: write enabled / -1: otherwise)
+  */
+static int8_t STORAGE_IsWriteProtected(uint8_t lun)
+{
+  (void)lun;
+  return 0;
+}
+
+/**
+  * @brief  Reads data from the medium.
+  * @param  lun: Logical unit number
+  * @param  buf: data read
+  * @param  blk_addr: Logical block address
+  * @param  blk_len: Blocks number, up to MSC_MEDIA_PACKET / 512
+  * @retval Status (0: OK / -1: Error)
+  */
+static int8_t STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  if(StorageDriver->disk_read(lun, buf, blk_addr, blk_len) != RES_OK)
+  {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Writes data into the medium.
+  * @param  lun: Logical unit number
+  * @param  buf: data to write
+  * @param  blk_addr: Logical block address
+  * @param  blk_len: Blocks number, up to MSC_MEDIA_PACKET / 512
+  * @retval Status (0 : OK / -1 : Error)
+  */
+static int8_t STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  if(StorageDriver->disk_write(lun, buf, blk_addr, blk_len) != RES_OK)
+  {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Returns the Max Supported LUNs.
+  * @param  None
+  * @retval Lun(s) number
+  */
+static int8_t STORAGE_GetMaxLun(void)
+{
+  return (int8_t)(STORAGE_LUN_NBR - 1U);
+}
@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file    usbd_storage.h
+  * @brief   Header for usbd_storage.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_STORAGE_H
+#define __USBD_STORAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_msc.h"
+#include "ff_gen_drv.h"
+
+/* Exported variables --------------------------------------------------------*/
+extern USBD_StorageTypeDef USBD_Storage_fops;
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t USBD_Storage_Init(const Diskio_drvTypeDef *drv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_STORAGE_H */
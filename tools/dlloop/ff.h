@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    ff.h
+  * @brief   FatFs of the download loopback test: the types and functions used
+  *          by Src/datalog_download.c, implemented on a directory of the host
+  *          (host_dir.c) instead of a card image, so the test needs no FatFs
+  *          package.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _FATFS
+#define _FATFS  1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define _MAX_LFN  255
+
+#define FA_READ   0x01
+#define AM_DIR    0x10
+
+/* Exported types ------------------------------------------------------------*/
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef char TCHAR;
+typedef uint32_t FSIZE_t;
+
+/* Same values as FatFs, they are sent in the ERROR frames */
+typedef enum
+{
+  FR_OK = 0,
+  FR_DISK_ERR = 1,
+  FR_NO_FILE = 4,
+  FR_NO_PATH = 5,
+  FR_INVALID_OBJECT = 9
+} FRESULT;
+
+typedef struct
+{
+  FSIZE_t objsize;
+} FFOBJID;
+
+typedef struct
+{
+  FFOBJID obj;
+  FSIZE_t fptr;
+  FILE *host;
+} FIL;
+
+typedef struct
+{
+  void *host;
+} DIR;
+
+typedef struct
+{
+  FSIZE_t fsize;
+  BYTE fattrib;
+  TCHAR fname[_MAX_LFN + 1];
+} FILINFO;
+
+/* Exported macro ------------------------------------------------------------*/
+#define f_size(fp)  ((fp)->obj.objsize)
+#define f_tell(fp)  ((fp)->fptr)
+
+/* Exported functions ------------------------------------------------------- */
+/* Drive "0:/" is the host directory root, until the next call */
+void HOSTDIR_Mount(const char *root);
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_opendir(DIR *dp, const TCHAR *path);
+FRESULT f_closedir(DIR *dp);
+FRESULT f_readdir(DIR *dp, FILINFO *fno);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FATFS */
@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    host_dir.c
+  * @brief   FatFs calls of datalog_download.c on a directory of the host: the
+  *          "0:/" drive is the directory given to HOSTDIR_Mount, read with
+  *          stdio and dirent. Entries are listed in readdir order, like the
+  *          directory entries of a card.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _DEFAULT_SOURCE
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* The DIR of dirent.h is the host directory, ff.h names its own FF_DIR here */
+typedef DIR HostDir_t;
+#define DIR FF_DIR
+#include "ff.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HOSTDIR_DRIVE      "0:/"
+#define HOSTDIR_PATH_SIZE  (4096U)
+
+/* Private variables ---------------------------------------------------------*/
+static char HostRoot[HOSTDIR_PATH_SIZE];
+
+/* Private function prototypes -----------------------------------------------*/
+static FRESULT HostDir_Path(char *out, const TCHAR *path);
+
+/* Exported functions --------------------------------------------------------*/
+
+void HOSTDIR_Mount(const char *root)
+{
+  strncpy(HostRoot, root, sizeof(HostRoot) - 1U);
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+  char host[HOSTDIR_PATH_SIZE];
+  long size;
+
+  memset(fp, 0, sizeof(*fp));
+  if((mode != FA_READ) || (HostDir_Path(host, path) != FR_OK))
+  {
+    return FR_NO_FILE;
+  }
+  fp->host = fopen(host, "rb");
+  if(fp->host == NULL)
+  {
+    return FR_NO_FILE;
+  }
+  if((fseek(fp->host, 0, SEEK_END) != 0) || ((size = ftell(fp->host)) < 0) || (fseek(fp->host, 0, SEEK_SET) != 0))
+  {
+    fclose(fp->host);
+    fp->host = NULL;
+    return FR_DISK_ERR;
+  }
+  fp->obj.objsize = (FSIZE_t)size;
+  return FR_OK;
+}
+
+FRESULT f_close(FIL *fp)
+{
+  if(fp->host == NULL)
+  {
+    return FR_INVALID_OBJECT;
+  }
+  fclose(fp->host);
+  fp->host = NULL;
+  return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+  size_t n = fread(buff, 1, btr, fp->host);
+
+  *br = (UINT)n;
+  fp->fptr += (FSIZE_t)n;
+  return ((n < btr) && ferror(fp->host)) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+  /* FatFs stops at the end of a file opened for reading */
+  if(ofs > fp->obj.objsize)
+  {
+    ofs = fp->obj.objsize;
+  }
+  if(fseek(fp->host, (long)ofs, SEEK_SET) != 0)
+  {
+    return FR_DISK_ERR;
+  }
+  fp->fptr = ofs;
+  return FR_OK;
+}
+
+FRESULT f_opendir(DIR *dp, const TCHAR *path)
+{
+  char host[HOSTDIR_PATH_SIZE];
+
+  if(HostDir_Path(host, path) != FR_OK)
+  {
+    return FR_NO_PATH;
+  }
+  dp->host = opendir(host);
+  return (dp->host != NULL) ? FR_OK : FR_NO_PATH;
+}
+
+FRESULT f_closedir(DIR *dp)
+{
+  if(dp->host == NULL)
+  {
+    return FR_INVALID_OBJECT;
+  }
+  closedir((HostDir_t *)dp->host);
+  dp->host = NULL;
+  return FR_OK;
+}
+
+FRESULT f_readdir(DIR *dp, FILINFO *fno)
+{
+  char host[HOSTDIR_PATH_SIZE];
+  struct dirent *entry;
+  struct stat st;
+
+  memset(fno, 0, sizeof(*fno));
+  do
+  {
+    entry = readdir((HostDir_t *)dp->host);
+  } while((entry != NULL) && ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)));
+
+  /* An empty name ends the listing */
+  if(entry == NULL)
+  {
+    return FR_OK;
+  }
+  if((strlen(entry->d_name) > _MAX_LFN) ||
+     (snprintf(host, sizeof(host), "%s/%s", HostRoot, entry->d_name) >= (int)sizeof(host)) ||
+     (stat(host, &st) != 0))
+  {
+    return FR_DISK_ERR;
+  }
+  strcpy(fno->fname, entry->d_name);
+  fno->fsize = (FSIZE_t)st.st_size;
+  fno->fattrib = S_ISDIR(st.st_mode) ? AM_DIR : 0;
+  return FR_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Host path of a path on the drive
+  * @param  out: host path, HOSTDIR_PATH_SIZE bytes
+  * @param  path: "0:/" followed by a name in the root directory, or nothing
+  * @retval FR_OK, FR_NO_PATH for another drive or a subdirectory
+  */
+static FRESULT HostDir_Path(char *out, const TCHAR *path)
+{
+  const char *name;
+
+  if(strncmp(path, HOSTDIR_DRIVE, strlen(HOSTDIR_DRIVE)) != 0)
+  {
+    return FR_NO_PATH;
+  }
+  name = path + strlen(HOSTDIR_DRIVE);
+  if((strchr(name, '/') != NULL) ||
+     (snprintf(out, HOSTDIR_PATH_SIZE, "%s/%s", HostRoot, name) >= (int)HOSTDIR_PATH_SIZE))
+  {
+    return FR_NO_PATH;
+  }
+  return FR_OK;
+}
@@ -0,0 +1,303 @@
+/**
+  ******************************************************************************
+  * @file    st_dlloop_test.cpp
+  * @brief   Log download over a pseudo terminal loopback: the device side of
+  *          the firmware (datalog_download.c) serves a directory of the host
+  *          to the client of st_logfetch (stlog::DownloadClient), over a link
+  *          throttled to the USB rate or unthrottled, clean or losing and
+  *          corrupting chunks. Each file must arrive byte for byte; the
+  *          throughput of each run is printed.
+  ******************************************************************************
+  */
+#include "datalog_download.h"
+#include "ff.h"
+#include "stlog/download.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// The download settings of the firmware: DATALOG_USB_DOWNLOAD_CHUNK and its write buffers
+constexpr std::uint32_t chunk_size = 4096;
+constexpr std::uint32_t buffer_size = 16384;
+constexpr unsigned window = 16;
+
+int failures = 0;
+
+void check(bool ok, const char* test, const char* what)
+{
+    if (!ok) {
+        std::printf("FAIL %s: %s\n", test, what);
+        failures++;
+    }
+}
+
+/// Device end of the pseudo terminal, with the link model of st_dlsim
+struct Link {
+    int fd = -1;
+    double rate = 0;        ///< bytes/s, 0 for unthrottled
+    double corrupt = 0;     ///< probability that a chunk payload is corrupted
+    double lose = 0;        ///< probability that a chunk frame is lost
+    std::mt19937 rng{1};
+    Clock::time_point free_at = Clock::now();
+    bool chunk_payload = false;
+    bool drop_payload = false;
+    std::uint64_t corrupted = 0;
+    std::uint64_t lost = 0;
+};
+
+Link link_state;
+
+std::uint32_t link_read(std::uint8_t* buf, std::uint32_t size)
+{
+    const ssize_t n = ::read(link_state.fd, buf, size);
+    return n > 0 ? std::uint32_t(n) : 0;
+}
+
+std::uint8_t link_write(const std::uint8_t* buf, std::uint32_t size)
+{
+    Link& l = link_state;
+    std::uniform_real_distribution<double> draw(0.0, 1.0);
+    std::vector<std::uint8_t> copy;
+
+    // The device writes each header, then its payload
+    if (l.chunk_payload) {
+        l.chunk_payload = false;
+        if (l.drop_payload) {
+            return 1;
+        }
+        if (l.corrupt > 0 && draw(l.rng) < l.corrupt) {
+            copy.assign(buf, buf + size);
+            copy[std::uniform_int_distribution<std::uint32_t>(0, size - 1)(l.rng)] ^= 0x55;
+            buf = copy.data();
+            l.corrupted++;
+        }
+    } else if (size == DATALOG_DL_HEADER_SIZE) {
+        DATALOG_DL_Header_t h;
+        std::memcpy(&h, buf, sizeof(h));
+        if (h.magic == DATALOG_DL_MAGIC && h.type == DATALOG_DL_FRM_CHUNK && h.size > 0) {
+            l.chunk_payload = true;
+            l.drop_payload = l.lose > 0 && draw(l.rng) < l.lose;
+            if (l.drop_payload) {
+                l.lost++;
+                return 1;
+            }
+        }
+    }
+
+    if (l.rate > 0) {
+        const auto now = Clock::now();
+        if (l.free_at < now) {
+            l.free_at = now;
+        }
+        l.free_at += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(size / l.rate));
+        if (l.free_at - now > std::chrono::milliseconds(1)) {
+            std::this_thread::sleep_until(l.free_at);
+        }
+    }
+
+    while (size > 0) {
+        const ssize_t n = ::write(l.fd, buf, size);
+        if (n > 0) {
+            buf += n;
+            size -= std::uint32_t(n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return 0;
+        }
+        struct pollfd pfd {l.fd, POLLOUT, 0};
+        if (::poll(&pfd, 1, int(DATALOG_DL_ACK_TIMEOUT_MS)) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+std::uint32_t link_tick()
+{
+    return std::uint32_t(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count());
+}
+
+void link_wait()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/// Pseudo terminal: the device keeps the master, the client opens the slave path
+struct Pty {
+    int master = -1;
+    int slave = -1;
+    std::string path;
+
+    Pty()
+    {
+        master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (master < 0 || ::grantpt(master) != 0 || ::unlockpt(master) != 0 || ::ptsname(master) == nullptr) {
+            return;
+        }
+        path = ::ptsname(master);
+        // Kept open: raw from the start, and no hang up when the client closes
+        slave = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+        struct termios tio {};
+        if (slave >= 0 && ::tcgetattr(slave, &tio) == 0) {
+            ::cfmakeraw(&tio);
+            ::tcsetattr(slave, TCSANOW, &tio);
+        }
+    }
+    ~Pty()
+    {
+        if (slave >= 0) {
+            ::close(slave);
+        }
+        if (master >= 0) {
+            ::close(master);
+        }
+    }
+    bool ok() const { return slave >= 0; }
+};
+
+std::vector<std::uint8_t> pattern(std::size_t size, std::uint32_t seed)
+{
+    std::vector<std::uint8_t> data(size);
+    std::mt19937 rng(seed);
+    for (auto& b : data) {
+        b = std::uint8_t(rng() >> 24);
+    }
+    return data;
+}
+
+struct LogFile {
+    std::string name;
+    std::vector<std::uint8_t> data;
+};
+
+/// Download all the files of the directory, check them and print the throughput
+void run(const char* test, const std::vector<LogFile>& files, double rate, double corrupt, double lose)
+{
+    Pty pty;
+    check(pty.ok(), test, "pseudo terminal");
+    if (!pty.ok()) {
+        return;
+    }
+    link_state = Link{};
+    link_state.fd = pty.master;
+    link_state.rate = rate;
+    link_state.corrupt = corrupt;
+    link_state.lose = lose;
+
+    // Sessions are served until the test is over, as the firmware does on each request
+    std::atomic<bool> stop{false};
+    std::thread device([&] {
+        const DATALOG_DL_Link_t link = {link_read, link_write, link_tick, link_wait};
+        std::vector<std::uint32_t> buffer(buffer_size / sizeof(std::uint32_t));
+        while (!stop) {
+            DATALOG_Download_Session(&link, "0:/", reinterpret_cast<std::uint8_t*>(buffer.data()),
+                                     buffer_size, chunk_size);
+        }
+    });
+
+    stlog::DownloadStats total;
+    try {
+        stlog::DownloadClient client(pty.path);
+        const auto remote = client.list();
+        check(client.chunk_size() == chunk_size, test, "chunk size of the listing");
+        check(remote.size() == files.size(), test, "number of files listed, the directory skipped");
+        for (const auto& r : remote) {
+            const LogFile* expected = nullptr;
+            for (const auto& f : files) {
+                expected = (f.name == r.name) ? &f : expected;
+            }
+            check(expected != nullptr, test, "file listed that is not in the directory");
+            if (expected == nullptr) {
+                continue;
+            }
+            check(r.size == expected->data.size(), test, "file size listed");
+            stlog::DownloadStats st;
+            const auto data = client.read(r, window, 8, &st);
+            check(data == expected->data, test, "file content received");
+            total.bytes += st.bytes;
+            total.seconds += st.seconds;
+            total.bad_chunks += st.bad_chunks;
+            total.requests += st.requests;
+        }
+    } catch (const std::exception& e) {
+        check(false, test, e.what());
+    }
+    stop = true;
+    device.join();
+
+    if (rate > 0) {
+        std::printf("%-9s link %.0f B/s: ", test, rate);
+    } else {
+        std::printf("%-9s link unthrottled: ", test);
+    }
+    std::printf("%llu bytes in %.3f s, %.3f MB/s, %llu chunks corrupted and %llu lost, %llu bad chunks, "
+                "%llu requests\n",
+                static_cast<unsigned long long>(total.bytes), total.seconds,
+                total.seconds > 0 ? double(total.bytes) / total.seconds / 1e6 : 0.0,
+                static_cast<unsigned long long>(link_state.corrupted),
+                static_cast<unsigned long long>(link_state.lost),
+                static_cast<unsigned long long>(total.bad_chunks),
+                static_cast<unsigned long long>(total.requests));
+    if (corrupt > 0 || lose > 0) {
+        check(link_state.corrupted + link_state.lost > 0, test, "no chunk corrupted or lost by the link");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    // Log files of the card: sizes off and on the chunk size, an empty one
+    const std::vector<LogFile> files = {
+        {"SensorTile_Log_N000.csv", pattern(2 * 1024 * 1024 + 123, 1)},
+        {"SensorTile_Log_N001.stlog", pattern(64 * chunk_size, 2)},
+        {"SD_Card_Report.txt", {}},
+    };
+
+    std::string root = (fs::temp_directory_path() / "st_dlloop_XXXXXX").string();
+    if (::mkdtemp(root.data()) == nullptr) {
+        std::printf("FAIL setup: %s\n", std::strerror(errno));
+        return 1;
+    }
+    for (const auto& f : files) {
+        std::ofstream out(fs::path(root) / f.name, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(f.data.data()), std::streamsize(f.data.size()));
+    }
+    // Not listed
+    fs::create_directory(fs::path(root) / "System Volume Information");
+    HOSTDIR_Mount(root.c_str());
+
+    run("usb", files, 1e6, 0, 0);
+    run("pty", files, 0, 0, 0);
+    run("lossy", files, 0, 0.02, 0.02);
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    if (failures == 0) {
+        std::printf("st_dlloop_test: all passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
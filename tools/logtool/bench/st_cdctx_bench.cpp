@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file    st_cdctx_bench.cpp
+  * @brief   USB CDC transmit path of the firmware (bsp/config/usbd_cdc_txring.c)
+  *          against a stubbed USBD_CDC_TransmitPacket with simulated bus
+  *          timings: throughput, dropped writes and latency of the data sent
+  *          from the transfer completion, and of the former 5 ms timer poll.
+  ******************************************************************************
+  */
+#include "usbd_cdc_txring.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-r bytes/s] [-l bytes] [-s seconds] [-b bytes] [-u us] [-t ms]\n"
+        "  -r  data rate of the application (default: 2000000, more than the bus)\n"
+        "  -l  bytes per CDC_Fill_Buffer call (default: 120, a CSV line)\n"
+        "  -s  simulated time (default: 10 s)\n"
+        "  -b  transmit buffer size, power of 2 (default: 2048)\n"
+        "  -u  bus time per 64 byte packet (default: 50 us, about 1.2 MB/s)\n"
+        "  -t  poll period of the timer driven version (default: 5 ms)\n",
+        argv0);
+}
+
+constexpr std::uint32_t packet_size = 64;
+
+/// Stubbed USB device: one IN transfer at a time, completed after the bus time of its packets
+struct Device {
+    double packet_us;
+    bool busy = false;
+    bool in_completion = false; ///< the timer version starts nothing from the completion
+    double done_us = 0;
+    std::uint64_t transfers = 0;
+};
+
+Device* device = nullptr;
+double now_us = 0;
+
+std::uint8_t transmit_packet(std::uint8_t* data, std::uint32_t size)
+{
+    (void)data;
+    if (device->busy || device->in_completion) {
+        return 1; // USBD_BUSY
+    }
+    // A transfer that is a multiple of the packet size ends with a zero length packet
+    const std::uint32_t packets = size / packet_size + 1;
+    device->busy = true;
+    device->done_us = now_us + packets * device->packet_us;
+    device->transfers++;
+    return 0;
+}
+
+struct Result {
+    double sent_bytes = 0;
+    std::uint64_t writes = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t transfers = 0;
+    double latency_sum_us = 0;
+    double latency_max_us = 0;
+    std::uint64_t latency_count = 0;
+};
+
+/// Run the application writes for the simulated time, kicking the ring on
+/// each write and transfer completion, or every poll_us when poll_us > 0
+Result run(double rate, std::uint32_t line, double seconds, std::uint32_t ring_size, double packet_us,
+           double poll_us)
+{
+    std::vector<std::uint8_t> storage(ring_size);
+    std::vector<std::uint8_t> data(line, 'x');
+    CDC_TxRing_t ring;
+    CDC_TxRing_Init(&ring, storage.data(), ring_size, transmit_packet);
+    Device dev{packet_us};
+    device = &dev;
+    now_us = 0;
+
+    // End offset in the ring and write time of the lines not sent yet
+    std::deque<std::pair<std::uint32_t, double>> lines;
+    Result res;
+    const double period_us = double(line) * 1e6 / rate;
+    const double end_us = seconds * 1e6;
+    double write_us = 0;
+    double tick_us = poll_us;
+
+    while (true) {
+        double next = write_us;
+        if (dev.busy) {
+            next = std::min(next, dev.done_us);
+        }
+        if (poll_us > 0) {
+            next = std::min(next, tick_us);
+        }
+        if (next > end_us) {
+            break;
+        }
+        now_us = next;
+
+        if (dev.busy && dev.done_us == now_us) {
+            dev.busy = false;
+            // The timer version only releases the data, the next tick sends more
+            dev.in_completion = poll_us > 0;
+            CDC_TxRing_Complete(&ring);
+            dev.in_completion = false;
+            while (!lines.empty() && std::int32_t(ring.out - lines.front().first) >= 0) {
+                const double latency = now_us - lines.front().second;
+                res.latency_sum_us += latency;
+                res.latency_max_us = std::max(res.latency_max_us, latency);
+                res.latency_count++;
+                lines.pop_front();
+            }
+        } else if (poll_us > 0 && tick_us == now_us) {
+            CDC_TxRing_Kick(&ring);
+            tick_us += poll_us;
+        } else {
+            res.writes++;
+            if (CDC_TxRing_Write(&ring, data.data(), line) != line) {
+                res.dropped++;
+            } else {
+                lines.emplace_back(ring.in, now_us);
+                if (poll_us == 0) {
+                    CDC_TxRing_Kick(&ring);
+                }
+            }
+            write_us += period_us;
+        }
+    }
+    res.sent_bytes = ring.out;
+    res.transfers = dev.transfers;
+    return res;
+}
+
+void print(const char* name, const Result& r, double seconds)
+{
+    std::printf("%-10s %8.3f MB/s, %6.2f%% writes dropped, %8.1f bytes/transfer, latency mean %7.2f ms max %7.2f ms\n",
+                name, r.sent_bytes / seconds / 1e6, r.writes ? 100.0 * double(r.dropped) / double(r.writes) : 0.0,
+                r.transfers ? r.sent_bytes / double(r.transfers) : 0.0,
+                r.latency_count ? r.latency_sum_us / double(r.latency_count) / 1000.0 : 0.0,
+                r.latency_max_us / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double rate = 2e6;
+    std::uint32_t line = 120;
+    double seconds = 10;
+    std::uint32_t ring_size = 2048;
+    double packet_us = 50;
+    double poll_ms = 5;
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "r:l:s:b:u:t:h")) != -1) {
+        switch (opt) {
+        case 'r': rate = std::strtod(optarg, nullptr); break;
+        case 'l': line = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 's': seconds = std::strtod(optarg, nullptr); break;
+        case 'b': ring_size = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'u': packet_us = std::strtod(optarg, nullptr); break;
+        case 't': poll_ms = std::strtod(optarg, nullptr); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (rate <= 0 || line == 0 || seconds <= 0 || ring_size == 0 || (ring_size & (ring_size - 1)) != 0 ||
+        line > ring_size || packet_us <= 0 || poll_ms <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%.0f B/s in writes of %u bytes, %u byte buffer, %.0f us per packet\n", rate, line, ring_size,
+                packet_us);
+    print("completion", run(rate, line, seconds, ring_size, packet_us, 0), seconds);
+    print("timer poll", run(rate, line, seconds, ring_size, packet_us, poll_ms * 1000), seconds);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/**
+  ******************************************************************************
+  * @file    st_logdecode_bench.cpp
+  * @brief   Decoding throughput over a synthetic log (4 GiB by default), for
+  *          an increasing number of threads.
+  ******************************************************************************
+  */
+#include "stlog/channel_reader.hpp"
+#include "stlog/channels.hpp"
+#include "stlog/decode.hpp"
+#include "stlog/mapped_file.hpp"
+#include "stlog/sinks.hpp"
+#include "stlog/synthetic.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-s MiB] [-k bin|csv] [-l row|columnar] [-b bytes] [-m mask] [-f none|csv|columns] [-c channel]\n"
+        "          [-j max threads] [-r runs] [-p path] [-K]\n"
+        "  -s  size of the synthetic log (default: 4096 MiB)\n"
+        "  -k  kind of log to generate (default: bin)\n"
+        "  -l  block layout of a binary log (default: row)\n"
+        "  -b  block size of a binary log (default: 4096)\n"
+        "  -m  channels of the log, bit n for channel n (default: 0x1fff, all)\n"
+        "  -c  also time the extraction of this channel alone\n"
+        "  -f  output format, written under /tmp (default: none)\n"
+        "  -p  log path (default: /tmp/st_logdecode_bench.<kind>), reused if the size matches\n"
+        "  -K  keep the generated log\n",
+        argv0);
+}
+
+std::unique_ptr<stlog::OutputSink> make_sink(const std::string& format)
+{
+    if (format == "csv") {
+        return std::make_unique<stlog::CsvSink>("/tmp/st_logdecode_bench.out.csv");
+    }
+    if (format == "columns") {
+        return std::make_unique<stlog::ColumnSink>("/tmp/st_logdecode_bench.out");
+    }
+    return std::make_unique<stlog::NullSink>();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::uint64_t size_mib = 4096;
+    std::string kind_name = "bin";
+    std::string format = "none";
+    std::string path;
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    int runs = 3;
+    bool keep = false;
+    std::uint8_t layout = DATALOG_LAYOUT_ROW;
+    std::uint32_t block_size = DATALOG_BLOCK_SIZE;
+    std::uint16_t channel_mask = DATALOG_CHANNEL_MASK_ALL;
+    std::string channel;
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "s:k:l:b:m:c:f:j:r:p:Kh")) != -1) {
+        switch (opt) {
+        case 'm': channel_mask = static_cast<std::uint16_t>(std::strtoul(optarg, nullptr, 0)); break;
+        case 'l': layout = std::string(optarg) == "columnar" ? DATALOG_LAYOUT_COLUMNAR : DATALOG_LAYOUT_ROW; break;
+        case 'b': block_size = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'c': channel = optarg; break;
+        case 's': size_mib = std::strtoull(optarg, nullptr, 10); break;
+        case 'k': kind_name = optarg; break;
+        case 'f': format = optarg; break;
+        case 'j': max_threads = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'r': runs = std::atoi(optarg); break;
+        case 'p': path = optarg; break;
+        case 'K': keep = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    max_threads = std::max(max_threads, 1u);
+    const stlog::LogKind kind = (kind_name == "csv") ? stlog::LogKind::Csv : stlog::LogKind::Binary;
+    if (path.empty()) {
+        path = "/tmp/st_logdecode_bench." + kind_name;
+    }
+
+    try {
+        const std::uint64_t bytes = size_mib << 20;
+        struct stat st {};
+        if (::stat(path.c_str(), &st) != 0 || std::uint64_t(st.st_size) < bytes) {
+            std::fprintf(stderr, "generating %llu MiB %s log in %s\n",
+                         static_cast<unsigned long long>(size_mib), kind_name.c_str(), path.c_str());
+            stlog::write_synthetic_log(path, kind, bytes, layout, block_size, channel_mask);
+        }
+
+        stlog::MappedFile file(path);
+        std::printf("%-8s %-8s %12s %12s %10s\n", "threads", "output", "records", "seconds", "MB/s");
+        std::vector<unsigned> thread_counts;
+        for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+            thread_counts.push_back(threads);
+        }
+        thread_counts.push_back(max_threads);
+
+        for (unsigned threads : thread_counts) {
+            double best = 0.0;
+            stlog::DecodeStats stats;
+            for (int run = 0; run < runs; ++run) {
+                auto sink = make_sink(format);
+                stlog::DecodeOptions options;
+                options.threads = threads;
+                auto start = std::chrono::steady_clock::now();
+                stats = stlog::decode_file(file, *sink, options);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                if (run == 0 || elapsed.count() < best) {
+                    best = elapsed.count();
+                }
+            }
+            std::printf("%-8u %-8s %12llu %12.3f %10.1f\n", threads, format.c_str(),
+                        static_cast<unsigned long long>(stats.records), best, stats.bytes / 1e6 / best);
+        }
+
+        if (!channel.empty() && kind == stlog::LogKind::Binary) {
+            const std::size_t idx = stlog::find_channel(channel);
+            if (idx >= stlog::channels.size()) {
+                std::fprintf(stderr, "unknown channel %s\n", channel.c_str());
+                return EXIT_FAILURE;
+            }
+            stlog::ChannelReadStats stats;
+            auto start = std::chrono::steady_clock::now();
+            auto values = stlog::read_channel(path, idx, &stats);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::printf("channel %s: %zu values, read %.1f MB of %.1f MB in %.3f s\n",
+                        channel.c_str(), values.size(), stats.bytes_read / 1e6, file.size() / 1e6, elapsed.count());
+        }
+
+        if (!keep) {
+            ::unlink(path.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/**
+  ******************************************************************************
+  * @file    st_sdwrite_bench.cpp
+  * @brief   SD write pattern of the firmware logging, written line by line
+  *          (or block by block) and through the write buffers of
+  *          datalog_writer.c, on a disk image.
+  ******************************************************************************
+  */
+#include "stlog/mapped_file.hpp"
+#include "stlog/sector_image.hpp"
+#include "stlog/synthetic.hpp"
+#include "datalog_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <unistd.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-s MiB] [-k bin|csv] [-b bytes] [-n buffers] [-p path]\n"
+        "  -s  size of the synthetic log (default: 64 MiB)\n"
+        "  -k  kind of log (default: csv)\n"
+        "  -b  write buffer size, 0 writes each line or block directly\n"
+        "      (default: 0, 512, 4096, 8192, 32768)\n"
+        "  -n  number of write buffers (default: 2)\n"
+        "  -p  image path (default: /tmp/st_sdwrite_bench.img)\n",
+        argv0);
+}
+
+std::uint8_t append_buffer(void* ctx, std::uint8_t* buffer, std::uint32_t size)
+{
+    static_cast<stlog::SectorImage*>(ctx)->append(buffer, size);
+    return 1;
+}
+
+stlog::SectorStats run(const stlog::MappedFile& log, const std::vector<stlog::WriteRequest>& requests,
+                       const std::string& image_path, std::uint32_t buffer_size, std::uint8_t buffers)
+{
+    stlog::SectorImage image(image_path);
+    if (buffer_size == 0) {
+        for (const auto& req : requests) {
+            image.append(log.data() + req.offset, req.size);
+        }
+    } else {
+        std::vector<std::uint32_t> storage(std::size_t(buffer_size) * buffers / sizeof(std::uint32_t));
+        DATALOG_Writer_t writer;
+        DATALOG_Writer_Init(&writer, reinterpret_cast<std::uint8_t*>(storage.data()), buffer_size, buffers,
+                            append_buffer, &image);
+        for (const auto& req : requests) {
+            DATALOG_Writer_Write(&writer, log.data() + req.offset, static_cast<std::uint32_t>(req.size));
+        }
+        std::uint32_t size;
+        std::uint8_t* last = DATALOG_Writer_Take(&writer, &size);
+        if (size > 0) {
+            image.append(last, size);
+        }
+    }
+    image.flush();
+    return image.stats();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::uint64_t size_mib = 64;
+    std::string kind_name = "csv";
+    std::string path = "/tmp/st_sdwrite_bench.img";
+    std::vector<std::uint32_t> buffer_sizes;
+    unsigned buffers = 2;
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "s:k:b:n:p:h")) != -1) {
+        switch (opt) {
+        case 's': size_mib = std::strtoull(optarg, nullptr, 10); break;
+        case 'k': kind_name = optarg; break;
+        case 'b': buffer_sizes.push_back(static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10))); break;
+        case 'n': buffers = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'p': path = optarg; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (buffer_sizes.empty()) {
+        buffer_sizes = {0, 512, 4096, 8192, 32768};
+    }
+    if (buffers < 1 || buffers > 255) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const stlog::LogKind kind = (kind_name == "bin") ? stlog::LogKind::Binary : stlog::LogKind::Csv;
+
+    try {
+        const std::string log_path = path + ".log";
+        stlog::write_synthetic_log(log_path, kind, size_mib << 20);
+        stlog::MappedFile log(log_path);
+        const auto requests = stlog::split_write_requests(log.data(), log.size(), kind);
+
+        std::printf("%-8s %12s %12s %12s %10s %10s\n", "buffer", "requests", "commands", "sectors", "sect/cmd", "MB/s");
+        for (auto buffer_size : buffer_sizes) {
+            if (buffer_size % DATALOG_SECTOR_SIZE != 0) {
+                std::fprintf(stderr, "buffer size %u is not a multiple of %u\n",
+                             buffer_size, static_cast<unsigned>(DATALOG_SECTOR_SIZE));
+                return EXIT_FAILURE;
+            }
+            auto start = std::chrono::steady_clock::now();
+            stlog::SectorStats stats = run(log, requests, path, buffer_size, static_cast<std::uint8_t>(buffers));
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::printf("%-8s %12llu %12llu %12llu %10.1f %10.1f\n",
+                        buffer_size == 0 ? "direct" : std::to_string(buffer_size).c_str(),
+                        static_cast<unsigned long long>(stats.requests),
+                        static_cast<unsigned long long>(stats.commands),
+                        static_cast<unsigned long long>(stats.sectors),
+                        double(stats.sectors) / double(stats.commands),
+                        log.size() / 1e6 / elapsed.count());
+            if (stats.reads > 0) {
+                std::printf("         %llu sectors read back for partial writes\n",
+                            static_cast<unsigned long long>(stats.reads));
+            }
+        }
+        ::unlink(log_path.c_str());
+        ::unlink(path.c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
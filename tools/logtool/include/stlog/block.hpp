@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    block.hpp
+  * @brief   Access to the blocks of a binary SensorTile log.
+  ******************************************************************************
+  */
+#ifndef STLOG_BLOCK_HPP
+#define STLOG_BLOCK_HPP
+
+#include "datalog_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace stlog {
+
+inline DATALOG_BlockHeader_t read_header(const std::uint8_t* block)
+{
+    DATALOG_BlockHeader_t hdr;
+    std::memcpy(&hdr, block, sizeof(hdr));
+    return hdr;
+}
+
+/// Channels of the records, logs before version 3 hold all of them
+inline std::uint16_t channel_mask(const DATALOG_BlockHeader_t& hdr)
+{
+    return hdr.channel_mask ? hdr.channel_mask : DATALOG_CHANNEL_MASK_ALL;
+}
+
+/// Block size recorded in the header, version 1 logs always use the default
+inline std::size_t block_size(const DATALOG_BlockHeader_t& hdr)
+{
+    return hdr.block_sectors ? std::size_t(hdr.block_sectors) * DATALOG_SECTOR_SIZE : DATALOG_BLOCK_SIZE;
+}
+
+/// Column table of a DATALOG_LAYOUT_COLUMNAR block
+inline DATALOG_ColumnTable_t read_column_table(const std::uint8_t* block)
+{
+    DATALOG_ColumnTable_t table;
+    std::memcpy(&table, block + DATALOG_BLOCK_HEADER_SIZE, sizeof(table));
+    return table;
+}
+
+/// True if the block has no CRC-32 trailer or if it matches the block content
+bool block_crc_ok(const std::uint8_t* block, std::size_t size);
+
+/// Time index footer block (DATALOG_LAYOUT_INDEX) of a log with @p size bytes blocks
+inline bool is_index_block(const DATALOG_BlockHeader_t& hdr, std::size_t size)
+{
+    return hdr.magic == DATALOG_BLOCK_MAGIC && hdr.layout == DATALOG_LAYOUT_INDEX
+        && hdr.record_size == DATALOG_INDEX_ENTRY_SIZE && block_size(hdr) == size
+        && hdr.record_count <= DATALOG_INDEX_CAPACITY(size);
+}
+
+/**
+  * @brief  Check that the header describes a block of @p size bytes whose
+  *         payload can be decoded by this version of the tools. The column
+  *         table is only checked when @p table is not null.
+  */
+bool header_is_valid(const DATALOG_BlockHeader_t& hdr, std::size_t size, const DATALOG_ColumnTable_t* table = nullptr);
+
+/// Append the records of a whole, valid block to @p out, absent channels are zero
+void unpack_block(const std::uint8_t* block, const DATALOG_BlockHeader_t& hdr, std::vector<DATALOG_Record_t>& out);
+
+} // namespace stlog
+
+#endif // STLOG_BLOCK_HPP
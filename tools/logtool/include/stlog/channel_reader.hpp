@@ -0,0 +1,34 @@
+/**
+  ******************************************************************************
+  * @file    channel_reader.hpp
+  * @brief   Extraction of a single channel from a binary SensorTile log.
+  ******************************************************************************
+  */
+#ifndef STLOG_CHANNEL_READER_HPP
+#define STLOG_CHANNEL_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stlog {
+
+struct ChannelReadStats {
+    std::uint64_t blocks = 0;
+    std::uint64_t bytes_read = 0;   // bytes requested from the file
+    std::uint64_t errors = 0;       // corrupt blocks skipped
+};
+
+/**
+  * @brief  Read the raw 32 bit words of one channel with positioned reads.
+  *         For columnar blocks only the header and the channel column are
+  *         read, row blocks fall back to reading the whole payload. Logs
+  *         written without the channel give no values. Block CRCs are not
+  *         checked, that needs the whole block: use decode_file to verify.
+  */
+std::vector<std::uint32_t> read_channel(const std::string& path, std::size_t channel, ChannelReadStats* stats = nullptr);
+
+} // namespace stlog
+
+#endif // STLOG_CHANNEL_READER_HPP
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    channels.hpp
+  * @brief   Description of the channels stored in a DATALOG_Record_t.
+  ******************************************************************************
+  */
+#ifndef STLOG_CHANNELS_HPP
+#define STLOG_CHANNELS_HPP
+
+#include "datalog_format.h"
+#include "datalog_schema.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace stlog {
+
+using ChannelType = datalog::ChannelType;
+using ChannelInfo = datalog::ChannelDesc;
+
+/// Every channel a log can hold, indexed by channel id (same definitions as the firmware)
+inline constexpr const std::array<ChannelInfo, DATALOG_CHANNEL_COUNT>& channels = datalog::AllChannels::descriptors;
+
+/// True if channel @p idx is stored in the records of a log with @p mask
+inline bool has_channel(std::uint16_t mask, std::size_t idx)
+{
+    return (mask >> idx) & 1u;
+}
+
+/// Index of the channel called @p name, channels.size() if there is none
+std::size_t find_channel(const std::string& name);
+/// Index of the channel with CSV column title @p title, channels.size() if there is none
+std::size_t find_title(const std::string& title);
+
+/// Print a channel word as text in [p, end), returns the end of the text
+char* format_value(char* p, char* end, const ChannelInfo& info, std::uint32_t word);
+
+/// Raw 32 bit word of channel @p idx, records are a packed array of channels
+inline std::uint32_t channel_word(const DATALOG_Record_t& rec, std::size_t idx)
+{
+    std::uint32_t word;
+    std::memcpy(&word, reinterpret_cast<const std::uint8_t*>(&rec) + idx * DATALOG_CHANNEL_SIZE, sizeof(word));
+    return word;
+}
+
+} // namespace stlog
+
+#endif // STLOG_CHANNELS_HPP
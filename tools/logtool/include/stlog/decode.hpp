@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    decode.hpp
+  * @brief   Parallel decoding of binary and CSV SensorTile logs.
+  ******************************************************************************
+  */
+#ifndef STLOG_DECODE_HPP
+#define STLOG_DECODE_HPP
+
+#include "datalog_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace stlog {
+
+class MappedFile;
+class OutputSink;
+
+enum class LogKind { Binary, Csv };
+
+/// Byte range [begin, end) of the mapped file
+struct Range {
+    std::size_t begin;
+    std::size_t end;
+};
+
+/// Records decoded from one Range, plus the sink specific encoded output
+struct Chunk {
+    std::vector<DATALOG_Record_t> records;
+    std::vector<char> encoded;
+    std::uint64_t errors = 0;
+    std::uint64_t crc_errors = 0;            // part of errors
+};
+
+struct DecodeOptions {
+    unsigned threads = 0;                    // 0: one per hardware thread
+    std::size_t chunk_size = 32u << 20;      // bytes of input per work item
+    std::uint32_t from_ms = 0;               // only records with from_ms <= T [ms] <= to_ms,
+    std::uint32_t to_ms = UINT32_MAX;        // binary logs seek with their time index
+};
+
+struct DecodeStats {
+    std::uint64_t bytes = 0;
+    std::uint64_t records = 0;
+    std::uint64_t errors = 0;                // corrupt blocks or malformed lines
+    std::uint64_t crc_errors = 0;            // blocks skipped because of a CRC mismatch
+};
+
+LogKind detect_kind(const std::uint8_t* data, std::size_t size);
+
+/// Split on block boundaries; the last range may hold a truncated block
+std::vector<Range> split_blocks(std::size_t size, std::size_t block_size, std::size_t chunk_size);
+/// Split after a '\n' so that no line crosses two ranges
+std::vector<Range> split_lines(const std::uint8_t* data, std::size_t size, std::size_t chunk_size);
+
+/// Channels of a CSV log, from its column titles
+std::uint16_t csv_channel_mask(const std::uint8_t* data, std::size_t size);
+
+/// Blocks with a bad header or CRC are skipped and counted as errors
+void decode_blocks(const std::uint8_t* data, Range range, std::size_t block_size, Chunk& out);
+/// Lines hold the channels of @p channel_mask, the other ones are zero
+void decode_csv(const std::uint8_t* data, Range range, std::uint16_t channel_mask, Chunk& out);
+
+/**
+  * @brief  Decode the file, or its time window, with a pool of threads. Work items are
+  *         decoded and encoded by the sink in parallel, then handed to
+  *         OutputSink::write in file order.
+  */
+DecodeStats decode_file(const MappedFile& file, OutputSink& sink, const DecodeOptions& options = {});
+
+} // namespace stlog
+
+#endif // STLOG_DECODE_HPP
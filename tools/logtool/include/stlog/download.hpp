@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    download.hpp
+  * @brief   Host side of the log download protocol over the USB CDC port
+  *          (Src/datalog_download.h).
+  ******************************************************************************
+  */
+#ifndef STLOG_DOWNLOAD_HPP
+#define STLOG_DOWNLOAD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stlog {
+
+/// File of the SD card, as listed by the device
+struct RemoteFile {
+    std::uint32_t number = 0;
+    std::string name;
+    std::uint32_t size = 0;
+};
+
+struct DownloadStats {
+    std::uint64_t bytes = 0;        // file bytes received
+    std::uint64_t chunks = 0;       // valid chunks received
+    std::uint64_t bad_chunks = 0;   // chunks with a wrong payload CRC
+    std::uint64_t requests = 0;     // READ requests sent
+    unsigned retries = 0;           // passes after the first one
+    double seconds = 0;
+};
+
+/**
+  * @brief  Download client on a serial port: the tty of the USB CDC port, or
+  *         the pseudo terminal of st_dlsim. The device starts a session on
+  *         the first request and ends it when the client is destroyed.
+  *         Throws std::system_error on I/O errors and std::runtime_error on
+  *         protocol errors.
+  */
+class DownloadClient {
+public:
+    /// timeout_ms: time without frame before a request is given up
+    explicit DownloadClient(const std::string& port, unsigned timeout_ms = 1000);
+    ~DownloadClient();
+
+    DownloadClient(const DownloadClient&) = delete;
+    DownloadClient& operator=(const DownloadClient&) = delete;
+
+    /// Files of the log directory, also gets the chunk size of the device
+    std::vector<RemoteFile> list();
+    std::uint32_t chunk_size() const { return chunk_size_; }
+
+    /// Read a whole file with window chunks in flight. The chunks lost or
+    /// corrupt are asked again, up to retries times.
+    std::vector<std::uint8_t> read(const RemoteFile& file, unsigned window, unsigned retries,
+                                   DownloadStats* stats = nullptr);
+
+    /// End the session, the device goes back to sampling
+    void end();
+
+private:
+    struct Frame {
+        std::uint8_t type = 0;
+        std::uint32_t file = 0;
+        std::uint32_t arg = 0;
+        std::uint32_t count = 0;
+        bool payload_ok = false;
+        std::vector<std::uint8_t> payload;
+    };
+
+    void send(std::uint8_t type, std::uint32_t file, std::uint32_t arg, std::uint32_t count,
+              std::uint8_t window = 0);
+    bool receive(Frame& frame, unsigned timeout_ms);
+    void read_range(const RemoteFile& file, std::uint32_t first, std::uint32_t count, unsigned window,
+                    std::vector<std::uint8_t>& data, std::vector<bool>& have, DownloadStats& stats);
+
+    int fd_ = -1;
+    unsigned timeout_ms_;
+    std::uint32_t chunk_size_ = 0;
+    bool session_ = false;
+    std::vector<std::uint8_t> rx_;
+};
+
+} // namespace stlog
+
+#endif // STLOG_DOWNLOAD_HPP
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    mapped_file.hpp
+  * @brief   Read only memory mapping of a log file.
+  ******************************************************************************
+  */
+#ifndef STLOG_MAPPED_FILE_HPP
+#define STLOG_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace stlog {
+
+/**
+  * @brief  Maps a whole file read only. Throws std::system_error if the file
+  *         can not be opened or mapped. An empty file maps to a null range.
+  */
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::uint8_t* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    void reset() noexcept;
+
+    int fd_ = -1;
+    const std::uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace stlog
+
+#endif // STLOG_MAPPED_FILE_HPP
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    sector_image.hpp
+  * @brief   File backed SD card image recording the sector write pattern of
+  *          the firmware log writes.
+  ******************************************************************************
+  */
+#ifndef STLOG_SECTOR_IMAGE_HPP
+#define STLOG_SECTOR_IMAGE_HPP
+
+#include "datalog_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stlog {
+
+struct SectorStats {
+    std::uint64_t requests = 0;     // append calls, f_write in the firmware
+    std::uint64_t commands = 0;     // device write commands (CMD24 / CMD25)
+    std::uint64_t sectors = 0;      // sectors written
+    std::uint64_t reads = 0;        // sectors read back to merge a partial write
+};
+
+/**
+  * @brief  Log file written sequentially to an image the way FatFs writes a
+  *         file: the whole sectors of a request go to the device in one
+  *         multi-sector command, partial sectors are merged in a one sector
+  *         cache that is written back when the file moves to another sector.
+  *         Throws std::system_error on I/O errors.
+  */
+class SectorImage {
+public:
+    explicit SectorImage(const std::string& path, std::size_t sector_size = DATALOG_SECTOR_SIZE);
+    ~SectorImage();
+
+    SectorImage(const SectorImage&) = delete;
+    SectorImage& operator=(const SectorImage&) = delete;
+
+    void append(const std::uint8_t* data, std::size_t size);
+    /// Write back the cached sector, like f_sync
+    void flush();
+
+    const SectorStats& stats() const { return stats_; }
+    std::uint64_t size() const { return pos_; }
+
+private:
+    void write_sectors(std::uint64_t first, const std::uint8_t* data, std::size_t count);
+
+    int fd_ = -1;
+    std::size_t sector_size_;
+    std::uint64_t pos_ = 0;
+    std::uint64_t stored_ = 0;                  // bytes on the image
+    std::vector<std::uint8_t> cache_;
+    std::uint64_t cache_sector_ = UINT64_MAX;
+    bool cache_dirty_ = false;
+    SectorStats stats_;
+};
+
+} // namespace stlog
+
+#endif // STLOG_SECTOR_IMAGE_HPP
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    sinks.hpp
+  * @brief   Output formats for the decoded records.
+  ******************************************************************************
+  */
+#ifndef STLOG_SINKS_HPP
+#define STLOG_SINKS_HPP
+
+#include "stlog/decode.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace stlog {
+
+/**
+  * @brief  Destination of the decoded records. begin() receives the channels
+  *         stored in the log before anything else, encode() is called from
+  *         the worker threads, write() from the calling thread in file order.
+  */
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void begin(std::uint16_t channel_mask) { (void)channel_mask; }
+    virtual void encode(Chunk& chunk) const = 0;
+    virtual void write(const Chunk& chunk) = 0;
+    virtual void finish() {}
+};
+
+/// Discards everything, used to measure the decoding alone
+class NullSink : public OutputSink {
+public:
+    void encode(Chunk&) const override {}
+    void write(const Chunk&) override {}
+};
+
+/// CSV text with the same columns as the firmware CSV log
+class CsvSink : public OutputSink {
+public:
+    explicit CsvSink(const std::string& path);  // "-" writes to stdout
+    ~CsvSink() override;
+    void begin(std::uint16_t channel_mask) override;
+    void encode(Chunk& chunk) const override;
+    void write(const Chunk& chunk) override;
+    void finish() override;
+
+private:
+    std::FILE* file_;
+    bool owned_;
+    std::vector<std::size_t> ids_;   // channels of the log
+};
+
+/**
+  * @brief  One raw little endian array per channel, written to
+  *         <directory>/<channel>.<u32|i32|f32>
+  */
+class ColumnSink : public OutputSink {
+public:
+    explicit ColumnSink(const std::string& directory);
+    ~ColumnSink() override;
+    void begin(std::uint16_t channel_mask) override;
+    void encode(Chunk& chunk) const override;
+    void write(const Chunk& chunk) override;
+    void finish() override;
+
+private:
+    std::string directory_;
+    std::vector<std::FILE*> files_;
+    std::vector<std::size_t> ids_;   // channel of each file
+};
+
+} // namespace stlog
+
+#endif // STLOG_SINKS_HPP
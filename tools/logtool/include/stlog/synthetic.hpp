@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    synthetic.hpp
+  * @brief   Generator of synthetic SensorTile logs for benchmarks.
+  ******************************************************************************
+  */
+#ifndef STLOG_SYNTHETIC_HPP
+#define STLOG_SYNTHETIC_HPP
+
+#include "stlog/decode.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stlog {
+
+/// Deterministic sample number @p index, 50 Hz like the firmware default
+DATALOG_Record_t synthetic_record(std::uint64_t index);
+
+/**
+  * @brief  Write a log of about @p bytes bytes, formatted exactly as the
+  *         firmware does, with the channels of @p channel_mask. @p layout
+  *         and @p block_size only apply to binary logs. Returns the number
+  *         of records written.
+  */
+std::uint64_t write_synthetic_log(const std::string& path, LogKind kind, std::uint64_t bytes,
+                                  std::uint8_t layout = DATALOG_LAYOUT_ROW,
+                                  std::uint32_t block_size = DATALOG_BLOCK_SIZE,
+                                  std::uint16_t channel_mask = DATALOG_CHANNEL_MASK_ALL);
+
+/// One DATALOG_SD_writeBuf call of the firmware: a CSV line or a binary block
+struct WriteRequest {
+    std::size_t offset;
+    std::size_t size;
+};
+
+/// Split a log into the writes the firmware made to produce it
+std::vector<WriteRequest> split_write_requests(const std::uint8_t* data, std::size_t size, LogKind kind,
+                                               std::uint32_t block_size = DATALOG_BLOCK_SIZE);
+
+} // namespace stlog
+
+#endif // STLOG_SYNTHETIC_HPP
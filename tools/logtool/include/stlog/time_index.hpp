@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file    time_index.hpp
+  * @brief   Time index of binary SensorTile logs, used to seek to a timestamp.
+  ******************************************************************************
+  */
+#ifndef STLOG_TIME_INDEX_HPP
+#define STLOG_TIME_INDEX_HPP
+
+#include "datalog_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stlog {
+
+struct TimeIndex {
+    std::size_t block_size = DATALOG_BLOCK_SIZE;
+    std::size_t data_blocks = 0;                  // blocks before the footer
+    std::vector<DATALOG_IndexEntry_t> entries;    // sorted by block
+    bool from_footer = false;                     // false: rebuilt from the block headers
+};
+
+/**
+  * @brief  Read the index footer of a binary log, or rebuild the index by
+  *         scanning the data block headers when the log was not closed
+  *         cleanly and has no footer.
+  */
+TimeIndex load_time_index(const std::uint8_t* data, std::size_t size);
+
+/// Index of every data block, built from the block headers
+TimeIndex rebuild_time_index(const std::uint8_t* data, std::size_t size, std::size_t block_size);
+
+/**
+  * @brief  Number of the last data block whose first record is not after
+  *         @p ms, so that decoding from there does not miss any record at or
+  *         after @p ms. Binary search in the index, then in the block headers
+  *         between two entries: O(log n) block header reads.
+  */
+std::size_t seek_block(const TimeIndex& index, const std::uint8_t* data, std::uint32_t ms);
+
+/**
+  * @brief  Append the index as a footer to a log without one, after dropping
+  *         a truncated last block. Throws std::system_error on failure.
+  */
+void append_time_index(const std::string& path, const TimeIndex& index);
+
+} // namespace stlog
+
+#endif // STLOG_TIME_INDEX_HPP
@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    block.cpp
+  * @brief   Access to the blocks of a binary SensorTile log.
+  ******************************************************************************
+  */
+#include "stlog/block.hpp"
+#include "datalog_crc.h"
+#include "datalog_schema.hpp"
+
+#include <bitset>
+
+namespace stlog {
+
+bool header_is_valid(const DATALOG_BlockHeader_t& hdr, std::size_t size, const DATALOG_ColumnTable_t* table)
+{
+    if (hdr.magic != DATALOG_BLOCK_MAGIC
+        || hdr.version == 0 || hdr.version > DATALOG_BLOCK_VERSION
+        || block_size(hdr) != size
+        || (hdr.version < 3 && hdr.channel_mask != 0)) {
+        return false;
+    }
+    const std::uint16_t mask = channel_mask(hdr);
+    const std::size_t channel_count = std::bitset<16>(mask).count();
+    if ((mask & ~DATALOG_CHANNEL_MASK_ALL) != 0 || (mask & (1u << DATALOG_CH_MS)) == 0
+        || hdr.channel_count != channel_count
+        || hdr.record_size != channel_count * DATALOG_CHANNEL_SIZE) {
+        return false;
+    }
+
+    const std::size_t count = hdr.record_count;
+    if (hdr.flags & DATALOG_FLAG_CRC32) {
+        size -= DATALOG_BLOCK_TRAILER_SIZE;
+    }
+    switch (hdr.layout) {
+    case DATALOG_LAYOUT_ROW:
+        return hdr.header_size >= DATALOG_BLOCK_HEADER_SIZE
+            && hdr.header_size + count * hdr.record_size <= size;
+
+    case DATALOG_LAYOUT_COLUMNAR:
+        if (hdr.header_size < DATALOG_BLOCK_HEADER_SIZE + DATALOG_COLUMN_TABLE_SIZE) {
+            return false;
+        }
+        if (table != nullptr) {
+            for (std::size_t channel = 0; channel < DATALOG_CHANNEL_COUNT; ++channel) {
+                const std::size_t offset = table->offset[channel];
+                if (((mask >> channel) & 1u) == 0) {
+                    continue;
+                }
+                if (offset < hdr.header_size || offset + count * DATALOG_CHANNEL_SIZE > size) {
+                    return false;
+                }
+            }
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool block_crc_ok(const std::uint8_t* block, std::size_t size)
+{
+    if ((read_header(block).flags & DATALOG_FLAG_CRC32) == 0) {
+        return true;
+    }
+    std::uint32_t crc;
+    std::memcpy(&crc, block + size - DATALOG_BLOCK_TRAILER_SIZE, sizeof(crc));
+    return DATALOG_CRC32(block, static_cast<std::uint32_t>(size - DATALOG_BLOCK_TRAILER_SIZE)) == crc;
+}
+
+void unpack_block(const std::uint8_t* block, const DATALOG_BlockHeader_t& hdr, std::vector<DATALOG_Record_t>& out)
+{
+    const std::size_t count = hdr.record_count;
+    const std::size_t first = out.size();
+    out.resize(first + count);
+
+    const std::uint16_t mask = channel_mask(hdr);
+
+    if (hdr.layout == DATALOG_LAYOUT_ROW) {
+        const std::uint8_t* rec = block + hdr.header_size;
+        if (mask == DATALOG_CHANNEL_MASK_ALL) {
+            std::memcpy(&out[first], rec, count * DATALOG_RECORD_SIZE);
+            return;
+        }
+        for (std::size_t row = 0; row < count; ++row, rec += hdr.record_size) {
+            datalog::unpack_record(mask, rec, out[first + row]);
+        }
+        return;
+    }
+
+    // Gather one column at a time, the writes stay in cache for a block
+    const DATALOG_ColumnTable_t table = read_column_table(block);
+    for (std::size_t channel = 0; channel < DATALOG_CHANNEL_COUNT; ++channel) {
+        if (((mask >> channel) & 1u) == 0) {
+            for (std::size_t row = 0; row < count; ++row) {
+                std::memset(reinterpret_cast<std::uint8_t*>(&out[first + row]) + channel * DATALOG_CHANNEL_SIZE, 0,
+                            DATALOG_CHANNEL_SIZE);
+            }
+            continue;
+        }
+        const std::uint8_t* column = block + table.offset[channel];
+        for (std::size_t row = 0; row < count; ++row) {
+            std::memcpy(reinterpret_cast<std::uint8_t*>(&out[first + row]) + channel * DATALOG_CHANNEL_SIZE,
+                        column + row * DATALOG_CHANNEL_SIZE, DATALOG_CHANNEL_SIZE);
+        }
+    }
+}
+
+} // namespace stlog
@@ -0,0 +1,152 @@
+/**
+  ******************************************************************************
+  * @file    channel_reader.cpp
+  * @brief   Extraction of a single channel from a binary SensorTile log.
+  ******************************************************************************
+  */
+#include "stlog/channel_reader.hpp"
+#include "stlog/block.hpp"
+
+#include <bitset>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace stlog {
+
+namespace {
+
+class FileDescriptor {
+public:
+    explicit FileDescriptor(const std::string& path) : fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+    {
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+    }
+    ~FileDescriptor() { ::close(fd_); }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+/// Read exactly size bytes at offset, false on a short read (end of file)
+bool read_at(int fd, void* buffer, std::size_t size, std::uint64_t offset, ChannelReadStats& stats)
+{
+    auto* p = static_cast<std::uint8_t*>(buffer);
+    stats.bytes_read += size;
+    while (size > 0) {
+        ssize_t got = ::pread(fd, p, size, static_cast<off_t>(offset));
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "pread");
+        }
+        if (got == 0) {
+            return false;
+        }
+        p += got;
+        size -= std::size_t(got);
+        offset += std::uint64_t(got);
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<std::uint32_t> read_channel(const std::string& path, std::size_t channel, ChannelReadStats* stats_out)
+{
+    if (channel >= DATALOG_CHANNEL_COUNT) {
+        throw std::out_of_range("channel index out of range");
+    }
+
+    FileDescriptor fd(path);
+    struct stat st {};
+    if (::fstat(fd.get(), &st) != 0) {
+        throw std::system_error(errno, std::generic_category(), "stat " + path);
+    }
+    // We jump from column to column, readahead would fetch the skipped ones
+    ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_RANDOM);
+
+    ChannelReadStats stats;
+    std::vector<std::uint32_t> values;
+    std::uint8_t head[DATALOG_BLOCK_HEADER_SIZE + DATALOG_COLUMN_TABLE_SIZE];
+    std::vector<std::uint8_t> payload;
+
+    const std::uint64_t file_size = std::uint64_t(st.st_size);
+    if (!read_at(fd.get(), head, sizeof(head), 0, stats)) {
+        return values;
+    }
+    if (read_header(head).magic != DATALOG_BLOCK_MAGIC) {
+        throw std::runtime_error(path + " is not a binary log");
+    }
+    std::size_t blk_size = block_size(read_header(head));
+    if (blk_size > DATALOG_BLOCK_SIZE_MAX) {
+        blk_size = DATALOG_BLOCK_SIZE;
+    }
+
+    for (std::uint64_t pos = 0; pos + blk_size <= file_size; pos += blk_size) {
+        ++stats.blocks;
+        if (pos != 0 && !read_at(fd.get(), head, sizeof(head), pos, stats)) {
+            break;
+        }
+        const DATALOG_BlockHeader_t hdr = read_header(head);
+        const DATALOG_ColumnTable_t table = read_column_table(head);
+        const bool columnar = hdr.layout == DATALOG_LAYOUT_COLUMNAR;
+        if (!header_is_valid(hdr, blk_size, columnar ? &table : nullptr)) {
+            if (!is_index_block(hdr, blk_size)) {
+                ++stats.errors;
+            }
+            continue;
+        }
+
+        const std::uint16_t mask = channel_mask(hdr);
+        if (((mask >> channel) & 1u) == 0) {
+            continue;   // channel not logged
+        }
+
+        const std::size_t count = hdr.record_count;
+        const std::size_t first = values.size();
+        values.resize(first + count);
+        if (columnar) {
+            if (!read_at(fd.get(), &values[first], count * DATALOG_CHANNEL_SIZE, pos + table.offset[channel], stats)) {
+                values.resize(first);
+                ++stats.errors;
+                break;
+            }
+        } else {
+            // Position of the channel among the ones of the record
+            const std::size_t word = std::bitset<16>(mask & ((1u << channel) - 1)).count();
+            payload.resize(count * hdr.record_size);
+            if (!read_at(fd.get(), payload.data(), payload.size(), pos + hdr.header_size, stats)) {
+                values.resize(first);
+                ++stats.errors;
+                break;
+            }
+            for (std::size_t row = 0; row < count; ++row) {
+                std::memcpy(&values[first + row], &payload[row * hdr.record_size + word * DATALOG_CHANNEL_SIZE],
+                            DATALOG_CHANNEL_SIZE);
+            }
+        }
+    }
+
+    if (file_size % blk_size != 0) {
+        ++stats.errors;   // truncated last block
+    }
+    if (stats_out != nullptr) {
+        *stats_out = stats;
+    }
+    return values;
+}
+
+} // namespace stlog
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file    channels.cpp
+  * @brief   Description of the channels stored in a DATALOG_Record_t.
+  ******************************************************************************
+  */
+#include "stlog/channels.hpp"
+
+#include <charconv>
+
+namespace stlog {
+
+std::size_t find_channel(const std::string& name)
+{
+    for (std::size_t idx = 0; idx < channels.size(); ++idx) {
+        if (name == channels[idx].name) {
+            return idx;
+        }
+    }
+    return channels.size();
+}
+
+std::size_t find_title(const std::string& title)
+{
+    for (std::size_t idx = 0; idx < channels.size(); ++idx) {
+        if (title == channels[idx].title) {
+            return idx;
+        }
+    }
+    return channels.size();
+}
+
+char* format_value(char* p, char* end, const ChannelInfo& info, std::uint32_t word)
+{
+    switch (info.type) {
+    case ChannelType::U32:
+        return std::to_chars(p, end, word).ptr;
+    case ChannelType::I32: {
+        std::int32_t v;
+        std::memcpy(&v, &word, sizeof(v));
+        return std::to_chars(p, end, v).ptr;
+    }
+    case ChannelType::F32: {
+        float v;
+        std::memcpy(&v, &word, sizeof(v));
+        return std::to_chars(p, end, v, std::chars_format::fixed, info.decimals).ptr;
+    }
+    }
+    return p;
+}
+
+} // namespace stlog
@@ -0,0 +1,294 @@
+/**
+  ******************************************************************************
+  * @file    decode.cpp
+  * @brief   Parallel decoding of binary and CSV SensorTile logs.
+  ******************************************************************************
+  */
+#include "stlog/decode.hpp"
+#include "stlog/block.hpp"
+#include "stlog/channels.hpp"
+#include "stlog/mapped_file.hpp"
+#include "stlog/sinks.hpp"
+#include "stlog/time_index.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+namespace stlog {
+
+namespace {
+
+/// Run fn(0) ... fn(count - 1) concurrently, rethrowing the first failure
+template <typename Fn>
+void run_parallel(std::size_t count, Fn&& fn)
+{
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> workers;
+    workers.reserve(count);
+
+    auto guarded = [&](std::size_t idx) {
+        try {
+            fn(idx);
+        } catch (...) {
+            errors[idx] = std::current_exception();
+        }
+    };
+    for (std::size_t idx = 1; idx < count; ++idx) {
+        workers.emplace_back(guarded, idx);
+    }
+    if (count > 0) {
+        guarded(0);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (auto& err : errors) {
+        if (err) {
+            std::rethrow_exception(err);
+        }
+    }
+}
+
+const char* skip_blanks(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    return p;
+}
+
+template <typename T>
+bool parse_field(const char*& p, const char* end, T& value)
+{
+    p = skip_blanks(p, end);
+    auto res = std::from_chars(p, end, value);
+    if (res.ec != std::errc()) {
+        return false;
+    }
+    p = skip_blanks(res.ptr, end);
+    if (p < end && *p == ',') {
+        ++p;
+    }
+    return true;
+}
+
+bool parse_line(const char* p, const char* end, std::uint16_t mask, DATALOG_Record_t& rec)
+{
+    if (mask != DATALOG_CHANNEL_MASK_ALL) {
+        bool ok = true;
+        for (std::size_t idx = 0; idx < DATALOG_CHANNEL_COUNT && ok; ++idx) {
+            std::uint32_t word = 0;
+            if (has_channel(mask, idx)) {
+                switch (channels[idx].type) {
+                case ChannelType::U32: ok = parse_field(p, end, word); break;
+                case ChannelType::I32: { std::int32_t v; ok = parse_field(p, end, v); std::memcpy(&word, &v, sizeof(v)); break; }
+                case ChannelType::F32: { float v; ok = parse_field(p, end, v); std::memcpy(&word, &v, sizeof(v)); break; }
+                }
+            }
+            std::memcpy(reinterpret_cast<std::uint8_t*>(&rec) + idx * DATALOG_CHANNEL_SIZE, &word, sizeof(word));
+        }
+        return ok && skip_blanks(p, end) == end;
+    }
+
+    bool ok = parse_field(p, end, rec.ms_counter);
+    for (auto& v : rec.acc) ok = ok && parse_field(p, end, v);
+    for (auto& v : rec.gyro) ok = ok && parse_field(p, end, v);
+    for (auto& v : rec.mag) ok = ok && parse_field(p, end, v);
+    ok = ok && parse_field(p, end, rec.pressure);
+    ok = ok && parse_field(p, end, rec.temperature);
+    ok = ok && parse_field(p, end, rec.humidity);
+    return ok && skip_blanks(p, end) == end;
+}
+
+} // namespace
+
+LogKind detect_kind(const std::uint8_t* data, std::size_t size)
+{
+    std::uint32_t magic = 0;
+    if (size >= sizeof(magic)) {
+        std::memcpy(&magic, data, sizeof(magic));
+    }
+    return magic == DATALOG_BLOCK_MAGIC ? LogKind::Binary : LogKind::Csv;
+}
+
+std::vector<Range> split_blocks(std::size_t size, std::size_t block_size, std::size_t chunk_size)
+{
+    std::size_t step = std::max<std::size_t>(chunk_size / block_size, 1) * block_size;
+    std::vector<Range> ranges;
+    for (std::size_t pos = 0; pos < size; pos += step) {
+        ranges.push_back({pos, std::min(pos + step, size)});
+    }
+    return ranges;
+}
+
+std::vector<Range> split_lines(const std::uint8_t* data, std::size_t size, std::size_t chunk_size)
+{
+    std::vector<Range> ranges;
+    std::size_t pos = 0;
+    while (pos < size) {
+        std::size_t end = std::min(pos + std::max<std::size_t>(chunk_size, 1), size);
+        if (end < size) {
+            auto nl = static_cast<const std::uint8_t*>(std::memchr(data + end, '\n', size - end));
+            end = nl ? std::size_t(nl - data) + 1 : size;
+        }
+        ranges.push_back({pos, end});
+        pos = end;
+    }
+    return ranges;
+}
+
+void decode_blocks(const std::uint8_t* data, Range range, std::size_t block_size, Chunk& out)
+{
+    out.records.reserve(out.records.size() + (range.end - range.begin) / block_size * DATALOG_ROW_CAPACITY(block_size, DATALOG_CHANNEL_SIZE));
+
+    for (std::size_t pos = range.begin; pos < range.end; pos += block_size) {
+        if (range.end - pos < block_size) {
+            ++out.errors;   // truncated last block
+            break;
+        }
+        const std::uint8_t* block = data + pos;
+        const DATALOG_BlockHeader_t hdr = read_header(block);
+        const DATALOG_ColumnTable_t table = read_column_table(block);
+        if (!header_is_valid(hdr, block_size, hdr.layout == DATALOG_LAYOUT_COLUMNAR ? &table : nullptr)) {
+            if (!is_index_block(hdr, block_size)) {
+                ++out.errors;
+            }
+            continue;
+        }
+        if (!block_crc_ok(block, block_size)) {
+            ++out.errors;
+            ++out.crc_errors;
+            continue;
+        }
+        unpack_block(block, hdr, out.records);
+    }
+}
+
+std::uint16_t csv_channel_mask(const std::uint8_t* data, std::size_t size)
+{
+    const char* p = reinterpret_cast<const char*>(data);
+    auto nl = static_cast<const char*>(std::memchr(p, '\n', size));
+    const char* end = nl ? nl : p + size;
+    if (end > p && end[-1] == '\r') {
+        --end;
+    }
+
+    std::uint16_t mask = 0;
+    while (p < end) {
+        auto comma = static_cast<const char*>(std::memchr(p, ',', std::size_t(end - p)));
+        const char* field_end = comma ? comma : end;
+        const std::size_t idx = find_title(std::string(skip_blanks(p, field_end), field_end));
+        if (idx >= DATALOG_CHANNEL_COUNT) {
+            return DATALOG_CHANNEL_MASK_ALL;   // no header, or not one of ours
+        }
+        mask = std::uint16_t(mask | (1u << idx));
+        p = comma ? comma + 1 : end;
+    }
+    return mask ? mask : DATALOG_CHANNEL_MASK_ALL;
+}
+
+void decode_csv(const std::uint8_t* data, Range range, std::uint16_t channel_mask, Chunk& out)
+{
+    const char* p = reinterpret_cast<const char*>(data) + range.begin;
+    const char* end = reinterpret_cast<const char*>(data) + range.end;
+
+    out.records.reserve(out.records.size() + (range.end - range.begin) / 64);
+
+    while (p < end) {
+        auto nl = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+        const char* line_end = nl ? nl : end;
+        const char* next = nl ? nl + 1 : end;
+        if (line_end > p && line_end[-1] == '\r') {
+            --line_end;
+        }
+
+        // Blank lines and the column titles are not data
+        if (line_end > p && ((*p >= '0' && *p <= '9') || *p == '-')) {
+            DATALOG_Record_t rec;
+            if (parse_line(p, line_end, channel_mask, rec)) {
+                out.records.push_back(rec);
+            } else {
+                ++out.errors;
+            }
+        }
+        p = next;
+    }
+}
+
+DecodeStats decode_file(const MappedFile& file, OutputSink& sink, const DecodeOptions& options)
+{
+    const std::uint8_t* data = file.data();
+    const LogKind kind = detect_kind(data, file.size());
+    // All the blocks of a file have the size recorded in the first one
+    std::size_t blk_size = (kind == LogKind::Binary) ? block_size(read_header(data)) : 0;
+    if (blk_size > DATALOG_BLOCK_SIZE_MAX) {
+        blk_size = DATALOG_BLOCK_SIZE;   // corrupt first header, every block will be checked anyway
+    }
+    const bool windowed = options.from_ms > 0 || options.to_ms < UINT32_MAX;
+    std::size_t begin = 0;
+    std::size_t end = file.size();
+    if (kind == LogKind::Binary && windowed) {
+        const TimeIndex index = load_time_index(data, file.size());
+        begin = seek_block(index, data, options.from_ms) * blk_size;
+        end = std::min(end, (seek_block(index, data, options.to_ms) + 1) * blk_size);
+        end = std::max(begin, end);
+    }
+    std::vector<Range> ranges = (kind == LogKind::Binary)
+        ? split_blocks(end - begin, blk_size, options.chunk_size)
+        : split_lines(data, file.size(), options.chunk_size);
+    for (auto& range : ranges) {
+        range.begin += begin;
+        range.end += begin;
+    }
+
+    std::size_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    threads = std::max<std::size_t>(threads, 1);
+
+    DecodeStats stats;
+    stats.bytes = end - begin;
+    // The firmware writes the same channels in every block of a file
+    const std::uint16_t mask = (kind == LogKind::Binary)
+        ? (file.size() >= DATALOG_BLOCK_HEADER_SIZE ? channel_mask(read_header(data)) : DATALOG_CHANNEL_MASK_ALL)
+        : csv_channel_mask(data, file.size());
+    sink.begin(mask);
+
+    std::vector<Chunk> window(threads);
+    for (std::size_t first = 0; first < ranges.size(); first += threads) {
+        std::size_t count = std::min(threads, ranges.size() - first);
+
+        run_parallel(count, [&](std::size_t idx) {
+            Chunk& chunk = window[idx];
+            chunk.records.clear();
+            chunk.encoded.clear();
+            chunk.errors = 0;
+            chunk.crc_errors = 0;
+            if (kind == LogKind::Binary) {
+                decode_blocks(data, ranges[first + idx], blk_size, chunk);
+            } else {
+                decode_csv(data, ranges[first + idx], mask, chunk);
+            }
+            if (windowed) {
+                auto outside = [&](const DATALOG_Record_t& rec) {
+                    return rec.ms_counter < options.from_ms || rec.ms_counter > options.to_ms;
+                };
+                chunk.records.erase(std::remove_if(chunk.records.begin(), chunk.records.end(), outside),
+                                    chunk.records.end());
+            }
+            sink.encode(chunk);
+        });
+
+        for (std::size_t idx = 0; idx < count; ++idx) {
+            sink.write(window[idx]);
+            stats.records += window[idx].records.size();
+            stats.errors += window[idx].errors;
+            stats.crc_errors += window[idx].crc_errors;
+        }
+    }
+    sink.finish();
+    return stats;
+}
+
+} // namespace stlog
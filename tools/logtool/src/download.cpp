@@ -0,0 +1,278 @@
+/**
+  ******************************************************************************
+  * @file    download.cpp
+  * @brief   Host side of the log download protocol over the USB CDC port
+  *          (Src/datalog_download.h).
+  ******************************************************************************
+  */
+#include "stlog/download.hpp"
+#include "datalog_crc.h"
+#include "datalog_download.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace stlog {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// CRC of a payload, zero padded to a multiple of 4 bytes as the device computes it
+std::uint32_t payload_crc(const std::uint8_t* data, std::size_t size)
+{
+    std::vector<std::uint8_t> padded((size + 3) & ~std::size_t(3), 0);
+    std::memcpy(padded.data(), data, size);
+    return DATALOG_CRC32(padded.data(), std::uint32_t(padded.size()));
+}
+
+std::uint32_t header_crc(const DATALOG_DL_Header_t& h)
+{
+    return DATALOG_CRC32(reinterpret_cast<const std::uint8_t*>(&h), DATALOG_DL_HEADER_CRC_SIZE);
+}
+
+} // namespace
+
+DownloadClient::DownloadClient(const std::string& port, unsigned timeout_ms)
+    : timeout_ms_(timeout_ms)
+{
+    fd_ = ::open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + port);
+    }
+    // Raw bytes both ways; opening the port sets DTR, so the device sends
+    struct termios tio {};
+    if (::tcgetattr(fd_, &tio) == 0) {
+        ::cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        ::tcsetattr(fd_, TCSANOW, &tio);
+        // Sensor data streamed before the session
+        ::tcflush(fd_, TCIFLUSH);
+    }
+}
+
+DownloadClient::~DownloadClient()
+{
+    try {
+        end();
+    } catch (const std::exception&) {
+        // The device ends the session by itself when idle
+    }
+    ::close(fd_);
+}
+
+std::vector<RemoteFile> DownloadClient::list()
+{
+    // A corrupt listing is asked again
+    for (int attempt = 0; attempt < 3; attempt++) {
+        std::vector<RemoteFile> files;
+        bool ok = true;
+        Frame frame;
+        send(DATALOG_DL_REQ_LIST, 0, 0, 0);
+        while (receive(frame, timeout_ms_)) {
+            if (frame.type == DATALOG_DL_FRM_ENTRY) {
+                ok = ok && frame.payload_ok && frame.file == files.size();
+                files.push_back({frame.file, std::string(frame.payload.begin(), frame.payload.end()), frame.arg});
+            } else if (frame.type == DATALOG_DL_FRM_LIST_END) {
+                if (ok && frame.count == files.size() && frame.arg > 0) {
+                    chunk_size_ = frame.arg;
+                    return files;
+                }
+                break;
+            } else if (frame.type == DATALOG_DL_FRM_ERROR) {
+                throw std::runtime_error("device can not list its files: FRESULT " + std::to_string(frame.arg));
+            }
+        }
+    }
+    throw std::runtime_error("no valid file listing from the device");
+}
+
+std::vector<std::uint8_t> DownloadClient::read(const RemoteFile& file, unsigned window, unsigned retries,
+                                               DownloadStats* stats)
+{
+    DownloadStats local;
+    DownloadStats& st = stats ? *stats : local;
+    if (chunk_size_ == 0) {
+        list();
+    }
+    window = std::clamp(window, 1u, 255u);
+
+    const std::uint32_t chunks = (file.size + chunk_size_ - 1) / chunk_size_;
+    std::vector<std::uint8_t> data(file.size);
+    std::vector<bool> have(chunks, false);
+    const auto start = Clock::now();
+
+    for (unsigned pass = 0;; pass++) {
+        // Runs of missing chunks, each one a READ request
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> runs;
+        for (std::uint32_t c = 0; c < chunks; c++) {
+            if (have[c]) {
+                continue;
+            }
+            if (!runs.empty() && runs.back().first + runs.back().second == c) {
+                runs.back().second++;
+            } else {
+                runs.emplace_back(c, 1);
+            }
+        }
+        if (runs.empty()) {
+            break;
+        }
+        if (pass > retries) {
+            std::size_t missing = std::size_t(std::count(have.begin(), have.end(), false));
+            throw std::runtime_error(file.name + ": " + std::to_string(missing) + " chunks missing after " +
+                                     std::to_string(retries) + " retries");
+        }
+        if (pass > 0) {
+            st.retries++;
+        }
+        for (const auto& run : runs) {
+            read_range(file, run.first, run.second, window, data, have, st);
+        }
+    }
+
+    st.bytes += file.size;
+    st.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    return data;
+}
+
+void DownloadClient::end()
+{
+    if (session_) {
+        session_ = false;
+        send(DATALOG_DL_REQ_END, 0, 0, 0);
+    }
+}
+
+void DownloadClient::read_range(const RemoteFile& file, std::uint32_t first, std::uint32_t count,
+                                unsigned window, std::vector<std::uint8_t>& data, std::vector<bool>& have,
+                                DownloadStats& stats)
+{
+    Frame frame;
+    send(DATALOG_DL_REQ_READ, file.number, first, count, std::uint8_t(window));
+    stats.requests++;
+
+    // Frames of an earlier READ given up may still come, only this range counts
+    while (receive(frame, timeout_ms_)) {
+        if (frame.file != file.number) {
+            continue;
+        }
+        if (frame.type == DATALOG_DL_FRM_CHUNK && frame.arg >= first && frame.arg - first < count) {
+            send(DATALOG_DL_REQ_ACK, file.number, frame.arg, 0);
+            const std::size_t offset = std::size_t(frame.arg) * chunk_size_;
+            const std::size_t size = std::min<std::size_t>(chunk_size_, file.size - offset);
+            if (!frame.payload_ok || frame.payload.size() != size) {
+                stats.bad_chunks++;
+                continue;
+            }
+            if (!have[frame.arg]) {
+                std::copy(frame.payload.begin(), frame.payload.end(), data.begin() + std::ptrdiff_t(offset));
+                have[frame.arg] = true;
+                stats.chunks++;
+            }
+        } else if (frame.type == DATALOG_DL_FRM_READ_END && frame.arg == first) {
+            return;
+        } else if (frame.type == DATALOG_DL_FRM_ERROR) {
+            throw std::runtime_error(file.name + ": device read error FRESULT " + std::to_string(frame.arg));
+        }
+    }
+}
+
+void DownloadClient::send(std::uint8_t type, std::uint32_t file, std::uint32_t arg, std::uint32_t count,
+                          std::uint8_t window)
+{
+    DATALOG_DL_Header_t h {};
+    h.magic = DATALOG_DL_MAGIC;
+    h.type = type;
+    h.window = window;
+    h.file = file;
+    h.arg = arg;
+    h.count = count;
+    h.crc = header_crc(h);
+    session_ = session_ || type != DATALOG_DL_REQ_END;
+
+    const auto* p = reinterpret_cast<const std::uint8_t*>(&h);
+    std::size_t left = sizeof(h);
+    while (left > 0) {
+        ssize_t n = ::write(fd_, p, left);
+        if (n > 0) {
+            p += n;
+            left -= std::size_t(n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+        struct pollfd pfd {fd_, POLLOUT, 0};
+        if (::poll(&pfd, 1, int(timeout_ms_)) == 0) {
+            throw std::runtime_error("the device does not read its port");
+        }
+    }
+}
+
+bool DownloadClient::receive(Frame& frame, unsigned timeout_ms)
+{
+    const auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        // Skip to a header with the magic and a valid CRC, anything else is
+        // the sensor data stream or a frame cut by an overrun
+        std::size_t pos = 0;
+        while (rx_.size() - pos >= DATALOG_DL_HEADER_SIZE) {
+            DATALOG_DL_Header_t h;
+            std::memcpy(&h, rx_.data() + pos, sizeof(h));
+            if (h.magic != DATALOG_DL_MAGIC || h.size > DATALOG_DL_PAYLOAD_MAX || h.crc != header_crc(h)) {
+                pos++;
+                continue;
+            }
+            if (rx_.size() - pos - DATALOG_DL_HEADER_SIZE < h.size) {
+                break;
+            }
+            const std::uint8_t* payload = rx_.data() + pos + DATALOG_DL_HEADER_SIZE;
+            frame.type = h.type;
+            frame.file = h.file;
+            frame.arg = h.arg;
+            frame.count = h.count;
+            frame.payload.assign(payload, payload + h.size);
+            frame.payload_ok = h.size == 0 ? h.data_crc == 0 : payload_crc(payload, h.size) == h.data_crc;
+            rx_.erase(rx_.begin(), rx_.begin() + std::ptrdiff_t(pos + DATALOG_DL_HEADER_SIZE + h.size));
+            return true;
+        }
+        rx_.erase(rx_.begin(), rx_.begin() + std::ptrdiff_t(pos));
+
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (left <= 0) {
+            return false;
+        }
+        struct pollfd pfd {fd_, POLLIN, 0};
+        int r = ::poll(&pfd, 1, int(left));
+        if (r < 0 && errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+        if (r <= 0) {
+            continue;
+        }
+        std::uint8_t buf[65536];
+        ssize_t n = ::read(fd_, buf, sizeof(buf));
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        if (n == 0) {
+            throw std::runtime_error("the device closed the port");
+        }
+        if (n > 0) {
+            rx_.insert(rx_.end(), buf, buf + n);
+        }
+    }
+}
+
+} // namespace stlog
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    mapped_file.cpp
+  * @brief   Read only memory mapping of a log file.
+  ******************************************************************************
+  */
+#include "stlog/mapped_file.hpp"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace stlog {
+
+MappedFile::MappedFile(const std::string& path)
+{
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0) {
+        int err = errno;
+        reset();
+        throw std::system_error(err, std::generic_category(), "stat " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ == 0) {
+        return;
+    }
+
+    void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (addr == MAP_FAILED) {
+        int err = errno;
+        reset();
+        throw std::system_error(err, std::generic_category(), "mmap " + path);
+    }
+    data_ = static_cast<const std::uint8_t*>(addr);
+
+    // The decoder walks the file front to back with several threads at once
+    ::madvise(addr, size_, MADV_SEQUENTIAL);
+    ::madvise(addr, size_, MADV_WILLNEED);
+}
+
+MappedFile::~MappedFile()
+{
+    reset();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)),
+      data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        fd_ = std::exchange(other.fd_, -1);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+void MappedFile::reset() noexcept
+{
+    if (data_ != nullptr) {
+        ::munmap(const_cast<std::uint8_t*>(data_), size_);
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+} // namespace stlog
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    sector_image.cpp
+  * @brief   File backed SD card image recording the sector write pattern of
+  *          the firmware log writes.
+  ******************************************************************************
+  */
+#include "stlog/sector_image.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace stlog {
+
+SectorImage::SectorImage(const std::string& path, std::size_t sector_size)
+    : fd_(::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)),
+      sector_size_(sector_size),
+      cache_(sector_size)
+{
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+}
+
+SectorImage::~SectorImage()
+{
+    ::close(fd_);
+}
+
+void SectorImage::write_sectors(std::uint64_t first, const std::uint8_t* data, std::size_t count)
+{
+    const std::size_t bytes = count * sector_size_;
+    const off_t offset = static_cast<off_t>(first * sector_size_);
+    if (::pwrite(fd_, data, bytes, offset) != static_cast<ssize_t>(bytes)) {
+        throw std::system_error(errno, std::generic_category(), "write image");
+    }
+    stored_ = std::max<std::uint64_t>(stored_, first * sector_size_ + bytes);
+    ++stats_.commands;
+    stats_.sectors += count;
+}
+
+void SectorImage::append(const std::uint8_t* data, std::size_t size)
+{
+    ++stats_.requests;
+    while (size > 0) {
+        const std::uint64_t sector = pos_ / sector_size_;
+        const std::size_t offset = static_cast<std::size_t>(pos_ % sector_size_);
+
+        if (offset == 0 && size >= sector_size_) {
+            // Whole sectors straight from the caller's buffer
+            const std::size_t count = size / sector_size_;
+            if (cache_sector_ >= sector && cache_sector_ < sector + count) {
+                cache_sector_ = UINT64_MAX;
+                cache_dirty_ = false;
+            }
+            write_sectors(sector, data, count);
+            pos_ += count * sector_size_;
+            data += count * sector_size_;
+            size -= count * sector_size_;
+            continue;
+        }
+
+        if (cache_sector_ != sector) {
+            flush();
+            if (sector * sector_size_ < stored_) {
+                if (::pread(fd_, cache_.data(), sector_size_, static_cast<off_t>(sector * sector_size_)) < 0) {
+                    throw std::system_error(errno, std::generic_category(), "read image");
+                }
+                ++stats_.reads;
+            } else {
+                std::fill(cache_.begin(), cache_.end(), std::uint8_t(0));
+            }
+            cache_sector_ = sector;
+        }
+        const std::size_t n = std::min(size, sector_size_ - offset);
+        std::memcpy(cache_.data() + offset, data, n);
+        cache_dirty_ = true;
+        pos_ += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void SectorImage::flush()
+{
+    if (cache_dirty_) {
+        write_sectors(cache_sector_, cache_.data(), 1);
+        cache_dirty_ = false;
+    }
+}
+
+} // namespace stlog
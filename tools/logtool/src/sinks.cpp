@@ -0,0 +1,169 @@
+/**
+  ******************************************************************************
+  * @file    sinks.cpp
+  * @brief   Output formats for the decoded records.
+  ******************************************************************************
+  */
+#include "stlog/sinks.hpp"
+#include "stlog/channels.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <sys/stat.h>
+
+namespace stlog {
+
+namespace {
+
+constexpr std::size_t max_field_chars = 32;
+
+const char* type_suffix(ChannelType type)
+{
+    switch (type) {
+    case ChannelType::U32: return ".u32";
+    case ChannelType::I32: return ".i32";
+    case ChannelType::F32: return ".f32";
+    }
+    return ".bin";
+}
+
+void write_all(std::FILE* file, const void* data, std::size_t size)
+{
+    if (size != 0 && std::fwrite(data, 1, size, file) != size) {
+        throw std::system_error(errno, std::generic_category(), "write");
+    }
+}
+
+std::vector<std::size_t> channel_ids(std::uint16_t mask)
+{
+    std::vector<std::size_t> ids;
+    for (std::size_t idx = 0; idx < channels.size(); ++idx) {
+        if (has_channel(mask, idx)) {
+            ids.push_back(idx);
+        }
+    }
+    return ids;
+}
+
+} // namespace
+
+CsvSink::CsvSink(const std::string& path)
+    : file_(path == "-" ? stdout : std::fopen(path.c_str(), "wb")),
+      owned_(path != "-")
+{
+    if (file_ == nullptr) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+}
+
+CsvSink::~CsvSink()
+{
+    if (owned_ && file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+void CsvSink::begin(std::uint16_t channel_mask)
+{
+    ids_ = channel_ids(channel_mask);
+    std::string header;
+    for (auto idx : ids_) {
+        header += channels[idx].title;
+        header += ',';
+    }
+    header.back() = '\n';
+    write_all(file_, header.data(), header.size());
+}
+
+void CsvSink::encode(Chunk& chunk) const
+{
+    chunk.encoded.resize(chunk.records.size() * ids_.size() * max_field_chars);
+    char* p = chunk.encoded.data();
+    char* end = p + chunk.encoded.size();
+
+    for (const auto& rec : chunk.records) {
+        for (auto idx : ids_) {
+            p = format_value(p, end, channels[idx], channel_word(rec, idx));
+            *p++ = ',';
+        }
+        p[-1] = '\n';
+    }
+    chunk.encoded.resize(std::size_t(p - chunk.encoded.data()));
+}
+
+void CsvSink::write(const Chunk& chunk)
+{
+    write_all(file_, chunk.encoded.data(), chunk.encoded.size());
+}
+
+void CsvSink::finish()
+{
+    if (std::fflush(file_) != 0) {
+        throw std::system_error(errno, std::generic_category(), "flush");
+    }
+}
+
+ColumnSink::ColumnSink(const std::string& directory)
+    : directory_(directory)
+{
+    if (::mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) {
+        throw std::system_error(errno, std::generic_category(), "mkdir " + directory);
+    }
+}
+
+ColumnSink::~ColumnSink()
+{
+    for (auto* file : files_) {
+        std::fclose(file);
+    }
+}
+
+void ColumnSink::begin(std::uint16_t channel_mask)
+{
+    ids_ = channel_ids(channel_mask);
+    for (auto idx : ids_) {
+        const ChannelInfo& info = channels[idx];
+        std::string path = directory_ + "/" + info.name + type_suffix(info.type);
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        files_.push_back(file);
+    }
+}
+
+void ColumnSink::encode(Chunk& chunk) const
+{
+    const std::size_t count = chunk.records.size();
+    chunk.encoded.resize(count * ids_.size() * DATALOG_CHANNEL_SIZE);
+
+    // Transpose: the n-th file occupies [n * count, (n + 1) * count) words
+    char* out = chunk.encoded.data();
+    for (std::size_t row = 0; row < count; ++row) {
+        for (std::size_t n = 0; n < ids_.size(); ++n) {
+            std::uint32_t word = channel_word(chunk.records[row], ids_[n]);
+            std::memcpy(out + (n * count + row) * DATALOG_CHANNEL_SIZE, &word, sizeof(word));
+        }
+    }
+}
+
+void ColumnSink::write(const Chunk& chunk)
+{
+    const std::size_t bytes = chunk.records.size() * DATALOG_CHANNEL_SIZE;
+    for (std::size_t idx = 0; idx < files_.size(); ++idx) {
+        write_all(files_[idx], chunk.encoded.data() + idx * bytes, bytes);
+    }
+}
+
+void ColumnSink::finish()
+{
+    for (auto* file : files_) {
+        if (std::fflush(file) != 0) {
+            throw std::system_error(errno, std::generic_category(), "flush");
+        }
+    }
+}
+
+} // namespace stlog
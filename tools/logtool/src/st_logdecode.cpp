@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file    st_logdecode.cpp
+  * @brief   Convert SensorTile SD logs (binary or CSV) to CSV or per channel
+  *          column files, decoding on all cores.
+  ******************************************************************************
+  */
+#include "stlog/channel_reader.hpp"
+#include "stlog/channels.hpp"
+#include "stlog/decode.hpp"
+#include "stlog/mapped_file.hpp"
+#include "stlog/sinks.hpp"
+#include "stlog/time_index.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-j threads] [-f csv|columns|none] [-c channel] [-t from[:to]] [-R] [-o output] <log file>\n"
+        "  -j  number of decoding threads (default: all cores)\n"
+        "  -f  output format (default: csv)\n"
+        "      csv      CSV text, '-' writes to stdout (default)\n"
+        "      columns  one raw array per channel in the output directory\n"
+        "      none     decode only, print statistics\n"
+        "  -c  extract a single channel of a binary log, reading only its column\n"
+        "      when the log is columnar. Written as text, or as a raw array with -f columns\n"
+        "  -t  only the records from..to ms (included), binary logs seek with their time index\n"
+        "  -R  append the time index to a binary log that was not closed cleanly\n"
+        "  -o  output file or directory\n",
+        argv0);
+}
+
+int extract_channel(const std::string& input, const std::string& name, const std::string& format, const std::string& output)
+{
+    const std::size_t channel = stlog::find_channel(name);
+    if (channel >= stlog::channels.size()) {
+        std::fprintf(stderr, "unknown channel %s, valid channels are:", name.c_str());
+        for (const auto& info : stlog::channels) {
+            std::fprintf(stderr, " %s", info.name);
+        }
+        std::fprintf(stderr, "\n");
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    stlog::ChannelReadStats stats;
+    std::vector<std::uint32_t> values = stlog::read_channel(input, channel, &stats);
+
+    std::FILE* out = output.empty() || output == "-" ? stdout : std::fopen(output.c_str(), "wb");
+    if (out == nullptr) {
+        std::perror(output.c_str());
+        return EXIT_FAILURE;
+    }
+    if (format == "columns") {
+        std::fwrite(values.data(), sizeof(values[0]), values.size(), out);
+    } else {
+        char text[64];
+        for (auto word : values) {
+            char* end = stlog::format_value(text, text + sizeof(text) - 1, stlog::channels[channel], word);
+            *end++ = '\n';
+            std::fwrite(text, 1, std::size_t(end - text), out);
+        }
+    }
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::fprintf(stderr, "%s: %zu values of %s, %llu blocks, %llu errors, read %.1f MB in %.3f s\n",
+                 input.c_str(), values.size(), name.c_str(),
+                 static_cast<unsigned long long>(stats.blocks),
+                 static_cast<unsigned long long>(stats.errors),
+                 stats.bytes_read / 1e6, elapsed.count());
+    return stats.errors == 0 ? EXIT_SUCCESS : 2;
+}
+
+int repair_index(const std::string& input)
+{
+    stlog::TimeIndex index;
+    std::size_t file_size;
+    {
+        // Unmapped before the file is truncated
+        stlog::MappedFile file(input);
+        if (stlog::detect_kind(file.data(), file.size()) != stlog::LogKind::Binary) {
+            throw std::runtime_error(input + " is not a binary log");
+        }
+        index = stlog::load_time_index(file.data(), file.size());
+        file_size = file.size();
+    }
+
+    if (index.from_footer) {
+        std::fprintf(stderr, "%s: already has a time index (%zu entries)\n", input.c_str(), index.entries.size());
+        return EXIT_SUCCESS;
+    }
+    stlog::append_time_index(input, index);
+    std::fprintf(stderr, "%s: %zu data blocks, dropped %zu trailing bytes, appended %zu index entries\n",
+                 input.c_str(), index.data_blocks, file_size - index.data_blocks * index.block_size,
+                 index.entries.size());
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    stlog::DecodeOptions options;
+    std::string format = "csv";
+    std::string output;
+    std::string channel;
+
+    bool repair = false;
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "j:f:c:t:Ro:h")) != -1) {
+        switch (opt) {
+        case 'c': channel = optarg; break;
+        case 'R': repair = true; break;
+        case 't': {
+            char* end;
+            options.from_ms = static_cast<std::uint32_t>(std::strtoul(optarg, &end, 10));
+            if (*end == ':') {
+                options.to_ms = static_cast<std::uint32_t>(std::strtoul(end + 1, nullptr, 10));
+            }
+            break;
+        }
+        case 'j': options.threads = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'f': format = optarg; break;
+        case 'o': output = optarg; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        if (repair) {
+            return repair_index(argv[optind]);
+        }
+        if (!channel.empty()) {
+            return extract_channel(argv[optind], channel, format, output);
+        }
+
+        std::unique_ptr<stlog::OutputSink> sink;
+        if (format == "csv") {
+            sink = std::make_unique<stlog::CsvSink>(output.empty() ? "-" : output);
+        } else if (format == "columns") {
+            if (output.empty()) {
+                std::fprintf(stderr, "columns output needs a directory (-o)\n");
+                return EXIT_FAILURE;
+            }
+            sink = std::make_unique<stlog::ColumnSink>(output);
+        } else if (format == "none") {
+            sink = std::make_unique<stlog::NullSink>();
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        stlog::MappedFile file(argv[optind]);
+        auto start = std::chrono::steady_clock::now();
+        stlog::DecodeStats stats = stlog::decode_file(file, *sink, options);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::fprintf(stderr, "%s: %llu records, %llu errors (%llu CRC), %.1f MB in %.3f s (%.1f MB/s)\n",
+                     argv[optind],
+                     static_cast<unsigned long long>(stats.records),
+                     static_cast<unsigned long long>(stats.errors),
+                     static_cast<unsigned long long>(stats.crc_errors),
+                     stats.bytes / 1e6, elapsed.count(),
+                     stats.bytes / 1e6 / elapsed.count());
+        return stats.errors == 0 ? EXIT_SUCCESS : 2;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file    st_logfetch.cpp
+  * @brief   List and download the SD card files of a SensorTile over its USB
+  *          CDC port, without switching it to mass storage. The chunks lost
+  *          or corrupt are asked again until each file is whole.
+  ******************************************************************************
+  */
+#include "stlog/download.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-a] [-w chunks] [-r retries] [-t ms] [-o dir] <port> [file...]\n"
+        "  lists the files of the SD card, or downloads the given ones\n"
+        "  -a  download all the files\n"
+        "  -w  chunks sent ahead of the acknowledgements (default: 16)\n"
+        "  -r  requests for the chunks still missing after the first pass (default: 3)\n"
+        "  -t  time without answer before a request is given up (default: 1000 ms)\n"
+        "  -o  output directory (default: .)\n",
+        argv0);
+}
+
+bool save(const std::string& path, const std::vector<std::uint8_t>& data)
+{
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+        std::perror(path.c_str());
+        return false;
+    }
+    const bool ok = std::fwrite(data.data(), 1, data.size(), out) == data.size();
+    if (std::fclose(out) != 0 || !ok) {
+        std::perror(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool all = false;
+    unsigned window = 16;
+    unsigned retries = 3;
+    unsigned timeout_ms = 1000;
+    std::string dir = ".";
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "aw:r:t:o:h")) != -1) {
+        switch (opt) {
+        case 'a': all = true; break;
+        case 'w': window = unsigned(std::strtoul(optarg, nullptr, 10)); break;
+        case 'r': retries = unsigned(std::strtoul(optarg, nullptr, 10)); break;
+        case 't': timeout_ms = unsigned(std::strtoul(optarg, nullptr, 10)); break;
+        case 'o': dir = optarg; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || window == 0 || window > 255 || timeout_ms == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::vector<std::string> names(argv + optind + 1, argv + argc);
+
+    try {
+        stlog::DownloadClient client(argv[optind], timeout_ms);
+        const auto files = client.list();
+
+        if (!all && names.empty()) {
+            for (const auto& f : files) {
+                std::printf("%10u  %s\n", f.size, f.name.c_str());
+            }
+            return EXIT_SUCCESS;
+        }
+
+        int status = EXIT_SUCCESS;
+        stlog::DownloadStats total;
+        for (const auto& name : names) {
+            bool found = false;
+            for (const auto& f : files) {
+                found = found || f.name == name;
+            }
+            if (!found) {
+                std::fprintf(stderr, "%s: no such file on the card\n", name.c_str());
+                status = EXIT_FAILURE;
+            }
+        }
+        for (const auto& f : files) {
+            bool wanted = all;
+            for (const auto& name : names) {
+                wanted = wanted || f.name == name;
+            }
+            if (!wanted) {
+                continue;
+            }
+            stlog::DownloadStats st;
+            const auto data = client.read(f, window, retries, &st);
+            if (!save(dir + "/" + f.name, data)) {
+                status = EXIT_FAILURE;
+                continue;
+            }
+            std::printf("%s: %u bytes in %.3f s, %.3f MB/s, %llu bad chunks, %llu requests\n", f.name.c_str(),
+                        f.size, st.seconds, st.seconds > 0 ? double(st.bytes) / st.seconds / 1e6 : 0.0,
+                        static_cast<unsigned long long>(st.bad_chunks),
+                        static_cast<unsigned long long>(st.requests));
+            total.bytes += st.bytes;
+            total.seconds += st.seconds;
+        }
+        if (total.seconds > 0) {
+            std::printf("%llu bytes in %.3f s, %.3f MB/s, chunks of %u bytes, window %u\n",
+                        static_cast<unsigned long long>(total.bytes), total.seconds,
+                        double(total.bytes) / total.seconds / 1e6, client.chunk_size(), window);
+        }
+        return status;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
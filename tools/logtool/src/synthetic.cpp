@@ -0,0 +1,161 @@
+/**
+  ******************************************************************************
+  * @file    synthetic.cpp
+  * @brief   Generator of synthetic SensorTile logs for benchmarks.
+  ******************************************************************************
+  */
+#include "stlog/synthetic.hpp"
+#include "stlog/channels.hpp"
+#include "datalog_block.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+namespace stlog {
+
+namespace {
+
+constexpr std::uint32_t period_ms = 20;
+constexpr std::size_t io_buffer_size = 1u << 20;
+constexpr std::uint16_t index_entries = 256;   // DATALOG_SD_INDEX_ENTRIES
+
+struct FileCloser {
+    void operator()(std::FILE* f) const { std::fclose(f); }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+void write_all(std::FILE* file, const void* data, std::size_t size)
+{
+    if (std::fwrite(data, 1, size, file) != size) {
+        throw std::system_error(errno, std::generic_category(), "write");
+    }
+}
+
+} // namespace
+
+DATALOG_Record_t synthetic_record(std::uint64_t index)
+{
+    const double t = double(index) * period_ms / 1000.0;
+    DATALOG_Record_t rec;
+    rec.ms_counter = static_cast<std::uint32_t>(index * period_ms);
+    for (int axis = 0; axis < 3; ++axis) {
+        rec.acc[axis] = static_cast<std::int32_t>(1000.0 * std::sin(t + axis));
+        rec.gyro[axis] = static_cast<std::int32_t>(25000.0 * std::sin(0.3 * t + axis));
+        rec.mag[axis] = static_cast<std::int32_t>(-400.0 + 50.0 * std::cos(0.01 * t + axis));
+    }
+    rec.pressure = static_cast<float>(1013.25 + 0.5 * std::sin(0.001 * t));
+    rec.temperature = static_cast<float>(24.0 + 2.0 * std::sin(0.0001 * t));
+    rec.humidity = static_cast<float>(45.0 + 5.0 * std::cos(0.0001 * t));
+    return rec;
+}
+
+std::uint64_t write_synthetic_log(const std::string& path, LogKind kind, std::uint64_t bytes,
+                                  std::uint8_t layout, std::uint32_t block_size, std::uint16_t channel_mask)
+{
+    channel_mask |= 1u << DATALOG_CH_MS;
+    FilePtr file(std::fopen(path.c_str(), "wb"));
+    if (!file) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+    std::setvbuf(file.get(), nullptr, _IOFBF, io_buffer_size);
+
+    std::uint64_t written = 0;
+    std::uint64_t index = 0;
+
+    if (kind == LogKind::Binary) {
+        std::vector<std::uint32_t> buffer(block_size / sizeof(std::uint32_t));
+        DATALOG_Block_t blk;
+        DATALOG_Block_Init(&blk, reinterpret_cast<std::uint8_t*>(buffer.data()), block_size, layout, channel_mask, 0);
+        std::vector<DATALOG_IndexEntry_t> entries(index_entries);
+        DATALOG_Index_t idx;
+        DATALOG_Index_Init(&idx, entries.data(), index_entries);
+        while (written < bytes) {
+            DATALOG_Record_t rec = synthetic_record(index++);
+            // Pack the channels of the mask, like DATALOG_Record_Encode
+            std::uint32_t packed[DATALOG_CHANNEL_COUNT];
+            std::size_t n = 0;
+            for (std::size_t idx = 0; idx < DATALOG_CHANNEL_COUNT; ++idx) {
+                if (has_channel(channel_mask, idx)) {
+                    packed[n++] = channel_word(rec, idx);
+                }
+            }
+            if (DATALOG_Block_Append(&blk, reinterpret_cast<const std::uint8_t*>(packed))) {
+                write_all(file.get(), DATALOG_Block_Seal(&blk), block_size);
+                DATALOG_Index_Add(&idx, blk.buffer);
+                DATALOG_Block_Next(&blk);
+                written += block_size;
+            }
+        }
+        // Footer written by DATALOG_SD_Log_Disable
+        std::uint16_t first = 0;
+        do {
+            first = static_cast<std::uint16_t>(first + DATALOG_Index_Seal(&idx, &blk, first));
+            write_all(file.get(), blk.buffer, block_size);
+            DATALOG_Block_Next(&blk);
+        } while (first < idx.count);
+        return index;
+    }
+
+    std::string header;
+    for (std::size_t idx = 0; idx < DATALOG_CHANNEL_COUNT; ++idx) {
+        if (has_channel(channel_mask, idx)) {
+            header += header.empty() ? "" : ",";
+            header += channels[idx].title;
+        }
+    }
+    header += "\r\n";
+    write_all(file.get(), header.data(), header.size());
+    written += header.size();
+
+    char line[256];
+    while (written < bytes) {
+        DATALOG_Record_t rec = synthetic_record(index++);
+        // Same text as DATALOG_Record_FormatCsv
+        char* p = line;
+        char* end = line + sizeof(line);
+        for (std::size_t idx = 0; idx < DATALOG_CHANNEL_COUNT; ++idx) {
+            if (!has_channel(channel_mask, idx)) {
+                continue;
+            }
+            if (p != line) {
+                *p++ = ',';
+                *p++ = ' ';
+            }
+            p = datalog::AllChannels::format_channel(std::uint8_t(idx), rec, p, end);
+        }
+        *p++ = '\r';
+        *p++ = '\n';
+        write_all(file.get(), line, std::size_t(p - line));
+        written += std::size_t(p - line);
+    }
+    return index;
+}
+
+std::vector<WriteRequest> split_write_requests(const std::uint8_t* data, std::size_t size, LogKind kind,
+                                               std::uint32_t block_size)
+{
+    std::vector<WriteRequest> requests;
+    std::size_t start = 0;
+    if (kind == LogKind::Binary) {
+        for (; start + block_size <= size; start += block_size) {
+            requests.push_back({start, block_size});
+        }
+    } else {
+        for (std::size_t pos = 0; pos < size; ++pos) {
+            if (data[pos] == '\n') {
+                requests.push_back({start, pos + 1 - start});
+                start = pos + 1;
+            }
+        }
+    }
+    if (start < size) {
+        requests.push_back({start, size - start});
+    }
+    return requests;
+}
+
+} // namespace stlog
@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file    time_index.cpp
+  * @brief   Time index of binary SensorTile logs, used to seek to a timestamp.
+  ******************************************************************************
+  */
+#include "stlog/time_index.hpp"
+#include "stlog/block.hpp"
+#include "datalog_block.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace stlog {
+
+namespace {
+
+/// Same limit as DATALOG_Index_t, the footer of a rebuilt index is sparse too
+constexpr std::uint16_t max_rebuilt_entries = std::numeric_limits<std::uint16_t>::max() - 1;
+
+struct FileCloser {
+    void operator()(std::FILE* f) const { std::fclose(f); }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+/// Data block with at least one record
+bool is_data_block(const std::uint8_t* block, std::size_t size, DATALOG_BlockHeader_t& hdr)
+{
+    hdr = read_header(block);
+    const DATALOG_ColumnTable_t table = read_column_table(block);
+    return header_is_valid(hdr, size, hdr.layout == DATALOG_LAYOUT_COLUMNAR ? &table : nullptr)
+        && hdr.record_count > 0;
+}
+
+} // namespace
+
+TimeIndex rebuild_time_index(const std::uint8_t* data, std::size_t size, std::size_t block_size)
+{
+    TimeIndex index;
+    index.block_size = block_size;
+    index.data_blocks = size / block_size;
+
+    std::vector<DATALOG_IndexEntry_t> entries(max_rebuilt_entries);
+    DATALOG_Index_t idx;
+    DATALOG_Index_Init(&idx, entries.data(), max_rebuilt_entries);
+    for (std::size_t blk = 0; blk < index.data_blocks; ++blk) {
+        DATALOG_BlockHeader_t hdr;
+        // The sequence of a corrupt block can not be trusted, skip it
+        if (is_data_block(data + blk * block_size, block_size, hdr) && hdr.sequence == blk) {
+            DATALOG_Index_Add(&idx, data + blk * block_size);
+        }
+    }
+    entries.resize(idx.count);
+    index.entries = std::move(entries);
+    return index;
+}
+
+TimeIndex load_time_index(const std::uint8_t* data, std::size_t size)
+{
+    if (size < DATALOG_BLOCK_HEADER_SIZE) {
+        return {};
+    }
+    std::size_t blk_size = block_size(read_header(data));
+    if (blk_size > DATALOG_BLOCK_SIZE_MAX) {
+        blk_size = DATALOG_BLOCK_SIZE;
+    }
+
+    // The footer blocks are the last ones of a cleanly closed log
+    std::size_t blocks = size / blk_size;
+    std::size_t first_footer = blocks;
+    while (first_footer > 0 && size % blk_size == 0
+           && is_index_block(read_header(data + (first_footer - 1) * blk_size), blk_size)) {
+        --first_footer;
+    }
+    if (first_footer == blocks) {
+        return rebuild_time_index(data, size, blk_size);
+    }
+
+    for (std::size_t blk = first_footer; blk < blocks; ++blk) {
+        if (!block_crc_ok(data + blk * blk_size, blk_size)) {
+            return rebuild_time_index(data, first_footer * blk_size, blk_size);
+        }
+    }
+
+    TimeIndex index;
+    index.block_size = blk_size;
+    index.data_blocks = first_footer;
+    index.from_footer = true;
+    for (std::size_t blk = first_footer; blk < blocks; ++blk) {
+        const std::uint8_t* block = data + blk * blk_size;
+        const DATALOG_BlockHeader_t hdr = read_header(block);
+        const std::size_t first = index.entries.size();
+        index.entries.resize(first + hdr.record_count);
+        std::memcpy(&index.entries[first], block + hdr.header_size, hdr.record_count * DATALOG_INDEX_ENTRY_SIZE);
+    }
+    return index;
+}
+
+std::size_t seek_block(const TimeIndex& index, const std::uint8_t* data, std::uint32_t ms)
+{
+    // Bracket the block between two index entries
+    auto after = std::upper_bound(index.entries.begin(), index.entries.end(), ms,
+                                  [](std::uint32_t t, const DATALOG_IndexEntry_t& e) { return t < e.first_ms; });
+    std::size_t lo = (after == index.entries.begin()) ? 0 : std::prev(after)->block;
+    std::size_t hi = (after == index.entries.end()) ? index.data_blocks : after->block;
+    lo = std::min(lo, index.data_blocks);
+    hi = std::min(std::max(hi, lo), index.data_blocks);
+
+    // Last block in [lo, hi) with first_ms <= ms, blocks that can not be
+    // decoded are skipped over
+    std::size_t found = lo;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        std::size_t probe = mid;
+        DATALOG_BlockHeader_t hdr;
+        while (probe < hi && !is_data_block(data + probe * index.block_size, index.block_size, hdr)) {
+            ++probe;
+        }
+        if (probe == hi) {
+            hi = mid;
+        } else if (hdr.first_ms <= ms) {
+            found = probe;
+            lo = probe + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return found;
+}
+
+void append_time_index(const std::string& path, const TimeIndex& index)
+{
+    FilePtr file(std::fopen(path.c_str(), "r+b"));
+    if (!file) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+    const off_t end = static_cast<off_t>(index.data_blocks * index.block_size);
+    if (::ftruncate(::fileno(file.get()), end) != 0 || std::fseek(file.get(), end, SEEK_SET) != 0) {
+        throw std::system_error(errno, std::generic_category(), "truncate " + path);
+    }
+
+    std::vector<DATALOG_IndexEntry_t> entries(index.entries);
+    DATALOG_Index_t idx;
+    DATALOG_Index_Init(&idx, entries.data(), static_cast<std::uint16_t>(entries.size() + 1));
+    idx.count = static_cast<std::uint16_t>(entries.size());
+
+    std::vector<std::uint32_t> buffer(index.block_size / sizeof(std::uint32_t));
+    DATALOG_Block_t blk;
+    DATALOG_Block_Init(&blk, reinterpret_cast<std::uint8_t*>(buffer.data()), static_cast<std::uint32_t>(index.block_size),
+                       DATALOG_LAYOUT_ROW, DATALOG_CHANNEL_MASK_ALL, static_cast<std::uint32_t>(index.data_blocks));
+    std::uint16_t first = 0;
+    do {
+        first = static_cast<std::uint16_t>(first + DATALOG_Index_Seal(&idx, &blk, first));
+        if (std::fwrite(blk.buffer, 1, blk.size, file.get()) != blk.size) {
+            throw std::system_error(errno, std::generic_category(), "write " + path);
+        }
+        DATALOG_Block_Next(&blk);
+    } while (first < idx.count);
+
+    if (std::fflush(file.get()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "flush " + path);
+    }
+}
+
+} // namespace stlog
@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file    st_cdctx_test.cpp
+  * @brief   USB CDC transmit ring of the firmware (bsp/config/usbd_cdc_txring.c)
+  *          against a stubbed USBD_CDC_TransmitPacket: the bytes sent across
+  *          the end of the buffer, the all or nothing writes of a full ring
+  *          and the next transfer started from the transfer completion.
+  ******************************************************************************
+  */
+#include "usbd_cdc_txring.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t ring_size = 256;
+
+int failures = 0;
+
+void check(bool ok, const char* test, const char* what)
+{
+    if (!ok) {
+        std::printf("FAIL %s: %s\n", test, what);
+        failures++;
+    }
+}
+
+/// Stubbed USB device: the IN transfers started, at most one at a time
+struct Device {
+    bool busy = false;
+    bool refuse = false;                 ///< not connected: every start fails
+    std::uint32_t starts = 0;
+    std::vector<std::uint8_t> received;  ///< data of the started transfers, in order
+};
+
+Device device;
+
+std::uint8_t transmit_packet(std::uint8_t* data, std::uint32_t size)
+{
+    if (device.busy || device.refuse) {
+        return 1; // USBD_BUSY
+    }
+    device.busy = true;
+    device.starts++;
+    device.received.insert(device.received.end(), data, data + size);
+    return 0;
+}
+
+/// The transfer in flight ends: the completion interrupt of the firmware
+void complete(CDC_TxRing_t& ring)
+{
+    device.busy = false;
+    CDC_TxRing_Complete(&ring);
+}
+
+std::vector<std::uint8_t> pattern(std::uint32_t size, std::uint32_t seed)
+{
+    std::vector<std::uint8_t> data(size);
+    for (std::uint32_t i = 0; i < size; i++) {
+        data[i] = std::uint8_t((i * 2654435761u + seed) >> 13);
+    }
+    return data;
+}
+
+void reset(CDC_TxRing_t& ring, std::vector<std::uint8_t>& storage)
+{
+    device = Device{};
+    storage.assign(ring_size, 0);
+    CDC_TxRing_Init(&ring, storage.data(), ring_size, transmit_packet);
+}
+
+/// Writes of uneven sizes wrap the buffer several times, each sent whole and in order
+void test_wrap()
+{
+    const char* test = "wrap";
+    std::vector<std::uint8_t> storage;
+    CDC_TxRing_t ring;
+    reset(ring, storage);
+
+    const auto data = pattern(ring_size * 7 + 13, 1);
+    std::uint32_t ofs = 0;
+    std::uint32_t size = 1;
+    bool all_written = true;
+    while (ofs < data.size()) {
+        const std::uint32_t n = std::min<std::uint32_t>(size, std::uint32_t(data.size()) - ofs);
+        if (CDC_TxRing_Write(&ring, &data[ofs], n) == n) {
+            CDC_TxRing_Kick(&ring);
+            ofs += n;
+            size = size * 3 % 97 + 1;
+        } else if (device.busy) {
+            complete(ring);
+        } else {
+            all_written = false;
+            break;
+        }
+    }
+    while (device.busy) {
+        complete(ring);
+    }
+    check(all_written, test, "a write was refused with the ring drained");
+    check(device.received == data, test, "bytes received differ from the bytes written");
+    check(ring.in == ring.out && ring.sending == 0, test, "ring not empty after the last completion");
+    check(ring.in == data.size(), test, "write index");
+}
+
+/// A write that does not fit is refused whole, the ring is left as it was
+void test_full()
+{
+    const char* test = "full";
+    std::vector<std::uint8_t> storage;
+    CDC_TxRing_t ring;
+    reset(ring, storage);
+    device.refuse = true;
+
+    const auto data = pattern(ring_size, 2);
+    check(CDC_TxRing_Write(&ring, data.data(), 200) == 200, test, "first write");
+    check(CDC_TxRing_Write(&ring, &data[200], 57) == 0, test, "write one byte too long accepted");
+    check(ring.in == 200 && ring.out == 0, test, "indexes moved by a refused write");
+    check(CDC_TxRing_Write(&ring, &data[200], 56) == 56, test, "write filling the ring");
+    check(CDC_TxRing_Write(&ring, &data[0], 1) == 0, test, "write to a full ring accepted");
+    check(std::memcmp(storage.data(), data.data(), ring_size) == 0, test, "buffer content");
+
+    // Not connected: the kick leaves the data pending, the next one sends it
+    CDC_TxRing_Kick(&ring);
+    check(ring.sending == 0 && device.starts == 0, test, "transfer started while refused");
+    device.refuse = false;
+    CDC_TxRing_Kick(&ring);
+    check(ring.sending == ring_size && device.received == data, test, "pending data not sent");
+}
+
+/// The completion releases the data sent and starts the next transfer, the
+/// part after the end of the buffer going with a transfer of its own
+void test_rearm()
+{
+    const char* test = "rearm";
+    std::vector<std::uint8_t> storage;
+    CDC_TxRing_t ring;
+    reset(ring, storage);
+
+    const auto data = pattern(ring_size + 100, 3);
+    check(CDC_TxRing_Write(&ring, data.data(), 200) == 200, test, "first write");
+    CDC_TxRing_Kick(&ring);
+    check(device.starts == 1 && ring.sending == 200, test, "first transfer");
+    complete(ring);
+    check(ring.out == 200 && ring.sending == 0, test, "first transfer not released");
+
+    check(CDC_TxRing_Write(&ring, &data[200], 30) == 30, test, "second write");
+    CDC_TxRing_Kick(&ring);
+    check(device.starts == 2 && ring.sending == 30, test, "second transfer");
+
+    // Written while the second transfer is in flight, across the end of the buffer
+    check(CDC_TxRing_Write(&ring, &data[230], 100) == 100, test, "third write");
+    CDC_TxRing_Kick(&ring);
+    check(device.starts == 2, test, "transfer started during another one");
+
+    complete(ring);
+    check(ring.out == 230, test, "second transfer not released");
+    check(device.starts == 3 && ring.sending == ring_size - 230, test, "completion did not send up to the end");
+    complete(ring);
+    check(device.starts == 4 && ring.sending == 74, test, "completion did not send from the buffer start");
+    complete(ring);
+    check(device.starts == 4 && ring.sending == 0 && ring.out == 330, test, "ring not idle once drained");
+    check(device.received == std::vector<std::uint8_t>(data.begin(), data.begin() + 330), test,
+          "bytes received");
+
+    // Idle: a new write is sent at once
+    check(CDC_TxRing_Write(&ring, &data[330], 10) == 10, test, "write after idle");
+    CDC_TxRing_Kick(&ring);
+    check(device.starts == 5 && ring.sending == 10, test, "write after idle not sent");
+}
+
+} // namespace
+
+int main()
+{
+    test_wrap();
+    test_full();
+    test_rearm();
+
+    if (failures == 0) {
+        std::printf("st_cdctx_test: all passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
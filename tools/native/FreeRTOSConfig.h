@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    FreeRTOSConfig.h
+  * @brief   FreeRTOS configuration of the native build, on the POSIX port:
+  *          the values of bsp/config/FreeRTOSConfig.h, with the stacks of
+  *          host threads and one priority more for the emulated interrupts.
+  ******************************************************************************
+  */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdint.h>
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     0
+#define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
+/* The CMSIS-RTOS priorities map to 0..6 as on the target, the emulated
+   interrupts (USB, EXTI) run above all of them */
+#define configMAX_PRIORITIES                    ( 8 )
+/* Task stacks are the stacks of the host threads: configMINIMAL_STACK_SIZE
+   words must stay above PTHREAD_STACK_MIN, and glibc printf and FatFs need
+   more than newlib */
+#define configMINIMAL_STACK_SIZE                ( ( uint32_t ) 4096 )
+#define configSTACK_DEPTH_TYPE                  uint32_t
+#define configMAX_TASK_NAME_LEN                 ( 16 )
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_MUTEXES                       1
+#define configQUEUE_REGISTRY_SIZE               100
+#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configUSE_RECURSIVE_MUTEXES             0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configUSE_APPLICATION_TASK_TAG          0
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configGENERATE_RUN_TIME_STATS           0
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configSUPPORT_STATIC_ALLOCATION         0
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES                   0
+#define configMAX_CO_ROUTINE_PRIORITIES         ( 2 )
+
+/* Software timer definitions: same priority as on the target */
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               ( configMAX_PRIORITIES - 2 )
+#define configTIMER_QUEUE_LENGTH                10
+#define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE * 2 )
+
+/* Priority of the tasks emulating the interrupts of the target */
+#define configNATIVE_IRQ_PRIORITY               ( configMAX_PRIORITIES - 1 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskCleanUpResources           1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_vTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xQueueGetMutexHolder            1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_eTaskGetState                   1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_xTimerPendFunctionCall          0
+
+/* A failed assertion stops the program with its location, instead of the
+   infinite loop of the target */
+void vAssertCalled( const char * pcFile, unsigned long ulLine );
+#define configASSERT( x ) if( ( x ) == 0 ) { vAssertCalled( __FILE__, __LINE__ ); }
+
+#endif /* FREERTOS_CONFIG_H */
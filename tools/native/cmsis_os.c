@@ -0,0 +1,383 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_os.c
+  * @brief   CMSIS-RTOS v1 API of the native build on the FreeRTOS POSIX port,
+  *          with the semantics of the ST wrapper. The emulated interrupts are
+  *          tasks, so the task API is used everywhere.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cmsis_os.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct os_pool_cb
+{
+  uint8_t *pool;
+  uint8_t *markers;
+  uint32_t pool_sz;
+  uint32_t item_sz;
+  uint32_t currentIndex;
+} os_pool_cb_t;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  FreeRTOS priority of a CMSIS-RTOS priority, as the ST wrapper
+  */
+static UBaseType_t makeFreeRtosPriority(osPriority priority)
+{
+  UBaseType_t fpriority = tskIDLE_PRIORITY;
+
+  if(priority != osPriorityError)
+  {
+    fpriority += (UBaseType_t)(priority - osPriorityIdle);
+  }
+  return fpriority;
+}
+
+/**
+  * @brief  Ticks to wait for a timeout in ms: 0 does not wait
+  */
+static TickType_t makeTicks(uint32_t millisec)
+{
+  TickType_t ticks;
+
+  if(millisec == osWaitForever)
+  {
+    return portMAX_DELAY;
+  }
+  if(millisec == 0U)
+  {
+    return 0U;
+  }
+  ticks = millisec / portTICK_PERIOD_MS;
+  return (ticks == 0U) ? 1U : ticks;
+}
+
+/*********************** Kernel Control Functions *****************************/
+
+osStatus osKernelStart (void)
+{
+  vTaskStartScheduler();
+  return osOK;
+}
+
+int32_t osKernelRunning(void)
+{
+  return (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) ? 0 : 1;
+}
+
+uint32_t osKernelSysTick(void)
+{
+  return (uint32_t)xTaskGetTickCount();
+}
+
+/*********************** Thread Management *************************************/
+
+osThreadId osThreadCreate (const osThreadDef_t *thread_def, void *argument)
+{
+  TaskHandle_t handle;
+
+  if(xTaskCreate((TaskFunction_t)thread_def->pthread, (const char *)thread_def->name,
+                 thread_def->stacksize, argument, makeFreeRtosPriority(thread_def->tpriority),
+                 &handle) != pdPASS)
+  {
+    return NULL;
+  }
+  return handle;
+}
+
+osThreadId osThreadGetId (void)
+{
+  return xTaskGetCurrentTaskHandle();
+}
+
+osStatus osThreadTerminate (osThreadId thread_id)
+{
+  vTaskDelete(thread_id);
+  return osOK;
+}
+
+osStatus osThreadYield (void)
+{
+  taskYIELD();
+  return osOK;
+}
+
+/*********************** Generic Wait Functions *******************************/
+
+osStatus osDelay (uint32_t millisec)
+{
+  TickType_t ticks = millisec / portTICK_PERIOD_MS;
+
+  vTaskDelay(ticks ? ticks : 1);
+  return osOK;
+}
+
+/***********************  Timer Management Functions ***************************/
+
+osTimerId osTimerCreate (const osTimerDef_t *timer_def, os_timer_type type, void *argument)
+{
+  /* As the ST wrapper, the callback gets the timer handle */
+  return xTimerCreate("", 1, (type == osTimerPeriodic) ? pdTRUE : pdFALSE, argument,
+                      (TimerCallbackFunction_t)timer_def->ptimer);
+}
+
+osStatus osTimerStart (osTimerId timer_id, uint32_t millisec)
+{
+  TickType_t ticks = millisec / portTICK_PERIOD_MS;
+
+  if(ticks == 0U)
+  {
+    ticks = 1U;
+  }
+  return (xTimerChangePeriod(timer_id, ticks, 0) == pdPASS) ? osOK : osErrorOS;
+}
+
+osStatus osTimerStop (osTimerId timer_id)
+{
+  return (xTimerStop(timer_id, 0) == pdPASS) ? osOK : osErrorOS;
+}
+
+osStatus osTimerDelete (osTimerId timer_id)
+{
+  return (xTimerDelete(timer_id, portMAX_DELAY) == pdPASS) ? osOK : osErrorOS;
+}
+
+/***************************  Signal Management ********************************/
+
+int32_t osSignalSet (osThreadId thread_id, int32_t signals)
+{
+  uint32_t previous;
+
+  if(xTaskGenericNotify(thread_id, (uint32_t)signals, eSetBits, &previous) != pdPASS)
+  {
+    return (int32_t)0x80000000;
+  }
+  return (int32_t)previous;
+}
+
+osEvent osSignalWait (int32_t signals, uint32_t millisec)
+{
+  osEvent ret;
+  uint32_t value;
+
+  if(signals & 0x80000000)
+  {
+    ret.status = osErrorValue;
+    return ret;
+  }
+  if(xTaskNotifyWait(0, (uint32_t)signals, &value, makeTicks(millisec)) != pdPASS)
+  {
+    ret.status = (millisec != 0U) ? osEventTimeout : osOK;
+  }
+  else if((value & (uint32_t)signals) == 0U)
+  {
+    ret.status = osErrorValue;
+  }
+  else
+  {
+    ret.status = osEventSignal;
+    ret.value.signals = (int32_t)value;
+  }
+  return ret;
+}
+
+/****************************  Mutex Management ********************************/
+
+osMutexId osMutexCreate (const osMutexDef_t *mutex_def)
+{
+  (void)mutex_def;
+  return xSemaphoreCreateMutex();
+}
+
+osStatus osMutexWait (osMutexId mutex_id, uint32_t millisec)
+{
+  if(mutex_id == NULL)
+  {
+    return osErrorParameter;
+  }
+  return (xSemaphoreTake(mutex_id, makeTicks(millisec)) == pdTRUE) ? osOK : osErrorOS;
+}
+
+osStatus osMutexRelease (osMutexId mutex_id)
+{
+  return (xSemaphoreGive(mutex_id) == pdTRUE) ? osOK : osErrorOS;
+}
+
+osStatus osMutexDelete (osMutexId mutex_id)
+{
+  vSemaphoreDelete(mutex_id);
+  return osOK;
+}
+
+/********************  Semaphore Management Functions **************************/
+
+osSemaphoreId osSemaphoreCreate (const osSemaphoreDef_t *semaphore_def, int32_t count)
+{
+  SemaphoreHandle_t sema;
+
+  (void)semaphore_def;
+  if(count <= 0)
+  {
+    return NULL;
+  }
+  /* As the ST wrapper: a count of 1 is a binary semaphore, given at creation */
+  if(count == 1)
+  {
+    sema = xSemaphoreCreateBinary();
+    if(sema != NULL)
+    {
+      xSemaphoreGive(sema);
+    }
+    return sema;
+  }
+  return xSemaphoreCreateCounting((UBaseType_t)count, (UBaseType_t)count);
+}
+
+int32_t osSemaphoreWait (osSemaphoreId semaphore_id, uint32_t millisec)
+{
+  if(semaphore_id == NULL)
+  {
+    return osErrorParameter;
+  }
+  return (xSemaphoreTake(semaphore_id, makeTicks(millisec)) == pdTRUE) ? osOK : osErrorOS;
+}
+
+osStatus osSemaphoreRelease (osSemaphoreId semaphore_id)
+{
+  return (xSemaphoreGive(semaphore_id) == pdTRUE) ? osOK : osErrorOS;
+}
+
+osStatus osSemaphoreDelete (osSemaphoreId semaphore_id)
+{
+  vSemaphoreDelete(semaphore_id);
+  return osOK;
+}
+
+/*******************   Memory Pool Management Functions  ***********************/
+
+/**
+  * @brief  Create a memory pool, its blocks 8 byte aligned
+  * @retval pool, NULL if out of memory
+  */
+osPoolId osPoolCreate (const osPoolDef_t *pool_def)
+{
+  os_pool_cb_t *thePool;
+  uint32_t itemSize = (pool_def->item_sz + 7U) & ~7U;
+
+  thePool = (os_pool_cb_t *)calloc(1, sizeof(os_pool_cb_t));
+  if(thePool == NULL)
+  {
+    return NULL;
+  }
+  thePool->pool = (uint8_t *)calloc(pool_def->pool_sz, itemSize);
+  thePool->markers = (uint8_t *)calloc(pool_def->pool_sz, 1);
+  if((thePool->pool == NULL) || (thePool->markers == NULL))
+  {
+    free(thePool->pool);
+    free(thePool->markers);
+    free(thePool);
+    return NULL;
+  }
+  thePool->pool_sz = pool_def->pool_sz;
+  thePool->item_sz = itemSize;
+  thePool->currentIndex = 0;
+  return thePool;
+}
+
+void *osPoolAlloc (osPoolId pool_id)
+{
+  void *p = NULL;
+  uint32_t i;
+  uint32_t index;
+
+  taskENTER_CRITICAL();
+  for(i = 0; i < pool_id->pool_sz; i++)
+  {
+    index = (pool_id->currentIndex + i) % pool_id->pool_sz;
+    if(pool_id->markers[index] == 0U)
+    {
+      pool_id->markers[index] = 1;
+      p = pool_id->pool + (size_t)index * pool_id->item_sz;
+      pool_id->currentIndex = index;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL();
+  return p;
+}
+
+void *osPoolCAlloc (osPoolId pool_id)
+{
+  void *p = osPoolAlloc(pool_id);
+
+  if(p != NULL)
+  {
+    memset(p, 0, pool_id->item_sz);
+  }
+  return p;
+}
+
+osStatus osPoolFree (osPoolId pool_id, void *block)
+{
+  uintptr_t offset;
+
+  if((pool_id == NULL) || (block == NULL) || ((uint8_t *)block < pool_id->pool))
+  {
+    return osErrorParameter;
+  }
+  offset = (uintptr_t)((uint8_t *)block - pool_id->pool);
+  if((offset % pool_id->item_sz) != 0U || (offset / pool_id->item_sz) >= pool_id->pool_sz)
+  {
+    return osErrorParameter;
+  }
+  pool_id->markers[offset / pool_id->item_sz] = 0;
+  return osOK;
+}
+
+/*******************   Message Queue Management Functions  *********************/
+
+/**
+  * @brief  Create a message queue: the messages are pointer wide, whatever
+  *         the item type of the definition, so the firmware posts the
+  *         addresses of its buffers and pool blocks as on the target
+  */
+osMessageQId osMessageCreate (const osMessageQDef_t *queue_def, osThreadId thread_id)
+{
+  (void)thread_id;
+  return xQueueCreate(queue_def->queue_sz, sizeof(uintptr_t));
+}
+
+osStatus osMessagePut (osMessageQId queue_id, uintptr_t info, uint32_t millisec)
+{
+  return (xQueueSend(queue_id, &info, makeTicks(millisec)) == pdTRUE) ? osOK : osErrorOS;
+}
+
+osEvent osMessageGet (osMessageQId queue_id, uint32_t millisec)
+{
+  osEvent event;
+  uintptr_t info;
+
+  event.def.message_id = queue_id;
+  event.value.p = NULL;
+  if(queue_id == NULL)
+  {
+    event.status = osErrorParameter;
+    return event;
+  }
+  if(xQueueReceive(queue_id, &info, makeTicks(millisec)) == pdTRUE)
+  {
+    /* value.p of a posted pool block, value.v of a command */
+    event.value.v = info;
+    event.status = osEventMessage;
+  }
+  else
+  {
+    event.status = (millisec == 0U) ? osOK : osEventTimeout;
+  }
+  return event;
+}
@@ -0,0 +1,215 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_os.h
+  * @brief   CMSIS-RTOS v1 API of the native build: the subset used by the
+  *          firmware and FatFs, with the types and definition macros of the
+  *          ST wrapper, on the FreeRTOS POSIX port.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CMSIS_OS_H
+#define __CMSIS_OS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "queue.h"
+#include "semphr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define osCMSIS           0x10002
+#define osKernelSystemId  "FreeRTOS POSIX"
+
+#define osFeature_MainThread   1
+#define osFeature_Pool         1
+#define osFeature_MailQ        0
+#define osFeature_MessageQ     1
+#define osFeature_Signals      8
+#define osFeature_Semaphore    65535
+#define osFeature_Wait         0
+#define osFeature_SysTick      1
+
+#define osWaitForever     0xFFFFFFFF
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  osPriorityIdle          = -3,
+  osPriorityLow           = -2,
+  osPriorityBelowNormal   = -1,
+  osPriorityNormal        =  0,
+  osPriorityAboveNormal   = +1,
+  osPriorityHigh          = +2,
+  osPriorityRealtime      = +3,
+  osPriorityError         =  0x84
+} osPriority;
+
+typedef enum
+{
+  osOK                    =     0,
+  osEventSignal           =  0x08,
+  osEventMessage          =  0x10,
+  osEventMail             =  0x20,
+  osEventTimeout          =  0x40,
+  osErrorParameter        =  0x80,
+  osErrorResource         =  0x81,
+  osErrorTimeoutResource  =  0xC1,
+  osErrorISR              =  0x82,
+  osErrorISRRecursive     =  0x83,
+  osErrorPriority         =  0x84,
+  osErrorNoMemory         =  0x85,
+  osErrorValue            =  0x86,
+  osErrorOS               =  0xFF,
+  os_status_reserved      =  0x7FFFFFFF
+} osStatus;
+
+typedef enum
+{
+  osTimerOnce             =     0,
+  osTimerPeriodic         =     1
+} os_timer_type;
+
+typedef void (*os_pthread) (void const *argument);
+typedef void (*os_ptimer) (void const *argument);
+
+typedef TaskHandle_t osThreadId;
+typedef TimerHandle_t osTimerId;
+typedef SemaphoreHandle_t osMutexId;
+typedef SemaphoreHandle_t osSemaphoreId;
+typedef struct os_pool_cb *osPoolId;
+typedef QueueHandle_t osMessageQId;
+
+typedef struct os_thread_def
+{
+  char                   *name;
+  os_pthread             pthread;
+  osPriority             tpriority;
+  uint32_t               instances;
+  uint32_t               stacksize;
+} osThreadDef_t;
+
+typedef struct os_timer_def
+{
+  os_ptimer              ptimer;
+} osTimerDef_t;
+
+typedef struct os_mutex_def
+{
+  uint32_t               dummy;
+} osMutexDef_t;
+
+typedef struct os_semaphore_def
+{
+  uint32_t               dummy;
+} osSemaphoreDef_t;
+
+typedef struct os_pool_def
+{
+  uint32_t               pool_sz;
+  uint32_t               item_sz;
+  void                   *pool;
+} osPoolDef_t;
+
+typedef struct os_messageQ_def
+{
+  uint32_t               queue_sz;
+  uint32_t               item_sz;
+  void                   *pool;
+} osMessageQDef_t;
+
+typedef struct
+{
+  osStatus                 status;
+  union
+  {
+    uintptr_t                   v;    /* uint32_t on the target, as wide as p here */
+    void                       *p;
+    int32_t               signals;
+  } value;
+  union
+  {
+    osMessageQId       message_id;
+  } def;
+} osEvent;
+
+/* Exported macro ------------------------------------------------------------*/
+#define osThreadDef(name, thread, priority, instances, stacksz)  \
+const osThreadDef_t os_thread_def_##name = \
+{ #name, (thread), (priority), (instances), (stacksz) }
+#define osThread(name)  &os_thread_def_##name
+
+#define osTimerDef(name, function)  \
+const osTimerDef_t os_timer_def_##name = \
+{ (function) }
+#define osTimer(name)  &os_timer_def_##name
+
+#define osMutexDef(name)  const osMutexDef_t os_mutex_def_##name = { 0 }
+#define osMutex(name)  &os_mutex_def_##name
+
+#define osSemaphoreDef(name)  const osSemaphoreDef_t os_semaphore_def_##name = { 0 }
+#define osSemaphore(name)  &os_semaphore_def_##name
+
+#define osPoolDef(name, no, type)   \
+const osPoolDef_t os_pool_def_##name = \
+{ (no), sizeof(type), NULL }
+#define osPool(name)  &os_pool_def_##name
+
+#define osMessageQDef(name, queue_sz, type)   \
+const osMessageQDef_t os_messageQ_def_##name = \
+{ (queue_sz), sizeof (type), NULL }
+#define osMessageQ(name)  &os_messageQ_def_##name
+
+#define osKernelSysTickFrequency configTICK_RATE_HZ
+
+/* Exported functions ------------------------------------------------------- */
+osStatus osKernelStart (void);
+int32_t osKernelRunning(void);
+uint32_t osKernelSysTick (void);
+
+osThreadId osThreadCreate (const osThreadDef_t *thread_def, void *argument);
+osThreadId osThreadGetId (void);
+osStatus osThreadTerminate (osThreadId thread_id);
+osStatus osThreadYield (void);
+
+osStatus osDelay (uint32_t millisec);
+
+osTimerId osTimerCreate (const osTimerDef_t *timer_def, os_timer_type type, void *argument);
+osStatus osTimerStart (osTimerId timer_id, uint32_t millisec);
+osStatus osTimerStop (osTimerId timer_id);
+osStatus osTimerDelete (osTimerId timer_id);
+
+int32_t osSignalSet (osThreadId thread_id, int32_t signals);
+osEvent osSignalWait (int32_t signals, uint32_t millisec);
+
+osMutexId osMutexCreate (const osMutexDef_t *mutex_def);
+osStatus osMutexWait (osMutexId mutex_id, uint32_t millisec);
+osStatus osMutexRelease (osMutexId mutex_id);
+osStatus osMutexDelete (osMutexId mutex_id);
+
+osSemaphoreId osSemaphoreCreate (const osSemaphoreDef_t *semaphore_def, int32_t count);
+int32_t osSemaphoreWait (osSemaphoreId semaphore_id, uint32_t millisec);
+osStatus osSemaphoreRelease (osSemaphoreId semaphore_id);
+osStatus osSemaphoreDelete (osSemaphoreId semaphore_id);
+
+osPoolId osPoolCreate (const osPoolDef_t *pool_def);
+void *osPoolAlloc (osPoolId pool_id);
+void *osPoolCAlloc (osPoolId pool_id);
+osStatus osPoolFree (osPoolId pool_id, void *block);
+
+osMessageQId osMessageCreate (const osMessageQDef_t *queue_def, osThreadId thread_id);
+osStatus osMessagePut (osMessageQId queue_id, uintptr_t info, uint32_t millisec);
+osEvent osMessageGet (osMessageQId queue_id, uint32_t millisec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CMSIS_OS_H */
@@ -0,0 +1,769 @@
+/**
+  ******************************************************************************
+  * @file    native_board.c
+  * @brief   SensorTile board of the native build. The HAL tick is the
+  *          monotonic clock, the interrupt mask of the firmware is the
+  *          critical section of the POSIX port, the SD card is a disk image
+  *          (image_diskio.c) with the write statistics of the BSP, and a
+  *          board task at the priority of the emulated interrupts plays the
+  *          user: double taps in SD card mode, then the end of the run.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 200809L   /* clock_nanosleep */
+#include "native_board.h"
+#include "native_bus.h"
+#include "cmsis_os.h"
+#include "datalog_application.h"
+#include "datalog_bench.h"
+#include "datalog_busprof.h"
+#include "datalog_record.h"
+#include "datalog_regrec.h"
+#include "image_diskio.h"
+#include "lsm6dsm_reg.h"
+#include "sd_diskio.h"
+#include "SensorTile_sd.h"
+#include "usbd_cdc_interface.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Interrupt sources of a double tap in TAP_SRC: DOUBLE_TAP and TAP_IA */
+#define BOARD_TAP_SRC_DOUBLE_TAP   0x50U
+/* Time the double tap event stays readable, then the sensor clears it */
+#define BOARD_TAP_PULSE_MS         20U
+/* Longest wait for the SD card log to close after the last tap */
+#define BOARD_LOG_CLOSE_MS         5000U
+
+/* Private variables ---------------------------------------------------------*/
+GPIO_TypeDef NativeGPIO[7];
+CoreDebug_Type NativeCoreDebug;
+/* Core clock of the target, the rate of the emulated cycle counter */
+uint32_t SystemCoreClock = 80000000U;
+
+static NATIVE_Config_t BoardConfig;
+static struct timespec BoardStart;
+static volatile uint8_t Exti2Enabled = 0;
+static __thread uint32_t PriMask = 0;
+
+static SD_WriteStats SdWriteStats;
+static uint64_t CardDebtUs = 0;
+
+static const char *const BoardSensorName[NATIVE_BUS_DEVICES] = {"lsm6dsm", "lsm303agr", "hts221", "lps22hb"};
+
+/* Private function prototypes -----------------------------------------------*/
+static void Board_Thread(void *argument);
+static void Board_BenchThread(void *argument);
+static void Board_ReplayThread(void *argument);
+static void Board_DoubleTap(void);
+static void Board_Report(void);
+#if defined(DATALOG_BUS_PROFILE)
+static void Board_Print(void *Context, const char *line, uint32_t size);
+#endif
+static uint64_t Board_SimClock(void);
+
+static DSTATUS NATIVE_SD_initialize(BYTE lun);
+static DSTATUS NATIVE_SD_status(BYTE lun);
+static DRESULT NATIVE_SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count);
+#if _USE_WRITE == 1
+static DRESULT NATIVE_SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count);
+#endif /* _USE_WRITE == 1 */
+#if _USE_IOCTL == 1
+static DRESULT NATIVE_SD_ioctl(BYTE lun, BYTE cmd, void *buff);
+#endif /* _USE_IOCTL == 1 */
+
+/* The SD card of the firmware: the image driver, with the BSP statistics */
+Diskio_drvTypeDef SD_Driver =
+{
+  NATIVE_SD_initialize,
+  NATIVE_SD_status,
+  NATIVE_SD_read,
+#if  _USE_WRITE == 1
+  NATIVE_SD_write,
+#endif /* _USE_WRITE == 1 */
+
+#if  _USE_IOCTL == 1
+  NATIVE_SD_ioctl,
+#endif /* _USE_IOCTL == 1 */
+};
+
+/* Board ---------------------------------------------------------------------*/
+
+/**
+  * @brief  Start the board and the firmware, with the HAL tick at 0. The
+  *         firmware does not return: the board task ends the process
+  * @param  Config: run configuration
+  * @retval None
+  */
+void NATIVE_Run(const NATIVE_Config_t *Config)
+{
+  NATIVE_Sim_Config_t sim;
+
+  BoardConfig = *Config;
+  clock_gettime(CLOCK_MONOTONIC, &BoardStart);
+
+  LoggingInterface = (Config->Mode == NATIVE_MODE_SD) ? SDCARD_Datalog : USB_Datalog;
+  NATIVE_USB_SetPort(Config->UsbFd, Config->UsbDtr, Config->UsbRate);
+  NATIVE_Bus_Reset();
+  sim.Waveform = Config->Waveform;
+  sim.Clock = Board_SimClock;
+  NATIVE_Sim_Attach(&sim);
+  if(Config->Replay != NULL)
+  {
+    NATIVE_Replay_Attach(Config->Replay, NATIVE_REPLAY_TIMED, Board_SimClock);
+  }
+
+  if(xTaskCreate(Board_Thread, "Board", configMINIMAL_STACK_SIZE, NULL,
+                 configNATIVE_IRQ_PRIORITY, NULL) != pdPASS)
+  {
+    fprintf(stderr, "cannot create the board task\n");
+    exit(EXIT_FAILURE);
+  }
+  (void)firmware_main();
+}
+
+/**
+  * @brief  Run the driver and formatting benchmark (datalog_bench.c) on the
+  *         sensor models instead of the firmware, print the report on
+  *         stdout and exit
+  * @param  Config: run configuration, only the sensor models are used
+  * @retval None
+  */
+void NATIVE_Bench(const NATIVE_Config_t *Config)
+{
+  NATIVE_Sim_Config_t sim;
+
+  BoardConfig = *Config;
+  clock_gettime(CLOCK_MONOTONIC, &BoardStart);
+
+  LoggingInterface = USB_Datalog;
+  NATIVE_Bus_Reset();
+  sim.Waveform = Config->Waveform;
+  sim.Clock = Board_SimClock;
+  NATIVE_Sim_Attach(&sim);
+
+  /* In a task, as in the firmware: the interrupt mask is the critical section of the port */
+  if(xTaskCreate(Board_BenchThread, "Bench", configMINIMAL_STACK_SIZE * 4, NULL,
+                 tskIDLE_PRIORITY + 1, NULL) != pdPASS)
+  {
+    fprintf(stderr, "cannot create the benchmark task\n");
+    exit(EXIT_FAILURE);
+  }
+  vTaskStartScheduler();
+}
+
+/**
+  * @brief  Run the sampling and the record formatting of the SD card log on
+  *         each sample of a register recording, as fast as possible, print
+  *         the throughput and a hash of the records on stdout and exit
+  * @param  Config: run configuration, with the recording
+  * @retval None
+  */
+void NATIVE_ReplayBench(const NATIVE_Config_t *Config)
+{
+  NATIVE_Sim_Config_t sim;
+
+  BoardConfig = *Config;
+  clock_gettime(CLOCK_MONOTONIC, &BoardStart);
+
+  LoggingInterface = USB_Datalog;
+  NATIVE_Bus_Reset();
+  sim.Waveform = Config->Waveform;
+  sim.Clock = Board_SimClock;
+  NATIVE_Sim_Attach(&sim);
+  NATIVE_Replay_Attach(Config->Replay, NATIVE_REPLAY_STEP, Board_SimClock);
+
+  if(xTaskCreate(Board_ReplayThread, "Replay", configMINIMAL_STACK_SIZE * 4, NULL,
+                 tskIDLE_PRIORITY + 1, NULL) != pdPASS)
+  {
+    fprintf(stderr, "cannot create the replay task\n");
+    exit(EXIT_FAILURE);
+  }
+  vTaskStartScheduler();
+}
+
+/**
+  * @brief  Replay task: the sensors are set up as by the firmware, then each
+  *         sample of the recording goes through getSensorsData and the
+  *         formatting of the SD card log, stamped with its recorded time so
+  *         the records are those of the field session. Their FNV-1a hash
+  *         tells whether a change of the pipeline changed its output
+  * @param  argument: not used
+  * @retval None
+  */
+static void Board_ReplayThread(void *argument)
+{
+  static T_SensorsData data;
+  NATIVE_Replay_Stats_t stats;
+  struct timespec start;
+  struct timespec end;
+#if defined(DATALOG_SD_BINARY)
+  uint32_t rec[DATALOG_RECORD_SIZE / sizeof(uint32_t)];
+#else
+  char line[256];
+#endif
+  const uint8_t *out;
+  int size;
+  uint32_t hash = 2166136261U;
+  uint32_t samples = 0;
+  uint32_t errors = 0;
+  double ns;
+  int i;
+
+  (void)argument;
+  MX_X_CUBE_MEMS1_Init();
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while(NATIVE_Replay_Step())
+  {
+    if(getSensorsData(&data) != BSP_ERROR_NONE)
+    {
+      errors++;
+    }
+    NATIVE_Replay_GetStats(&stats);
+    data.ms_counter = stats.FrameMs;
+#if defined(DATALOG_SD_BINARY)
+    DATALOG_Record_Encode(&data, (uint8_t *)rec);
+    out = (const uint8_t *)rec;
+    size = (int)DATALOG_Record_Size();
+#else
+    size = DATALOG_Record_FormatCsv(&data, line, sizeof(line));
+    out = (const uint8_t *)line;
+#endif
+    for(i = 0; i < size; i++)
+    {
+      hash = (hash ^ out[i]) * 16777619U;
+    }
+    samples++;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  NATIVE_Replay_GetStats(&stats);
+  ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+  printf("replay: %lu samples (%.3f s recorded) in %.3f ms, %.0f samples/s, %.0f ns per sample\n",
+         (unsigned long)samples,
+         (double)(BoardConfig.Replay->LastMs - BoardConfig.Replay->FirstMs + BoardConfig.Replay->PeriodMs) / 1000.0,
+         ns / 1e6, (ns > 0) ? samples * 1e9 / ns : 0.0, samples ? ns / samples : 0.0);
+  printf("replay: %llu register bytes from the recording, %lu sensor errors, records hash 0x%08lX\n",
+         (unsigned long long)stats.Reads, (unsigned long)errors, (unsigned long)hash);
+  fflush(stdout);
+  vTaskSuspendAll();
+  exit(EXIT_SUCCESS);
+}
+
+/**
+  * @brief  Benchmark task: the sensors are set up as by the firmware, then
+  *         each case is timed
+  * @param  argument: not used
+  * @retval None
+  */
+static void Board_BenchThread(void *argument)
+{
+  static DATALOG_Bench_Result_t results[DATALOG_BENCH_CASES];
+  char line[128];
+  uint32_t count;
+  uint32_t i;
+
+  (void)argument;
+  MX_X_CUBE_MEMS1_Init();
+  count = DATALOG_Bench_Run(results, DATALOG_BENCH_CASES);
+
+  printf("bench: %lu calls per function, cycles of a %lu MHz core\n", (unsigned long)DATALOG_BENCH_ITERATIONS,
+         (unsigned long)(SystemCoreClock / 1000000U));
+  for(i = 0; i < count; i++)
+  {
+    if(DATALOG_Bench_Format(&results[i], line, sizeof(line)) > 0)
+    {
+      /* Without the CR of the CDC port */
+      line[strcspn(line, "\r")] = '\0';
+      printf("%s\n", line);
+    }
+  }
+  fflush(stdout);
+  vTaskSuspendAll();
+  exit(EXIT_SUCCESS);
+}
+
+/**
+  * @brief  The user of the board: a double tap starts the SD card log, a
+  *         second one closes it at the end of the run
+  * @param  argument: not used
+  * @retval None
+  */
+static void Board_Thread(void *argument)
+{
+  uint8_t tapped = 0;
+  uint32_t start;
+
+  (void)argument;
+  for(;;)
+  {
+    vTaskDelay(1);
+    if((BoardConfig.Mode == NATIVE_MODE_SD) && !tapped && (HAL_GetTick() >= BoardConfig.TapMs))
+    {
+      Board_DoubleTap();
+      tapped = 1;
+    }
+    if(((BoardConfig.Stop != NULL) && *BoardConfig.Stop) ||
+       ((BoardConfig.DurationMs != 0U) && (HAL_GetTick() >= BoardConfig.DurationMs)) ||
+       ((BoardConfig.Replay != NULL) && NATIVE_Replay_Done()))
+    {
+      break;
+    }
+  }
+
+  if((BoardConfig.Mode == NATIVE_MODE_SD) && SD_Log_Enabled)
+  {
+    Board_DoubleTap();
+    start = HAL_GetTick();
+    while(SD_Log_Enabled && (HAL_GetTick() - start < BOARD_LOG_CLOSE_MS))
+    {
+      vTaskDelay(1);
+    }
+  }
+
+  Board_Report();
+  vTaskSuspendAll();
+  exit(EXIT_SUCCESS);
+}
+
+/**
+  * @brief  Double tap on the LSM6DSM: the event in TAP_SRC and the INT2
+  *         edge, if the firmware enabled its interrupt
+  * @param  None
+  * @retval None
+  */
+static void Board_DoubleTap(void)
+{
+  if(!Exti2Enabled)
+  {
+    return;
+  }
+  NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_TAP_SRC, BOARD_TAP_SRC_DOUBLE_TAP);
+  HAL_GPIO_EXTI_Callback(BSP_LSM6DSM_INT2);
+  vTaskDelay(BOARD_TAP_PULSE_MS);
+  NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_TAP_SRC, 0);
+}
+
+/**
+  * @brief  Print the card, USB, CDC and sensor counters of the run
+  * @param  None
+  * @retval None
+  */
+static void Board_Report(void)
+{
+  const IMAGE_Stats_t *card = IMAGE_GetStats();
+  CDC_TxOverrun_t overrun;
+  NATIVE_USB_Stats_t usb;
+  NATIVE_Sim_Stats_t sensor;
+  NATIVE_Replay_Stats_t replay;
+#if defined(DATALOG_SD_REGISTERS)
+  DATALOG_RegRec_Stats_t regrec;
+#endif
+  uint32_t i;
+
+  CDC_GetOverrun(&overrun);
+  NATIVE_USB_GetStats(&usb);
+  fprintf(stderr, "run: %lu ms\n", (unsigned long)HAL_GetTick());
+  fprintf(stderr, "card: %llu write commands, %llu sectors, %llu us card time, worst write %lu us\n",
+          (unsigned long long)card->write_commands, (unsigned long long)card->write_sectors,
+          (unsigned long long)card->time_us, (unsigned long)SdWriteStats.Total.MaxUs);
+  fprintf(stderr, "usb: %llu bytes in %llu transfers to the host, %llu bytes from the host\n",
+          (unsigned long long)usb.TxBytes, (unsigned long long)usb.TxTransfers,
+          (unsigned long long)usb.RxBytes);
+  fprintf(stderr, "cdc: %lu writes dropped, %lu bytes\n",
+          (unsigned long)overrun.Dropped, (unsigned long)overrun.DroppedBytes);
+  for(i = 0; i < NATIVE_BUS_DEVICES; i++)
+  {
+    NATIVE_Sim_GetStats((NATIVE_Bus_Device_t)i, &sensor);
+    fprintf(stderr, "%s: %llu data sets, %llu lost by a full FIFO\n", BoardSensorName[i],
+            (unsigned long long)sensor.Samples, (unsigned long long)sensor.FifoOverruns);
+  }
+  if(BoardConfig.Replay != NULL)
+  {
+    NATIVE_Replay_GetStats(&replay);
+    fprintf(stderr, "replay: %lu of %lu frames, %llu register bytes from the recording\n",
+            (unsigned long)replay.Frames, (unsigned long)BoardConfig.Replay->Frames,
+            (unsigned long long)replay.Reads);
+  }
+#if defined(DATALOG_SD_REGISTERS)
+  DATALOG_RegRec_GetStats(&regrec);
+  fprintf(stderr, "regrec: %lu samples recorded, %lu lost, %lu truncated\n", (unsigned long)regrec.Samples,
+          (unsigned long)regrec.Lost, (unsigned long)regrec.Truncated);
+#endif
+#if defined(DATALOG_BUS_PROFILE)
+  /* The period being filled, or the last one if the write task did not report it */
+  DATALOG_BusProf_Report(Board_Print, stderr);
+#endif
+}
+
+#if defined(DATALOG_BUS_PROFILE)
+/**
+  * @brief  Bus profiler line to a stream, without the CR of the CDC port
+  * @param  Context: FILE
+  * @param  line: text
+  * @param  size: length of the text
+  * @retval None
+  */
+static void Board_Print(void *Context, const char *line, uint32_t size)
+{
+  if((size >= 2U) && (line[size - 2] == '\r'))
+  {
+    fwrite(line, 1, size - 2, (FILE *)Context);
+    fputc('\n', (FILE *)Context);
+  }
+  else
+  {
+    fwrite(line, 1, size, (FILE *)Context);
+  }
+}
+#endif
+
+/**
+  * @brief  Time of the sensor models: the monotonic clock since the board
+  *         started, scaled by the simulation speed
+  * @retval ns
+  */
+static uint64_t Board_SimClock(void)
+{
+  struct timespec now;
+  int64_t ns;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ns = (int64_t)(now.tv_sec - BoardStart.tv_sec) * 1000000000LL + (now.tv_nsec - BoardStart.tv_nsec);
+  return (uint64_t)((double)ns * BoardConfig.SimSpeed);
+}
+
+/* HAL -----------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+  return HAL_OK;
+}
+
+void SystemClock_Config(void)
+{
+}
+
+/**
+  * @brief  Milliseconds since the board started
+  * @retval tick
+  */
+uint32_t HAL_GetTick(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((now.tv_sec - BoardStart.tv_sec) * 1000 +
+                    (now.tv_nsec - BoardStart.tv_nsec) / 1000000);
+}
+
+/**
+  * @brief  Busy wait: the task keeps the processor, as on the target
+  * @param  Delay: ms
+  * @retval None
+  */
+void HAL_Delay(uint32_t Delay)
+{
+  struct timespec until;
+
+  clock_gettime(CLOCK_MONOTONIC, &until);
+  until.tv_sec += Delay / 1000U;
+  until.tv_nsec += (long)(Delay % 1000U) * 1000000L;
+  if(until.tv_nsec >= 1000000000L)
+  {
+    until.tv_sec++;
+    until.tv_nsec -= 1000000000L;
+  }
+  /* The tick signal of the port interrupts the sleep */
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR)
+  {
+  }
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+  (void)GPIOx;
+  (void)GPIO_Init;
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+  GPIOx->ODR &= ~GPIO_Pin;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if(PinState != GPIO_PIN_RESET)
+  {
+    GPIOx->ODR |= GPIO_Pin;
+  }
+  else
+  {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  GPIOx->ODR ^= GPIO_Pin;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+  (void)IRQn;
+  (void)PreemptPriority;
+  (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  if(IRQn == BSP_LSM6DSM_INT2_EXTI_IRQn)
+  {
+    Exti2Enabled = 1;
+  }
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  if(IRQn == BSP_LSM6DSM_INT2_EXTI_IRQn)
+  {
+    Exti2Enabled = 0;
+  }
+}
+
+void HAL_PWREx_EnableVddUSB(void)
+{
+}
+
+void HAL_PWREx_EnableVddIO2(void)
+{
+}
+
+/**
+  * @brief  DWT of the core: the cycle counter, when enabled, is the
+  *         monotonic clock at SystemCoreClock
+  * @retval DWT registers
+  */
+DWT_Type *NATIVE_DWT(void)
+{
+  static DWT_Type dwt;
+  struct timespec now;
+  uint64_t ns;
+
+  if(dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    dwt.CYCCNT = (uint32_t)(ns * (SystemCoreClock / 1000000U) / 1000U);
+  }
+  return &dwt;
+}
+
+/**
+  * @brief  PRIMASK of the running task. Masking the interrupts enters a
+  *         critical section: the tick signal and the emulated interrupt
+  *         tasks can not preempt the task until it unmasks them
+  * @retval PRIMASK
+  */
+uint32_t NATIVE_GetPRIMASK(void)
+{
+  return PriMask;
+}
+
+void NATIVE_SetPRIMASK(uint32_t priMask)
+{
+  priMask &= 1U;
+  if(priMask && !PriMask)
+  {
+    taskENTER_CRITICAL();
+  }
+  else if(!priMask && PriMask)
+  {
+    taskEXIT_CRITICAL();
+  }
+  PriMask = priMask;
+}
+
+void vAssertCalled(const char *pcFile, unsigned long ulLine)
+{
+  fprintf(stderr, "assertion failed: %s:%lu\n", pcFile, ulLine);
+  abort();
+}
+
+/* BSP -----------------------------------------------------------------------*/
+
+void BSP_LED_Init(Led_TypeDef Led)
+{
+  BSP_LED_Off(Led);
+}
+
+void BSP_LED_DeInit(Led_TypeDef Led)
+{
+  BSP_LED_Off(Led);
+}
+
+void BSP_LED_On(Led_TypeDef Led)
+{
+  if(Led == LED1)
+  {
+    HAL_GPIO_WritePin(LED1_GPIO_PORT, LED1_PIN, GPIO_PIN_SET);
+  }
+  else
+  {
+    HAL_GPIO_WritePin(LEDSWD_GPIO_PORT, LEDSWD_PIN, GPIO_PIN_SET);
+  }
+}
+
+void BSP_LED_Off(Led_TypeDef Led)
+{
+  if(Led == LED1)
+  {
+    HAL_GPIO_WritePin(LED1_GPIO_PORT, LED1_PIN, GPIO_PIN_RESET);
+  }
+  else
+  {
+    HAL_GPIO_WritePin(LEDSWD_GPIO_PORT, LEDSWD_PIN, GPIO_PIN_RESET);
+  }
+}
+
+void BSP_LED_Toggle(Led_TypeDef Led)
+{
+  if(Led == LED1)
+  {
+    HAL_GPIO_TogglePin(LED1_GPIO_PORT, LED1_PIN);
+  }
+  else
+  {
+    HAL_GPIO_TogglePin(LEDSWD_GPIO_PORT, LEDSWD_PIN);
+  }
+}
+
+void SD_IO_CS_Init(void)
+{
+}
+
+void SD_IO_CS_DeInit(void)
+{
+}
+
+/**
+  * @brief  Card geometry, from the image
+  * @param  pCardInfo: card information
+  * @retval MSD_OK, MSD_ERROR if no image is open
+  */
+uint8_t BSP_SD_GetCardInfo(SD_CardInfo *pCardInfo)
+{
+  DWORD sectors = 0;
+  DWORD block = 0;
+
+  memset(pCardInfo, 0, sizeof(SD_CardInfo));
+  if((IMAGE_Driver.disk_ioctl(0, GET_SECTOR_COUNT, &sectors) != RES_OK) ||
+     (IMAGE_Driver.disk_ioctl(0, GET_BLOCK_SIZE, &block) != RES_OK))
+  {
+    return MSD_ERROR;
+  }
+  pCardInfo->CardType = HIGH_CAPACITY_SD_CARD;
+  pCardInfo->CardBlockSize = BLOCK_SIZE;
+  pCardInfo->CardCapacity = (uint32_t)sectors * BLOCK_SIZE;
+  pCardInfo->LogBlockSize = BLOCK_SIZE;
+  pCardInfo->LogBlockNbr = (uint32_t)sectors;
+  pCardInfo->EraseBlockNbr = (uint32_t)block;
+  pCardInfo->AUBlockNbr = (uint32_t)block;
+  return MSD_OK;
+}
+
+void BSP_SD_GetWriteStats(SD_WriteStats *pStats)
+{
+  *pStats = SdWriteStats;
+}
+
+void BSP_SD_ResetWriteStats(void)
+{
+  memset(&SdWriteStats, 0, sizeof(SdWriteStats));
+}
+
+/**
+  * @brief  Counts a latency in its log2 histogram bucket, as the BSP
+  * @param  Hist: histogram
+  * @param  Us: latency in microseconds
+  * @retval None
+  */
+static void SD_LatencyAdd(SD_LatencyHist *Hist, uint32_t Us)
+{
+  uint32_t bucket = 0;
+
+  while((Us >> bucket) > 1U && bucket < SD_LATENCY_BUCKETS - 1U)
+  {
+    bucket++;
+  }
+  Hist->Hist[bucket]++;
+  Hist->Count++;
+  Hist->TotalUs += Us;
+  if(Us > Hist->MaxUs)
+  {
+    Hist->MaxUs = Us;
+  }
+}
+
+/* SD card disk I/O ----------------------------------------------------------*/
+
+static DSTATUS NATIVE_SD_initialize(BYTE lun)
+{
+  return IMAGE_Driver.disk_initialize(lun);
+}
+
+static DSTATUS NATIVE_SD_status(BYTE lun)
+{
+  return IMAGE_Driver.disk_status(lun);
+}
+
+static DRESULT NATIVE_SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+  return IMAGE_Driver.disk_read(lun, buff, sector, count);
+}
+
+#if _USE_WRITE == 1
+/**
+  * @brief  Write command, timed with the card model of the image. The
+  *         whole command is busy time: the data moves at once. With
+  *         CardSleep, the task is blocked for the card time, as the SD
+  *         driver waits for the DMA and the busy card on the RTOS
+  * @retval DRESULT
+  */
+static DRESULT NATIVE_SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+  uint64_t start = IMAGE_GetStats()->time_us;
+  DRESULT res = IMAGE_Driver.disk_write(lun, buff, sector, count);
+  uint32_t us = (uint32_t)(IMAGE_GetStats()->time_us - start);
+
+  if(res == RES_OK)
+  {
+    SD_LatencyAdd(&SdWriteStats.Response, 0);
+    SD_LatencyAdd(&SdWriteStats.Busy, us);
+    SD_LatencyAdd(&SdWriteStats.Total, us);
+    SdWriteStats.LastUs = us;
+  }
+  if(BoardConfig.CardSleep && osKernelRunning())
+  {
+    CardDebtUs += us;
+    if(CardDebtUs >= 1000U)
+    {
+      vTaskDelay((TickType_t)(CardDebtUs / 1000U));
+      CardDebtUs %= 1000U;
+    }
+  }
+  return res;
+}
+#endif /* _USE_WRITE == 1 */
+
+#if _USE_IOCTL == 1
+static DRESULT NATIVE_SD_ioctl(BYTE lun, BYTE cmd, void *buff)
+{
+  return IMAGE_Driver.disk_ioctl(lun, cmd, buff);
+}
+#endif /* _USE_IOCTL == 1 */
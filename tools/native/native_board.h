@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    native_board.h
+  * @brief   SensorTile board of the native build: the HAL and BSP functions
+  *          left to the firmware sources once the sensors (native_sensors.c,
+  *          native_sim.c) and the USB controller (usbd_native.c) are
+  *          emulated, the SD card on a disk image, and the double tap of the
+  *          user.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NATIVE_BOARD_H
+#define __NATIVE_BOARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_sim.h"
+#include "native_replay.h"
+#include <signal.h>
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  NATIVE_MODE_USB = 0,      /* USB_Datalog */
+  NATIVE_MODE_SD            /* SDCARD_Datalog */
+} NATIVE_Mode_t;
+
+typedef struct
+{
+  NATIVE_Mode_t Mode;
+  int UsbFd;                        /* master side of the CDC port, -1 for no host */
+  uint8_t UsbDtr;                   /* the host opens the port (DTR) */
+  double UsbRate;                   /* bytes/s the host reads, 0 for unlimited */
+  uint32_t DurationMs;              /* run time, 0 until Stop */
+  uint32_t TapMs;                   /* SD mode: double tap starting the log */
+  uint8_t CardSleep;                /* block the writing task for the card time */
+  const NATIVE_Sim_Waveform_t *Waveform;  /* input of the sensor models, NULL for the synthetic one */
+  double SimSpeed;                  /* simulated sensor time per real time */
+  const NATIVE_Replay_t *Replay;    /* register recording in front of the sensor models, NULL for none */
+  volatile sig_atomic_t *Stop;      /* set by the signal handlers */
+} NATIVE_Config_t;
+
+typedef struct
+{
+  uint64_t TxBytes;                 /* device to host */
+  uint64_t RxBytes;                 /* host to device */
+  uint64_t TxTransfers;
+} NATIVE_USB_Stats_t;
+
+/* Exported functions ------------------------------------------------------- */
+void NATIVE_Run(const NATIVE_Config_t *Config);
+void NATIVE_Bench(const NATIVE_Config_t *Config);
+void NATIVE_ReplayBench(const NATIVE_Config_t *Config);
+
+void NATIVE_USB_SetPort(int Fd, uint8_t Dtr, double Rate);
+void NATIVE_USB_GetStats(NATIVE_USB_Stats_t *Stats);
+
+/* Firmware entry point, main() of Src/main.c */
+int firmware_main(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NATIVE_BOARD_H */
@@ -0,0 +1,266 @@
+/**
+  ******************************************************************************
+  * @file    native_bus.c
+  * @brief   Sensor buses of the native build. Each sensor is a register file
+  *          with its power-on contents (identification, HTS221 calibration);
+  *          the multi-byte transfers auto-increment the address, as the
+  *          drivers configure the sensors. The I2C3 and tick functions of the
+  *          BSP bus layer (SensorTile_bus.c) are implemented here, the SPI
+  *          sensors are reached from native_sensors.c.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_bus.h"
+#include "SensorTile_conf.h"
+#include "hts221_reg.h"
+#include "lps22hb_reg.h"
+#include "lsm303agr_reg.h"
+#include "lsm6dsm_reg.h"
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t Regs[NATIVE_BUS_REGS];
+  NATIVE_Bus_Hook_t Hook;
+} Bus_Device_t;
+
+/* Private define ------------------------------------------------------------*/
+/* Auto-increment and SPI read bits the component drivers add to the address */
+#define BUS_REG_MASK  0x7FU
+
+/* Private variables ---------------------------------------------------------*/
+static Bus_Device_t BusDevices[NATIVE_BUS_DEVICES];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Power-on contents of a register file
+  * @param  Device: sensor
+  * @retval None
+  */
+static void Bus_PowerOn(NATIVE_Bus_Device_t Device)
+{
+  uint8_t *regs = BusDevices[Device].Regs;
+
+  memset(regs, 0, NATIVE_BUS_REGS);
+  switch(Device)
+  {
+    case NATIVE_LSM6DSM:
+      regs[LSM6DSM_WHO_AM_I] = LSM6DSM_ID;
+      regs[LSM6DSM_CTRL3_C] = 0x04U;            /* IF_INC */
+      break;
+
+    case NATIVE_LSM303AGR_MAG:
+      regs[LSM303AGR_WHO_AM_I_M] = LSM303AGR_ID_MG;
+      regs[LSM303AGR_CFG_REG_A_M] = 0x03U;      /* idle */
+      break;
+
+    case NATIVE_LPS22HB:
+      regs[LPS22HB_WHO_AM_I] = LPS22HB_ID;
+      regs[LPS22HB_CTRL_REG2] = 0x10U;          /* IF_ADD_INC */
+      break;
+
+    case NATIVE_HTS221:
+      /* Calibration: 0 LSB is 10 degC and 30 %rH, 4096 LSB is 30 degC,
+         8192 LSB is 80 %rH */
+      regs[HTS221_WHO_AM_I] = HTS221_ID;
+      regs[HTS221_H0_RH_X2] = 60U;
+      regs[HTS221_H1_RH_X2] = 160U;
+      regs[HTS221_T0_DEGC_X8] = 80U;
+      regs[HTS221_T1_DEGC_X8] = 240U;
+      regs[HTS221_H1_T0_OUT_L + 1U] = 0x20U;
+      regs[HTS221_T1_OUT_L + 1U] = 0x10U;
+      break;
+
+    default:
+      break;
+  }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Power cycle all the sensors and remove the device models
+  * @param  None
+  * @retval None
+  */
+void NATIVE_Bus_Reset(void)
+{
+  uint32_t i;
+
+  memset(BusDevices, 0, sizeof(BusDevices));
+  for(i = 0; i < NATIVE_BUS_DEVICES; i++)
+  {
+    Bus_PowerOn((NATIVE_Bus_Device_t)i);
+  }
+}
+
+/**
+  * @brief  Software reset of a sensor: the register file goes back to its
+  *         power-on contents, the model stays attached
+  * @param  Device: sensor
+  * @retval None
+  */
+void NATIVE_Bus_ResetDevice(NATIVE_Bus_Device_t Device)
+{
+  Bus_PowerOn(Device);
+}
+
+/**
+  * @brief  Attach a model to a device
+  * @param  Device: sensor
+  * @param  Hook: model, NULL to leave the bare register file
+  * @retval None
+  */
+void NATIVE_Bus_SetHook(NATIVE_Bus_Device_t Device, const NATIVE_Bus_Hook_t *Hook)
+{
+  if(Hook != NULL)
+  {
+    BusDevices[Device].Hook = *Hook;
+  }
+  else
+  {
+    memset(&BusDevices[Device].Hook, 0, sizeof(NATIVE_Bus_Hook_t));
+  }
+}
+
+/**
+  * @brief  Model attached to a device, to put another one in front of it
+  * @param  Device: sensor
+  * @param  Hook: model, all NULL for the bare register file
+  * @retval None
+  */
+void NATIVE_Bus_GetHook(NATIVE_Bus_Device_t Device, NATIVE_Bus_Hook_t *Hook)
+{
+  *Hook = BusDevices[Device].Hook;
+}
+
+/**
+  * @brief  Read a register without going through the model
+  * @param  Device: sensor
+  * @param  Reg: register address
+  * @retval Register value
+  */
+uint8_t NATIVE_Bus_Peek(NATIVE_Bus_Device_t Device, uint8_t Reg)
+{
+  return BusDevices[Device].Regs[Reg & BUS_REG_MASK];
+}
+
+/**
+  * @brief  Write a register without going through the model, as the
+  *         sensor itself does (outputs, status and interrupt sources)
+  * @param  Device: sensor
+  * @param  Reg: register address
+  * @param  Value: register value
+  * @retval None
+  */
+void NATIVE_Bus_Poke(NATIVE_Bus_Device_t Device, uint8_t Reg, uint8_t Value)
+{
+  BusDevices[Device].Regs[Reg & BUS_REG_MASK] = Value;
+}
+
+/**
+  * @brief  Bus read transfer
+  * @param  Device: sensor
+  * @param  Reg: first register address, with the address flags of the driver
+  * @param  pData: destination
+  * @param  Length: number of registers
+  * @retval BSP status
+  */
+int32_t NATIVE_Bus_Read(NATIVE_Bus_Device_t Device, uint8_t Reg, uint8_t *pData, uint16_t Length)
+{
+  Bus_Device_t *dev = &BusDevices[Device];
+  uint8_t reg = Reg & BUS_REG_MASK;
+  uint16_t i;
+
+  for(i = 0; i < Length; i++)
+  {
+    pData[i] = dev->Regs[reg];
+    if(dev->Hook.Read != NULL)
+    {
+      pData[i] = dev->Hook.Read(dev->Hook.Context, reg, pData[i]);
+    }
+    reg = (dev->Hook.Next != NULL) ? dev->Hook.Next(dev->Hook.Context, reg) : reg + 1U;
+    reg &= BUS_REG_MASK;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Bus write transfer
+  * @param  Device: sensor
+  * @param  Reg: first register address, with the address flags of the driver
+  * @param  pData: source
+  * @param  Length: number of registers
+  * @retval BSP status
+  */
+int32_t NATIVE_Bus_Write(NATIVE_Bus_Device_t Device, uint8_t Reg, const uint8_t *pData, uint16_t Length)
+{
+  Bus_Device_t *dev = &BusDevices[Device];
+  uint8_t reg = Reg & BUS_REG_MASK;
+  uint16_t i;
+
+  for(i = 0; i < Length; i++)
+  {
+    dev->Regs[reg] = pData[i];
+    if(dev->Hook.Write != NULL)
+    {
+      dev->Hook.Write(dev->Hook.Context, reg, pData[i]);
+    }
+    reg = (reg + 1U) & BUS_REG_MASK;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/* BSP bus layer -------------------------------------------------------------*/
+
+int32_t BSP_I2C3_Init(void)
+{
+  return BSP_ERROR_NONE;
+}
+
+int32_t BSP_I2C3_DeInit(void)
+{
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  I2C3 register read: only the HTS221 answers
+  * @param  Addr: 8 bit device address
+  * @param  Reg: register address
+  * @param  pData: destination
+  * @param  len: number of registers
+  * @retval BSP status
+  */
+int32_t BSP_I2C3_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t len)
+{
+  if((Addr | 1U) != HTS221_I2C_ADDRESS)
+  {
+    return BSP_ERROR_BUS_FAILURE;
+  }
+  return NATIVE_Bus_Read(NATIVE_HTS221, (uint8_t)Reg, pData, len);
+}
+
+/**
+  * @brief  I2C3 register write: only the HTS221 answers
+  * @param  Addr: 8 bit device address
+  * @param  Reg: register address
+  * @param  pData: source
+  * @param  len: number of registers
+  * @retval BSP status
+  */
+int32_t BSP_I2C3_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pData, uint16_t len)
+{
+  if((Addr | 1U) != HTS221_I2C_ADDRESS)
+  {
+    return BSP_ERROR_BUS_FAILURE;
+  }
+  return NATIVE_Bus_Write(NATIVE_HTS221, (uint8_t)Reg, pData, len);
+}
+
+int32_t BSP_GetTick(void)
+{
+  return (int32_t)HAL_GetTick();
+}
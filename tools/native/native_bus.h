@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    native_bus.h
+  * @brief   Sensor buses of the native build: a register file per sensor
+  *          behind the bus functions of the BSP, with hooks for the device
+  *          models and a peek and poke API for the test stimuli.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NATIVE_BUS_H
+#define __NATIVE_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define NATIVE_BUS_REGS   128U    /* 7 bit register addresses */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  NATIVE_LSM6DSM = 0,
+  NATIVE_LSM303AGR_MAG,
+  NATIVE_HTS221,
+  NATIVE_LPS22HB,
+  NATIVE_BUS_DEVICES
+} NATIVE_Bus_Device_t;
+
+/**
+  * @brief  Model of a device behind its register file. Read is called for
+  *         each byte the firmware reads and returns the byte it gets, so a
+  *         model can update the outputs or pop a FIFO; Write is called after
+  *         each byte written to the register file; Next gives the address
+  *         following Reg in a multi-byte read, for the FIFO outputs that
+  *         roll back (NULL: auto-increment). They run in the task of the
+  *         firmware doing the transfer.
+  */
+typedef struct
+{
+  uint8_t (*Read)(void *Context, uint8_t Reg, uint8_t Value);
+  void    (*Write)(void *Context, uint8_t Reg, uint8_t Value);
+  uint8_t (*Next)(void *Context, uint8_t Reg);
+  void    *Context;
+} NATIVE_Bus_Hook_t;
+
+/* Exported functions ------------------------------------------------------- */
+void NATIVE_Bus_Reset(void);
+void NATIVE_Bus_ResetDevice(NATIVE_Bus_Device_t Device);
+void NATIVE_Bus_SetHook(NATIVE_Bus_Device_t Device, const NATIVE_Bus_Hook_t *Hook);
+void NATIVE_Bus_GetHook(NATIVE_Bus_Device_t Device, NATIVE_Bus_Hook_t *Hook);
+uint8_t NATIVE_Bus_Peek(NATIVE_Bus_Device_t Device, uint8_t Reg);
+void NATIVE_Bus_Poke(NATIVE_Bus_Device_t Device, uint8_t Reg, uint8_t Value);
+int32_t NATIVE_Bus_Read(NATIVE_Bus_Device_t Device, uint8_t Reg, uint8_t *pData, uint16_t Length);
+int32_t NATIVE_Bus_Write(NATIVE_Bus_Device_t Device, uint8_t Reg, const uint8_t *pData, uint16_t Length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NATIVE_BUS_H */
@@ -0,0 +1,366 @@
+/**
+  ******************************************************************************
+  * @file    native_replay.c
+  * @brief   Replay of a sensor register recording. A hook goes in front of
+  *          the model of each sensor (native_bus.c): a register found in a
+  *          frame applied reads as recorded, from then on, without the
+  *          model; the writes, the addressing and the registers never
+  *          recorded go to the model. The calibration frames are applied at
+  *          once. In NATIVE_REPLAY_TIMED mode the recording starts with the
+  *          first read of a register it holds, and each sample frame is
+  *          applied once the clock passes its time from the first one.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_replay.h"
+#include "datalog_regformat.h"
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  NATIVE_Bus_Hook_t Model;
+  uint8_t Value[NATIVE_BUS_REGS];
+  uint8_t Valid[NATIVE_BUS_REGS];       /* read from the recording */
+  uint8_t Recorded[NATIVE_BUS_REGS];    /* in a sample frame */
+} Replay_Device_t;
+
+/* Private variables ---------------------------------------------------------*/
+static Replay_Device_t ReplayDevices[NATIVE_BUS_DEVICES];
+static NATIVE_Replay_t Replay;
+static NATIVE_Replay_Mode_t ReplayMode;
+static uint64_t (*ReplayClock)(void);
+static uint32_t ReplayCursor;           /* next frame */
+static uint8_t ReplayStarted;
+static uint64_t ReplayOriginNs;
+static NATIVE_Replay_Stats_t ReplayStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t Replay_Frame(const NATIVE_Replay_t *Rep, uint32_t Offset, DATALOG_RegFrame_t *Frame);
+static void Replay_Apply(uint32_t Offset, const DATALOG_RegFrame_t *Frame, uint8_t Mark);
+static void Replay_Advance(const Replay_Device_t *Device, uint8_t Reg);
+static uint8_t Replay_Read(void *Context, uint8_t Reg, uint8_t Value);
+static void Replay_Write(void *Context, uint8_t Reg, uint8_t Value);
+static uint8_t Replay_Next(void *Context, uint8_t Reg);
+
+/* The sensors of the recording are the devices of the bus, in the same order */
+_Static_assert(DATALOG_REGREC_LSM6DSM == NATIVE_LSM6DSM && DATALOG_REGREC_LSM303AGR_MAG == NATIVE_LSM303AGR_MAG &&
+               DATALOG_REGREC_HTS221 == NATIVE_HTS221 && DATALOG_REGREC_LPS22HB == NATIVE_LPS22HB &&
+               DATALOG_REGREC_DEVICES == NATIVE_BUS_DEVICES, "register recording and bus devices differ");
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Check a recording and count its frames. A file cut by a power
+  *         loss ends at its last complete frame
+  * @param  Rep: recording, filled
+  * @param  Data: file contents
+  * @param  Size: file size
+  * @retval 0 on success, -1 if it is not a register recording or holds no sample
+  */
+int NATIVE_Replay_Open(NATIVE_Replay_t *Rep, const uint8_t *Data, uint32_t Size)
+{
+  DATALOG_RegHeader_t header;
+  DATALOG_RegFrame_t frame;
+  uint32_t offset;
+
+  memset(Rep, 0, sizeof(NATIVE_Replay_t));
+  Rep->Data = Data;
+  Rep->Size = Size;
+  if(Size < DATALOG_REGREC_HEADER_SIZE)
+  {
+    return -1;
+  }
+  memcpy(&header, Data, sizeof(header));
+  if((header.magic != DATALOG_REGREC_MAGIC) || (header.version != DATALOG_REGREC_VERSION) ||
+     (header.header_size < DATALOG_REGREC_HEADER_SIZE) || (header.header_size > Size))
+  {
+    return -1;
+  }
+  Rep->PeriodMs = header.period_ms;
+
+  offset = header.header_size;
+  Rep->Start = offset;
+  Rep->First = offset;
+  while(Replay_Frame(Rep, offset, &frame))
+  {
+    if(!(frame.flags & DATALOG_REGREC_FLAG_CONST))
+    {
+      if(Rep->Frames == 0U)
+      {
+        Rep->First = offset;
+        Rep->FirstMs = frame.ms_counter;
+      }
+      Rep->LastMs = frame.ms_counter;
+      Rep->Frames++;
+      Rep->Gaps += (frame.flags & DATALOG_REGREC_FLAG_GAP) ? 1U : 0U;
+      Rep->Truncated += (frame.flags & DATALOG_REGREC_FLAG_TRUNCATED) ? 1U : 0U;
+    }
+    offset += DATALOG_REGREC_FRAME_SIZE + frame.size;
+  }
+  Rep->End = offset;
+  return (Rep->Frames != 0U) ? 0 : -1;
+}
+
+/**
+  * @brief  Put the replay in front of the sensor models, which must be
+  *         attached, and apply the calibration frames
+  * @param  Rep: recording checked by NATIVE_Replay_Open, kept in memory
+  * @param  Mode: frames by time or by NATIVE_Replay_Step
+  * @param  Clock: ns of the sensor models, for NATIVE_REPLAY_TIMED
+  * @retval None
+  */
+void NATIVE_Replay_Attach(const NATIVE_Replay_t *Rep, NATIVE_Replay_Mode_t Mode, uint64_t (*Clock)(void))
+{
+  NATIVE_Bus_Hook_t hook;
+  DATALOG_RegFrame_t frame;
+  uint32_t offset;
+  uint32_t i;
+
+  memset(ReplayDevices, 0, sizeof(ReplayDevices));
+  memset(&ReplayStats, 0, sizeof(ReplayStats));
+  Replay = *Rep;
+  ReplayMode = Mode;
+  ReplayClock = Clock;
+  ReplayStarted = 0;
+
+  for(i = 0; i < NATIVE_BUS_DEVICES; i++)
+  {
+    NATIVE_Bus_GetHook((NATIVE_Bus_Device_t)i, &ReplayDevices[i].Model);
+  }
+
+  /* Registers of the samples, then the calibration before them */
+  for(offset = Replay.First; Replay_Frame(&Replay, offset, &frame); offset += DATALOG_REGREC_FRAME_SIZE + frame.size)
+  {
+    if(!(frame.flags & DATALOG_REGREC_FLAG_CONST))
+    {
+      Replay_Apply(offset, &frame, 1);
+    }
+  }
+  for(offset = Replay.Start; offset < Replay.First; offset += DATALOG_REGREC_FRAME_SIZE + frame.size)
+  {
+    (void)Replay_Frame(&Replay, offset, &frame);
+    Replay_Apply(offset, &frame, 0);
+  }
+  ReplayCursor = Replay.First;
+
+  for(i = 0; i < NATIVE_BUS_DEVICES; i++)
+  {
+    hook.Read = Replay_Read;
+    hook.Write = Replay_Write;
+    hook.Next = Replay_Next;
+    hook.Context = &ReplayDevices[i];
+    NATIVE_Bus_SetHook((NATIVE_Bus_Device_t)i, &hook);
+  }
+}
+
+/**
+  * @brief  Apply the next sample frame, in NATIVE_REPLAY_STEP mode
+  * @param  None
+  * @retval 1 if a frame was applied, 0 at the end of the recording
+  */
+uint8_t NATIVE_Replay_Step(void)
+{
+  DATALOG_RegFrame_t frame;
+
+  while((ReplayCursor < Replay.End) && Replay_Frame(&Replay, ReplayCursor, &frame))
+  {
+    Replay_Apply(ReplayCursor, &frame, 0);
+    ReplayCursor += DATALOG_REGREC_FRAME_SIZE + frame.size;
+    if(!(frame.flags & DATALOG_REGREC_FLAG_CONST))
+    {
+      ReplayStats.Frames++;
+      ReplayStats.FrameMs = frame.ms_counter;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  End of the recording: all the frames applied and, in
+  *         NATIVE_REPLAY_TIMED mode, one sampling period after the last one
+  * @param  None
+  * @retval 1 at the end
+  */
+uint8_t NATIVE_Replay_Done(void)
+{
+  uint64_t ms;
+
+  if(ReplayCursor < Replay.End)
+  {
+    return 0;
+  }
+  if(ReplayMode == NATIVE_REPLAY_STEP)
+  {
+    return 1;
+  }
+  ms = (ReplayClock() - ReplayOriginNs) / 1000000U;
+  return ms > (uint64_t)(Replay.LastMs - Replay.FirstMs) + Replay.PeriodMs;
+}
+
+/**
+  * @brief  Frames applied and bytes read from the recording
+  * @param  Stats: counters
+  * @retval None
+  */
+void NATIVE_Replay_GetStats(NATIVE_Replay_Stats_t *Stats)
+{
+  *Stats = ReplayStats;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Frame header at an offset, if the frame is complete
+  * @param  Rep: recording
+  * @param  Offset: start of the frame
+  * @param  Frame: header, copied out (the frames are not aligned)
+  * @retval 1 if it is a frame
+  */
+static uint8_t Replay_Frame(const NATIVE_Replay_t *Rep, uint32_t Offset, DATALOG_RegFrame_t *Frame)
+{
+  if((Offset > Rep->Size) || (Rep->Size - Offset < DATALOG_REGREC_FRAME_SIZE))
+  {
+    return 0;
+  }
+  memcpy(Frame, &Rep->Data[Offset], sizeof(DATALOG_RegFrame_t));
+  return (Frame->sync == DATALOG_REGREC_SYNC) &&
+         (Rep->Size - Offset - DATALOG_REGREC_FRAME_SIZE >= Frame->size);
+}
+
+/**
+  * @brief  Registers of a frame: their values, or only marked as recorded
+  * @param  Offset: start of the frame
+  * @param  Frame: its header
+  * @param  Mark: 0 to apply the values, 1 to mark the registers recorded
+  * @retval None
+  */
+static void Replay_Apply(uint32_t Offset, const DATALOG_RegFrame_t *Frame, uint8_t Mark)
+{
+  const uint8_t *p = &Replay.Data[Offset + DATALOG_REGREC_FRAME_SIZE];
+  const uint8_t *end = p + Frame->size;
+
+  while(end - p >= (long)DATALOG_REGREC_ENTRY_HEADER)
+  {
+    Replay_Device_t *dev = &ReplayDevices[DATALOG_REGREC_DEVICE(p[0])];
+    uint8_t length = DATALOG_REGREC_LENGTH(p[0]);
+    uint8_t reg = p[1] & (NATIVE_BUS_REGS - 1U);
+    uint8_t i;
+
+    p += DATALOG_REGREC_ENTRY_HEADER;
+    if(end - p < length)
+    {
+      break;
+    }
+    for(i = 0; i < length; i++)
+    {
+      if(Mark)
+      {
+        dev->Recorded[reg] = 1;
+      }
+      else
+      {
+        dev->Value[reg] = p[i];
+        dev->Valid[reg] = 1;
+      }
+      /* As the bus addresses the bytes of the transfer */
+      reg = (dev->Model.Next != NULL) ? dev->Model.Next(dev->Model.Context, reg) : reg + 1U;
+      reg &= NATIVE_BUS_REGS - 1U;
+    }
+    p += length;
+  }
+}
+
+/**
+  * @brief  Apply the sample frames due at the clock, the first read of a
+  *         recorded register starting the recording
+  * @param  Device: device read
+  * @param  Reg: register read
+  * @retval None
+  */
+static void Replay_Advance(const Replay_Device_t *Device, uint8_t Reg)
+{
+  DATALOG_RegFrame_t frame;
+  uint64_t now = ReplayClock();
+  uint64_t ms;
+
+  if(!ReplayStarted)
+  {
+    if(!Device->Recorded[Reg])
+    {
+      return;
+    }
+    ReplayStarted = 1;
+    ReplayOriginNs = now;
+  }
+  ms = (now - ReplayOriginNs) / 1000000U;
+  while((ReplayCursor < Replay.End) && Replay_Frame(&Replay, ReplayCursor, &frame))
+  {
+    if(!(frame.flags & DATALOG_REGREC_FLAG_CONST))
+    {
+      if((uint64_t)(frame.ms_counter - Replay.FirstMs) > ms)
+      {
+        break;
+      }
+      ReplayStats.Frames++;
+      ReplayStats.FrameMs = frame.ms_counter;
+    }
+    Replay_Apply(ReplayCursor, &frame, 0);
+    ReplayCursor += DATALOG_REGREC_FRAME_SIZE + frame.size;
+  }
+}
+
+/**
+  * @brief  Byte read by the firmware: as recorded, or from the model
+  * @param  Context: device
+  * @param  Reg: register address
+  * @param  Value: register file contents
+  * @retval Byte read
+  */
+static uint8_t Replay_Read(void *Context, uint8_t Reg, uint8_t Value)
+{
+  Replay_Device_t *dev = (Replay_Device_t *)Context;
+
+  if(ReplayMode == NATIVE_REPLAY_TIMED)
+  {
+    Replay_Advance(dev, Reg);
+  }
+  if(dev->Valid[Reg])
+  {
+    ReplayStats.Reads++;
+    return dev->Value[Reg];
+  }
+  return (dev->Model.Read != NULL) ? dev->Model.Read(dev->Model.Context, Reg, Value) : Value;
+}
+
+/**
+  * @brief  Byte written by the firmware, to the model
+  * @param  Context: device
+  * @param  Reg: register address
+  * @param  Value: byte written
+  * @retval None
+  */
+static void Replay_Write(void *Context, uint8_t Reg, uint8_t Value)
+{
+  Replay_Device_t *dev = (Replay_Device_t *)Context;
+
+  if(dev->Model.Write != NULL)
+  {
+    dev->Model.Write(dev->Model.Context, Reg, Value);
+  }
+}
+
+/**
+  * @brief  Address following Reg in a transfer, as the model has it
+  * @param  Context: device
+  * @param  Reg: register address
+  * @retval Next address
+  */
+static uint8_t Replay_Next(void *Context, uint8_t Reg)
+{
+  Replay_Device_t *dev = (Replay_Device_t *)Context;
+
+  return (dev->Model.Next != NULL) ? dev->Model.Next(dev->Model.Context, Reg) : (uint8_t)(Reg + 1U);
+}
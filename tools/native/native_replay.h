@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    native_replay.h
+  * @brief   Replay of a sensor register recording (DATALOG_SD_REGISTERS,
+  *          datalog_regformat.h) in front of the sensor models: the
+  *          registers recorded read as in the field session, the others
+  *          (control, identification) stay with the models. The frames
+  *          follow the clock of the sensor models (original timing) or are
+  *          stepped one sample at a time (as fast as possible).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NATIVE_REPLAY_H
+#define __NATIVE_REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_bus.h"
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  NATIVE_REPLAY_TIMED = 0,  /* a frame is read from its time on, after the first output read */
+  NATIVE_REPLAY_STEP        /* NATIVE_Replay_Step moves to the next frame */
+} NATIVE_Replay_Mode_t;
+
+/**
+  * @brief  Recording in memory, checked by NATIVE_Replay_Open
+  */
+typedef struct
+{
+  const uint8_t *Data;
+  uint32_t Size;
+  uint32_t Start;           /* offset of the first frame, calibration */
+  uint32_t First;           /* offset of the first sample frame */
+  uint32_t End;             /* end of the valid frames */
+  uint32_t Frames;          /* sample frames */
+  uint32_t FirstMs;         /* time of the first and last sample */
+  uint32_t LastMs;
+  uint32_t PeriodMs;        /* sampling period of the firmware */
+  uint32_t Gaps;            /* frames after lost samples */
+  uint32_t Truncated;       /* frames with reads left out */
+} NATIVE_Replay_t;
+
+typedef struct
+{
+  uint32_t Frames;          /* frames applied */
+  uint64_t Reads;           /* register bytes read from the recording */
+  uint32_t FrameMs;         /* time of the last sample frame applied */
+} NATIVE_Replay_Stats_t;
+
+/* Exported functions ------------------------------------------------------- */
+int NATIVE_Replay_Open(NATIVE_Replay_t *Rep, const uint8_t *Data, uint32_t Size);
+void NATIVE_Replay_Attach(const NATIVE_Replay_t *Replay, NATIVE_Replay_Mode_t Mode, uint64_t (*Clock)(void));
+uint8_t NATIVE_Replay_Step(void);
+uint8_t NATIVE_Replay_Done(void);
+void NATIVE_Replay_GetStats(NATIVE_Replay_Stats_t *Stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NATIVE_REPLAY_H */
@@ -0,0 +1,526 @@
+/**
+  ******************************************************************************
+  * @file    native_sensors.c
+  * @brief   Motion and environmental sensor BSP of the native build: the
+  *          functions of SensorTile_motion_sensors.c, SensorTile_env_sensors.c
+  *          and their _ex files used by the firmware, on the same component
+  *          drivers, bus types and addresses. Only the SPI transfers, which
+  *          drive the SPI2 registers in the BSP, go to the register files of
+  *          native_bus.c instead.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "SensorTile_motion_sensors.h"
+#include "SensorTile_motion_sensors_ex.h"
+#include "SensorTile_env_sensors.h"
+#include "native_bus.h"
+
+/* Exported variables --------------------------------------------------------*/
+void *MotionCompObj[MOTION_INSTANCES_NBR];
+void *EnvCompObj[ENV_INSTANCES_NBR];
+
+/* Private variables ---------------------------------------------------------*/
+/* We define a jump table in order to get the correct index from the desired function. */
+/* This table should have a size equal to the maximum value of a function plus 1.      */
+static uint32_t FunctionIndex[5] = {0, 0, 1, 1, 2};
+static MOTION_SENSOR_FuncDrv_t *MotionFuncDrv[MOTION_INSTANCES_NBR][MOTION_FUNCTIONS_NBR];
+static MOTION_SENSOR_CommonDrv_t *MotionDrv[MOTION_INSTANCES_NBR];
+static MOTION_SENSOR_Ctx_t MotionCtx[MOTION_INSTANCES_NBR];
+static ENV_SENSOR_FuncDrv_t *EnvFuncDrv[ENV_INSTANCES_NBR][ENV_FUNCTIONS_NBR];
+static ENV_SENSOR_CommonDrv_t *EnvDrv[ENV_INSTANCES_NBR];
+static ENV_SENSOR_Ctx_t EnvCtx[ENV_INSTANCES_NBR];
+
+/* Private function prototypes -----------------------------------------------*/
+static int32_t LSM6DSM_0_Probe(uint32_t Functions);
+static int32_t LSM303AGR_MAG_0_Probe(uint32_t Functions);
+static int32_t HTS221_0_Probe(uint32_t Functions);
+static int32_t LPS22HB_0_Probe(uint32_t Functions);
+
+static int32_t BSP_SPI_Init(void);
+static int32_t BSP_LSM6DSM_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len);
+static int32_t BSP_LSM6DSM_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len);
+static int32_t BSP_LSM303AGR_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len);
+static int32_t BSP_LSM303AGR_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len);
+static int32_t BSP_LPS22HB_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len);
+static int32_t BSP_LPS22HB_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len);
+
+/* Motion sensors ------------------------------------------------------------*/
+
+/**
+  * @brief  Initializes the motion sensors
+  * @param  Instance Motion sensor instance
+  * @param  Functions Motion sensor functions. Could be :
+  *         - MOTION_GYRO
+  *         - MOTION_ACCELERO
+  *         - MOTION_MAGNETO
+  * @retval BSP status
+  */
+int32_t BSP_MOTION_SENSOR_Init(uint32_t Instance, uint32_t Functions)
+{
+  uint32_t function = MOTION_GYRO;
+  uint32_t i;
+  uint32_t component_functions = 0;
+  MOTION_SENSOR_Capabilities_t cap;
+
+  switch (Instance)
+  {
+    case LSM6DSM_0:
+      if (LSM6DSM_0_Probe(Functions) != BSP_ERROR_NONE)
+      {
+        return BSP_ERROR_NO_INIT;
+      }
+      break;
+    case LSM303AGR_MAG_0:
+      if (LSM303AGR_MAG_0_Probe(Functions) != BSP_ERROR_NONE)
+      {
+        return BSP_ERROR_NO_INIT;
+      }
+      break;
+    default:
+      return BSP_ERROR_WRONG_PARAM;
+  }
+
+  if (MotionDrv[Instance]->GetCapabilities(MotionCompObj[Instance], (void *)&cap) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_UNKNOWN_COMPONENT;
+  }
+  component_functions = ((uint32_t)cap.Gyro) | ((uint32_t)cap.Acc << 1) | ((uint32_t)cap.Magneto << 2);
+
+  for (i = 0; i < MOTION_FUNCTIONS_NBR; i++)
+  {
+    if (((Functions & function) == function) && ((component_functions & function) == function))
+    {
+      if (MotionFuncDrv[Instance][FunctionIndex[function]]->Enable(MotionCompObj[Instance]) != BSP_ERROR_NONE)
+      {
+        return BSP_ERROR_COMPONENT_FAILURE;
+      }
+    }
+    function = function << 1;
+  }
+
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Get motion sensor axes data
+  * @param  Instance Motion sensor instance
+  * @param  Function Motion sensor function
+  * @param  Axes pointer to axes data structure
+  * @retval BSP status
+  */
+int32_t BSP_MOTION_SENSOR_GetAxes(uint32_t Instance, uint32_t Function, BSP_MOTION_SENSOR_Axes_t *Axes)
+{
+  if ((Instance >= MOTION_INSTANCES_NBR) || ((MotionCtx[Instance].Functions & Function) != Function))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+  if (MotionFuncDrv[Instance][FunctionIndex[Function]]->GetAxes(MotionCompObj[Instance], Axes) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_COMPONENT_FAILURE;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Set motion sensor output data rate
+  * @param  Instance Motion sensor instance
+  * @param  Function Motion sensor function
+  * @param  Odr Output data rate
+  * @retval BSP status
+  */
+int32_t BSP_MOTION_SENSOR_SetOutputDataRate(uint32_t Instance, uint32_t Function, float Odr)
+{
+  if ((Instance >= MOTION_INSTANCES_NBR) || ((MotionCtx[Instance].Functions & Function) != Function))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+  if (MotionFuncDrv[Instance][FunctionIndex[Function]]->SetOutputDataRate(MotionCompObj[Instance], Odr) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_COMPONENT_FAILURE;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Set motion sensor full scale
+  * @param  Instance Motion sensor instance
+  * @param  Function Motion sensor function
+  * @param  Fullscale Fullscale value
+  * @retval BSP status
+  */
+int32_t BSP_MOTION_SENSOR_SetFullScale(uint32_t Instance, uint32_t Function, int32_t Fullscale)
+{
+  if ((Instance >= MOTION_INSTANCES_NBR) || ((MotionCtx[Instance].Functions & Function) != Function))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+  if (MotionFuncDrv[Instance][FunctionIndex[Function]]->SetFullScale(MotionCompObj[Instance], Fullscale) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_COMPONENT_FAILURE;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Enable the double tap detection, LSM6DSM only
+  * @param  Instance the device instance
+  * @param  IntPin the interrupt pin to be used
+  * @retval BSP status
+  */
+int32_t BSP_MOTION_SENSOR_Enable_Double_Tap_Detection(uint32_t Instance, BSP_MOTION_SENSOR_IntPin_t IntPin)
+{
+  if (Instance != LSM6DSM_0)
+  {
+    return (Instance < MOTION_INSTANCES_NBR) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_WRONG_PARAM;
+  }
+  if (LSM6DSM_ACC_Enable_Double_Tap_Detection(MotionCompObj[Instance], (LSM6DSM_SensorIntPin_t)IntPin) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_COMPONENT_FAILURE;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Get the status of all hardware events, LSM6DSM only
+  * @param  Instance the device instance
+  * @param  Status the pointer to the status of all hardware events
+  * @retval BSP status
+  */
+int32_t BSP_MOTION_SENSOR_Get_Event_Status(uint32_t Instance, BSP_MOTION_SENSOR_Event_Status_t *Status)
+{
+  if (Instance != LSM6DSM_0)
+  {
+    return (Instance < MOTION_INSTANCES_NBR) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_WRONG_PARAM;
+  }
+  /* The second cast (void *) is added to bypass Misra R11.3 rule */
+  if (LSM6DSM_ACC_Get_Event_Status(MotionCompObj[Instance], (LSM6DSM_Event_Status_t *)(void *)Status) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_COMPONENT_FAILURE;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/* Environmental sensors -----------------------------------------------------*/
+
+/**
+  * @brief  Initializes the environmental sensor
+  * @param  Instance environmental sensor instance to be used
+  * @param  Functions Environmental sensor functions. Could be :
+  *         - ENV_TEMPERATURE
+  *         - ENV_PRESSURE
+  *         - ENV_HUMIDITY
+  * @retval BSP status
+  */
+int32_t BSP_ENV_SENSOR_Init(uint32_t Instance, uint32_t Functions)
+{
+  uint32_t function = ENV_TEMPERATURE;
+  uint32_t i;
+  uint32_t component_functions = 0;
+  ENV_SENSOR_Capabilities_t cap;
+
+  switch (Instance)
+  {
+    case HTS221_0:
+      if (HTS221_0_Probe(Functions) != BSP_ERROR_NONE)
+      {
+        return BSP_ERROR_NO_INIT;
+      }
+      break;
+    case LPS22HB_0:
+      if (LPS22HB_0_Probe(Functions) != BSP_ERROR_NONE)
+      {
+        return BSP_ERROR_NO_INIT;
+      }
+      break;
+    default:
+      return BSP_ERROR_WRONG_PARAM;
+  }
+
+  if (EnvDrv[Instance]->GetCapabilities(EnvCompObj[Instance], (void *)&cap) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_UNKNOWN_COMPONENT;
+  }
+  component_functions = ((uint32_t)cap.Temperature) | ((uint32_t)cap.Pressure << 1) | ((uint32_t)cap.Humidity << 2);
+
+  for (i = 0; i < ENV_FUNCTIONS_NBR; i++)
+  {
+    if (((Functions & function) == function) && ((component_functions & function) == function))
+    {
+      if (EnvFuncDrv[Instance][FunctionIndex[function]]->Enable(EnvCompObj[Instance]) != BSP_ERROR_NONE)
+      {
+        return BSP_ERROR_COMPONENT_FAILURE;
+      }
+    }
+    function = function << 1;
+  }
+
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Set environmental sensor output data rate
+  * @param  Instance environmental sensor instance to be used
+  * @param  Function Environmental sensor function
+  * @param  Odr Output Data Rate value to be set
+  * @retval BSP status
+  */
+int32_t BSP_ENV_SENSOR_SetOutputDataRate(uint32_t Instance, uint32_t Function, float Odr)
+{
+  if ((Instance >= ENV_INSTANCES_NBR) || ((EnvCtx[Instance].Functions & Function) != Function))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+  if (EnvFuncDrv[Instance][FunctionIndex[Function]]->SetOutputDataRate(EnvCompObj[Instance], Odr) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_COMPONENT_FAILURE;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Get environmental sensor value
+  * @param  Instance environmental sensor instance to be used
+  * @param  Function Environmental sensor function
+  * @param  Value pointer to environmental sensor value
+  * @retval BSP status
+  */
+int32_t BSP_ENV_SENSOR_GetValue(uint32_t Instance, uint32_t Function, float *Value)
+{
+  if ((Instance >= ENV_INSTANCES_NBR) || ((EnvCtx[Instance].Functions & Function) != Function))
+  {
+    return BSP_ERROR_WRONG_PARAM;
+  }
+  if (EnvFuncDrv[Instance][FunctionIndex[Function]]->GetValue(EnvCompObj[Instance], Value) != BSP_ERROR_NONE)
+  {
+    return BSP_ERROR_COMPONENT_FAILURE;
+  }
+  return BSP_ERROR_NONE;
+}
+
+/* Probes --------------------------------------------------------------------*/
+
+/**
+  * @brief  Register Bus IOs for instance 0 if component ID is OK
+  * @retval BSP status
+  */
+static int32_t LSM6DSM_0_Probe(uint32_t Functions)
+{
+  LSM6DSM_IO_t            io_ctx;
+  uint8_t                 id;
+  static LSM6DSM_Object_t lsm6dsm_obj_0;
+  LSM6DSM_Capabilities_t  cap;
+  int32_t ret = BSP_ERROR_NONE;
+
+  io_ctx.BusType     = LSM6DSM_SPI_3WIRES_BUS;
+  io_ctx.Address     = 0x0;
+  io_ctx.Init        = BSP_SPI_Init;
+  io_ctx.DeInit      = BSP_SPI_Init;
+  io_ctx.ReadReg     = BSP_LSM6DSM_ReadReg;
+  io_ctx.WriteReg    = BSP_LSM6DSM_WriteReg;
+  io_ctx.GetTick     = BSP_GetTick;
+
+  if ((LSM6DSM_RegisterBusIO(&lsm6dsm_obj_0, &io_ctx) != LSM6DSM_OK) ||
+      (LSM6DSM_ReadID(&lsm6dsm_obj_0, &id) != LSM6DSM_OK) || (id != LSM6DSM_ID))
+  {
+    return BSP_ERROR_UNKNOWN_COMPONENT;
+  }
+
+  (void)LSM6DSM_GetCapabilities(&lsm6dsm_obj_0, &cap);
+  MotionCtx[LSM6DSM_0].Functions = ((uint32_t)cap.Gyro) | ((uint32_t)cap.Acc << 1) | ((uint32_t)cap.Magneto << 2);
+  MotionCompObj[LSM6DSM_0] = &lsm6dsm_obj_0;
+  MotionDrv[LSM6DSM_0] = (MOTION_SENSOR_CommonDrv_t *)(void *)&LSM6DSM_COMMON_Driver;
+
+  if (((Functions & MOTION_GYRO) == MOTION_GYRO) && (cap.Gyro == 1U))
+  {
+    MotionFuncDrv[LSM6DSM_0][FunctionIndex[MOTION_GYRO]] = (MOTION_SENSOR_FuncDrv_t *)(void *)&LSM6DSM_GYRO_Driver;
+    ret = (MotionDrv[LSM6DSM_0]->Init(MotionCompObj[LSM6DSM_0]) != LSM6DSM_OK) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_NONE;
+  }
+  if (((Functions & MOTION_ACCELERO) == MOTION_ACCELERO) && (cap.Acc == 1U))
+  {
+    MotionFuncDrv[LSM6DSM_0][FunctionIndex[MOTION_ACCELERO]] = (MOTION_SENSOR_FuncDrv_t *)(void *)&LSM6DSM_ACC_Driver;
+    ret = (MotionDrv[LSM6DSM_0]->Init(MotionCompObj[LSM6DSM_0]) != LSM6DSM_OK) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_NONE;
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  Register Bus IOs for instance 1 if component ID is OK
+  * @retval BSP status
+  */
+static int32_t LSM303AGR_MAG_0_Probe(uint32_t Functions)
+{
+  LSM303AGR_IO_t                io_ctx;
+  uint8_t                       id;
+  static LSM303AGR_MAG_Object_t lsm303agr_mag_obj_0;
+  LSM303AGR_Capabilities_t      cap;
+  int32_t ret = BSP_ERROR_NONE;
+
+  io_ctx.BusType     = LSM303AGR_SPI_3WIRES_BUS;
+  io_ctx.Address     = 0x0;
+  io_ctx.Init        = BSP_SPI_Init;
+  io_ctx.DeInit      = BSP_SPI_Init;
+  io_ctx.ReadReg     = BSP_LSM303AGR_ReadReg;
+  io_ctx.WriteReg    = BSP_LSM303AGR_WriteReg;
+  io_ctx.GetTick     = BSP_GetTick;
+
+  if ((LSM303AGR_MAG_RegisterBusIO(&lsm303agr_mag_obj_0, &io_ctx) != LSM303AGR_OK) ||
+      (LSM303AGR_MAG_ReadID(&lsm303agr_mag_obj_0, &id) != LSM303AGR_OK) || (id != (uint8_t)LSM303AGR_ID_MG))
+  {
+    return BSP_ERROR_UNKNOWN_COMPONENT;
+  }
+
+  (void)LSM303AGR_MAG_GetCapabilities(&lsm303agr_mag_obj_0, &cap);
+  MotionCtx[LSM303AGR_MAG_0].Functions = ((uint32_t)cap.Gyro) | ((uint32_t)cap.Acc << 1) | ((uint32_t)cap.Magneto << 2);
+  MotionCompObj[LSM303AGR_MAG_0] = &lsm303agr_mag_obj_0;
+  MotionDrv[LSM303AGR_MAG_0] = (MOTION_SENSOR_CommonDrv_t *)(void *)&LSM303AGR_MAG_COMMON_Driver;
+
+  if (((Functions & MOTION_MAGNETO) == MOTION_MAGNETO) && (cap.Magneto == 1U))
+  {
+    MotionFuncDrv[LSM303AGR_MAG_0][FunctionIndex[MOTION_MAGNETO]] = (MOTION_SENSOR_FuncDrv_t *)(void *)&LSM303AGR_MAG_Driver;
+    ret = (MotionDrv[LSM303AGR_MAG_0]->Init(MotionCompObj[LSM303AGR_MAG_0]) != LSM303AGR_OK) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_NONE;
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  Register Bus IOs for instance 0 if component ID is OK
+  * @retval BSP status
+  */
+static int32_t HTS221_0_Probe(uint32_t Functions)
+{
+  HTS221_IO_t            io_ctx;
+  uint8_t                id;
+  static HTS221_Object_t hts221_obj_0;
+  HTS221_Capabilities_t  cap;
+  int32_t ret = BSP_ERROR_NONE;
+
+  io_ctx.BusType     = HTS221_I2C_BUS;
+  io_ctx.Address     = HTS221_I2C_ADDRESS;
+  io_ctx.Init        = BSP_I2C3_Init;
+  io_ctx.DeInit      = BSP_I2C3_DeInit;
+  io_ctx.ReadReg     = BSP_I2C3_ReadReg;
+  io_ctx.WriteReg    = BSP_I2C3_WriteReg;
+  io_ctx.GetTick     = BSP_GetTick;
+
+  if ((HTS221_RegisterBusIO(&hts221_obj_0, &io_ctx) != HTS221_OK) ||
+      (HTS221_ReadID(&hts221_obj_0, &id) != HTS221_OK) || (id != HTS221_ID))
+  {
+    return BSP_ERROR_UNKNOWN_COMPONENT;
+  }
+
+  (void)HTS221_GetCapabilities(&hts221_obj_0, &cap);
+  EnvCtx[HTS221_0].Functions = ((uint32_t)cap.Temperature) | ((uint32_t)cap.Pressure << 1) | ((uint32_t)cap.Humidity << 2);
+  EnvCompObj[HTS221_0] = &hts221_obj_0;
+  EnvDrv[HTS221_0] = (ENV_SENSOR_CommonDrv_t *)(void *)&HTS221_COMMON_Driver;
+
+  if (((Functions & ENV_TEMPERATURE) == ENV_TEMPERATURE) && (cap.Temperature == 1U))
+  {
+    EnvFuncDrv[HTS221_0][FunctionIndex[ENV_TEMPERATURE]] = (ENV_SENSOR_FuncDrv_t *)(void *)&HTS221_TEMP_Driver;
+    ret = (EnvDrv[HTS221_0]->Init(EnvCompObj[HTS221_0]) != HTS221_OK) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_NONE;
+  }
+  if (((Functions & ENV_HUMIDITY) == ENV_HUMIDITY) && (cap.Humidity == 1U))
+  {
+    EnvFuncDrv[HTS221_0][FunctionIndex[ENV_HUMIDITY]] = (ENV_SENSOR_FuncDrv_t *)(void *)&HTS221_HUM_Driver;
+    ret = (EnvDrv[HTS221_0]->Init(EnvCompObj[HTS221_0]) != HTS221_OK) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_NONE;
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  Register Bus IOs for instance 1 if component ID is OK. The BSP
+  *         reboots the sensor and waits 1 s: the register file boots at once
+  * @retval BSP status
+  */
+static int32_t LPS22HB_0_Probe(uint32_t Functions)
+{
+  LPS22HB_IO_t            io_ctx;
+  uint8_t                 id;
+  static LPS22HB_Object_t lps22hb_obj_0;
+  LPS22HB_Capabilities_t  cap;
+  int32_t ret = BSP_ERROR_NONE;
+
+  io_ctx.BusType     = LPS22HB_SPI_3WIRES_BUS;
+  io_ctx.Address     = 0x0;
+  io_ctx.Init        = BSP_SPI_Init;
+  io_ctx.DeInit      = BSP_SPI_Init;
+  io_ctx.ReadReg     = BSP_LPS22HB_ReadReg;
+  io_ctx.WriteReg    = BSP_LPS22HB_WriteReg;
+  io_ctx.GetTick     = BSP_GetTick;
+
+  if ((LPS22HB_RegisterBusIO(&lps22hb_obj_0, &io_ctx) != LPS22HB_OK) ||
+      (LPS22HB_ReadID(&lps22hb_obj_0, &id) != LPS22HB_OK) || (id != LPS22HB_ID))
+  {
+    return BSP_ERROR_UNKNOWN_COMPONENT;
+  }
+  /* LPS22HB_SwResetAndMemoryBoot, then 3-wire SPI again */
+  if ((lps22hb_boot_set(&lps22hb_obj_0.Ctx, PROPERTY_ENABLE) != LPS22HB_OK) ||
+      (LPS22HB_Write_Reg(&lps22hb_obj_0, LPS22HB_CTRL_REG1, 0x01) != LPS22HB_OK))
+  {
+    return BSP_ERROR_UNKNOWN_COMPONENT;
+  }
+
+  (void)LPS22HB_GetCapabilities(&lps22hb_obj_0, &cap);
+  EnvCtx[LPS22HB_0].Functions = ((uint32_t)cap.Temperature) | ((uint32_t)cap.Pressure << 1) | ((uint32_t)cap.Humidity << 2);
+  EnvCompObj[LPS22HB_0] = &lps22hb_obj_0;
+  EnvDrv[LPS22HB_0] = (ENV_SENSOR_CommonDrv_t *)(void *)&LPS22HB_COMMON_Driver;
+
+  if (((Functions & ENV_TEMPERATURE) == ENV_TEMPERATURE) && (cap.Temperature == 1U))
+  {
+    EnvFuncDrv[LPS22HB_0][FunctionIndex[ENV_TEMPERATURE]] = (ENV_SENSOR_FuncDrv_t *)(void *)&LPS22HB_TEMP_Driver;
+    ret = (EnvDrv[LPS22HB_0]->Init(EnvCompObj[LPS22HB_0]) != LPS22HB_OK) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_NONE;
+  }
+  if (((Functions & ENV_PRESSURE) == ENV_PRESSURE) && (cap.Pressure == 1U))
+  {
+    EnvFuncDrv[LPS22HB_0][FunctionIndex[ENV_PRESSURE]] = (ENV_SENSOR_FuncDrv_t *)(void *)&LPS22HB_PRESS_Driver;
+    ret = (EnvDrv[LPS22HB_0]->Init(EnvCompObj[LPS22HB_0]) != LPS22HB_OK) ? BSP_ERROR_COMPONENT_FAILURE : BSP_ERROR_NONE;
+  }
+
+  return ret;
+}
+
+/* SPI2 sensors --------------------------------------------------------------*/
+
+static int32_t BSP_SPI_Init(void)
+{
+  return BSP_ERROR_NONE;
+}
+
+static int32_t BSP_LSM6DSM_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len)
+{
+  (void)Addr;
+  return NATIVE_Bus_Write(NATIVE_LSM6DSM, (uint8_t)Reg, pdata, len);
+}
+
+static int32_t BSP_LSM6DSM_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len)
+{
+  (void)Addr;
+  return NATIVE_Bus_Read(NATIVE_LSM6DSM, (uint8_t)Reg, pdata, len);
+}
+
+static int32_t BSP_LSM303AGR_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len)
+{
+  (void)Addr;
+  return NATIVE_Bus_Write(NATIVE_LSM303AGR_MAG, (uint8_t)Reg, pdata, len);
+}
+
+static int32_t BSP_LSM303AGR_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len)
+{
+  (void)Addr;
+  return NATIVE_Bus_Read(NATIVE_LSM303AGR_MAG, (uint8_t)Reg, pdata, len);
+}
+
+static int32_t BSP_LPS22HB_WriteReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len)
+{
+  (void)Addr;
+  return NATIVE_Bus_Write(NATIVE_LPS22HB, (uint8_t)Reg, pdata, len);
+}
+
+static int32_t BSP_LPS22HB_ReadReg(uint16_t Addr, uint16_t Reg, uint8_t *pdata, uint16_t len)
+{
+  (void)Addr;
+  return NATIVE_Bus_Read(NATIVE_LPS22HB, (uint8_t)Reg, pdata, len);
+}
@@ -0,0 +1,233 @@
+/**
+  ******************************************************************************
+  * @file    native_sim.c
+  * @brief   Sensor models of the native build: simulated time, waveform and
+  *          the sampling helpers of the four models. The time is either a
+  *          clock (the board scales the monotonic clock, so the models run
+  *          at any multiple of the real output data rates) or stepped by
+  *          the caller, for the benchmarks that run the drivers without the
+  *          RTOS.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_sim_models.h"
+#include <math.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Data sets generated in one go after an idle period; older ones would be
+   overwritten in the outputs and in the FIFOs (2048 words) anyway */
+#define SIM_BACKLOG_MAX   4096U
+
+/* Exported variables --------------------------------------------------------*/
+NATIVE_Sim_Stats_t SimStats[NATIVE_BUS_DEVICES];
+
+/* Private variables ---------------------------------------------------------*/
+static NATIVE_Sim_Waveform_t SimWaveform = {NATIVE_Sim_Synthetic, NULL};
+static uint64_t (*SimClock)(void) = NULL;
+static uint64_t SimTimeNs = 0;
+
+/* The four models sample the same instants when their rates are multiples */
+static DATALOG_Record_t SimLastValues;
+static uint64_t SimLastTimeNs = UINT64_MAX;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach the four models to the register files, after
+  *         NATIVE_Bus_Reset. The simulated time starts at 0
+  * @param  Config: waveform and clock
+  * @retval None
+  */
+void NATIVE_Sim_Attach(const NATIVE_Sim_Config_t *Config)
+{
+  if((Config != NULL) && (Config->Waveform != NULL))
+  {
+    SimWaveform = *Config->Waveform;
+  }
+  SimClock = (Config != NULL) ? Config->Clock : NULL;
+  SimTimeNs = 0;
+  SimLastTimeNs = UINT64_MAX;
+  memset(SimStats, 0, sizeof(SimStats));
+
+  SIM_LSM6DSM_Attach();
+  SIM_LSM303AGR_Attach();
+  SIM_LPS22HB_Attach();
+  SIM_HTS221_Attach();
+}
+
+/**
+  * @brief  Step the simulated time, without a clock
+  * @param  TimeNs: ns since NATIVE_Sim_Attach, never going back
+  * @retval None
+  */
+void NATIVE_Sim_SetTime(uint64_t TimeNs)
+{
+  SimTimeNs = TimeNs;
+}
+
+/**
+  * @brief  Simulated time
+  * @retval ns since NATIVE_Sim_Attach
+  */
+uint64_t NATIVE_Sim_GetTime(void)
+{
+  return SIM_Now();
+}
+
+/**
+  * @brief  Counters of a model
+  * @param  Device: sensor
+  * @param  Stats: destination
+  * @retval None
+  */
+void NATIVE_Sim_GetStats(NATIVE_Bus_Device_t Device, NATIVE_Sim_Stats_t *Stats)
+{
+  *Stats = SimStats[Device];
+}
+
+/**
+  * @brief  Default waveform: the signals of the synthetic logs of the host
+  *         tools, so that a log of the native build can be checked against
+  *         stlog::synthetic_record
+  * @param  Context: not used
+  * @param  TimeNs: simulated time
+  * @param  Values: physical values
+  * @retval None
+  */
+void NATIVE_Sim_Synthetic(void *Context, uint64_t TimeNs, DATALOG_Record_t *Values)
+{
+  const double t = (double)TimeNs * 1e-9;
+  int axis;
+
+  (void)Context;
+  Values->ms_counter = (uint32_t)(TimeNs / 1000000U);
+  for(axis = 0; axis < 3; axis++)
+  {
+    Values->acc[axis] = (int32_t)(1000.0 * sin(t + axis));
+    Values->gyro[axis] = (int32_t)(25000.0 * sin(0.3 * t + axis));
+    Values->mag[axis] = (int32_t)(-400.0 + 50.0 * cos(0.01 * t + axis));
+  }
+  Values->pressure = (float)(1013.25 + 0.5 * sin(0.001 * t));
+  Values->temperature = (float)(24.0 + 2.0 * sin(0.0001 * t));
+  Values->humidity = (float)(45.0 + 5.0 * cos(0.0001 * t));
+}
+
+/* Model helpers -------------------------------------------------------------*/
+
+/**
+  * @brief  Current simulated time
+  * @retval ns
+  */
+uint64_t SIM_Now(void)
+{
+  if(SimClock != NULL)
+  {
+    SimTimeNs = SimClock();
+  }
+  return SimTimeNs;
+}
+
+/**
+  * @brief  Physical values at a sampling instant
+  * @param  TimeNs: simulated time
+  * @retval Values, valid until the next call
+  */
+const DATALOG_Record_t *SIM_Sample(uint64_t TimeNs)
+{
+  if(TimeNs != SimLastTimeNs)
+  {
+    SimWaveform.Sample(SimWaveform.Context, TimeNs, &SimLastValues);
+    SimLastTimeNs = TimeNs;
+  }
+  return &SimLastValues;
+}
+
+/**
+  * @brief  Output data rate of a stream. The first data set comes one
+  *         period after the rate changes, as after the turn-on time
+  * @param  Stream: stream
+  * @param  Odr: Hz, 0 to power it down
+  * @param  Now: simulated time
+  * @retval None
+  */
+void SIM_Stream_SetOdr(SIM_Stream_t *Stream, float Odr, uint64_t Now)
+{
+  uint64_t period = (Odr > 0.0f) ? (uint64_t)(1e9 / Odr + 0.5) : 0U;
+
+  if(period != Stream->PeriodNs)
+  {
+    Stream->PeriodNs = period;
+    Stream->NextNs = Now + period;
+  }
+}
+
+/**
+  * @brief  Next data set of a stream due at Now, in time order. After a
+  *         long idle period only the last SIM_BACKLOG_MAX are produced
+  * @param  Stream: stream
+  * @param  Now: simulated time
+  * @param  TimeNs: sampling instant of the data set
+  * @retval 1 if a data set is due
+  */
+uint8_t SIM_Stream_Next(SIM_Stream_t *Stream, uint64_t Now, uint64_t *TimeNs)
+{
+  uint64_t late;
+
+  if((Stream->PeriodNs == 0U) || (Stream->NextNs > Now))
+  {
+    return 0;
+  }
+  late = (Now - Stream->NextNs) / Stream->PeriodNs;
+  if(late >= SIM_BACKLOG_MAX)
+  {
+    Stream->NextNs += (late - SIM_BACKLOG_MAX + 1U) * Stream->PeriodNs;
+  }
+  *TimeNs = Stream->NextNs;
+  Stream->NextNs += Stream->PeriodNs;
+  return 1;
+}
+
+/**
+  * @brief  Physical value in LSB to a 16 bit output, rounded and saturated
+  * @param  Value: LSB
+  * @retval Output
+  */
+int16_t SIM_ToInt16(double Value)
+{
+  if(Value >= 32767.0)
+  {
+    return INT16_MAX;
+  }
+  if(Value <= -32768.0)
+  {
+    return INT16_MIN;
+  }
+  return (int16_t)lround(Value);
+}
+
+/**
+  * @brief  16 bit little endian output register pair
+  * @param  Device: sensor
+  * @param  Reg: address of the low byte
+  * @param  Value: output
+  * @retval None
+  */
+void SIM_Put16(NATIVE_Bus_Device_t Device, uint8_t Reg, int16_t Value)
+{
+  NATIVE_Bus_Poke(Device, Reg, (uint8_t)((uint16_t)Value & 0xFFU));
+  NATIVE_Bus_Poke(Device, (uint8_t)(Reg + 1U), (uint8_t)((uint16_t)Value >> 8));
+}
+
+/**
+  * @brief  16 bit little endian register pair
+  * @param  Device: sensor
+  * @param  Reg: address of the low byte
+  * @retval Value
+  */
+int16_t SIM_Get16(NATIVE_Bus_Device_t Device, uint8_t Reg)
+{
+  return (int16_t)(uint16_t)(NATIVE_Bus_Peek(Device, Reg) |
+                             ((uint16_t)NATIVE_Bus_Peek(Device, (uint8_t)(Reg + 1U)) << 8));
+}
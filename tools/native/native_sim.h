@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    native_sim.h
+  * @brief   Register level models of the SensorTile sensors (LSM6DSM,
+  *          LSM303AGR magnetometer, LPS22HB, HTS221) behind the register
+  *          files of native_bus.c: identification, control registers,
+  *          output registers scaled by the configured full scale, data ready
+  *          flags and the LSM6DSM and LPS22HB FIFOs, sampled from a waveform
+  *          at the output data rate of the simulated time.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NATIVE_SIM_H
+#define __NATIVE_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_bus.h"
+#include "datalog_format.h"
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Physical values seen by the sensors at a time of the simulation,
+  *         in the units of the log (mg, mdps, mgauss, hPa, degC, %rH).
+  *         ms_counter is not used.
+  */
+typedef struct
+{
+  void (*Sample)(void *Context, uint64_t TimeNs, DATALOG_Record_t *Values);
+  void *Context;
+} NATIVE_Sim_Waveform_t;
+
+typedef struct
+{
+  const NATIVE_Sim_Waveform_t *Waveform;  /* NULL for NATIVE_Sim_Synthetic */
+  uint64_t (*Clock)(void);                /* ns of simulated time, NULL to step it with NATIVE_Sim_SetTime */
+} NATIVE_Sim_Config_t;
+
+typedef struct
+{
+  uint64_t Samples;         /* output data sets produced */
+  uint64_t FifoOverruns;    /* data sets lost by a full FIFO */
+} NATIVE_Sim_Stats_t;
+
+/* Exported functions ------------------------------------------------------- */
+void NATIVE_Sim_Attach(const NATIVE_Sim_Config_t *Config);
+void NATIVE_Sim_SetTime(uint64_t TimeNs);
+uint64_t NATIVE_Sim_GetTime(void);
+void NATIVE_Sim_GetStats(NATIVE_Bus_Device_t Device, NATIVE_Sim_Stats_t *Stats);
+
+/* Signals of stlog::synthetic_record, continuous in time */
+void NATIVE_Sim_Synthetic(void *Context, uint64_t TimeNs, DATALOG_Record_t *Values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NATIVE_SIM_H */
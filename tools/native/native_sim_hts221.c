@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file    native_sim_hts221.c
+  * @brief   Register model of the HTS221: power down, output data rate and
+  *          block data update of CTRL_REG1, one-shot and reboot of CTRL_REG2,
+  *          STATUS_REG, and the outputs computed back from the calibration
+  *          registers of the register file, so the driver interpolation
+  *          returns the waveform values.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_sim_models.h"
+#include "hts221_reg.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define HTS221_SIM_BDU             0x04U
+#define HTS221_SIM_PD              0x80U
+#define HTS221_SIM_ONE_SHOT        0x01U
+#define HTS221_SIM_BOOT            0x80U
+
+#define HTS221_SIM_T_DA            0x01U
+#define HTS221_SIM_H_DA            0x02U
+
+/* Private variables ---------------------------------------------------------*/
+static SIM_Stream_t Hts221Sim;
+
+/* ODR codes of CTRL_REG1, 0 is one-shot */
+static const float Hts221SimOdr[4] = {0.0f, 1.0f, 7.0f, 12.5f};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Output of a calibration line, inverse of the driver interpolation
+  * @param  Value: physical value
+  * @param  X0, X1: calibration points
+  * @param  Out0, Out1: outputs at the calibration points
+  * @retval Output
+  */
+static int16_t HTS221_Sim_Inverse(float Value, float X0, float X1, int16_t Out0, int16_t Out1)
+{
+  if(X1 == X0)
+  {
+    return Out0;
+  }
+  return SIM_ToInt16(Out0 + (double)(Value - X0) * (Out1 - Out0) / (X1 - X0));
+}
+
+/**
+  * @brief  One conversion of both outputs
+  * @param  TimeNs: sampling instant
+  * @retval None
+  */
+static void HTS221_Sim_Convert(uint64_t TimeNs)
+{
+  const DATALOG_Record_t *values = SIM_Sample(TimeNs);
+  uint8_t msb = NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_T1_T0_MSB);
+  float h0 = NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_H0_RH_X2) / 2.0f;
+  float h1 = NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_H1_RH_X2) / 2.0f;
+  float t0 = (NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_T0_DEGC_X8) | ((msb & 0x03U) << 8)) / 8.0f;
+  float t1 = (NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_T1_DEGC_X8) | ((msb & 0x0CU) << 6)) / 8.0f;
+
+  SIM_Put16(NATIVE_HTS221, HTS221_HUMIDITY_OUT_L,
+            HTS221_Sim_Inverse(values->humidity, h0, h1, SIM_Get16(NATIVE_HTS221, HTS221_H0_T0_OUT_L),
+                               SIM_Get16(NATIVE_HTS221, HTS221_H1_T0_OUT_L)));
+  SIM_Put16(NATIVE_HTS221, HTS221_TEMP_OUT_L,
+            HTS221_Sim_Inverse(values->temperature, t0, t1, SIM_Get16(NATIVE_HTS221, HTS221_T0_OUT_L),
+                               SIM_Get16(NATIVE_HTS221, HTS221_T1_OUT_L)));
+  NATIVE_Bus_Poke(NATIVE_HTS221, HTS221_STATUS_REG, HTS221_SIM_T_DA | HTS221_SIM_H_DA);
+  SimStats[NATIVE_HTS221].Samples++;
+}
+
+/**
+  * @brief  Produce the conversions due at the simulated time
+  * @param  Now: simulated time
+  * @retval None
+  */
+static void HTS221_Sim_Update(uint64_t Now)
+{
+  uint64_t t;
+
+  while(SIM_Stream_Next(&Hts221Sim, Now, &t))
+  {
+    HTS221_Sim_Convert(t);
+  }
+}
+
+/**
+  * @brief  Register read: the outputs are refreshed before the byte is
+  *         returned, except inside an output register pair when BDU is set
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: register file contents
+  * @retval Byte read
+  */
+static uint8_t HTS221_Sim_Read(void *Context, uint8_t Reg, uint8_t Value)
+{
+  uint8_t bdu = NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_CTRL_REG1) & HTS221_SIM_BDU;
+  uint8_t status;
+
+  (void)Context;
+  (void)Value;
+  if(!bdu || ((Reg != HTS221_HUMIDITY_OUT_H) && (Reg != HTS221_TEMP_OUT_H)))
+  {
+    HTS221_Sim_Update(SIM_Now());
+  }
+  status = NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_STATUS_REG);
+  if(Reg == HTS221_HUMIDITY_OUT_H)
+  {
+    NATIVE_Bus_Poke(NATIVE_HTS221, HTS221_STATUS_REG, status & (uint8_t)~HTS221_SIM_H_DA);
+  }
+  else if(Reg == HTS221_TEMP_OUT_H)
+  {
+    NATIVE_Bus_Poke(NATIVE_HTS221, HTS221_STATUS_REG, status & (uint8_t)~HTS221_SIM_T_DA);
+  }
+  return NATIVE_Bus_Peek(NATIVE_HTS221, Reg);
+}
+
+/**
+  * @brief  Register write: power down, rate, one-shot and reboot
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: byte written
+  * @retval None
+  */
+static void HTS221_Sim_Write(void *Context, uint8_t Reg, uint8_t Value)
+{
+  uint64_t now = SIM_Now();
+  uint8_t ctrl1 = NATIVE_Bus_Peek(NATIVE_HTS221, HTS221_CTRL_REG1);
+
+  (void)Context;
+  HTS221_Sim_Update(now);
+  if(Reg == HTS221_CTRL_REG2)
+  {
+    /* Reboot and one-shot complete at once and clear themselves */
+    NATIVE_Bus_Poke(NATIVE_HTS221, HTS221_CTRL_REG2, Value & (uint8_t)~(HTS221_SIM_BOOT | HTS221_SIM_ONE_SHOT));
+    if((Value & HTS221_SIM_ONE_SHOT) && (ctrl1 & HTS221_SIM_PD) && ((ctrl1 & 0x03U) == 0U))
+    {
+      HTS221_Sim_Convert(now);
+    }
+  }
+  SIM_Stream_SetOdr(&Hts221Sim, (ctrl1 & HTS221_SIM_PD) ? Hts221SimOdr[ctrl1 & 0x03U] : 0.0f, now);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach the model to the power-on register file
+  * @param  None
+  * @retval None
+  */
+void SIM_HTS221_Attach(void)
+{
+  static const NATIVE_Bus_Hook_t hook = {HTS221_Sim_Read, HTS221_Sim_Write, NULL, NULL};
+
+  memset(&Hts221Sim, 0, sizeof(Hts221Sim));
+  NATIVE_Bus_SetHook(NATIVE_HTS221, &hook);
+}
@@ -0,0 +1,324 @@
+/**
+  ******************************************************************************
+  * @file    native_sim_lps22hb.c
+  * @brief   Register model of the LPS22HB: output data rate and block data
+  *          update of CTRL_REG1, one-shot, software reset and reboot of
+  *          CTRL_REG2, STATUS with its overrun flags, and the 32 slot FIFO:
+  *          FIFO and stream modes of FIFO_CTRL, the watermark, STOP_ON_FTH
+  *          and FIFO_STATUS. While the FIFO runs the outputs show its oldest
+  *          slot, popped by the read of TEMP_OUT_H. The triggered modes have
+  *          no trigger (stream-to-FIFO stays in stream, the bypass-to ones
+  *          in bypass) and the low-pass filter is not modelled.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_sim_models.h"
+#include "lps22hb_reg.h"
+#include <math.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define LPS22HB_SIM_FIFO_SLOTS     32U
+#define LPS22HB_SIM_PRESS_LSB      4096.0   /* LSB/hPa */
+#define LPS22HB_SIM_TEMP_LSB       100.0    /* LSB/degC */
+
+#define LPS22HB_SIM_BDU            0x02U
+#define LPS22HB_SIM_ONE_SHOT       0x01U
+#define LPS22HB_SIM_SWRESET        0x04U
+#define LPS22HB_SIM_STOP_ON_FTH    0x20U
+#define LPS22HB_SIM_FIFO_EN        0x40U
+#define LPS22HB_SIM_BOOT           0x80U
+
+#define LPS22HB_SIM_P_DA           0x01U
+#define LPS22HB_SIM_T_DA           0x02U
+#define LPS22HB_SIM_P_OR           0x10U
+#define LPS22HB_SIM_T_OR           0x20U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  int32_t Pressure;         /* 24 bit output */
+  int16_t Temperature;
+} LPS22HB_Sim_Slot_t;
+
+typedef struct
+{
+  SIM_Stream_t Stream;
+  uint8_t FifoMode;         /* 0 bypass, 1 FIFO, 2 stream */
+  uint8_t FifoDepth;
+  LPS22HB_Sim_Slot_t Fifo[LPS22HB_SIM_FIFO_SLOTS];
+  uint8_t FifoHead;
+  uint8_t FifoCount;
+  uint8_t FifoOverrun;
+} LPS22HB_Sim_t;
+
+/* Private variables ---------------------------------------------------------*/
+static LPS22HB_Sim_t Lps22hbSim;
+
+/* ODR codes of CTRL_REG1, 0 is power down / one-shot */
+static const float Lps22hbSimOdr[8] = {0.0f, 1.0f, 10.0f, 25.0f, 50.0f, 75.0f, 0.0f, 0.0f};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Show a slot in the output registers
+  * @param  Slot: pressure and temperature
+  * @retval None
+  */
+static void LPS22HB_Sim_Output(const LPS22HB_Sim_Slot_t *Slot)
+{
+  uint32_t press = (uint32_t)Slot->Pressure;
+
+  NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_PRESS_OUT_XL, (uint8_t)(press & 0xFFU));
+  NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_PRESS_OUT_L, (uint8_t)((press >> 8) & 0xFFU));
+  NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_PRESS_OUT_H, (uint8_t)((press >> 16) & 0xFFU));
+  SIM_Put16(NATIVE_LPS22HB, LPS22HB_TEMP_OUT_L, Slot->Temperature);
+}
+
+/**
+  * @brief  FIFO_STATUS from the FIFO contents
+  * @param  None
+  * @retval None
+  */
+static void LPS22HB_Sim_FifoStatus(void)
+{
+  LPS22HB_Sim_t *sim = &Lps22hbSim;
+  uint8_t wtm = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_FIFO_CTRL) & 0x1FU;
+  uint8_t status = sim->FifoCount;
+
+  if(sim->FifoOverrun)
+  {
+    status |= 0x40U;                                        /* OVR */
+  }
+  if(sim->FifoCount >= wtm)
+  {
+    status |= 0x80U;                                        /* FTH_FIFO */
+  }
+  NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_FIFO_STATUS, status);
+}
+
+/**
+  * @brief  One conversion: to the outputs or to the FIFO
+  * @param  TimeNs: sampling instant
+  * @retval None
+  */
+static void LPS22HB_Sim_Convert(uint64_t TimeNs)
+{
+  LPS22HB_Sim_t *sim = &Lps22hbSim;
+  const DATALOG_Record_t *values = SIM_Sample(TimeNs);
+  uint8_t status = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_STATUS);
+  LPS22HB_Sim_Slot_t slot;
+  double press = values->pressure * LPS22HB_SIM_PRESS_LSB;
+
+  /* 24 bit two's complement */
+  press = (press > 8388607.0) ? 8388607.0 : ((press < -8388608.0) ? -8388608.0 : press);
+  slot.Pressure = (int32_t)lround(press);
+  slot.Temperature = SIM_ToInt16(values->temperature * LPS22HB_SIM_TEMP_LSB);
+  SimStats[NATIVE_LPS22HB].Samples++;
+
+  if(status & LPS22HB_SIM_P_DA)
+  {
+    status |= LPS22HB_SIM_P_OR;
+  }
+  if(status & LPS22HB_SIM_T_DA)
+  {
+    status |= LPS22HB_SIM_T_OR;
+  }
+  NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_STATUS, status | LPS22HB_SIM_P_DA | LPS22HB_SIM_T_DA);
+
+  if(sim->FifoMode == 0U)
+  {
+    LPS22HB_Sim_Output(&slot);
+    return;
+  }
+  if(sim->FifoCount == sim->FifoDepth)
+  {
+    SimStats[NATIVE_LPS22HB].FifoOverruns++;
+    if(sim->FifoMode == 1U)
+    {
+      return;                                               /* FIFO mode stops when full */
+    }
+    sim->FifoHead = (uint8_t)((sim->FifoHead + 1U) % LPS22HB_SIM_FIFO_SLOTS);
+    sim->FifoCount--;
+    sim->FifoOverrun = 1;
+  }
+  sim->Fifo[(sim->FifoHead + sim->FifoCount) % LPS22HB_SIM_FIFO_SLOTS] = slot;
+  sim->FifoCount++;
+  LPS22HB_Sim_Output(&sim->Fifo[sim->FifoHead]);
+}
+
+/**
+  * @brief  Produce the conversions due at the simulated time
+  * @param  Now: simulated time
+  * @retval None
+  */
+static void LPS22HB_Sim_Update(uint64_t Now)
+{
+  uint64_t t;
+
+  while(SIM_Stream_Next(&Lps22hbSim.Stream, Now, &t))
+  {
+    LPS22HB_Sim_Convert(t);
+  }
+  LPS22HB_Sim_FifoStatus();
+}
+
+/**
+  * @brief  Rate and FIFO settings of the control registers
+  * @param  Now: simulated time
+  * @retval None
+  */
+static void LPS22HB_Sim_Configure(uint64_t Now)
+{
+  LPS22HB_Sim_t *sim = &Lps22hbSim;
+  uint8_t ctrl1 = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_CTRL_REG1);
+  uint8_t ctrl2 = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_CTRL_REG2);
+  uint8_t fifo = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_FIFO_CTRL);
+  uint8_t mode = 0;
+
+  SIM_Stream_SetOdr(&sim->Stream, Lps22hbSimOdr[(ctrl1 >> 4) & 0x07U], Now);
+
+  if(ctrl2 & LPS22HB_SIM_FIFO_EN)
+  {
+    switch(fifo >> 5)
+    {
+      case LPS22HB_FIFO_MODE:
+        mode = 1;
+        break;
+      case LPS22HB_STREAM_MODE:
+      case LPS22HB_STREAM_TO_FIFO_MODE:
+      case LPS22HB_DYNAMIC_STREAM_MODE:
+        mode = 2;
+        break;
+      default:
+        break;
+    }
+  }
+  if(mode == 0U)
+  {
+    sim->FifoHead = 0;
+    sim->FifoCount = 0;
+    sim->FifoOverrun = 0;
+  }
+  sim->FifoMode = mode;
+  sim->FifoDepth = ((ctrl2 & LPS22HB_SIM_STOP_ON_FTH) && ((fifo & 0x1FU) != 0U)) ?
+                   (uint8_t)(fifo & 0x1FU) : (uint8_t)LPS22HB_SIM_FIFO_SLOTS;
+}
+
+/**
+  * @brief  Register read: the outputs are refreshed before the byte is
+  *         returned, except inside an output register block when BDU is set
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: register file contents
+  * @retval Byte read
+  */
+static uint8_t LPS22HB_Sim_Read(void *Context, uint8_t Reg, uint8_t Value)
+{
+  LPS22HB_Sim_t *sim = &Lps22hbSim;
+  uint8_t bdu = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_CTRL_REG1) & LPS22HB_SIM_BDU;
+  uint8_t status;
+
+  (void)Context;
+  (void)Value;
+  if(!bdu || ((Reg != LPS22HB_PRESS_OUT_L) && (Reg != LPS22HB_PRESS_OUT_H) && (Reg != LPS22HB_TEMP_OUT_H)))
+  {
+    LPS22HB_Sim_Update(SIM_Now());
+  }
+
+  Value = NATIVE_Bus_Peek(NATIVE_LPS22HB, Reg);
+  status = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_STATUS);
+  if(Reg == LPS22HB_PRESS_OUT_H)
+  {
+    NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_STATUS, status & (uint8_t)~(LPS22HB_SIM_P_DA | LPS22HB_SIM_P_OR));
+  }
+  else if(Reg == LPS22HB_TEMP_OUT_H)
+  {
+    NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_STATUS, status & (uint8_t)~(LPS22HB_SIM_T_DA | LPS22HB_SIM_T_OR));
+    /* The end of a slot pops it */
+    if((sim->FifoMode != 0U) && (sim->FifoCount != 0U))
+    {
+      sim->FifoHead = (uint8_t)((sim->FifoHead + 1U) % LPS22HB_SIM_FIFO_SLOTS);
+      sim->FifoCount--;
+      sim->FifoOverrun = 0;
+      if(sim->FifoCount != 0U)
+      {
+        LPS22HB_Sim_Output(&sim->Fifo[sim->FifoHead]);
+      }
+      LPS22HB_Sim_FifoStatus();
+    }
+  }
+  return Value;
+}
+
+/**
+  * @brief  Register write: one-shot, software reset, reboot and the control
+  *         registers
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: byte written
+  * @retval None
+  */
+static void LPS22HB_Sim_Write(void *Context, uint8_t Reg, uint8_t Value)
+{
+  uint64_t now = SIM_Now();
+
+  (void)Context;
+  LPS22HB_Sim_Update(now);
+  if(Reg == LPS22HB_CTRL_REG2)
+  {
+    if(Value & LPS22HB_SIM_SWRESET)
+    {
+      NATIVE_Bus_ResetDevice(NATIVE_LPS22HB);
+      memset(&Lps22hbSim, 0, sizeof(Lps22hbSim));
+      Value = NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_CTRL_REG2);
+    }
+    /* Reboot and one-shot complete at once and clear themselves */
+    NATIVE_Bus_Poke(NATIVE_LPS22HB, LPS22HB_CTRL_REG2,
+                    Value & (uint8_t)~(LPS22HB_SIM_BOOT | LPS22HB_SIM_ONE_SHOT));
+    LPS22HB_Sim_Configure(now);
+    if((Value & LPS22HB_SIM_ONE_SHOT) && (Lps22hbSim.Stream.PeriodNs == 0U))
+    {
+      LPS22HB_Sim_Convert(now);
+    }
+  }
+  else
+  {
+    LPS22HB_Sim_Configure(now);
+  }
+  LPS22HB_Sim_FifoStatus();
+}
+
+/**
+  * @brief  With the FIFO enabled, TEMP_OUT_H rolls back to PRESS_OUT_XL in
+  *         a burst read, one slot after the other
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @retval Next register address
+  */
+static uint8_t LPS22HB_Sim_Next(void *Context, uint8_t Reg)
+{
+  (void)Context;
+  if((Reg == LPS22HB_TEMP_OUT_H) && (NATIVE_Bus_Peek(NATIVE_LPS22HB, LPS22HB_CTRL_REG2) & LPS22HB_SIM_FIFO_EN))
+  {
+    return LPS22HB_PRESS_OUT_XL;
+  }
+  return (uint8_t)(Reg + 1U);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach the model to the power-on register file
+  * @param  None
+  * @retval None
+  */
+void SIM_LPS22HB_Attach(void)
+{
+  static const NATIVE_Bus_Hook_t hook = {LPS22HB_Sim_Read, LPS22HB_Sim_Write, LPS22HB_Sim_Next, NULL};
+
+  memset(&Lps22hbSim, 0, sizeof(Lps22hbSim));
+  LPS22HB_Sim_Configure(SIM_Now());
+  NATIVE_Bus_SetHook(NATIVE_LPS22HB, &hook);
+}
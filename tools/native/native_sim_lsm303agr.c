@@ -0,0 +1,153 @@
+/**
+  ******************************************************************************
+  * @file    native_sim_lsm303agr.c
+  * @brief   Register model of the LSM303AGR magnetometer: continuous and
+  *          single modes and output data rate of CFG_REG_A_M, software
+  *          reset, block data update of CFG_REG_C_M, the hard-iron offsets
+  *          subtracted from the outputs, STATUS_REG_M with its overrun flags.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_sim_models.h"
+#include "lsm303agr_reg.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define LSM303AGR_SIM_SENSITIVITY  1.5f     /* mgauss/LSB */
+
+#define LSM303AGR_SIM_MD_MASK      0x03U
+#define LSM303AGR_SIM_MD_SINGLE    0x01U
+#define LSM303AGR_SIM_MD_IDLE      0x03U
+#define LSM303AGR_SIM_SOFT_RST     0x20U
+#define LSM303AGR_SIM_REBOOT       0x40U
+#define LSM303AGR_SIM_BDU          0x10U
+
+#define LSM303AGR_SIM_ZYXDA        0x0FU    /* Zyxda and the three axes */
+#define LSM303AGR_SIM_ZYXOR        0xF0U
+
+/* Private variables ---------------------------------------------------------*/
+static SIM_Stream_t Lsm303agrSim;
+
+/* ODR codes of CFG_REG_A_M */
+static const float Lsm303agrSimOdr[4] = {10.0f, 20.0f, 50.0f, 100.0f};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Produce the data sets due at the simulated time
+  * @param  Now: simulated time
+  * @retval None
+  */
+static void LSM303AGR_Sim_Update(uint64_t Now)
+{
+  const DATALOG_Record_t *values;
+  uint8_t status = NATIVE_Bus_Peek(NATIVE_LSM303AGR_MAG, LSM303AGR_STATUS_REG_M);
+  uint8_t cfg;
+  uint64_t t;
+  int axis;
+
+  while(SIM_Stream_Next(&Lsm303agrSim, Now, &t))
+  {
+    values = SIM_Sample(t);
+    for(axis = 0; axis < 3; axis++)
+    {
+      SIM_Put16(NATIVE_LSM303AGR_MAG, (uint8_t)(LSM303AGR_OUTX_L_REG_M + 2 * axis),
+                SIM_ToInt16(values->mag[axis] / LSM303AGR_SIM_SENSITIVITY -
+                            SIM_Get16(NATIVE_LSM303AGR_MAG, (uint8_t)(LSM303AGR_OFFSET_X_REG_L_M + 2 * axis))));
+    }
+    if(status & LSM303AGR_SIM_ZYXDA)
+    {
+      status |= LSM303AGR_SIM_ZYXOR;
+    }
+    status |= LSM303AGR_SIM_ZYXDA;
+    SimStats[NATIVE_LSM303AGR_MAG].Samples++;
+
+    /* A single measurement returns to idle */
+    cfg = NATIVE_Bus_Peek(NATIVE_LSM303AGR_MAG, LSM303AGR_CFG_REG_A_M);
+    if((cfg & LSM303AGR_SIM_MD_MASK) == LSM303AGR_SIM_MD_SINGLE)
+    {
+      NATIVE_Bus_Poke(NATIVE_LSM303AGR_MAG, LSM303AGR_CFG_REG_A_M, cfg | LSM303AGR_SIM_MD_IDLE);
+      SIM_Stream_SetOdr(&Lsm303agrSim, 0.0f, Now);
+    }
+  }
+  NATIVE_Bus_Poke(NATIVE_LSM303AGR_MAG, LSM303AGR_STATUS_REG_M, status);
+}
+
+/**
+  * @brief  Register read: the outputs are refreshed before the byte is
+  *         returned, except inside the output registers when BDU is set
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: register file contents
+  * @retval Byte read
+  */
+static uint8_t LSM303AGR_Sim_Read(void *Context, uint8_t Reg, uint8_t Value)
+{
+  uint8_t bdu = NATIVE_Bus_Peek(NATIVE_LSM303AGR_MAG, LSM303AGR_CFG_REG_C_M) & LSM303AGR_SIM_BDU;
+
+  (void)Context;
+  (void)Value;
+  if(!bdu || (Reg <= LSM303AGR_OUTX_L_REG_M) || (Reg > LSM303AGR_OUTZ_H_REG_M))
+  {
+    LSM303AGR_Sim_Update(SIM_Now());
+  }
+  if((Reg >= LSM303AGR_OUTX_L_REG_M) && (Reg <= LSM303AGR_OUTZ_H_REG_M))
+  {
+    NATIVE_Bus_Poke(NATIVE_LSM303AGR_MAG, LSM303AGR_STATUS_REG_M, 0);
+  }
+  return NATIVE_Bus_Peek(NATIVE_LSM303AGR_MAG, Reg);
+}
+
+/**
+  * @brief  Register write: software reset, reboot and the operating mode
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: byte written
+  * @retval None
+  */
+static void LSM303AGR_Sim_Write(void *Context, uint8_t Reg, uint8_t Value)
+{
+  uint64_t now = SIM_Now();
+  uint8_t md;
+
+  (void)Context;
+  if(Reg != LSM303AGR_CFG_REG_A_M)
+  {
+    return;
+  }
+  LSM303AGR_Sim_Update(now);
+  if(Value & LSM303AGR_SIM_SOFT_RST)
+  {
+    NATIVE_Bus_ResetDevice(NATIVE_LSM303AGR_MAG);
+    memset(&Lsm303agrSim, 0, sizeof(Lsm303agrSim));
+    return;
+  }
+  if(Value & LSM303AGR_SIM_REBOOT)
+  {
+    NATIVE_Bus_Poke(NATIVE_LSM303AGR_MAG, LSM303AGR_CFG_REG_A_M, Value & (uint8_t)~LSM303AGR_SIM_REBOOT);
+  }
+  md = Value & LSM303AGR_SIM_MD_MASK;
+  if(md == LSM303AGR_SIM_MD_SINGLE)
+  {
+    /* Restart the stream: the measurement takes a period of the data rate */
+    SIM_Stream_SetOdr(&Lsm303agrSim, 0.0f, now);
+  }
+  SIM_Stream_SetOdr(&Lsm303agrSim, (md <= LSM303AGR_SIM_MD_SINGLE) ? Lsm303agrSimOdr[(Value >> 2) & 0x03U] : 0.0f,
+                    now);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach the model to the power-on register file
+  * @param  None
+  * @retval None
+  */
+void SIM_LSM303AGR_Attach(void)
+{
+  static const NATIVE_Bus_Hook_t hook = {LSM303AGR_Sim_Read, LSM303AGR_Sim_Write, NULL, NULL};
+
+  memset(&Lsm303agrSim, 0, sizeof(Lsm303agrSim));
+  NATIVE_Bus_SetHook(NATIVE_LSM303AGR_MAG, &hook);
+}
@@ -0,0 +1,446 @@
+/**
+  ******************************************************************************
+  * @file    native_sim_lsm6dsm.c
+  * @brief   Register model of the LSM6DSM: accelerometer and gyroscope
+  *          output data rates and full scales of CTRL1_XL / CTRL2_G, the
+  *          outputs with block data update, STATUS_REG, CTRL3_C software
+  *          reset, and the 4 kB FIFO with its decimation factors, modes and
+  *          FIFO_STATUS1..4. The data sets are written gyroscope first, then
+  *          accelerometer, as the pattern of the datasheet. The triggered
+  *          modes have no trigger: continuous-to-FIFO stays continuous and
+  *          bypass-to-continuous stays in bypass.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_sim_models.h"
+#include "lsm6dsm_reg.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define LSM6DSM_SIM_FIFO_WORDS    2048U     /* 4 kB of 16 bit words */
+
+#define LSM6DSM_SIM_XLDA          0x01U
+#define LSM6DSM_SIM_GDA           0x02U
+#define LSM6DSM_SIM_TDA           0x04U
+
+#define LSM6DSM_SIM_SW_RESET      0x01U
+#define LSM6DSM_SIM_BDU           0x40U
+#define LSM6DSM_SIM_BOOT          0x80U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  SIM_Stream_t Xl;
+  SIM_Stream_t Gyro;
+  SIM_Stream_t Fifo;
+  float XlSensitivity;          /* mg/LSB */
+  float GyroSensitivity;        /* mdps/LSB */
+  uint8_t FifoMode;             /* 0 bypass, 1 FIFO, 2 continuous */
+  uint8_t XlDecimation;         /* 0: not in the FIFO */
+  uint8_t GyroDecimation;
+  uint32_t FifoTick;            /* FIFO data rate periods since the FIFO start */
+  uint16_t FifoWord[LSM6DSM_SIM_FIFO_WORDS];
+  uint16_t FifoPattern[LSM6DSM_SIM_FIFO_WORDS];
+  uint16_t FifoHead;
+  uint16_t FifoCount;
+  uint16_t PatternNext;         /* pattern of the next word written */
+  uint8_t FifoOverrun;
+} LSM6DSM_Sim_t;
+
+/* Private variables ---------------------------------------------------------*/
+static LSM6DSM_Sim_t Lsm6dsmSim;
+
+/* ODR_XL / ODR_G / ODR_FIFO codes, 1.6 Hz is the accelerometer low power one */
+static const float Lsm6dsmSimOdr[16] = {0.0f, 12.5f, 26.0f, 52.0f, 104.0f, 208.0f, 416.0f, 833.0f,
+                                        1660.0f, 3330.0f, 6660.0f, 1.6f, 0.0f, 0.0f, 0.0f, 0.0f};
+/* FS_XL codes: 2, 16, 4 and 8 g */
+static const float Lsm6dsmSimXlSensitivity[4] = {0.061f, 0.488f, 0.122f, 0.244f};
+/* DEC_FIFO_XL / DEC_FIFO_GYRO codes */
+static const uint8_t Lsm6dsmSimDecimation[8] = {0, 1, 2, 3, 4, 8, 16, 32};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Gyroscope sensitivity of FS_G and FS_125
+  * @param  Ctrl2: CTRL2_G
+  * @retval mdps/LSB
+  */
+static float LSM6DSM_Sim_GyroSensitivity(uint8_t Ctrl2)
+{
+  switch((Ctrl2 >> 1) & 0x07U)
+  {
+    case 0:  return 8.75f;
+    case 2:  return 17.5f;
+    case 4:  return 35.0f;
+    case 6:  return 70.0f;
+    default: return 4.375f;      /* FS_125 */
+  }
+}
+
+static uint32_t LSM6DSM_Sim_Gcd(uint32_t a, uint32_t b)
+{
+  while(b != 0U)
+  {
+    uint32_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+/**
+  * @brief  Sensors written to the FIFO at a FIFO data rate period
+  * @param  Tick: period since the FIFO start
+  * @param  Gyro: gyroscope data set written
+  * @param  Xl: accelerometer data set written
+  * @retval Number of words written
+  */
+static uint16_t LSM6DSM_Sim_FifoSets(uint32_t Tick, uint8_t *Gyro, uint8_t *Xl)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+
+  *Gyro = (sim->GyroDecimation != 0U) && (sim->Gyro.PeriodNs != 0U) && ((Tick % sim->GyroDecimation) == 0U);
+  *Xl = (sim->XlDecimation != 0U) && (sim->Xl.PeriodNs != 0U) && ((Tick % sim->XlDecimation) == 0U);
+  return (uint16_t)(3U * (*Gyro + *Xl));
+}
+
+/**
+  * @brief  FIFO_STATUS1..4 from the FIFO contents
+  * @param  None
+  * @retval None
+  */
+static void LSM6DSM_Sim_FifoStatus(void)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+  uint16_t fth = (uint16_t)(NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_FIFO_CTRL1) |
+                            ((NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_FIFO_CTRL2) & 0x07U) << 8));
+  uint16_t pattern = (sim->FifoCount != 0U) ? sim->FifoPattern[sim->FifoHead] : sim->PatternNext;
+  uint8_t gyro, xl;
+  /* DIFF_FIFO has 11 bits, a full FIFO reads 2047 */
+  uint16_t level = (sim->FifoCount < 0x7FFU) ? sim->FifoCount : 0x7FFU;
+  uint8_t status2 = (uint8_t)((level >> 8) & 0x07U);
+
+  if(sim->FifoCount == 0U)
+  {
+    status2 |= 0x10U;                                       /* FIFO_EMPTY */
+  }
+  if(sim->FifoCount + LSM6DSM_Sim_FifoSets(sim->FifoTick, &gyro, &xl) > LSM6DSM_SIM_FIFO_WORDS)
+  {
+    status2 |= 0x20U;                                       /* FIFO_FULL_SMART */
+  }
+  if(sim->FifoOverrun)
+  {
+    status2 |= 0x40U;                                       /* OVER_RUN */
+  }
+  if(sim->FifoCount >= fth)
+  {
+    status2 |= 0x80U;                                       /* WaterM */
+  }
+  NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_FIFO_STATUS1, (uint8_t)(level & 0xFFU));
+  NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_FIFO_STATUS2, status2);
+  NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_FIFO_STATUS3, (uint8_t)(pattern & 0xFFU));
+  NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_FIFO_STATUS4, (uint8_t)((pattern >> 8) & 0x03U));
+}
+
+/**
+  * @brief  Write one FIFO word
+  * @param  Word: output
+  * @retval None
+  */
+static void LSM6DSM_Sim_FifoPush(int16_t Word)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+  uint16_t tail;
+
+  if(sim->FifoCount == LSM6DSM_SIM_FIFO_WORDS)
+  {
+    if(sim->FifoMode == 1U)
+    {
+      return;                                               /* FIFO mode stops when full */
+    }
+    sim->FifoHead = (uint16_t)((sim->FifoHead + 1U) % LSM6DSM_SIM_FIFO_WORDS);
+    sim->FifoCount--;
+    sim->FifoOverrun = 1;
+  }
+  tail = (uint16_t)((sim->FifoHead + sim->FifoCount) % LSM6DSM_SIM_FIFO_WORDS);
+  sim->FifoWord[tail] = (uint16_t)Word;
+  sim->FifoPattern[tail] = sim->PatternNext++;
+  sim->FifoCount++;
+}
+
+/**
+  * @brief  FIFO data rate period: the data sets of the decimated sensors
+  * @param  TimeNs: sampling instant
+  * @retval None
+  */
+static void LSM6DSM_Sim_FifoTick(uint64_t TimeNs)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+  const DATALOG_Record_t *values;
+  uint32_t period = 1;
+  uint8_t gyro, xl;
+  uint16_t words;
+  int axis;
+
+  /* The pattern repeats every least common multiple of the decimations */
+  if(sim->GyroDecimation != 0U)
+  {
+    period = sim->GyroDecimation;
+  }
+  if(sim->XlDecimation != 0U)
+  {
+    period = period / LSM6DSM_Sim_Gcd(period, sim->XlDecimation) * sim->XlDecimation;
+  }
+  if((sim->FifoTick % period) == 0U)
+  {
+    sim->PatternNext = 0;
+  }
+
+  words = LSM6DSM_Sim_FifoSets(sim->FifoTick, &gyro, &xl);
+  sim->FifoTick++;
+  if(words == 0U)
+  {
+    return;
+  }
+  if((sim->FifoMode == 1U) && (sim->FifoCount + words > LSM6DSM_SIM_FIFO_WORDS))
+  {
+    SimStats[NATIVE_LSM6DSM].FifoOverruns++;
+    return;
+  }
+  if(sim->FifoCount + words > LSM6DSM_SIM_FIFO_WORDS)
+  {
+    SimStats[NATIVE_LSM6DSM].FifoOverruns++;
+  }
+
+  values = SIM_Sample(TimeNs);
+  for(axis = 0; gyro && (axis < 3); axis++)
+  {
+    LSM6DSM_Sim_FifoPush(SIM_ToInt16(values->gyro[axis] / sim->GyroSensitivity));
+  }
+  for(axis = 0; xl && (axis < 3); axis++)
+  {
+    LSM6DSM_Sim_FifoPush(SIM_ToInt16(values->acc[axis] / sim->XlSensitivity));
+  }
+}
+
+/**
+  * @brief  Produce the data sets due at the simulated time
+  * @param  Now: simulated time
+  * @retval None
+  */
+static void LSM6DSM_Sim_Update(uint64_t Now)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+  const DATALOG_Record_t *values;
+  uint8_t status = NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_STATUS_REG);
+  uint64_t t;
+  int axis;
+
+  while(SIM_Stream_Next(&sim->Gyro, Now, &t))
+  {
+    values = SIM_Sample(t);
+    for(axis = 0; axis < 3; axis++)
+    {
+      SIM_Put16(NATIVE_LSM6DSM, (uint8_t)(LSM6DSM_OUTX_L_G + 2 * axis),
+                SIM_ToInt16(values->gyro[axis] / sim->GyroSensitivity));
+    }
+    SIM_Put16(NATIVE_LSM6DSM, LSM6DSM_OUT_TEMP_L, SIM_ToInt16((values->temperature - 25.0f) * 256.0f));
+    status |= LSM6DSM_SIM_GDA | LSM6DSM_SIM_TDA;
+    SimStats[NATIVE_LSM6DSM].Samples++;
+  }
+  while(SIM_Stream_Next(&sim->Xl, Now, &t))
+  {
+    values = SIM_Sample(t);
+    for(axis = 0; axis < 3; axis++)
+    {
+      SIM_Put16(NATIVE_LSM6DSM, (uint8_t)(LSM6DSM_OUTX_L_XL + 2 * axis),
+                SIM_ToInt16(values->acc[axis] / sim->XlSensitivity));
+    }
+    SIM_Put16(NATIVE_LSM6DSM, LSM6DSM_OUT_TEMP_L, SIM_ToInt16((values->temperature - 25.0f) * 256.0f));
+    status |= LSM6DSM_SIM_XLDA | LSM6DSM_SIM_TDA;
+    SimStats[NATIVE_LSM6DSM].Samples++;
+  }
+  NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_STATUS_REG, status);
+
+  while(SIM_Stream_Next(&sim->Fifo, Now, &t))
+  {
+    LSM6DSM_Sim_FifoTick(t);
+  }
+  LSM6DSM_Sim_FifoStatus();
+}
+
+/**
+  * @brief  Empty the FIFO
+  * @param  None
+  * @retval None
+  */
+static void LSM6DSM_Sim_FifoReset(void)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+
+  sim->FifoHead = 0;
+  sim->FifoCount = 0;
+  sim->FifoTick = 0;
+  sim->PatternNext = 0;
+  sim->FifoOverrun = 0;
+}
+
+/**
+  * @brief  Rates, full scales and FIFO settings of the control registers
+  * @param  Now: simulated time
+  * @retval None
+  */
+static void LSM6DSM_Sim_Configure(uint64_t Now)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+  uint8_t ctrl1 = NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_CTRL1_XL);
+  uint8_t ctrl2 = NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_CTRL2_G);
+  uint8_t ctrl3 = NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_FIFO_CTRL3);
+  uint8_t ctrl5 = NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_FIFO_CTRL5);
+  uint8_t mode;
+  uint8_t odr;
+
+  SIM_Stream_SetOdr(&sim->Xl, Lsm6dsmSimOdr[ctrl1 >> 4], Now);
+  /* 1.6 Hz is an accelerometer only rate */
+  SIM_Stream_SetOdr(&sim->Gyro, ((ctrl2 >> 4) < 11U) ? Lsm6dsmSimOdr[ctrl2 >> 4] : 0.0f, Now);
+  sim->XlSensitivity = Lsm6dsmSimXlSensitivity[(ctrl1 >> 2) & 0x03U];
+  sim->GyroSensitivity = LSM6DSM_Sim_GyroSensitivity(ctrl2);
+  sim->XlDecimation = Lsm6dsmSimDecimation[ctrl3 & 0x07U];
+  sim->GyroDecimation = Lsm6dsmSimDecimation[(ctrl3 >> 3) & 0x07U];
+
+  switch(ctrl5 & 0x07U)
+  {
+    case LSM6DSM_FIFO_MODE:
+      mode = 1;
+      break;
+    case LSM6DSM_STREAM_TO_FIFO_MODE:
+    case LSM6DSM_STREAM_MODE:
+      mode = 2;
+      break;
+    default:
+      mode = 0;
+      break;
+  }
+  if(mode == 0U)
+  {
+    LSM6DSM_Sim_FifoReset();
+  }
+  sim->FifoMode = mode;
+  /* ODR_FIFO has no 1.6 Hz code */
+  odr = (uint8_t)((ctrl5 >> 3) & 0x0FU);
+  SIM_Stream_SetOdr(&sim->Fifo, ((mode != 0U) && (odr < 11U)) ? Lsm6dsmSimOdr[odr] : 0.0f, Now);
+}
+
+/**
+  * @brief  Register read: the outputs are refreshed before the byte is
+  *         returned, except inside an output register block when BDU is set
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: register file contents
+  * @retval Byte read
+  */
+static uint8_t LSM6DSM_Sim_Read(void *Context, uint8_t Reg, uint8_t Value)
+{
+  LSM6DSM_Sim_t *sim = &Lsm6dsmSim;
+  uint8_t bdu = NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_CTRL3_C) & LSM6DSM_SIM_BDU;
+  uint8_t status;
+  uint16_t word;
+
+  (void)Context;
+  (void)Value;
+  if(!bdu || (Reg < LSM6DSM_OUT_TEMP_L) || (Reg > LSM6DSM_OUTZ_H_XL) ||
+     (Reg == LSM6DSM_OUT_TEMP_L) || (Reg == LSM6DSM_OUTX_L_G) || (Reg == LSM6DSM_OUTX_L_XL))
+  {
+    LSM6DSM_Sim_Update(SIM_Now());
+  }
+
+  status = NATIVE_Bus_Peek(NATIVE_LSM6DSM, LSM6DSM_STATUS_REG);
+  if((Reg == LSM6DSM_OUT_TEMP_L) || (Reg == LSM6DSM_OUT_TEMP_H))
+  {
+    NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_STATUS_REG, status & (uint8_t)~LSM6DSM_SIM_TDA);
+  }
+  else if((Reg >= LSM6DSM_OUTX_L_G) && (Reg <= LSM6DSM_OUTZ_H_G))
+  {
+    NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_STATUS_REG, status & (uint8_t)~LSM6DSM_SIM_GDA);
+  }
+  else if((Reg >= LSM6DSM_OUTX_L_XL) && (Reg <= LSM6DSM_OUTZ_H_XL))
+  {
+    NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_STATUS_REG, status & (uint8_t)~LSM6DSM_SIM_XLDA);
+  }
+  else if((Reg == LSM6DSM_FIFO_DATA_OUT_L) || (Reg == LSM6DSM_FIFO_DATA_OUT_H))
+  {
+    if(sim->FifoCount == 0U)
+    {
+      return 0;
+    }
+    word = sim->FifoWord[sim->FifoHead];
+    if(Reg == LSM6DSM_FIFO_DATA_OUT_L)
+    {
+      return (uint8_t)(word & 0xFFU);
+    }
+    /* The high byte pops the word */
+    sim->FifoHead = (uint16_t)((sim->FifoHead + 1U) % LSM6DSM_SIM_FIFO_WORDS);
+    sim->FifoCount--;
+    sim->FifoOverrun = 0;
+    LSM6DSM_Sim_FifoStatus();
+    return (uint8_t)(word >> 8);
+  }
+  return NATIVE_Bus_Peek(NATIVE_LSM6DSM, Reg);
+}
+
+/**
+  * @brief  Register write: software reset, reboot and the control registers
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @param  Value: byte written
+  * @retval None
+  */
+static void LSM6DSM_Sim_Write(void *Context, uint8_t Reg, uint8_t Value)
+{
+  uint64_t now = SIM_Now();
+
+  (void)Context;
+  LSM6DSM_Sim_Update(now);
+  if((Reg == LSM6DSM_CTRL3_C) && (Value & LSM6DSM_SIM_SW_RESET))
+  {
+    NATIVE_Bus_ResetDevice(NATIVE_LSM6DSM);
+    memset(&Lsm6dsmSim, 0, sizeof(Lsm6dsmSim));
+  }
+  else if((Reg == LSM6DSM_CTRL3_C) && (Value & LSM6DSM_SIM_BOOT))
+  {
+    /* Trimming reloaded at once */
+    NATIVE_Bus_Poke(NATIVE_LSM6DSM, LSM6DSM_CTRL3_C, Value & (uint8_t)~LSM6DSM_SIM_BOOT);
+  }
+  LSM6DSM_Sim_Configure(now);
+  LSM6DSM_Sim_FifoStatus();
+}
+
+/**
+  * @brief  FIFO_DATA_OUT_H rolls back to FIFO_DATA_OUT_L in a burst read
+  * @param  Context: not used
+  * @param  Reg: register address
+  * @retval Next register address
+  */
+static uint8_t LSM6DSM_Sim_Next(void *Context, uint8_t Reg)
+{
+  (void)Context;
+  return (Reg == LSM6DSM_FIFO_DATA_OUT_H) ? LSM6DSM_FIFO_DATA_OUT_L : (uint8_t)(Reg + 1U);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach the model to the power-on register file
+  * @param  None
+  * @retval None
+  */
+void SIM_LSM6DSM_Attach(void)
+{
+  static const NATIVE_Bus_Hook_t hook = {LSM6DSM_Sim_Read, LSM6DSM_Sim_Write, LSM6DSM_Sim_Next, NULL};
+
+  memset(&Lsm6dsmSim, 0, sizeof(Lsm6dsmSim));
+  LSM6DSM_Sim_Configure(SIM_Now());
+  LSM6DSM_Sim_FifoStatus();
+  NATIVE_Bus_SetHook(NATIVE_LSM6DSM, &hook);
+}
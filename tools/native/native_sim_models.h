@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file    native_sim_models.h
+  * @brief   Helpers shared by the sensor models of native_sim.c.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NATIVE_SIM_MODELS_H
+#define __NATIVE_SIM_MODELS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_sim.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Sampling instants of one output data rate
+  */
+typedef struct
+{
+  uint64_t NextNs;          /* time of the next data set */
+  uint64_t PeriodNs;        /* 0 when the output is powered down */
+} SIM_Stream_t;
+
+/* Exported variables --------------------------------------------------------*/
+extern NATIVE_Sim_Stats_t SimStats[NATIVE_BUS_DEVICES];
+
+/* Exported functions ------------------------------------------------------- */
+uint64_t SIM_Now(void);
+const DATALOG_Record_t *SIM_Sample(uint64_t TimeNs);
+
+void SIM_Stream_SetOdr(SIM_Stream_t *Stream, float Odr, uint64_t Now);
+uint8_t SIM_Stream_Next(SIM_Stream_t *Stream, uint64_t Now, uint64_t *TimeNs);
+
+int16_t SIM_ToInt16(double Value);
+void SIM_Put16(NATIVE_Bus_Device_t Device, uint8_t Reg, int16_t Value);
+int16_t SIM_Get16(NATIVE_Bus_Device_t Device, uint8_t Reg);
+
+void SIM_LSM6DSM_Attach(void);
+void SIM_LSM303AGR_Attach(void);
+void SIM_LPS22HB_Attach(void);
+void SIM_HTS221_Attach(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NATIVE_SIM_MODELS_H */
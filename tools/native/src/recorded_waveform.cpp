@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file    recorded_waveform.cpp
+  * @brief   Waveform of the sensor models read from a SensorTile log.
+  ******************************************************************************
+  */
+#include "recorded_waveform.hpp"
+
+#include "stlog/decode.hpp"
+#include "stlog/mapped_file.hpp"
+#include "stlog/sinks.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace native {
+
+namespace {
+
+/// Keeps the decoded records, in file order
+class RecordSink : public stlog::OutputSink {
+public:
+    explicit RecordSink(std::vector<DATALOG_Record_t>& records) : records_(records) {}
+    void encode(stlog::Chunk&) const override {}
+    void write(const stlog::Chunk& chunk) override
+    {
+        records_.insert(records_.end(), chunk.records.begin(), chunk.records.end());
+    }
+
+private:
+    std::vector<DATALOG_Record_t>& records_;
+};
+
+template <typename T>
+T lerp(T a, T b, double f)
+{
+    return T(double(a) + (double(b) - double(a)) * f);
+}
+
+} // namespace
+
+RecordedWaveform::RecordedWaveform(const std::string& path)
+{
+    std::vector<DATALOG_Record_t> decoded;
+    RecordSink sink(decoded);
+    stlog::decode_file(stlog::MappedFile(path), sink);
+
+    // Time must increase for the interpolation: a clock going back (a new
+    // session appended to the file) or a repeated timestamp is dropped
+    for (const auto& rec : decoded) {
+        if (records_.empty() || rec.ms_counter > records_.back().ms_counter) {
+            records_.push_back(rec);
+        }
+    }
+    if (records_.size() < 2) {
+        throw std::runtime_error(path + ": not enough records for a waveform");
+    }
+    // The loop closes with one more sampling period, from the last record to the first
+    const std::uint32_t last_period = records_.back().ms_counter - records_[records_.size() - 2].ms_counter;
+    duration_ms_ = records_.back().ms_counter - records_.front().ms_counter + last_period;
+
+    waveform_.Sample = &RecordedWaveform::sample;
+    waveform_.Context = this;
+}
+
+void RecordedWaveform::sample(void* context, std::uint64_t time_ns, DATALOG_Record_t* values)
+{
+    auto& self = *static_cast<RecordedWaveform*>(context);
+    const auto& records = self.records_;
+    const double t = std::fmod(double(time_ns) * 1e-6, double(self.duration_ms_)) + records.front().ms_counter;
+
+    // The models sample forward in time: the segment is found from the last one
+    std::size_t i = self.cursor_;
+    if (t < records[i].ms_counter) {
+        i = 0;
+    }
+    while (i + 1 < records.size() && records[i + 1].ms_counter <= t) {
+        ++i;
+    }
+    self.cursor_ = i;
+
+    const DATALOG_Record_t& a = records[i];
+    const DATALOG_Record_t& b = records[(i + 1) % records.size()];
+    const double span = (i + 1 < records.size()) ? double(b.ms_counter - a.ms_counter)
+                                                 : double(self.duration_ms_) + records.front().ms_counter - a.ms_counter;
+    const double f = (t - a.ms_counter) / span;
+
+    values->ms_counter = std::uint32_t(time_ns / 1000000U);
+    for (int axis = 0; axis < 3; ++axis) {
+        values->acc[axis] = lerp(a.acc[axis], b.acc[axis], f);
+        values->gyro[axis] = lerp(a.gyro[axis], b.gyro[axis], f);
+        values->mag[axis] = lerp(a.mag[axis], b.mag[axis], f);
+    }
+    values->pressure = lerp(a.pressure, b.pressure, f);
+    values->temperature = lerp(a.temperature, b.temperature, f);
+    values->humidity = lerp(a.humidity, b.humidity, f);
+}
+
+} // namespace native
@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file    recorded_waveform.hpp
+  * @brief   Waveform of the sensor models read from a SensorTile log.
+  ******************************************************************************
+  */
+#ifndef NATIVE_RECORDED_WAVEFORM_HPP
+#define NATIVE_RECORDED_WAVEFORM_HPP
+
+#include "native_sim.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace native {
+
+/**
+  * @brief  The records of a binary or CSV log (decoded by stlog) played back
+  *         in a loop, linearly interpolated between their timestamps so the
+  *         models can sample them at any output data rate. Channels missing
+  *         from the log read as 0. Throws if the log can not be decoded or
+  *         has less than two records.
+  */
+class RecordedWaveform {
+public:
+    explicit RecordedWaveform(const std::string& path);
+
+    RecordedWaveform(const RecordedWaveform&) = delete;
+    RecordedWaveform& operator=(const RecordedWaveform&) = delete;
+
+    const NATIVE_Sim_Waveform_t* waveform() const { return &waveform_; }
+    std::size_t records() const { return records_.size(); }
+    std::uint32_t duration_ms() const { return duration_ms_; }
+
+private:
+    static void sample(void* context, std::uint64_t time_ns, DATALOG_Record_t* values);
+
+    std::vector<DATALOG_Record_t> records_;
+    std::uint32_t duration_ms_ = 0;     // loop length
+    std::size_t cursor_ = 0;            // segment of the last sample
+    NATIVE_Sim_Waveform_t waveform_;
+};
+
+} // namespace native
+
+#endif // NATIVE_RECORDED_WAVEFORM_HPP
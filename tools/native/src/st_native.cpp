@@ -0,0 +1,256 @@
+/**
+  ******************************************************************************
+  * @file    st_native.cpp
+  * @brief   The SensorTile firmware (Src/main.c and the datalog sources) on
+  *          the FreeRTOS POSIX port: the sensors are register models behind
+  *          the component drivers, the SD card is a disk image and the USB
+  *          CDC port a pseudo terminal. Runs the whole pipeline on a
+  *          workstation, for perf and the host tools.
+  ******************************************************************************
+  */
+#include "native_board.h"
+#include "image_diskio.h"
+#include "recorded_waveform.hpp"
+
+#include "stlog/mapped_file.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-m usb|sd] [-s MiB] [-r bytes/s] [-l link] [-n] [-t seconds] [-T ms] [-c] [-w log] [-x speed]\n"
+        "          [-R recording] <card image>\n"
+        "       %s -b\n"
+        "       %s -P recording\n"
+        "  runs the firmware; the CDC port is a pseudo terminal, whose path is printed\n"
+        "  -m  logging interface: usb (USB_Datalog) or sd (SDCARD_Datalog, default)\n"
+        "  -s  size of the card image, created and formatted if missing or empty (default: 256)\n"
+        "  -r  rate the host reads the CDC port, 0 for unlimited (default: 1000000)\n"
+        "  -l  symbolic link to the pseudo terminal, removed on exit\n"
+        "  -n  the host does not open the CDC port (no DTR)\n"
+        "  -t  run time, 0 until SIGINT or SIGTERM (default: 0)\n"
+        "  -T  sd: double tap starting the log, ms after reset (default: 500)\n"
+        "  -c  sd: card timings of st_sdlog_bench, the writing task waits for them\n"
+        "  -w  values seen by the sensors: a binary or CSV log played in a loop (default: synthetic)\n"
+        "  -x  simulated sensor time per real time, the sensors run at x times their data rates (default: 1)\n"
+        "  -R  register recording (DATALOG_SD_REGISTERS) read by the drivers in its original timing,\n"
+        "      the run ends with it\n"
+        "  -b  time the driver conversions and the record formatting (datalog_bench.c) and exit\n"
+        "  -P  run each sample of a register recording through getSensorsData and the SD card record\n"
+        "      formatting as fast as possible, print the throughput and a hash of the records and exit\n",
+        argv0, argv0, argv0);
+}
+
+volatile sig_atomic_t stop = 0;
+
+void on_signal(int)
+{
+    stop = 1;
+}
+
+std::string link_path;
+
+void cleanup()
+{
+    if (!link_path.empty()) {
+        ::unlink(link_path.c_str());
+    }
+    IMAGE_Close();
+}
+
+/// Image of the card: formatted FAT when it is new
+bool open_card(const char* path, std::uint32_t mib, bool timed)
+{
+    static const IMAGE_Latency_t latency = {500, 250, 8192, 100000};
+    struct stat st;
+    bool format = ::stat(path, &st) != 0 || st.st_size == 0;
+    std::uint32_t sectors = format ? mib * 2048U : std::uint32_t(st.st_size / 512);
+
+    if (!format && (st.st_size < 512 || st.st_size % 512 != 0)) {
+        std::fprintf(stderr, "%s is not a card image\n", path);
+        return false;
+    }
+    if (IMAGE_Open(path, sectors, timed ? &latency : nullptr) != 0) {
+        std::fprintf(stderr, "cannot map %s: %s\n", path, std::strerror(errno));
+        return false;
+    }
+    if (format) {
+        char drive[4];
+        static BYTE work[_MAX_SS];
+        if (FATFS_LinkDriver(&IMAGE_Driver, drive) != 0 ||
+            f_mkfs(drive, FM_ANY, 0, work, sizeof(work)) != FR_OK) {
+            std::fprintf(stderr, "cannot format %s\n", path);
+            return false;
+        }
+        FATFS_UnLinkDriver(drive);
+    }
+    IMAGE_ResetStats();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    NATIVE_Config_t config{};
+    std::uint32_t mib = 256;
+    double seconds = 0;
+    bool timed = false;
+    bool bench = false;
+    std::string waveform_path;
+    std::unique_ptr<native::RecordedWaveform> recorded;
+    std::string replay_path;
+    bool replay_bench = false;
+    stlog::MappedFile replay_file;
+    NATIVE_Replay_t replay{};
+
+    config.Mode = NATIVE_MODE_SD;
+    config.UsbDtr = 1;
+    config.UsbRate = 1e6;
+    config.TapMs = 500;
+    config.SimSpeed = 1.0;
+    config.Stop = &stop;
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "m:s:r:l:nt:T:cw:x:R:bP:h")) != -1) {
+        switch (opt) {
+        case 'm':
+            if (std::strcmp(optarg, "usb") == 0) {
+                config.Mode = NATIVE_MODE_USB;
+            } else if (std::strcmp(optarg, "sd") == 0) {
+                config.Mode = NATIVE_MODE_SD;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 's': mib = std::uint32_t(std::strtoul(optarg, nullptr, 10)); break;
+        case 'r': config.UsbRate = std::strtod(optarg, nullptr); break;
+        case 'l': link_path = optarg; break;
+        case 'n': config.UsbDtr = 0; break;
+        case 't': seconds = std::strtod(optarg, nullptr); break;
+        case 'T': config.TapMs = std::uint32_t(std::strtoul(optarg, nullptr, 10)); break;
+        case 'c': timed = true; break;
+        case 'w': waveform_path = optarg; break;
+        case 'x': config.SimSpeed = std::strtod(optarg, nullptr); break;
+        case 'R': replay_path = optarg; break;
+        case 'b': bench = true; break;
+        case 'P':
+            replay_path = optarg;
+            replay_bench = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if ((optind >= argc && !bench && !replay_bench) || mib == 0 || mib > 2U * 1024U * 1024U || config.UsbRate < 0 || seconds < 0 ||
+        !(config.SimSpeed > 0)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    config.DurationMs = std::uint32_t(seconds * 1000.0);
+    config.CardSleep = timed ? 1 : 0;
+
+    if (!waveform_path.empty()) {
+        try {
+            recorded = std::make_unique<native::RecordedWaveform>(waveform_path);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return EXIT_FAILURE;
+        }
+        std::fprintf(stderr, "waveform: %zu records, %.3f s loop\n", recorded->records(),
+                     recorded->duration_ms() / 1000.0);
+        config.Waveform = recorded->waveform();
+    }
+
+    if (!replay_path.empty()) {
+        try {
+            replay_file = stlog::MappedFile(replay_path);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return EXIT_FAILURE;
+        }
+        if (replay_file.size() > std::size_t(UINT32_MAX) ||
+            NATIVE_Replay_Open(&replay, replay_file.data(), std::uint32_t(replay_file.size())) != 0) {
+            std::fprintf(stderr, "%s: not a register recording\n", replay_path.c_str());
+            return EXIT_FAILURE;
+        }
+        std::fprintf(stderr, "replay: %lu samples, %.3f s, %lu after lost samples, %lu truncated\n",
+                     (unsigned long)replay.Frames, (replay.LastMs - replay.FirstMs) / 1000.0,
+                     (unsigned long)replay.Gaps, (unsigned long)replay.Truncated);
+        config.Replay = &replay;
+    }
+
+    if (replay_bench) {
+        // The sensor registers come from the recording: no card, no CDC port
+        NATIVE_ReplayBench(&config);
+        return EXIT_FAILURE;
+    }
+
+    if (bench) {
+        // The sensor registers are read from RAM: no card, no CDC port
+        NATIVE_Bench(&config);
+        return EXIT_FAILURE;
+    }
+
+    if (!open_card(argv[optind], mib, timed)) {
+        return EXIT_FAILURE;
+    }
+
+    // The slave stays open here: raw from the start, and no hang up between hosts
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    int slave = -1;
+    const char* name = nullptr;
+    if (master >= 0 && ::grantpt(master) == 0 && ::unlockpt(master) == 0) {
+        name = ::ptsname(master);
+        slave = name ? ::open(name, O_RDWR | O_NOCTTY) : -1;
+    }
+    struct termios tio {};
+    if (slave < 0 || ::tcgetattr(slave, &tio) != 0) {
+        std::fprintf(stderr, "cannot create a pseudo terminal: %s\n", std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    ::cfmakeraw(&tio);
+    ::tcsetattr(slave, TCSANOW, &tio);
+    if (!link_path.empty() && ::symlink(name, link_path.c_str()) != 0) {
+        std::fprintf(stderr, "cannot link %s: %s\n", link_path.c_str(), std::strerror(errno));
+        link_path.clear();
+        return EXIT_FAILURE;
+    }
+    std::printf("%s\n", name);
+    std::fflush(stdout);
+    config.UsbFd = master;
+
+    // The board task exits the process at the end of the run
+    std::atexit(cleanup);
+
+    // Only a flag: the handler runs in whichever task thread the signal hits,
+    // interrupted system calls are restarted
+    struct sigaction sa {};
+    sa.sa_handler = on_signal;
+    sa.sa_flags = SA_RESTART;
+    ::sigemptyset(&sa.sa_mask);
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+
+    NATIVE_Run(&config);
+    return EXIT_FAILURE;
+}
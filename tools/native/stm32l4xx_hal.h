@@ -0,0 +1,207 @@
+/**
+  ******************************************************************************
+  * @file    stm32l4xx_hal.h
+  * @brief   HAL of the native build: the GPIO, NVIC, power and tick API and
+  *          the USB device handle used by the firmware sources, the BSP
+  *          headers and the USB device library, implemented by
+  *          native_board.c and usbd_native.c.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32L4xx_HAL_H
+#define __STM32L4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal_conf.h"
+#include "stm32l4xx_hal_def.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  EXTI0_IRQn = 6,
+  EXTI1_IRQn = 7,
+  EXTI2_IRQn = 8,
+  EXTI3_IRQn = 9,
+  EXTI4_IRQn = 10,
+  OTG_FS_IRQn = 67
+} IRQn_Type;
+
+typedef struct
+{
+  uint32_t ODR;     /* output data register, the LEDs and chip selects */
+} GPIO_TypeDef;
+
+typedef struct
+{
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+  uint32_t Instance;
+} SPI_HandleTypeDef;
+
+/**
+  * @brief  Endpoint of the USB device handle: the fields read by the
+  *         USB device library and the transfer in flight of usbd_native.c
+  */
+typedef struct
+{
+  uint8_t   num;
+  uint8_t   is_in;
+  uint8_t   is_stall;
+  uint8_t   type;
+  uint32_t  maxpacket;
+  uint8_t   *xfer_buff;
+  uint32_t  xfer_len;
+  uint32_t  xfer_count;
+} PCD_EPTypeDef;
+
+typedef struct
+{
+  PCD_EPTypeDef IN_ep[16];
+  PCD_EPTypeDef OUT_ep[16];
+  uint32_t      Setup[12];
+  uint8_t       USB_Address;
+  void          *pData;     /* USB device library handle */
+} PCD_HandleTypeDef;
+
+/* Cycle counter of the Cortex-M4: CYCCNT follows the monotonic clock at
+   SystemCoreClock, read on each access through DWT */
+typedef struct
+{
+  uint32_t CTRL;
+  uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  uint32_t DEMCR;
+} CoreDebug_Type;
+
+/* Exported constants --------------------------------------------------------*/
+extern GPIO_TypeDef NativeGPIO[7];
+#define GPIOA   (&NativeGPIO[0])
+#define GPIOB   (&NativeGPIO[1])
+#define GPIOC   (&NativeGPIO[2])
+#define GPIOD   (&NativeGPIO[3])
+#define GPIOE   (&NativeGPIO[4])
+#define GPIOF   (&NativeGPIO[5])
+#define GPIOG   (&NativeGPIO[6])
+
+extern CoreDebug_Type NativeCoreDebug;
+#define DWT         NATIVE_DWT()
+#define CoreDebug   (&NativeCoreDebug)
+
+#define DWT_CTRL_CYCCNTENA_Msk       (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk   (1UL << 24)
+
+extern uint32_t SystemCoreClock;
+
+#define SPI3    0x40003C00U
+
+#define GPIO_PIN_0                 ((uint16_t)0x0001)
+#define GPIO_PIN_1                 ((uint16_t)0x0002)
+#define GPIO_PIN_2                 ((uint16_t)0x0004)
+#define GPIO_PIN_3                 ((uint16_t)0x0008)
+#define GPIO_PIN_4                 ((uint16_t)0x0010)
+#define GPIO_PIN_5                 ((uint16_t)0x0020)
+#define GPIO_PIN_6                 ((uint16_t)0x0040)
+#define GPIO_PIN_7                 ((uint16_t)0x0080)
+#define GPIO_PIN_8                 ((uint16_t)0x0100)
+#define GPIO_PIN_9                 ((uint16_t)0x0200)
+#define GPIO_PIN_10                ((uint16_t)0x0400)
+#define GPIO_PIN_11                ((uint16_t)0x0800)
+#define GPIO_PIN_12                ((uint16_t)0x1000)
+#define GPIO_PIN_13                ((uint16_t)0x2000)
+#define GPIO_PIN_14                ((uint16_t)0x4000)
+#define GPIO_PIN_15                ((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT            0x00000000U
+#define GPIO_MODE_OUTPUT_PP        0x00000001U
+#define GPIO_MODE_AF_PP            0x00000002U
+#define GPIO_MODE_IT_RISING        0x10110000U
+#define GPIO_MODE_IT_FALLING       0x10210000U
+
+#define GPIO_NOPULL                0x00000000U
+#define GPIO_PULLUP                0x00000001U
+#define GPIO_PULLDOWN              0x00000002U
+
+#define GPIO_SPEED_FREQ_LOW        0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM     0x00000001U
+#define GPIO_SPEED_FREQ_HIGH       0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH  0x00000003U
+#define GPIO_SPEED_LOW             GPIO_SPEED_FREQ_LOW
+#define GPIO_SPEED_MEDIUM          GPIO_SPEED_FREQ_MEDIUM
+#define GPIO_SPEED_FAST            GPIO_SPEED_FREQ_HIGH
+#define GPIO_SPEED_HIGH            GPIO_SPEED_FREQ_VERY_HIGH
+
+#define GPIO_AF6_SPI3              ((uint8_t)0x06)
+
+/* Exported macro ------------------------------------------------------------*/
+/* No clock tree on the host */
+#define __GPIOA_CLK_ENABLE()       do { } while(0)
+#define __GPIOB_CLK_ENABLE()       do { } while(0)
+#define __GPIOC_CLK_ENABLE()       do { } while(0)
+#define __GPIOD_CLK_ENABLE()       do { } while(0)
+#define __GPIOE_CLK_ENABLE()       do { } while(0)
+#define __GPIOF_CLK_ENABLE()       do { } while(0)
+#define __GPIOG_CLK_ENABLE()       do { } while(0)
+#define __GPIOA_CLK_DISABLE()      do { } while(0)
+#define __GPIOB_CLK_DISABLE()      do { } while(0)
+#define __GPIOC_CLK_DISABLE()      do { } while(0)
+#define __GPIOD_CLK_DISABLE()      do { } while(0)
+#define __GPIOE_CLK_DISABLE()      do { } while(0)
+#define __GPIOF_CLK_DISABLE()      do { } while(0)
+#define __GPIOG_CLK_DISABLE()      do { } while(0)
+#define __SPI3_CLK_ENABLE()        do { } while(0)
+
+/* Interrupt mask of the application tasks against the emulated interrupts */
+#define __get_PRIMASK()            NATIVE_GetPRIMASK()
+#define __set_PRIMASK(x)           NATIVE_SetPRIMASK(x)
+#define __disable_irq()            NATIVE_SetPRIMASK(1U)
+#define __enable_irq()             NATIVE_SetPRIMASK(0U)
+
+/* Exported functions ------------------------------------------------------- */
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+void HAL_PWREx_EnableVddUSB(void);
+void HAL_PWREx_EnableVddIO2(void);
+
+DWT_Type *NATIVE_DWT(void);
+
+uint32_t NATIVE_GetPRIMASK(void);
+void NATIVE_SetPRIMASK(uint32_t priMask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32L4xx_HAL_H */
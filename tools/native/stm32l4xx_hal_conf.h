@@ -0,0 +1,18 @@
+/**
+  ******************************************************************************
+  * @file    stm32l4xx_hal_conf.h
+  * @brief   HAL configuration of the native build: no peripheral module, so
+  *          the firmware takes its software paths (CRC-32 of the log blocks).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32L4xx_HAL_CONF_H
+#define __STM32L4xx_HAL_CONF_H
+
+/* Exported constants --------------------------------------------------------*/
+#define HSE_VALUE    ((uint32_t)16000000)
+#define LSE_VALUE    ((uint32_t)32768)
+#define TICK_INT_PRIORITY  ((uint32_t)0x0F)
+
+#endif /* __STM32L4xx_HAL_CONF_H */
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file    stm32l4xx_hal_def.h
+  * @brief   HAL common definitions of the native build: the types and
+  *          attributes of the ST header that the firmware sources use.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32L4xx_HAL_DEF_H
+#define __STM32L4xx_HAL_DEF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  HAL_OK       = 0x00,
+  HAL_ERROR    = 0x01,
+  HAL_BUSY     = 0x02,
+  HAL_TIMEOUT  = 0x03
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+  HAL_UNLOCKED = 0x00,
+  HAL_LOCKED   = 0x01
+} HAL_LockTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+#define __IO    volatile
+#define HAL_MAX_DELAY      0xFFFFFFFFU
+#define UNUSED(X) (void)X
+
+#ifndef __weak
+#define __weak   __attribute__((weak))
+#endif
+#ifndef __packed
+#define __packed __attribute__((__packed__))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32L4xx_HAL_DEF_H */
@@ -0,0 +1,152 @@
+/**
+  ******************************************************************************
+  * @file    st_native_sensors_test.cpp
+  * @brief   Sensor path of the native build without the RTOS: the component
+  *          drivers of the firmware, configured as MX_DataLogTerminal_Init
+  *          does, read the register models of native_sim*.c through the BSP
+  *          of native_sensors.c and the register files of native_bus.c. The
+  *          values read must follow the synthetic waveform.
+  ******************************************************************************
+  */
+#include "SensorTile_env_sensors.h"
+#include "SensorTile_motion_sensors.h"
+#include "SensorTile_motion_sensors_ex.h"
+#include "hts221_settings.h"
+#include "lps22hb_settings.h"
+#include "lsm303agr_settings.h"
+#include "lsm6dsm_settings.h"
+#include "native_sim.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* test, const char* what)
+{
+    if (!ok) {
+        std::printf("FAIL %s: %s\n", test, what);
+        failures++;
+    }
+}
+
+void check_near(double value, double expected, double tolerance, const char* test, const char* what)
+{
+    if (std::fabs(value - expected) > tolerance) {
+        std::printf("FAIL %s: %s %.3f, expected %.3f +/- %.3f\n", test, what, value, expected, tolerance);
+        failures++;
+    }
+}
+
+/* The firmware configuration of the sensors (Src/datalog_application.c) */
+void init_sensors()
+{
+    const char* test = "init";
+
+    check(BSP_MOTION_SENSOR_Init(LSM303AGR_MAG_0, MOTION_MAGNETO) == BSP_ERROR_NONE, test, "LSM303AGR");
+    BSP_MOTION_SENSOR_SetOutputDataRate(LSM303AGR_MAG_0, MOTION_MAGNETO, LSM303AGR_MAG_ODR);
+    BSP_MOTION_SENSOR_SetFullScale(LSM303AGR_MAG_0, MOTION_MAGNETO, LSM303AGR_MAG_FS);
+
+    check(BSP_MOTION_SENSOR_Init(LSM6DSM_0, MOTION_ACCELERO | MOTION_GYRO) == BSP_ERROR_NONE, test, "LSM6DSM");
+    BSP_MOTION_SENSOR_SetOutputDataRate(LSM6DSM_0, MOTION_ACCELERO, LSM6DSM_ACC_ODR);
+    BSP_MOTION_SENSOR_SetFullScale(LSM6DSM_0, MOTION_ACCELERO, LSM6DSM_ACC_FS);
+    BSP_MOTION_SENSOR_SetOutputDataRate(LSM6DSM_0, MOTION_GYRO, LSM6DSM_GYRO_ODR);
+    BSP_MOTION_SENSOR_SetFullScale(LSM6DSM_0, MOTION_GYRO, LSM6DSM_GYRO_FS);
+
+    check(BSP_ENV_SENSOR_Init(HTS221_0, ENV_TEMPERATURE | ENV_HUMIDITY) == BSP_ERROR_NONE, test, "HTS221");
+    BSP_ENV_SENSOR_SetOutputDataRate(HTS221_0, ENV_TEMPERATURE, HTS221_ODR);
+    BSP_ENV_SENSOR_SetOutputDataRate(HTS221_0, ENV_HUMIDITY, HTS221_ODR);
+
+    check(BSP_ENV_SENSOR_Init(LPS22HB_0, ENV_TEMPERATURE | ENV_PRESSURE) == BSP_ERROR_NONE, test, "LPS22HB");
+    BSP_ENV_SENSOR_SetOutputDataRate(LPS22HB_0, ENV_TEMPERATURE, LPS22HB_ODR);
+    BSP_ENV_SENSOR_SetOutputDataRate(LPS22HB_0, ENV_PRESSURE, LPS22HB_ODR);
+
+    check(BSP_MOTION_SENSOR_Enable_Double_Tap_Detection(LSM6DSM_0, BSP_MOTION_SENSOR_INT2_PIN) == BSP_ERROR_NONE,
+          test, "double tap");
+}
+
+/* One read of every channel at a simulated time: each one within a sample
+   period of the waveform and the resolution of its full scale */
+void read_at(std::uint64_t time_ns)
+{
+    const char* test = "read";
+    const double period_s[] = {1.0 / LSM6DSM_ACC_ODR, 1.0 / LSM6DSM_GYRO_ODR, 1.0 / LSM303AGR_MAG_ODR};
+    DATALOG_Record_t expected;
+    BSP_MOTION_SENSOR_Axes_t acc;
+    BSP_MOTION_SENSOR_Axes_t gyro;
+    BSP_MOTION_SENSOR_Axes_t mag;
+    float pressure = 0.0f;
+    float temperature = 0.0f;
+    float humidity = 0.0f;
+
+    NATIVE_Sim_SetTime(time_ns);
+    NATIVE_Sim_Synthetic(nullptr, time_ns, &expected);
+
+    check(BSP_MOTION_SENSOR_GetAxes(LSM6DSM_0, MOTION_ACCELERO, &acc) == BSP_ERROR_NONE, test, "accelerometer");
+    check(BSP_MOTION_SENSOR_GetAxes(LSM6DSM_0, MOTION_GYRO, &gyro) == BSP_ERROR_NONE, test, "gyroscope");
+    check(BSP_MOTION_SENSOR_GetAxes(LSM303AGR_MAG_0, MOTION_MAGNETO, &mag) == BSP_ERROR_NONE, test, "magnetometer");
+    check(BSP_ENV_SENSOR_GetValue(LPS22HB_0, ENV_PRESSURE, &pressure) == BSP_ERROR_NONE, test, "pressure");
+    check(BSP_ENV_SENSOR_GetValue(HTS221_0, ENV_TEMPERATURE, &temperature) == BSP_ERROR_NONE, test, "temperature");
+    check(BSP_ENV_SENSOR_GetValue(HTS221_0, ENV_HUMIDITY, &humidity) == BSP_ERROR_NONE, test, "humidity");
+
+    /* Slopes of the synthetic signals: 1000 mg/s, 7500 mdps/s, 0.5 mgauss/s */
+    const std::int32_t acc_axes[3] = {acc.x, acc.y, acc.z};
+    const std::int32_t gyro_axes[3] = {gyro.x, gyro.y, gyro.z};
+    const std::int32_t mag_axes[3] = {mag.x, mag.y, mag.z};
+    for (int axis = 0; axis < 3; axis++) {
+        check_near(acc_axes[axis], expected.acc[axis], 1000.0 * period_s[0] + 2.0, test, "acceleration (mg)");
+        check_near(gyro_axes[axis], expected.gyro[axis], 7500.0 * period_s[1] + 150.0, test, "angular rate (mdps)");
+        check_near(mag_axes[axis], expected.mag[axis], 0.5 * period_s[2] + 3.0, test, "magnetic field (mgauss)");
+    }
+    check_near(pressure, expected.pressure, 0.01, test, "pressure (hPa)");
+    check_near(temperature, expected.temperature, 0.1, test, "temperature (degC)");
+    check_near(humidity, expected.humidity, 0.5, test, "humidity (%rH)");
+}
+
+/* Every model produced data sets at its output data rate */
+void test_stats()
+{
+    const char* test = "model counters";
+    NATIVE_Sim_Stats_t stats;
+
+    NATIVE_Sim_GetStats(NATIVE_LSM6DSM, &stats);
+    check(stats.Samples > 0, test, "no LSM6DSM data set");
+    NATIVE_Sim_GetStats(NATIVE_LSM303AGR_MAG, &stats);
+    check(stats.Samples > 0, test, "no LSM303AGR data set");
+    NATIVE_Sim_GetStats(NATIVE_LPS22HB, &stats);
+    check(stats.Samples > 0, test, "no LPS22HB data set");
+    NATIVE_Sim_GetStats(NATIVE_HTS221, &stats);
+    check(stats.Samples > 0, test, "no HTS221 data set");
+}
+
+} // namespace
+
+/* The tick of native_board.c, here the simulated time */
+extern "C" uint32_t HAL_GetTick(void)
+{
+    return std::uint32_t(NATIVE_Sim_GetTime() / 1000000U);
+}
+
+int main()
+{
+    NATIVE_Sim_Config_t sim = {nullptr, nullptr};
+
+    NATIVE_Bus_Reset();
+    NATIVE_Sim_Attach(&sim);
+    init_sensors();
+
+    /* Every 0.37 s over a minute, off the sampling instants */
+    for (std::uint64_t t = 1000000000ULL; t < 61000000000ULL; t += 370000000ULL) {
+        read_at(t);
+    }
+    test_stats();
+
+    if (failures == 0) {
+        std::printf("st_native_sensors_test: all passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,369 @@
+/**
+  ******************************************************************************
+  * @file    usbd_native.c
+  * @brief   USB device controller of the native build: the low level driver
+  *          functions of usbd_conf.c on a pseudo terminal. A task at the
+  *          priority of the emulated interrupts plays the host and the
+  *          controller interrupt: it enumerates the device, opens the CDC
+  *          port (DTR) and moves the bulk transfers every 1 ms frame, at the
+  *          rate the host reads.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "native_board.h"
+#include "usbd_core.h"
+#include "usbd_desc.h"
+#include "cmsis_os.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define USB_FRAME_MS           1U
+/* Full speed bulk: at most 19 packets of 64 bytes per frame */
+#define USB_FRAME_MAX_BYTES    (19U * 64U)
+#define USB_ENDPOINTS          16U
+
+/* Private variables ---------------------------------------------------------*/
+PCD_HandleTypeDef hpcd;
+
+/* Enumeration reads no descriptor: the requests are built by the host task */
+USBD_DescriptorsTypeDef VCP_Desc;
+USBD_DescriptorsTypeDef MSC_Desc;
+
+static int UsbFd = -1;
+static uint8_t UsbDtr = 0;
+static double UsbRate = 0.0;
+static double UsbCredit = 0.0;
+static uint8_t InPending[USB_ENDPOINTS];
+static uint8_t OutPending[USB_ENDPOINTS];
+static NATIVE_USB_Stats_t UsbStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void USB_IRQ_Thread(void *argument);
+static void USB_Enumerate(USBD_HandleTypeDef *pdev);
+static void USB_InTransfers(USBD_HandleTypeDef *pdev);
+static void USB_OutTransfers(USBD_HandleTypeDef *pdev);
+
+/* Host ----------------------------------------------------------------------*/
+
+/**
+  * @brief  Port of the host, before USBD_Start
+  * @param  Fd: master side of the pseudo terminal (non blocking), -1 for none
+  * @param  Dtr: the host opens the port
+  * @param  Rate: bytes/s the host reads, 0 for unlimited
+  * @retval None
+  */
+void NATIVE_USB_SetPort(int Fd, uint8_t Dtr, double Rate)
+{
+  UsbFd = Fd;
+  UsbDtr = Dtr;
+  UsbRate = Rate;
+}
+
+void NATIVE_USB_GetStats(NATIVE_USB_Stats_t *Stats)
+{
+  *Stats = UsbStats;
+}
+
+/**
+  * @brief  The host and the OTG_FS interrupt
+  * @param  argument: USB device handle
+  * @retval None
+  */
+static void USB_IRQ_Thread(void *argument)
+{
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef *)argument;
+
+  vTaskDelay(USB_FRAME_MS);
+  USB_Enumerate(pdev);
+  for(;;)
+  {
+    vTaskDelay(USB_FRAME_MS);
+    UsbCredit += (UsbRate > 0.0) ? UsbRate * USB_FRAME_MS / 1000.0 : (double)USB_FRAME_MAX_BYTES;
+    if(UsbCredit > 2.0 * USB_FRAME_MAX_BYTES)
+    {
+      UsbCredit = 2.0 * USB_FRAME_MAX_BYTES;
+    }
+    USB_InTransfers(pdev);
+    USB_OutTransfers(pdev);
+  }
+}
+
+/**
+  * @brief  Bus reset, SET_ADDRESS, SET_CONFIGURATION, then the CDC
+  *         SET_CONTROL_LINE_STATE of the host opening the port
+  * @param  pdev: device handle
+  * @retval None
+  */
+static void USB_Enumerate(USBD_HandleTypeDef *pdev)
+{
+  uint8_t set_address[8] = {0x00, USB_REQ_SET_ADDRESS, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+  uint8_t set_configuration[8] = {0x00, USB_REQ_SET_CONFIGURATION, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+  uint8_t set_control_line_state[8] = {0x21, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+  USBD_LL_SetSpeed(pdev, USBD_SPEED_FULL);
+  USBD_LL_Reset(pdev);
+  USBD_LL_SetupStage(pdev, set_address);
+  USBD_LL_SetupStage(pdev, set_configuration);
+  if(UsbFd >= 0 && UsbDtr)
+  {
+    set_control_line_state[2] = 0x03;   /* DTR and RTS */
+    USBD_LL_SetupStage(pdev, set_control_line_state);
+  }
+}
+
+/**
+  * @brief  IN transfers: the bytes the host reads in this frame go to the
+  *         pseudo terminal; a full terminal NAKs. A transfer completes when
+  *         all its bytes, or its zero length packet, went out
+  * @param  pdev: device handle
+  * @retval None
+  */
+static void USB_InTransfers(USBD_HandleTypeDef *pdev)
+{
+  PCD_EPTypeDef *ep;
+  uint32_t size;
+  ssize_t n;
+  uint8_t i;
+
+  for(i = 1; i < USB_ENDPOINTS; i++)
+  {
+    ep = &hpcd.IN_ep[i];
+    if(!InPending[i] || (UsbFd < 0))
+    {
+      continue;
+    }
+    while(ep->xfer_count < ep->xfer_len && UsbCredit >= 1.0)
+    {
+      size = ep->xfer_len - ep->xfer_count;
+      if(size > (uint32_t)UsbCredit)
+      {
+        size = (uint32_t)UsbCredit;
+      }
+      n = write(UsbFd, ep->xfer_buff + ep->xfer_count, size);
+      if(n <= 0)
+      {
+        break;
+      }
+      ep->xfer_count += (uint32_t)n;
+      UsbCredit -= (double)n;
+      UsbStats.TxBytes += (uint64_t)n;
+    }
+    if(ep->xfer_count == ep->xfer_len)
+    {
+      InPending[i] = 0;
+      UsbStats.TxTransfers++;
+      USBD_LL_DataInStage(pdev, i, ep->xfer_buff);
+    }
+  }
+}
+
+/**
+  * @brief  OUT transfers: a packet of what the host wrote completes a
+  *         prepared reception
+  * @param  pdev: device handle
+  * @retval None
+  */
+static void USB_OutTransfers(USBD_HandleTypeDef *pdev)
+{
+  PCD_EPTypeDef *ep;
+  uint32_t size;
+  ssize_t n;
+  uint8_t i;
+
+  for(i = 1; i < USB_ENDPOINTS; i++)
+  {
+    ep = &hpcd.OUT_ep[i];
+    if(!OutPending[i] || (UsbFd < 0))
+    {
+      continue;
+    }
+    size = (ep->xfer_len < ep->maxpacket) ? ep->xfer_len : ep->maxpacket;
+    n = read(UsbFd, ep->xfer_buff, size);
+    if(n > 0)
+    {
+      ep->xfer_count = (uint32_t)n;
+      OutPending[i] = 0;
+      UsbStats.RxBytes += (uint64_t)n;
+      USBD_LL_DataOutStage(pdev, i, ep->xfer_buff);
+    }
+  }
+}
+
+/*******************************************************************************
+                       LL Driver Interface (USB Device Library --> PCD)
+*******************************************************************************/
+
+/**
+  * @brief  Initializes the Low Level portion of the Device driver.
+  * @param  pdev: Device handle
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
+{
+  memset(&hpcd, 0, sizeof(hpcd));
+  memset(InPending, 0, sizeof(InPending));
+  memset(OutPending, 0, sizeof(OutPending));
+  /* Link The driver to the stack */
+  hpcd.pData = pdev;
+  pdev->pData = &hpcd;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_DeInit(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  return USBD_OK;
+}
+
+/**
+  * @brief  Starts the Low Level portion of the Device driver: the host
+  *         task, at the priority of the emulated interrupts
+  * @param  pdev: Device handle
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_LL_Start(USBD_HandleTypeDef *pdev)
+{
+  if(xTaskCreate(USB_IRQ_Thread, "USB IRQ", configMINIMAL_STACK_SIZE, pdev,
+                 configNATIVE_IRQ_PRIORITY, NULL) != pdPASS)
+  {
+    return USBD_FAIL;
+  }
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Stop(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t ep_type, uint16_t ep_mps)
+{
+  PCD_EPTypeDef *ep = (ep_addr & 0x80U) ? &hpcd.IN_ep[ep_addr & 0x7FU] : &hpcd.OUT_ep[ep_addr & 0x7FU];
+
+  (void)pdev;
+  ep->num = ep_addr & 0x7FU;
+  ep->is_in = (ep_addr & 0x80U) ? 1U : 0U;
+  ep->type = ep_type;
+  ep->maxpacket = ep_mps;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  return USBD_LL_FlushEP(pdev, ep_addr);
+}
+
+USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  if(ep_addr & 0x80U)
+  {
+    InPending[ep_addr & 0x7FU] = 0;
+  }
+  else
+  {
+    OutPending[ep_addr & 0x7FU] = 0;
+  }
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  if(ep_addr & 0x80U)
+  {
+    hpcd.IN_ep[ep_addr & 0x7FU].is_stall = 1;
+  }
+  else
+  {
+    hpcd.OUT_ep[ep_addr & 0x7FU].is_stall = 1;
+  }
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  if(ep_addr & 0x80U)
+  {
+    hpcd.IN_ep[ep_addr & 0x7FU].is_stall = 0;
+  }
+  else
+  {
+    hpcd.OUT_ep[ep_addr & 0x7FU].is_stall = 0;
+  }
+  return USBD_OK;
+}
+
+uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  if(ep_addr & 0x80U)
+  {
+    return hpcd.IN_ep[ep_addr & 0x7FU].is_stall;
+  }
+  return hpcd.OUT_ep[ep_addr & 0x7FU].is_stall;
+}
+
+USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_addr)
+{
+  (void)pdev;
+  hpcd.USB_Address = dev_addr;
+  return USBD_OK;
+}
+
+/**
+  * @brief  Transmits data over an endpoint. The control endpoint has no
+  *         host reading it: its status and data stages are dropped
+  * @param  pdev: Device handle
+  * @param  ep_addr: Endpoint Number
+  * @param  pbuf: Pointer to data to be sent
+  * @param  size: Data size
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
+{
+  PCD_EPTypeDef *ep = &hpcd.IN_ep[ep_addr & 0x7FU];
+
+  (void)pdev;
+  if((ep_addr & 0x7FU) == 0U)
+  {
+    return USBD_OK;
+  }
+  ep->xfer_buff = pbuf;
+  ep->xfer_len = size;
+  ep->xfer_count = 0;
+  InPending[ep_addr & 0x7FU] = 1;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
+{
+  PCD_EPTypeDef *ep = &hpcd.OUT_ep[ep_addr & 0x7FU];
+
+  (void)pdev;
+  if((ep_addr & 0x7FU) == 0U)
+  {
+    return USBD_OK;
+  }
+  ep->xfer_buff = pbuf;
+  ep->xfer_len = size;
+  ep->xfer_count = 0;
+  OutPending[ep_addr & 0x7FU] = 1;
+  return USBD_OK;
+}
+
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  return hpcd.OUT_ep[ep_addr & 0x7FU].xfer_count;
+}
+
+void USBD_LL_Delay(uint32_t Delay)
+{
+  HAL_Delay(Delay);
+}
@@ -0,0 +1,237 @@
+/**
+  ******************************************************************************
+  * @file    st_sdlog_bench.cpp
+  * @brief   Log writes of the firmware (write buffers of datalog_writer.c and
+  *          log file of datalog_file.c) through FatFs on a disk image with
+  *          simulated card timings: sustained throughput and number of write
+  *          buffers needed at a given data rate.
+  ******************************************************************************
+  */
+#include "stlog/mapped_file.hpp"
+#include "stlog/synthetic.hpp"
+#include "datalog_file.h"
+#include "datalog_writer.h"
+#include "image_diskio.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <unistd.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-s MiB] [-k bin|csv] [-b bytes] [-n buffers] [-P MiB] [-r bytes/s]\n"
+        "          [-c us] [-t us] [-S sectors] [-T us] [-p path]\n"
+        "  -s  size of the synthetic log (default: 64 MiB)\n"
+        "  -k  kind of log (default: csv)\n"
+        "  -b  write buffer size (default: 8192)\n"
+        "  -n  number of write buffers (default: 2)\n"
+        "  -P  preallocated file size, 0 writes through FatFs (default: 64 MiB)\n"
+        "  -r  data rate of the sensors, for the buffers needed (default: none)\n"
+        "  -c  card time per command (default: 500 us)\n"
+        "  -t  card time per sector (default: 250 us)\n"
+        "  -S  written sectors between busy stalls, 0 for none (default: 8192)\n"
+        "  -T  busy stall duration (default: 100000 us)\n"
+        "  -p  image path (default: /tmp/st_sdlog_bench.img)\n",
+        argv0);
+}
+
+/// A full write buffer: when the sensors filled it and how long the card took to write it
+struct Job {
+    double ready_us;
+    std::uint64_t cost_us;
+};
+
+struct Context {
+    DATALOG_File_t* file;
+    double ready_us;
+    std::vector<Job> jobs;
+    bool ok;
+};
+
+std::uint8_t write_buffer(void* ctx, std::uint8_t* buffer, std::uint32_t size)
+{
+    auto* c = static_cast<Context*>(ctx);
+    const std::uint64_t start = IMAGE_GetStats()->time_us;
+    if (!DATALOG_File_Write(c->file, buffer, size)) {
+        c->ok = false;
+    }
+    c->jobs.push_back({c->ready_us, IMAGE_GetStats()->time_us - start});
+    return c->ok;
+}
+
+void check(FRESULT res, const char* what)
+{
+    if (res != FR_OK) {
+        throw std::runtime_error(std::string(what) + " failed: FRESULT " + std::to_string(res));
+    }
+}
+
+/// Compare the log file on the image with the log written
+void verify(const char* name, const stlog::MappedFile& log)
+{
+    FIL file;
+    check(f_open(&file, name, FA_READ), "f_open");
+    std::vector<std::uint8_t> buffer(1u << 16);
+    std::size_t offset = 0;
+    bool same = f_size(&file) == log.size();
+    while (same) {
+        UINT n = 0;
+        check(f_read(&file, buffer.data(), UINT(buffer.size()), &n), "f_read");
+        if (n == 0) {
+            break;
+        }
+        same = std::memcmp(buffer.data(), log.data() + offset, n) == 0;
+        offset += n;
+    }
+    f_close(&file);
+    if (!same || offset != log.size()) {
+        throw std::runtime_error("the log file on the image differs from the log written");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::uint64_t size_mib = 64;
+    std::string kind_name = "csv";
+    std::uint32_t buffer_size = 8192;
+    unsigned buffers = 2;
+    std::uint64_t prealloc_mib = 64;
+    double rate = 0;
+    IMAGE_Latency_t latency = {500, 250, 8192, 100000};
+    std::string path = "/tmp/st_sdlog_bench.img";
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "s:k:b:n:P:r:c:t:S:T:p:h")) != -1) {
+        switch (opt) {
+        case 's': size_mib = std::strtoull(optarg, nullptr, 10); break;
+        case 'k': kind_name = optarg; break;
+        case 'b': buffer_size = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'n': buffers = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'P': prealloc_mib = std::strtoull(optarg, nullptr, 10); break;
+        case 'r': rate = std::strtod(optarg, nullptr); break;
+        case 'c': latency.command_us = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 't': latency.sector_us = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'S': latency.stall_sectors = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'T': latency.stall_us = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'p': path = optarg; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (buffer_size == 0 || buffer_size % DATALOG_SECTOR_SIZE != 0 || buffers < 2 || buffers > 255) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const stlog::LogKind kind = (kind_name == "bin") ? stlog::LogKind::Binary : stlog::LogKind::Csv;
+    const char* name = (kind == stlog::LogKind::Binary) ? "SensorTile_Log_N000.bin" : "SensorTile_Log_N000.csv";
+
+    char drive[4];
+    try {
+        const std::string log_path = path + ".log";
+        stlog::write_synthetic_log(log_path, kind, size_mib << 20);
+        stlog::MappedFile log(log_path);
+        const auto requests = stlog::split_write_requests(log.data(), log.size(), kind);
+
+        // Room for the log, its preallocation and the file system
+        const std::uint64_t image_bytes = std::max<std::uint64_t>(log.size(), prealloc_mib << 20) + (64u << 20);
+        if (IMAGE_Open(path.c_str(), std::uint32_t(image_bytes / DATALOG_SECTOR_SIZE), &latency) != 0) {
+            throw std::runtime_error("cannot map " + path + ": " + std::strerror(errno));
+        }
+        if (FATFS_LinkDriver(&IMAGE_Driver, drive) != 0) {
+            throw std::runtime_error("FATFS_LinkDriver failed");
+        }
+        std::vector<std::uint8_t> work(_MAX_SS * 64);
+        check(f_mkfs(drive, FM_ANY, 0, work.data(), UINT(work.size())), "f_mkfs");
+        FATFS fs;
+        check(f_mount(&fs, drive, 1), "f_mount");
+        IMAGE_ResetStats();
+
+        auto start = std::chrono::steady_clock::now();
+        DATALOG_File_t file;
+        if (!DATALOG_File_Open(&file, name, FSIZE_t(prealloc_mib << 20))) {
+            throw std::runtime_error("cannot create the log file");
+        }
+        const bool expanded = file.expanded;
+        std::vector<std::uint32_t> storage(std::size_t(buffer_size) * buffers / sizeof(std::uint32_t));
+        Context ctx{&file, 0.0, {}, true};
+        DATALOG_Writer_t writer;
+        DATALOG_Writer_Init(&writer, reinterpret_cast<std::uint8_t*>(storage.data()), buffer_size,
+                            std::uint8_t(buffers), write_buffer, &ctx);
+        for (const auto& req : requests) {
+            ctx.ready_us = rate > 0 ? double(req.offset + req.size) * 1e6 / rate : 0.0;
+            DATALOG_Writer_Write(&writer, log.data() + req.offset, std::uint32_t(req.size));
+        }
+        std::uint32_t last_size;
+        std::uint8_t* last = DATALOG_Writer_Take(&writer, &last_size);
+        if (last_size > 0) {
+            write_buffer(&ctx, last, last_size);
+        }
+        ctx.ok = DATALOG_File_Close(&file) && ctx.ok;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (!ctx.ok) {
+            throw std::runtime_error("log write failed");
+        }
+        const IMAGE_Stats_t stats = *IMAGE_GetStats();
+        verify(name, log);
+
+        std::printf("log        %.1f MiB %s, %zu writes, %s\n", double(log.size()) / (1u << 20), kind_name.c_str(),
+                    requests.size(), expanded ? "preallocated" : "through FatFs");
+        std::printf("card       %llu write commands (%.1f sectors/command), %llu read commands, %llu stalls, "
+                    "longest write %.1f ms\n",
+                    static_cast<unsigned long long>(stats.write_commands),
+                    double(stats.write_sectors) / double(stats.write_commands),
+                    static_cast<unsigned long long>(stats.read_commands),
+                    static_cast<unsigned long long>(stats.stalls), stats.max_write_us / 1000.0);
+        std::printf("sustained  %.3f s card time, %.2f MB/s\n", stats.time_us / 1e6,
+                    double(log.size()) / double(stats.time_us));
+
+        if (rate > 0) {
+            // The writer task takes the buffers in order; the sensors need a
+            // free buffer each time one fills up
+            std::deque<double> queued;
+            double done = 0.0;
+            double backlog = 0.0;
+            std::size_t needed = 0;
+            for (const auto& job : ctx.jobs) {
+                while (!queued.empty() && queued.front() <= job.ready_us) {
+                    queued.pop_front();
+                }
+                done = std::max(done, job.ready_us) + double(job.cost_us);
+                queued.push_back(done);
+                backlog = std::max(backlog, done - job.ready_us);
+                needed = std::max(needed, queued.size() + 1);
+            }
+            std::printf("at %.0f B/s  %zu buffers of %u bytes needed (%u configured), longest backlog %.1f ms%s\n",
+                        rate, needed, buffer_size, buffers, backlog / 1000.0,
+                        done > double(log.size()) * 1e6 / rate * 1.01 ? ", the card is too slow" : "");
+        }
+        std::printf("host       %.1f MB/s\n", double(log.size()) / 1e6 / elapsed.count());
+
+        f_mount(nullptr, drive, 0);
+        FATFS_UnLinkDriver(drive);
+        IMAGE_Close();
+        ::unlink(log_path.c_str());
+        ::unlink(path.c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,272 @@
+/**
+  ******************************************************************************
+  * @file    image_diskio.c
+  * @brief   FatFs disk I/O driver on a memory mapped image file, with the
+  *          same interface as sd_diskio.c, to run the storage code of the
+  *          firmware on a Linux host.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 200809L   /* ftruncate, mmap */
+#include "image_diskio.h"
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define IMAGE_SECTOR_SIZE 512U
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t *Image = NULL;
+static uint32_t ImageSectors;
+static IMAGE_Latency_t Latency;
+static IMAGE_Stats_t Stats;
+static uint32_t SectorsToStall;
+static volatile DSTATUS Stat = STA_NOINIT;
+
+/* Private function prototypes -----------------------------------------------*/
+DSTATUS IMAGE_initialize (BYTE);
+DSTATUS IMAGE_status (BYTE);
+DRESULT IMAGE_read (BYTE, BYTE*, DWORD, UINT);
+#if _USE_WRITE == 1
+  DRESULT IMAGE_write (BYTE, const BYTE*, DWORD, UINT);
+#endif /* _USE_WRITE == 1 */
+#if _USE_IOCTL == 1
+  DRESULT IMAGE_ioctl (BYTE, BYTE, void*);
+#endif  /* _USE_IOCTL == 1 */
+
+const Diskio_drvTypeDef  IMAGE_Driver =
+{
+  IMAGE_initialize,
+  IMAGE_status,
+  IMAGE_read,
+#if  _USE_WRITE == 1
+  IMAGE_write,
+#endif /* _USE_WRITE == 1 */
+
+#if  _USE_IOCTL == 1
+  IMAGE_ioctl,
+#endif /* _USE_IOCTL == 1 */
+};
+
+/**
+  * @brief  Map an image file, created or resized to the given size
+  * @param  path: image file
+  * @param  sectors: size of the image in sectors
+  * @param  latency: card timings, NULL for none
+  * @retval 0 on success, -1 with errno set on error
+  */
+int IMAGE_Open(const char *path, uint32_t sectors, const IMAGE_Latency_t *latency)
+{
+  const size_t size = (size_t)sectors * IMAGE_SECTOR_SIZE;
+  void *map;
+  int fd;
+
+  IMAGE_Close();
+  fd = open(path, O_RDWR | O_CREAT, 0644);
+  if(fd < 0)
+  {
+    return -1;
+  }
+  if(ftruncate(fd, (off_t)size) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+  map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    return -1;
+  }
+
+  Image = (uint8_t *)map;
+  ImageSectors = sectors;
+  if(latency != NULL)
+  {
+    Latency = *latency;
+  }
+  else
+  {
+    memset(&Latency, 0, sizeof(Latency));
+  }
+  IMAGE_ResetStats();
+  return 0;
+}
+
+/**
+  * @brief  Unmap the image, the data stays in the file
+  * @retval None
+  */
+void IMAGE_Close(void)
+{
+  if(Image != NULL)
+  {
+    munmap(Image, (size_t)ImageSectors * IMAGE_SECTOR_SIZE);
+    Image = NULL;
+  }
+  Stat = STA_NOINIT;
+}
+
+/**
+  * @brief  Commands and simulated card time since the last reset
+  * @retval Statistics
+  */
+const IMAGE_Stats_t *IMAGE_GetStats(void)
+{
+  return &Stats;
+}
+
+/**
+  * @brief  Clear the statistics and restart the stall period
+  * @retval None
+  */
+void IMAGE_ResetStats(void)
+{
+  memset(&Stats, 0, sizeof(Stats));
+  SectorsToStall = Latency.stall_sectors;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Initializes a Drive
+  * @param  lun : not used
+  * @retval DSTATUS: Operation status
+  */
+DSTATUS IMAGE_initialize(BYTE lun)
+{
+  (void)lun;
+  Stat = (Image != NULL) ? 0 : STA_NOINIT;
+  return Stat;
+}
+
+/**
+  * @brief  Gets Disk Status
+  * @param  lun : not used
+  * @retval DSTATUS: Operation status
+  */
+DSTATUS IMAGE_status(BYTE lun)
+{
+  (void)lun;
+  return Stat;
+}
+
+/**
+  * @brief  Reads Sector(s)
+  * @param  lun : not used
+  * @param  *buff: Data buffer to store read data
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to read
+  * @retval DRESULT: Operation result
+  */
+DRESULT IMAGE_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+  (void)lun;
+  if(Stat & STA_NOINIT) return RES_NOTRDY;
+  if(((uint64_t)sector + count) > ImageSectors) return RES_PARERR;
+
+  memcpy(buff, &Image[(size_t)sector * IMAGE_SECTOR_SIZE], (size_t)count * IMAGE_SECTOR_SIZE);
+  Stats.read_commands++;
+  Stats.read_sectors += count;
+  Stats.time_us += Latency.command_us + (uint64_t)Latency.sector_us * count;
+  return RES_OK;
+}
+
+/**
+  * @brief  Writes Sector(s)
+  * @param  lun : not used
+  * @param  *buff: Data to be written
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write
+  * @retval DRESULT: Operation result
+  */
+#if _USE_WRITE == 1
+DRESULT IMAGE_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+  uint64_t time_us;
+
+  (void)lun;
+  if(Stat & STA_NOINIT) return RES_NOTRDY;
+  if(((uint64_t)sector + count) > ImageSectors) return RES_PARERR;
+
+  memcpy(&Image[(size_t)sector * IMAGE_SECTOR_SIZE], buff, (size_t)count * IMAGE_SECTOR_SIZE);
+  time_us = Latency.command_us + (uint64_t)Latency.sector_us * count;
+
+  /* The card stays busy a long time every stall_sectors written sectors,
+     e.g. for its internal garbage collection */
+  if(Latency.stall_sectors > 0)
+  {
+    UINT left = count;
+
+    while(left >= SectorsToStall)
+    {
+      left -= SectorsToStall;
+      SectorsToStall = Latency.stall_sectors;
+      time_us += Latency.stall_us;
+      Stats.stalls++;
+    }
+    SectorsToStall -= left;
+  }
+
+  Stats.write_commands++;
+  Stats.write_sectors += count;
+  Stats.time_us += time_us;
+  if(time_us > Stats.max_write_us)
+  {
+    Stats.max_write_us = (uint32_t)time_us;
+  }
+  return RES_OK;
+}
+#endif /* _USE_WRITE == 1 */
+
+/**
+  * @brief  I/O control operation
+  * @param  lun : not used
+  * @param  cmd: Control code
+  * @param  *buff: Buffer to send/receive control data
+  * @retval DRESULT: Operation result
+  */
+#if _USE_IOCTL == 1
+DRESULT IMAGE_ioctl(BYTE lun, BYTE cmd, void *buff)
+{
+  DRESULT res = RES_ERROR;
+
+  (void)lun;
+  if (Stat & STA_NOINIT) return RES_NOTRDY;
+
+  switch (cmd)
+  {
+  /* The mapping is written back by the kernel */
+  case CTRL_SYNC :
+    res = RES_OK;
+    break;
+
+  /* Get number of sectors on the disk (DWORD) */
+  case GET_SECTOR_COUNT :
+    *(DWORD*)buff = ImageSectors;
+    res = RES_OK;
+    break;
+
+  /* Get R/W sector size (WORD) */
+  case GET_SECTOR_SIZE :
+    *(WORD*)buff = IMAGE_SECTOR_SIZE;
+    res = RES_OK;
+    break;
+
+  /* Get erase block size in unit of sector (DWORD): the stall period stands
+     for the allocation unit of the card, 1 when unknown */
+  case GET_BLOCK_SIZE :
+    *(DWORD*)buff = (Latency.stall_sectors > 0) ? Latency.stall_sectors : 1;
+    res = RES_OK;
+    break;
+
+  default:
+    res = RES_PARERR;
+  }
+
+  return res;
+}
+#endif /* _USE_IOCTL == 1 */
@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    image_diskio.h
+  * @brief   Header for image_diskio.c module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMAGE_DISKIO_H
+#define __IMAGE_DISKIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ff_gen_drv.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Time the card takes for each command, added to a simulated clock
+  *         instead of slept, so a benchmark gives the same result on any
+  *         machine.
+  */
+typedef struct
+{
+  uint32_t command_us;      /* overhead of each read or write command */
+  uint32_t sector_us;       /* transfer and programming of one sector */
+  uint32_t stall_sectors;   /* written sectors between two long busy stalls, 0 for none;
+                               reported as the erase block size (allocation unit) */
+  uint32_t stall_us;        /* duration of a busy stall */
+} IMAGE_Latency_t;
+
+typedef struct
+{
+  uint64_t time_us;         /* simulated card time */
+  uint64_t read_commands;
+  uint64_t read_sectors;
+  uint64_t write_commands;
+  uint64_t write_sectors;
+  uint64_t stalls;
+  uint32_t max_write_us;    /* longest write command */
+} IMAGE_Stats_t;
+
+/* Exported variables --------------------------------------------------------*/
+extern const Diskio_drvTypeDef IMAGE_Driver;
+
+/* Exported functions ------------------------------------------------------- */
+int IMAGE_Open(const char *path, uint32_t sectors, const IMAGE_Latency_t *latency);
+void IMAGE_Close(void);
+const IMAGE_Stats_t *IMAGE_GetStats(void);
+void IMAGE_ResetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMAGE_DISKIO_H */
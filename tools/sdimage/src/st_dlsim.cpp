@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file    st_dlsim.cpp
+  * @brief   Simulated SensorTile serving the log download protocol of the
+  *          firmware (datalog_download.c) on an SD card image, behind a
+  *          pseudo terminal that st_logfetch opens like the USB CDC port.
+  *          The link is throttled to the USB rate, and chunks can be
+  *          corrupted or lost to exercise the retries of the host.
+  ******************************************************************************
+  */
+#include "datalog_download.h"
+#include "image_diskio.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-c bytes] [-b bytes] [-r bytes/s] [-e rate] [-d rate] [-l link] [-1] <card image>\n"
+        "  serves the files of the image on a pseudo terminal, whose path is printed\n"
+        "  -c  chunk size, multiple of 4 (default: 4096)\n"
+        "  -b  read buffer size, the SD write buffers of the firmware (default: 16384)\n"
+        "  -r  link rate, 0 for unlimited (default: 1000000, USB full speed CDC)\n"
+        "  -e  probability that a chunk payload is corrupted (default: 0)\n"
+        "  -d  probability that a chunk frame is lost (default: 0)\n"
+        "  -l  symbolic link to the pseudo terminal, removed on exit\n"
+        "  -1  exit after the first session ended by the host\n",
+        argv0);
+}
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> stop{false};
+
+void on_signal(int)
+{
+    stop = true;
+}
+
+/// Master side of the pseudo terminal, with the link model
+struct Link {
+    int fd = -1;
+    double rate = 0;
+    double corrupt = 0;
+    double lose = 0;
+    std::mt19937 rng{1};
+    Clock::time_point free_at = Clock::now();
+    bool chunk_payload = false;   // the next write is the payload of a CHUNK frame
+    bool drop_payload = false;
+    std::uint64_t corrupted = 0;
+    std::uint64_t lost = 0;
+};
+
+Link link_state;
+
+std::uint32_t link_read(std::uint8_t* buf, std::uint32_t size)
+{
+    ssize_t n = ::read(link_state.fd, buf, size);
+    return n > 0 ? std::uint32_t(n) : 0;
+}
+
+std::uint8_t link_write(const std::uint8_t* buf, std::uint32_t size)
+{
+    Link& l = link_state;
+    std::uniform_real_distribution<double> draw(0.0, 1.0);
+    std::vector<std::uint8_t> copy;
+
+    // The device writes each header, then its payload
+    if (l.chunk_payload) {
+        l.chunk_payload = false;
+        if (l.drop_payload) {
+            return 1;
+        }
+        if (l.corrupt > 0 && draw(l.rng) < l.corrupt) {
+            copy.assign(buf, buf + size);
+            copy[std::uniform_int_distribution<std::uint32_t>(0, size - 1)(l.rng)] ^= 0x55;
+            buf = copy.data();
+            l.corrupted++;
+        }
+    } else if (size == DATALOG_DL_HEADER_SIZE) {
+        DATALOG_DL_Header_t h;
+        std::memcpy(&h, buf, sizeof(h));
+        if (h.magic == DATALOG_DL_MAGIC && h.type == DATALOG_DL_FRM_CHUNK && h.size > 0) {
+            l.chunk_payload = true;
+            l.drop_payload = l.lose > 0 && draw(l.rng) < l.lose;
+            if (l.drop_payload) {
+                l.lost++;
+                return 1;
+            }
+        }
+    }
+
+    // Bytes leave at the link rate
+    if (l.rate > 0) {
+        const auto now = Clock::now();
+        if (l.free_at < now) {
+            l.free_at = now;
+        }
+        l.free_at += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(size / l.rate));
+        // Headers are shorter than a sleep, they only move the link clock
+        if (l.free_at - now > std::chrono::milliseconds(1)) {
+            std::this_thread::sleep_until(l.free_at);
+        }
+    }
+
+    while (size > 0) {
+        ssize_t n = ::write(l.fd, buf, size);
+        if (n > 0) {
+            buf += n;
+            size -= std::uint32_t(n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return 0;
+        }
+        // The host does not read: give up like CDC_Write
+        struct pollfd pfd {l.fd, POLLOUT, 0};
+        if (::poll(&pfd, 1, int(DATALOG_DL_ACK_TIMEOUT_MS)) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+std::uint32_t link_tick()
+{
+    return std::uint32_t(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count());
+}
+
+void link_wait()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::uint32_t chunk = 4096;
+    std::uint32_t buffer_size = 16384;
+    double rate = 1e6;
+    double corrupt = 0;
+    double lose = 0;
+    std::string link_path;
+    bool once = false;
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "c:b:r:e:d:l:1h")) != -1) {
+        switch (opt) {
+        case 'c': chunk = std::uint32_t(std::strtoul(optarg, nullptr, 10)); break;
+        case 'b': buffer_size = std::uint32_t(std::strtoul(optarg, nullptr, 10)); break;
+        case 'r': rate = std::strtod(optarg, nullptr); break;
+        case 'e': corrupt = std::strtod(optarg, nullptr); break;
+        case 'd': lose = std::strtod(optarg, nullptr); break;
+        case 'l': link_path = optarg; break;
+        case '1': once = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || chunk == 0 || chunk % 4 != 0 || chunk > DATALOG_DL_PAYLOAD_MAX ||
+        buffer_size < chunk || rate < 0 || corrupt < 0 || corrupt > 1 || lose < 0 || lose > 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char* path = argv[optind];
+
+    struct stat st;
+    if (::stat(path, &st) != 0 || st.st_size < 512 || st.st_size % 512 != 0) {
+        std::fprintf(stderr, "%s is not a card image\n", path);
+        return EXIT_FAILURE;
+    }
+    if (IMAGE_Open(path, std::uint32_t(st.st_size / 512), nullptr) != 0) {
+        std::fprintf(stderr, "cannot map %s: %s\n", path, std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    char drive[4];
+    FATFS fs;
+    if (FATFS_LinkDriver(&IMAGE_Driver, drive) != 0 || f_mount(&fs, drive, 1) != FR_OK) {
+        std::fprintf(stderr, "no FAT file system on %s\n", path);
+        IMAGE_Close();
+        return EXIT_FAILURE;
+    }
+
+    // The slave stays open here: raw from the start, and no hang up between hosts
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    int slave = -1;
+    const char* name = nullptr;
+    if (master >= 0 && ::grantpt(master) == 0 && ::unlockpt(master) == 0) {
+        name = ::ptsname(master);
+        slave = name ? ::open(name, O_RDWR | O_NOCTTY) : -1;
+    }
+    struct termios tio {};
+    if (slave < 0 || ::tcgetattr(slave, &tio) != 0) {
+        std::fprintf(stderr, "cannot create a pseudo terminal: %s\n", std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    ::cfmakeraw(&tio);
+    ::tcsetattr(slave, TCSANOW, &tio);
+    if (!link_path.empty() && ::symlink(name, link_path.c_str()) != 0) {
+        std::fprintf(stderr, "cannot link %s: %s\n", link_path.c_str(), std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    std::printf("%s\n", name);
+    std::fflush(stdout);
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    link_state.fd = master;
+    link_state.rate = rate;
+    link_state.corrupt = corrupt;
+    link_state.lose = lose;
+    const DATALOG_DL_Link_t link = {link_read, link_write, link_tick, link_wait};
+    std::vector<std::uint32_t> buffer(buffer_size / sizeof(std::uint32_t));
+
+    while (!stop) {
+        if (DATALOG_Download_Session(&link, drive, reinterpret_cast<std::uint8_t*>(buffer.data()),
+                                     std::uint32_t(buffer.size() * sizeof(std::uint32_t)), chunk) &&
+            once) {
+            break;
+        }
+    }
+
+    const IMAGE_Stats_t* s = IMAGE_GetStats();
+    std::fprintf(stderr, "card: %llu read commands, %.1f sectors per command; link: %llu chunks corrupted, %llu lost\n",
+                 static_cast<unsigned long long>(s->read_commands),
+                 s->read_commands ? double(s->read_sectors) / double(s->read_commands) : 0.0,
+                 static_cast<unsigned long long>(link_state.corrupted),
+                 static_cast<unsigned long long>(link_state.lost));
+    if (!link_path.empty()) {
+        ::unlink(link_path.c_str());
+    }
+    ::close(slave);
+    ::close(master);
+    f_mount(nullptr, drive, 0);
+    FATFS_UnLinkDriver(drive);
+    IMAGE_Close();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file    st_sdrecover.cpp
+  * @brief   Recover the SensorTile logs cut by a power loss on an SD card
+  *          image (e.g. read with dd), with the recovery code of the firmware
+  *          (datalog_recover.c): the binary blocks or CSV lines written
+  *          after the last sync are added back to the files and the unused
+  *          preallocated clusters freed.
+  ******************************************************************************
+  */
+#include "datalog_format.h"
+#include "datalog_recover.h"
+#include "image_diskio.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr const char* log_prefix = "SensorTile_Log_N";
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s <card image> [log file...]\n"
+        "  recovers the given log files, by default all the %s files of the root directory\n",
+        argv0, log_prefix);
+}
+
+/// Log files in the root directory of the mounted image
+std::vector<std::string> list_logs(const char* drive)
+{
+    std::vector<std::string> names;
+    DIR dir;
+    FILINFO info;
+    if (f_opendir(&dir, drive) != FR_OK) {
+        return names;
+    }
+    while (f_readdir(&dir, &info) == FR_OK && info.fname[0] != 0) {
+        if (std::strncmp(info.fname, log_prefix, std::strlen(log_prefix)) == 0) {
+            names.emplace_back(info.fname);
+        }
+    }
+    f_closedir(&dir);
+    return names;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int opt;
+    while ((opt = ::getopt(argc, argv, "h")) != -1) {
+        usage(argv[0]);
+        return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char* path = argv[optind];
+
+    struct stat st;
+    if (::stat(path, &st) != 0) {
+        std::fprintf(stderr, "cannot use %s: %s\n", path, std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (st.st_size < 512 || st.st_size % 512 != 0) {
+        std::fprintf(stderr, "%s is not a whole number of sectors\n", path);
+        return EXIT_FAILURE;
+    }
+    if (IMAGE_Open(path, std::uint32_t(st.st_size / 512), nullptr) != 0) {
+        std::fprintf(stderr, "cannot map %s: %s\n", path, std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+    char drive[4];
+    FATFS fs;
+    if (FATFS_LinkDriver(&IMAGE_Driver, drive) != 0 || f_mount(&fs, drive, 1) != FR_OK) {
+        std::fprintf(stderr, "no FAT file system on %s\n", path);
+        IMAGE_Close();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> names(argv + optind + 1, argv + argc);
+    if (names.empty()) {
+        names = list_logs(drive);
+    }
+
+    // One block of the largest size a log can use
+    std::vector<std::uint32_t> buffer(DATALOG_BLOCK_SIZE_MAX / sizeof(std::uint32_t));
+    int status = EXIT_SUCCESS;
+    for (const auto& name : names) {
+        FSIZE_t recovered = 0;
+        if (!DATALOG_Recover(name.c_str(), reinterpret_cast<std::uint8_t*>(buffer.data()),
+                             std::uint32_t(buffer.size() * sizeof(std::uint32_t)), &recovered)) {
+            std::fprintf(stderr, "%s: recovery failed\n", name.c_str());
+            status = EXIT_FAILURE;
+            continue;
+        }
+        std::printf("%s: %llu bytes recovered\n", name.c_str(), static_cast<unsigned long long>(recovered));
+    }
+
+    f_mount(nullptr, drive, 0);
+    FATFS_UnLinkDriver(drive);
+    IMAGE_Close();
+    return status;
+}
@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    SensorTile_conf.h
+  * @brief   BSP configuration of the SD card SPI test: the SD driver options
+  *          of bsp/config/SensorTile_conf.h, without the RTOS.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SENSORTILE_CONF_H__
+#define __SENSORTILE_CONF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+
+/* SD card driver: the card busy and the DMA completion are polled, there is
+   no scheduler */
+#define USE_SD_RTOS_WAIT                   0U
+
+/* SD card driver: write latency histograms, timed with the bus time */
+#define USE_SD_LATENCY_STATS               1U
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SENSORTILE_CONF_H__*/
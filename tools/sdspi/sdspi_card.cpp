@@ -0,0 +1,376 @@
+/**
+  ******************************************************************************
+  * @file    sdspi_card.cpp
+  * @brief   Emulated SDHC card in SPI mode and the SD_IO_* link functions of
+  *          the BSP over it, with the same byte sequences as
+  *          bsp/SensorTile/SensorTile.c.
+  ******************************************************************************
+  */
+#include "sdspi_card.hpp"
+
+#include "SensorTile_sd.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace stsd {
+
+SpiCard::SpiCard(std::uint32_t blocks)
+    : memory_(std::size_t(blocks) * block_size, 0)
+{
+}
+
+void SpiCard::clear_log()
+{
+    commands_.clear();
+    blocks_.clear();
+    violations_.clear();
+    stop_tokens_ = 0;
+    pre_erase_ = 0;
+}
+
+void SpiCard::select(bool selected)
+{
+    selected_ = selected;
+    if (!selected && state_ == State::Command) {
+        state_ = State::Idle;
+    }
+}
+
+void SpiCard::violation(const std::string& what)
+{
+    violations_.push_back(what);
+}
+
+std::uint8_t SpiCard::exchange(std::uint8_t mosi)
+{
+    std::uint8_t miso = 0xFF;
+    bool busy = false;
+
+    now_us_++;
+    if (!selected_) {
+        return 0xFF;
+    }
+    if (!out_.empty()) {
+        miso = out_.front();
+        out_.pop_front();
+    } else if (busy_ > 0) {
+        miso = 0x00;
+        busy = true;
+        busy_--;
+    }
+
+    if (busy && mosi != 0xFF) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "0x%02X sent while the card is busy", mosi);
+        violation(text);
+        return miso;
+    }
+
+    switch (state_) {
+    case State::Idle:
+        if ((mosi & 0xC0) == 0x40) {
+            frame_[0] = mosi;
+            frame_len_ = 1;
+            state_ = State::Command;
+        }
+        break;
+    case State::Command:
+        frame_[frame_len_++] = mosi;
+        if (frame_len_ == sizeof(frame_)) {
+            state_ = State::Idle;
+            execute();
+        }
+        break;
+    case State::WaitToken:
+        if (mosi == 0xFF) {
+            break;
+        }
+        if (mosi == (multiple_ ? 0xFC : 0xFE)) {
+            token_ = mosi;
+            block_.clear();
+            state_ = State::Data;
+        } else if (multiple_ && mosi == 0xFD) {
+            // Stop Tran: one byte, then busy until the last block is programmed
+            stop_tokens_++;
+            out_.push_back(0xFF);
+            busy_ = faults.stuck_busy ? UINT64_MAX : stop_busy_bytes;
+            state_ = State::Idle;
+        } else {
+            char text[64];
+            std::snprintf(text, sizeof(text), "0x%02X instead of a start token", mosi);
+            violation(text);
+            if ((mosi & 0xC0) == 0x40) {
+                frame_[0] = mosi;
+                frame_len_ = 1;
+                state_ = State::Command;
+            }
+        }
+        break;
+    case State::Data:
+        block_.push_back(mosi);
+        if (block_.size() == block_size + 2) {
+            end_block();
+        }
+        break;
+    }
+    return miso;
+}
+
+void SpiCard::execute()
+{
+    const Command cmd{std::uint8_t(frame_[0] & 0x3F), app_,
+                      (std::uint32_t(frame_[1]) << 24) | (std::uint32_t(frame_[2]) << 16) |
+                          (std::uint32_t(frame_[3]) << 8) | frame_[4]};
+    const std::uint8_t r1_idle = idle_ ? 0x01 : 0x00;
+
+    commands_.push_back(cmd);
+    app_ = false;
+    out_.clear();
+
+    if (!cmd.app) {
+        switch (cmd.index) {
+        case 0:     // GO_IDLE_STATE
+            idle_ = true;
+            op_cond_polls_ = 0;
+            respond(0x01);
+            return;
+        case 8:     // SEND_IF_COND, R7 echoes the voltage and check pattern
+            respond(r1_idle);
+            out_.insert(out_.end(), {0x00, 0x00, std::uint8_t((cmd.arg >> 8) & 0x0F), std::uint8_t(cmd.arg)});
+            return;
+        case 55:    // APP_CMD
+            app_ = true;
+            respond(r1_idle);
+            return;
+        case 58:    // READ_OCR, powered up and high capacity
+            respond(r1_idle);
+            out_.insert(out_.end(), {0xC0, 0xFF, 0x80, 0x00});
+            return;
+        case 24:    // WRITE_BLOCK
+        case 25:    // WRITE_MULTIPLE_BLOCK
+            if (idle_) {
+                violation("write command before the end of the initialization");
+            }
+            if (cmd.arg >= memory_.size() / block_size) {
+                respond(0x40);  // address error
+                return;
+            }
+            respond(0x00);
+            multiple_ = (cmd.index == 25);
+            pre_erase_ = multiple_ ? set_pre_erase_ : 0;
+            set_pre_erase_ = 0;
+            address_ = cmd.arg;
+            transaction_block_ = 0;
+            state_ = State::WaitToken;
+            return;
+        default:
+            break;
+        }
+    } else {
+        switch (cmd.index) {
+        case 41:    // SD_SEND_OP_COND, ready at the second poll
+            if (++op_cond_polls_ >= 2) {
+                idle_ = false;
+            }
+            respond(idle_ ? 0x01 : 0x00);
+            return;
+        case 23:    // SET_WR_BLK_ERASE_COUNT
+            if (faults.refuse_acmd23) {
+                respond(0x04 | r1_idle);
+                return;
+            }
+            set_pre_erase_ = cmd.arg & 0x7FFFFF;
+            respond(r1_idle);
+            return;
+        default:
+            break;
+        }
+    }
+    respond(0x04 | r1_idle);    // illegal command
+}
+
+void SpiCard::end_block()
+{
+    const int index = int(transaction_block_++);
+    DataBlock rec{token_, address_, 0};
+
+    state_ = multiple_ ? State::WaitToken : State::Idle;
+    if (index == faults.mute_block) {
+        // No data response: the card lost the block and waits for the next command
+        faults.mute_block = -1;
+        state_ = State::Idle;
+    } else if (index == faults.reject_block) {
+        // Rejected, nothing to program: the card waits for the stop token
+        faults.reject_block = -1;
+        rec.response = std::uint8_t(0xE0 | faults.reject_response);
+        out_.push_back(rec.response);
+    } else if (address_ >= memory_.size() / block_size) {
+        rec.response = 0xED;
+        out_.push_back(rec.response);
+    } else {
+        std::memcpy(&memory_[std::size_t(address_) * block_size], block_.data(), block_size);
+        rec.response = 0xE5;
+        out_.push_back(rec.response);
+        busy_ = busy_bytes;
+        address_++;
+    }
+    blocks_.push_back(rec);
+}
+
+namespace {
+SpiCard* card = nullptr;
+}
+
+void attach(SpiCard* c)
+{
+    card = c;
+}
+
+} // namespace stsd
+
+using stsd::card;
+
+GPIO_TypeDef SdSpiGPIOG;
+DWT_Type SdSpiDWT;
+CoreDebug_Type SdSpiCoreDebug;
+uint32_t SystemCoreClock = 80000000U;
+SPI_HandleTypeDef SPI_SD_Handle;
+
+namespace {
+
+void sync_cycles()
+{
+    SdSpiDWT.CYCCNT = std::uint32_t(card->now_us() * (SystemCoreClock / 1000000U));
+}
+
+std::uint8_t xfer(std::uint8_t mosi)
+{
+    const std::uint8_t miso = card->exchange(mosi);
+    sync_cycles();
+    return miso;
+}
+
+} // namespace
+
+extern "C" {
+
+/* The tick does not advance, as in the USB interrupt of the mass storage
+   mode: the driver times its waits with the cycle counter */
+uint32_t HAL_GetTick(void)
+{
+    return 0;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    card->advance_us(std::uint64_t(Delay) * 1000U);
+    sync_cycles();
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState == GPIO_PIN_SET) {
+        GPIOx->ODR |= GPIO_Pin;
+    } else {
+        GPIOx->ODR &= ~std::uint32_t(GPIO_Pin);
+    }
+    if (GPIOx == SENSORTILE_SD_CS_GPIO_PORT && GPIO_Pin == SENSORTILE_SD_CS_PIN) {
+        card->select(PinState == GPIO_PIN_RESET);
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    return HAL_OK;
+}
+
+void SD_IO_Init(void)
+{
+    SENSORTILE_SD_CS_HIGH();
+    for (int counter = 0; counter <= 9; counter++) {
+        SD_IO_WriteByte(SENSORTILE_SD_DUMMY_BYTE);
+    }
+}
+
+void SD_IO_Init_LS(void)
+{
+    SD_IO_Init();
+}
+
+void SD_IO_WriteByte(uint8_t Data)
+{
+    xfer(Data);
+}
+
+uint8_t SD_IO_ReadByte(void)
+{
+    return xfer(SENSORTILE_SD_DUMMY_BYTE);
+}
+
+void SD_IO_WriteDMA(uint8_t *pData, uint16_t Size)
+{
+    for (uint16_t i = 0; i < Size; i++) {
+        xfer(pData[i]);
+    }
+    HAL_SPI_TxCpltCallback(&SPI_SD_Handle);
+}
+
+void SD_IO_ReadDMA(uint8_t *pData, uint16_t Size)
+{
+    for (uint16_t i = 0; i < Size; i++) {
+        pData[i] = xfer(SENSORTILE_SD_DUMMY_BYTE);
+    }
+    HAL_SPI_TxRxCpltCallback(&SPI_SD_Handle);
+}
+
+static void SD_IO_SendFrame(uint8_t Cmd, uint32_t Arg, uint8_t Crc)
+{
+    const uint8_t frame[6] = {uint8_t(Cmd | 0x40), uint8_t(Arg >> 24), uint8_t(Arg >> 16),
+                              uint8_t(Arg >> 8), uint8_t(Arg), Crc};
+
+    SENSORTILE_SD_CS_LOW();
+    for (uint8_t byte : frame) {
+        SD_IO_WriteByte(byte);
+    }
+}
+
+uint8_t SD_IO_WriteCmd_wResp(uint8_t Cmd, uint32_t Arg, uint8_t Crc)
+{
+    uint32_t n = 10;
+    uint8_t resp;
+
+    SD_IO_SendFrame(Cmd, Arg, Crc);
+    do {
+        resp = SD_IO_ReadByte();
+    } while ((resp & 0x80) && --n);
+    return resp;
+}
+
+HAL_StatusTypeDef SD_IO_WriteCmd(uint8_t Cmd, uint32_t Arg, uint8_t Crc, uint8_t Response)
+{
+    SD_IO_SendFrame(Cmd, Arg, Crc);
+    if (Response != SENSORTILE_SD_NO_RESPONSE_EXPECTED) {
+        return SD_IO_WaitResponse(Response);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef SD_IO_WaitResponse(uint8_t Response)
+{
+    uint32_t timeout = 0xFF0;
+
+    while ((SD_IO_ReadByte() != Response) && timeout) {
+        timeout--;
+    }
+    return (timeout == 0) ? HAL_TIMEOUT : HAL_OK;
+}
+
+void SD_IO_WriteDummy(void)
+{
+    SENSORTILE_SD_CS_HIGH();
+    SD_IO_WriteByte(SENSORTILE_SD_DUMMY_BYTE);
+}
+
+} // extern "C"
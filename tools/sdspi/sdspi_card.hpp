@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file    sdspi_card.hpp
+  * @brief   SDHC card in SPI mode, emulated byte by byte behind the SD_IO_*
+  *          link functions of the BSP (bsp/SensorTile/SensorTile.c), so the
+  *          SD driver of the firmware (SensorTile_sd.c) runs on the host.
+  ******************************************************************************
+  */
+#ifndef STSD_SDSPI_CARD_HPP
+#define STSD_SDSPI_CARD_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace stsd {
+
+constexpr std::uint32_t block_size = 512;
+
+/// A command frame received by the card
+struct Command {
+    std::uint8_t index;
+    bool app;                   // after CMD55
+    std::uint32_t arg;
+};
+
+/// Data block received in a write transaction
+struct DataBlock {
+    std::uint8_t token;         // 0xFE (CMD24) or 0xFC (CMD25)
+    std::uint32_t address;
+    std::uint8_t response;      // data response sent, 0 for none
+};
+
+/**
+  * @brief  Card faults, set by the test before the transaction
+  */
+struct Faults {
+    bool refuse_acmd23 = false;         // ACMD23 answered illegal command
+    int reject_block = -1;              // block of the next write transaction rejected...
+    std::uint8_t reject_response = 0x0D; // ...with this data response (0x0B CRC, 0x0D write error)
+    int mute_block = -1;                // block of the next write transaction without data response
+    bool stuck_busy = false;            // never leaves the busy state after a stop token
+};
+
+/**
+  * @brief  The card: every SPI byte is exchanged with exchange(), the bus
+  *         time moves by one byte time per exchange. Protocol violations by
+  *         the host (a byte other than 0xFF while the card is busy, a start
+  *         token out of place, a command inside a write transaction) are
+  *         recorded in violations().
+  */
+class SpiCard {
+public:
+    explicit SpiCard(std::uint32_t blocks);
+
+    std::uint8_t exchange(std::uint8_t mosi);
+    void select(bool selected);
+    /// Time of the bus, 1 us per byte (8 MHz SPI clock)
+    void advance_us(std::uint64_t us) { now_us_ += us; }
+    std::uint64_t now_us() const { return now_us_; }
+
+    Faults faults;
+    std::uint32_t busy_bytes = 200;         // programming time after each block
+    std::uint32_t stop_busy_bytes = 500;    // after the stop token
+
+    const std::vector<Command>& commands() const { return commands_; }
+    const std::vector<DataBlock>& blocks() const { return blocks_; }
+    std::uint32_t stop_tokens() const { return stop_tokens_; }
+    std::uint32_t pre_erase() const { return pre_erase_; }
+    const std::vector<std::string>& violations() const { return violations_; }
+    const std::uint8_t* data(std::uint32_t block) const { return &memory_[std::size_t(block) * block_size]; }
+    void clear_log();
+
+private:
+    enum class State { Idle, Command, WaitToken, Data };
+
+    void execute();
+    void respond(std::uint8_t r1) { out_.push_back(0xFF); out_.push_back(r1); }
+    void end_block();
+    void violation(const std::string& what);
+
+    std::vector<std::uint8_t> memory_;
+    std::uint64_t now_us_ = 0;
+    bool selected_ = false;
+    bool idle_ = true;                      // R1 in idle state, until ACMD41
+    bool app_ = false;                      // the next command is an ACMD
+    std::uint32_t op_cond_polls_ = 0;
+    State state_ = State::Idle;
+    std::uint8_t frame_[6] = {};
+    std::uint32_t frame_len_ = 0;
+    std::deque<std::uint8_t> out_;          // bytes to send before the busy
+    std::uint64_t busy_ = 0;                // busy bytes after out_
+    bool multiple_ = false;                 // write transaction of CMD25
+    std::uint32_t address_ = 0;             // next block written
+    std::uint32_t transaction_block_ = 0;
+    std::uint8_t token_ = 0;
+    std::vector<std::uint8_t> block_;
+    std::uint32_t pre_erase_ = 0;           // ACMD23 count of the last CMD25
+    std::uint32_t set_pre_erase_ = 0;       // last ACMD23
+    std::uint32_t stop_tokens_ = 0;
+    std::vector<Command> commands_;
+    std::vector<DataBlock> blocks_;
+    std::vector<std::string> violations_;
+};
+
+/// The card behind the SD_IO_* functions and the HAL shim
+void attach(SpiCard* card);
+
+} // namespace stsd
+
+#endif // STSD_SDSPI_CARD_HPP
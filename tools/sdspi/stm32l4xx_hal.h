@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @file    stm32l4xx_hal.h
+  * @brief   HAL of the SD card SPI test: the types, registers and functions
+  *          used by bsp/SensorTile/SensorTile_sd.c and the BSP headers it
+  *          includes, implemented by the emulated card (sdspi_card.cpp).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32L4xx_HAL_H
+#define __STM32L4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  HAL_OK       = 0x00,
+  HAL_ERROR    = 0x01,
+  HAL_BUSY     = 0x02,
+  HAL_TIMEOUT  = 0x03
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+  uint32_t ODR;     /* output data register, the chip select */
+} GPIO_TypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+  uint32_t Instance;
+} SPI_HandleTypeDef;
+
+/* Cycle counter of the Cortex-M4: CYCCNT follows the time of the emulated
+   bus at SystemCoreClock */
+typedef struct
+{
+  uint32_t CTRL;
+  uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  uint32_t DEMCR;
+} CoreDebug_Type;
+
+/* Exported constants --------------------------------------------------------*/
+extern GPIO_TypeDef SdSpiGPIOG;
+#define GPIOG   (&SdSpiGPIOG)
+
+extern DWT_Type SdSpiDWT;
+extern CoreDebug_Type SdSpiCoreDebug;
+#define DWT         (&SdSpiDWT)
+#define CoreDebug   (&SdSpiCoreDebug)
+
+#define DWT_CTRL_CYCCNTENA_Msk       (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk   (1UL << 24)
+
+extern uint32_t SystemCoreClock;
+
+#define GPIO_PIN_1                 ((uint16_t)0x0002)
+#define GPIO_PIN_2                 ((uint16_t)0x0004)
+#define GPIO_PIN_3                 ((uint16_t)0x0008)
+#define GPIO_PIN_4                 ((uint16_t)0x0010)
+#define GPIO_PIN_9                 ((uint16_t)0x0200)
+#define GPIO_PIN_10                ((uint16_t)0x0400)
+#define GPIO_PIN_11                ((uint16_t)0x0800)
+#define GPIO_PIN_12                ((uint16_t)0x1000)
+#define GPIO_PIN_14                ((uint16_t)0x4000)
+
+/* Exported macro ------------------------------------------------------------*/
+#define __IO    volatile
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+
+/* Transfer callbacks of the SD driver, called at the end of the emulated DMA */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32L4xx_HAL_H */
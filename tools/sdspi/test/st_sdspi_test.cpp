@@ -0,0 +1,213 @@
+/**
+  ******************************************************************************
+  * @file    st_sdspi_test.cpp
+  * @brief   Write path of the SD card driver (bsp/SensorTile/SensorTile_sd.c)
+  *          against an emulated SPI card: the ACMD23 pre-erase before CMD25,
+  *          the multiple block start and stop tokens, the waits on the card
+  *          busy and the errors of the data response and of a stuck card.
+  ******************************************************************************
+  */
+#include "sdspi_card.hpp"
+
+#include "SensorTile_sd.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t card_blocks = 4096;
+
+int failures = 0;
+
+void check(bool ok, const char* test, const char* what)
+{
+    if (!ok) {
+        std::printf("FAIL %s: %s\n", test, what);
+        failures++;
+    }
+}
+
+std::vector<std::uint32_t> pattern(std::uint32_t blocks, std::uint32_t seed)
+{
+    std::vector<std::uint32_t> data(blocks * stsd::block_size / 4);
+    for (std::size_t i = 0; i < data.size(); i++) {
+        data[i] = std::uint32_t(i * 2654435761u) ^ seed;
+    }
+    return data;
+}
+
+bool stored(const stsd::SpiCard& card, std::uint32_t sector, const std::vector<std::uint32_t>& data,
+            std::uint32_t blocks)
+{
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(data.data());
+    for (std::uint32_t b = 0; b < blocks; b++) {
+        if (std::memcmp(card.data(sector + b), bytes + std::size_t(b) * stsd::block_size, stsd::block_size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::uint32_t count_commands(const stsd::SpiCard& card, std::uint8_t index, bool app)
+{
+    std::uint32_t n = 0;
+    for (const auto& cmd : card.commands()) {
+        n += (cmd.index == index && cmd.app == app) ? 1 : 0;
+    }
+    return n;
+}
+
+void report_violations(const stsd::SpiCard& card, const char* test)
+{
+    for (const auto& v : card.violations()) {
+        std::printf("FAIL %s: %s\n", test, v.c_str());
+        failures++;
+    }
+}
+
+/* CMD25 preceded by ACMD23 with its block count, one 0xFC token per block,
+   the 0xFD stop token, and no byte sent while the card programs */
+void test_multiple(stsd::SpiCard& card)
+{
+    const char* test = "multiple block write";
+    auto data = pattern(8, 1);
+
+    card.clear_log();
+    card.busy_bytes = 3000;
+    check(BSP_SD_WriteBlocks(data.data(), 100, 8, 0) == MSD_OK, test, "write failed");
+    const auto& cmds = card.commands();
+    check(cmds.size() == 3 && cmds[0].index == SD_CMD_APP_CMD && !cmds[0].app &&
+              cmds[1].index == SD_CMD_SD_APP_SET_WR_BLK_ERASE_COUNT && cmds[1].app && cmds[1].arg == 8 &&
+              cmds[2].index == SD_CMD_WRITE_MULT_BLOCK && cmds[2].arg == 100,
+          test, "expected CMD55, ACMD23(8), CMD25(100)");
+    check(card.pre_erase() == 8, test, "pre-erase count not applied to the CMD25");
+    check(card.blocks().size() == 8, test, "expected 8 data blocks");
+    for (const auto& block : card.blocks()) {
+        check(block.token == SD_START_DATA_MULTIPLE_BLOCK_WRITE, test, "data block without the 0xFC token");
+    }
+    check(card.stop_tokens() == 1, test, "expected one stop token");
+    check(stored(card, 100, data, 8), test, "data differs");
+    report_violations(card, test);
+}
+
+/* One block: CMD24 and the 0xFE token, no pre-erase */
+void test_single(stsd::SpiCard& card)
+{
+    const char* test = "single block write";
+    auto data = pattern(1, 2);
+
+    card.clear_log();
+    check(BSP_SD_WriteBlocks(data.data(), 7, 1, 0) == MSD_OK, test, "write failed");
+    check(card.commands().size() == 1 && card.commands()[0].index == SD_CMD_WRITE_SINGLE_BLOCK,
+          test, "expected CMD24 alone");
+    check(card.blocks().size() == 1 && card.blocks()[0].token == SD_START_DATA_SINGLE_BLOCK_WRITE,
+          test, "expected one block with the 0xFE token");
+    check(card.stop_tokens() == 0, test, "stop token after CMD24");
+    check(stored(card, 7, data, 1), test, "data differs");
+    report_violations(card, test);
+}
+
+/* ACMD23 is only a hint: the write goes on when the card refuses it */
+void test_acmd23_refused(stsd::SpiCard& card)
+{
+    const char* test = "ACMD23 refused";
+    auto data = pattern(4, 3);
+
+    card.clear_log();
+    card.faults.refuse_acmd23 = true;
+    check(BSP_SD_WriteBlocks(data.data(), 200, 4, 0) == MSD_OK, test, "write failed");
+    card.faults.refuse_acmd23 = false;
+    check(count_commands(card, SD_CMD_WRITE_MULT_BLOCK, false) == 1, test, "no CMD25");
+    check(card.pre_erase() == 0, test, "pre-erase count applied");
+    check(stored(card, 200, data, 4), test, "data differs");
+    report_violations(card, test);
+}
+
+/* A rejected block ends the transaction: no more data tokens, the stop token
+   is sent, the error is returned and the card takes the next write */
+void test_rejected(stsd::SpiCard& card, std::uint8_t response, const char* test)
+{
+    auto data = pattern(8, 4);
+
+    card.clear_log();
+    card.faults.reject_block = 3;
+    card.faults.reject_response = response;
+    check(BSP_SD_WriteBlocks(data.data(), 300, 8, 0) == MSD_ERROR, test, "error not returned");
+    check(card.blocks().size() == 4, test, "data tokens sent after the rejected block");
+    check(card.stop_tokens() == 1, test, "no stop token after the rejected block");
+    check(stored(card, 300, data, 3), test, "blocks before the rejected one differ");
+    report_violations(card, test);
+
+    card.clear_log();
+    check(BSP_SD_WriteBlocks(data.data(), 300, 8, 0) == MSD_OK, test, "next write failed");
+    check(stored(card, 300, data, 8), test, "next write data differs");
+    report_violations(card, test);
+}
+
+/* A card that never answers a block, or stays busy after the stop token,
+   fails the write instead of hanging the caller */
+void test_stuck(stsd::SpiCard& card)
+{
+    auto data = pattern(4, 5);
+
+    {
+        const char* test = "no data response";
+        card.clear_log();
+        card.faults.mute_block = 1;
+        check(BSP_SD_WriteBlocks(data.data(), 400, 4, 0) == MSD_ERROR, test, "error not returned");
+        card.faults.mute_block = -1;
+    }
+    {
+        const char* test = "busy after the stop token";
+        const std::uint64_t start = card.now_us();
+        card.clear_log();
+        card.faults.stuck_busy = true;
+        check(BSP_SD_WriteBlocks(data.data(), 500, 4, 0) == MSD_ERROR, test, "error not returned");
+        card.faults.stuck_busy = false;
+        const std::uint64_t waited_ms = (card.now_us() - start) / 1000;
+        check(waited_ms >= SENSORTILE_SD_BUSY_TIMEOUT_MS && waited_ms < 2 * SENSORTILE_SD_BUSY_TIMEOUT_MS,
+              test, "busy timeout out of range");
+        report_violations(card, test);
+    }
+}
+
+/* The write latency histograms time the commands with the bus time */
+void test_stats()
+{
+    const char* test = "write statistics";
+    SD_WriteStats stats;
+
+    BSP_SD_GetWriteStats(&stats);
+    check(stats.Total.Count > 0 && stats.Busy.Count == stats.Total.Count, test, "writes not counted");
+    check(stats.Total.MaxUs >= 8 * (stsd::block_size + 3 + 3000), test, "busy time of the 8 block write not counted");
+}
+
+} // namespace
+
+int main()
+{
+    stsd::SpiCard card(card_blocks);
+    stsd::attach(&card);
+
+    if (BSP_SD_Init() != MSD_OK) {
+        std::printf("FAIL init: BSP_SD_Init\n");
+        return 1;
+    }
+    BSP_SD_ResetWriteStats();
+
+    test_multiple(card);
+    test_single(card);
+    test_acmd23_refused(card);
+    test_rejected(card, SD_DATA_WRITE_ERROR, "write error response");
+    test_rejected(card, SD_DATA_CRC_ERROR, "CRC error response");
+    test_stats();
+    test_stuck(card);
+
+    if (failures == 0) {
+        std::printf("st_sdspi_test: all passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
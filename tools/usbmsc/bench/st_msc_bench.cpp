@@ -0,0 +1,371 @@
+/**
+  ******************************************************************************
+  * @file    st_msc_bench.cpp
+  * @brief   USB mass storage mode of the firmware on a disk image: the MSC
+  *          class of the STM32 USB device library (BOT and SCSI) with the
+  *          storage media of the firmware (usbd_storage.c) on the image
+  *          driver, behind stubbed USBD_LL functions. A host sequence
+  *          checks INQUIRY, READ CAPACITY, WRITE(10), READ(10) and the
+  *          sense data of an out of range read, then reports the read and
+  *          write throughput with simulated card and USB bus timings.
+  ******************************************************************************
+  */
+#include "image_diskio.h"
+#include "usbd_core.h"
+#include "usbd_storage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-s MiB] [-n sectors] [-c us] [-t us] [-u us] [-p path]\n"
+        "  -s  size of the card image (default: 64 MiB)\n"
+        "  -n  sectors per SCSI read or write command (default: 128)\n"
+        "  -c  card time per command (default: 500 us)\n"
+        "  -t  card time per sector (default: 250 us)\n"
+        "  -u  USB time per 64 byte packet (default: 53 us, 19 packets per frame)\n"
+        "  -p  image path (default: /tmp/st_msc_bench.img)\n",
+        argv0);
+}
+
+constexpr std::uint32_t sector_size = 512;
+constexpr std::uint32_t packet_size = 64;
+constexpr std::uint32_t cbw_signature = 0x43425355;
+constexpr std::uint32_t csw_signature = 0x53425355;
+constexpr std::uint32_t cbw_length = 31;
+constexpr std::uint32_t csw_length = 13;
+
+/// Transfers queued by the device on its bulk endpoints
+struct Bus {
+    std::uint8_t* rx_buf = nullptr;   ///< buffer of the pending OUT transfer
+    std::uint32_t rx_max = 0;
+    std::uint32_t rx_size = 0;
+    std::uint8_t* tx_buf = nullptr;   ///< data of the pending IN transfer
+    std::uint32_t tx_size = 0;
+    bool tx_pending = false;
+    bool in_stalled = false;
+    std::uint64_t packets = 0;        ///< bus packets of all the transfers
+};
+
+Bus bus;
+
+void put32(std::uint8_t* p, std::uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = std::uint8_t(v >> (8 * i));
+    }
+}
+
+std::uint32_t get32(const std::uint8_t* p)
+{
+    return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+}
+
+std::uint32_t get32be(const std::uint8_t* p)
+{
+    return std::uint32_t(p[0]) << 24 | std::uint32_t(p[1]) << 16 | std::uint32_t(p[2]) << 8 | std::uint32_t(p[3]);
+}
+
+/// Bus packets of a transfer, a short or empty one included
+std::uint64_t packets(std::uint32_t size)
+{
+    return std::max<std::uint64_t>(1, (size + packet_size - 1) / packet_size);
+}
+
+/// SCSI READ(10) or WRITE(10) command block
+std::vector<std::uint8_t> rw10(std::uint8_t op, std::uint32_t lba, std::uint16_t count)
+{
+    return {op, 0, std::uint8_t(lba >> 24), std::uint8_t(lba >> 16), std::uint8_t(lba >> 8), std::uint8_t(lba),
+            0, std::uint8_t(count >> 8), std::uint8_t(count), 0};
+}
+
+/// Data written to a sector, different for each sector
+void fill(std::uint8_t* p, std::uint32_t lba)
+{
+    for (std::uint32_t i = 0; i < sector_size; i += 4) {
+        put32(&p[i], (lba * 2654435761U) ^ (i * 40503U));
+    }
+}
+
+/// The USB host side: bulk only transport of the SCSI commands
+class Host {
+public:
+    bool attach()
+    {
+        dev_.dev_speed = USBD_SPEED_FULL;
+        USBD_RegisterClass(&dev_, USBD_MSC_CLASS);
+        USBD_MSC_RegisterStorage(&dev_, &USBD_Storage_fops);
+        // SET_CONFIGURATION: the class opens its endpoints and waits for a CBW
+        if (USBD_SetClassConfig(&dev_, 1) != USBD_OK) {
+            return false;
+        }
+        dev_.dev_config = 1;
+        dev_.dev_state = USBD_STATE_CONFIGURED;
+        return bus.rx_buf != nullptr;
+    }
+
+    /// One command: CBW, data stage and CSW.
+    /// @return CSW status (0 passed, 1 failed), -1 on a transport error
+    int command(const std::vector<std::uint8_t>& cb, bool in, std::uint8_t* data, std::uint32_t length)
+    {
+        std::uint8_t cbw[cbw_length] = {};
+        put32(&cbw[0], cbw_signature);
+        put32(&cbw[4], ++tag_);
+        put32(&cbw[8], length);
+        cbw[12] = in ? 0x80 : 0x00;
+        cbw[14] = std::uint8_t(cb.size());
+        std::memcpy(&cbw[15], cb.data(), cb.size());
+        if (!receive(cbw, cbw_length)) {
+            return -1;
+        }
+
+        std::uint32_t done = 0;
+        while (true) {
+            if (bus.tx_pending) {
+                std::uint8_t* buf = bus.tx_buf;
+                bus.tx_pending = false;
+                bus.packets += packets(bus.tx_size);
+                if (bus.tx_size == csw_length && get32(&buf[0]) == csw_signature && get32(&buf[4]) == tag_) {
+                    const int status = buf[12];
+                    USBD_LL_DataInStage(&dev_, MSC_EPIN_ADDR & 0x7F, buf);
+                    return status;
+                }
+                if (!in || done + bus.tx_size > length) {
+                    return -1;
+                }
+                std::memcpy(&data[done], buf, bus.tx_size);
+                done += bus.tx_size;
+                USBD_LL_DataInStage(&dev_, MSC_EPIN_ADDR & 0x7F, buf);
+            } else if (!in && done < length && bus.rx_buf != nullptr) {
+                const std::uint32_t n = std::min(bus.rx_max, length - done);
+                if (!receive(&data[done], n)) {
+                    return -1;
+                }
+                done += n;
+            } else if (bus.in_stalled) {
+                // CLEAR_FEATURE(ENDPOINT_HALT) from the host, the CSW follows
+                bus.in_stalled = false;
+                MSC_BOT_CplClrFeature(&dev_, MSC_EPIN_ADDR);
+                if (!bus.tx_pending) {
+                    return -1;
+                }
+            } else {
+                return -1;
+            }
+        }
+    }
+
+private:
+    /// OUT transfer to the buffer the device prepared
+    bool receive(const std::uint8_t* data, std::uint32_t size)
+    {
+        std::uint8_t* buf = bus.rx_buf;
+        if (buf == nullptr || size > bus.rx_max) {
+            return false;
+        }
+        bus.rx_buf = nullptr;
+        std::memcpy(buf, data, size);
+        bus.rx_size = size;
+        bus.packets += packets(size);
+        USBD_LL_DataOutStage(&dev_, MSC_EPOUT_ADDR, buf);
+        return true;
+    }
+
+    USBD_HandleTypeDef dev_{};
+    std::uint32_t tag_ = 0;
+};
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+    std::printf("%-44s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        failures++;
+    }
+}
+
+} // namespace
+
+/* Low level driver of the USB device library, stubbed -----------------------*/
+extern "C" {
+
+USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef*) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_DeInit(USBD_HandleTypeDef*) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_Start(USBD_HandleTypeDef*) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_Stop(USBD_HandleTypeDef*) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef*, uint8_t, uint8_t, uint16_t) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef*, uint8_t) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef*, uint8_t) { return USBD_OK; }
+USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef*, uint8_t) { return USBD_OK; }
+void USBD_LL_Delay(uint32_t) {}
+
+USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef*, uint8_t ep_addr)
+{
+    if (ep_addr == MSC_EPIN_ADDR) {
+        bus.in_stalled = true;
+    }
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef*, uint8_t ep_addr)
+{
+    if (ep_addr == MSC_EPIN_ADDR) {
+        bus.in_stalled = false;
+    }
+    return USBD_OK;
+}
+
+uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef*, uint8_t ep_addr)
+{
+    return ep_addr == MSC_EPIN_ADDR && bus.in_stalled;
+}
+
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef*, uint8_t ep_addr, uint8_t* pbuf, uint32_t size)
+{
+    if (ep_addr == MSC_EPIN_ADDR) {
+        bus.tx_buf = pbuf;
+        bus.tx_size = size;
+        bus.tx_pending = true;
+    }
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef*, uint8_t ep_addr, uint8_t* pbuf, uint32_t size)
+{
+    if (ep_addr == MSC_EPOUT_ADDR) {
+        bus.rx_buf = pbuf;
+        bus.rx_max = size;
+    }
+    return USBD_OK;
+}
+
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef*, uint8_t)
+{
+    return bus.rx_size;
+}
+
+} // extern "C"
+
+int main(int argc, char** argv)
+{
+    std::uint64_t size_mib = 64;
+    std::uint32_t sectors_per_command = 128;
+    IMAGE_Latency_t latency = {500, 250, 0, 0};
+    double packet_us = 53;
+    std::string path = "/tmp/st_msc_bench.img";
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "s:n:c:t:u:p:h")) != -1) {
+        switch (opt) {
+        case 's': size_mib = std::strtoull(optarg, nullptr, 10); break;
+        case 'n': sectors_per_command = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'c': latency.command_us = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 't': latency.sector_us = static_cast<std::uint32_t>(std::strtoul(optarg, nullptr, 10)); break;
+        case 'u': packet_us = std::strtod(optarg, nullptr); break;
+        case 'p': path = optarg; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    const std::uint64_t image_sectors = size_mib * 1024 * 1024 / sector_size;
+    if (image_sectors < 2 || image_sectors > UINT32_MAX || sectors_per_command == 0 ||
+        sectors_per_command > UINT16_MAX || packet_us <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::uint32_t sectors = std::uint32_t(image_sectors);
+
+    if (IMAGE_Open(path.c_str(), sectors, &latency) != 0) {
+        std::perror(path.c_str());
+        return EXIT_FAILURE;
+    }
+    Host host;
+    if (!USBD_Storage_Init(&IMAGE_Driver) || !host.attach()) {
+        std::fprintf(stderr, "the mass storage class did not start\n");
+        return EXIT_FAILURE;
+    }
+
+    std::uint8_t reply[36];
+    check(host.command({0x12, 0, 0, 0, sizeof(reply), 0}, true, reply, sizeof(reply)) == 0 &&
+          std::memcmp(&reply[8], "STM     SensorTile SD", 21) == 0, "INQUIRY");
+    check(host.command({0x00, 0, 0, 0, 0, 0}, false, nullptr, 0) == 0, "TEST UNIT READY");
+    check(host.command({0x25, 0, 0, 0, 0, 0, 0, 0, 0, 0}, true, reply, 8) == 0 &&
+          get32be(&reply[0]) == sectors - 1 && get32be(&reply[4]) == sector_size, "READ CAPACITY(10)");
+
+    // The whole card, sectors_per_command sectors at a time
+    std::vector<std::uint8_t> data(std::size_t(sectors_per_command) * sector_size);
+    std::vector<std::uint8_t> expected(sector_size);
+    std::uint64_t scsi_commands = 0;
+    bool ok = true;
+    IMAGE_ResetStats();
+    bus.packets = 0;
+    for (std::uint32_t lba = 0; lba < sectors && ok; lba += sectors_per_command) {
+        const std::uint32_t n = std::min(sectors_per_command, sectors - lba);
+        for (std::uint32_t i = 0; i < n; i++) {
+            fill(&data[std::size_t(i) * sector_size], lba + i);
+        }
+        ok = host.command(rw10(0x2A, lba, std::uint16_t(n)), false, data.data(), n * sector_size) == 0;
+        scsi_commands++;
+    }
+    const IMAGE_Stats_t write_stats = *IMAGE_GetStats();
+    const std::uint64_t write_packets = bus.packets;
+    check(ok, "WRITE(10) of the whole card");
+
+    // Sectors on the image, read with the disk driver
+    for (std::uint32_t lba = 0; lba < sectors && ok; lba += 1 + lba / 7) {
+        fill(expected.data(), lba);
+        ok = IMAGE_Driver.disk_read(0, data.data(), lba, 1) == RES_OK &&
+             std::memcmp(data.data(), expected.data(), sector_size) == 0;
+    }
+    check(ok, "image content after WRITE(10)");
+
+    IMAGE_ResetStats();
+    bus.packets = 0;
+    for (std::uint32_t lba = 0; lba < sectors && ok; lba += sectors_per_command) {
+        const std::uint32_t n = std::min(sectors_per_command, sectors - lba);
+        ok = host.command(rw10(0x28, lba, std::uint16_t(n)), true, data.data(), n * sector_size) == 0;
+        for (std::uint32_t i = 0; i < n && ok; i++) {
+            fill(expected.data(), lba + i);
+            ok = std::memcmp(&data[std::size_t(i) * sector_size], expected.data(), sector_size) == 0;
+        }
+    }
+    const IMAGE_Stats_t read_stats = *IMAGE_GetStats();
+    const std::uint64_t read_packets = bus.packets;
+    check(ok, "READ(10) of the whole card");
+
+    check(host.command(rw10(0x28, sectors - 1, 2), true, data.data(), 2 * sector_size) == 1,
+          "READ(10) past the end fails");
+    check(host.command({0x03, 0, 0, 0, 18, 0}, true, reply, 18) == 0 && (reply[2] & 0x0F) == 0x05 &&
+          reply[12] == 0x21, "REQUEST SENSE: address out of range");
+    check(host.command({0x00, 0, 0, 0, 0, 0}, false, nullptr, 0) == 0, "TEST UNIT READY after the error");
+
+    // The BOT handles one packet of MSC_MEDIA_PACKET bytes at a time: the card and the bus take turns
+    const double bytes = double(sectors) * sector_size;
+    const auto report = [&](const char* name, const IMAGE_Stats_t& stats, std::uint64_t commands,
+                            std::uint64_t card_sectors, std::uint64_t bus_packets) {
+        const double us = double(stats.time_us) + double(bus_packets) * packet_us;
+        std::printf("%-6s %7.3f MB/s, %6.1f card commands per SCSI command, %5.1f sectors per card command\n",
+                    name, bytes / us, double(commands) / double(scsi_commands),
+                    commands ? double(card_sectors) / double(commands) : 0.0);
+    };
+    std::printf("%u sectors, %u sectors per SCSI command, MSC_MEDIA_PACKET %u bytes\n", sectors,
+                sectors_per_command, unsigned(MSC_MEDIA_PACKET));
+    report("write", write_stats, write_stats.write_commands, write_stats.write_sectors, write_packets);
+    report("read", read_stats, read_stats.read_commands, read_stats.read_sectors, read_packets);
+
+    IMAGE_Close();
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
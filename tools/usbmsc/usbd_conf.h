@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+  * @file    usbd_conf.h
+  * @brief   USB device library configuration of the host tools: the values
+  *          of bsp/config/usbd_conf.h, without the HAL.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CONF_H
+#define __USBD_CONF_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Common Config */
+#define USBD_MAX_NUM_INTERFACES               1
+#define USBD_MAX_NUM_CONFIGURATION            1
+#define USBD_MAX_STR_DESC_SIZ                 0x100
+#define USBD_SUPPORT_USER_STRING              0
+#define USBD_SELF_POWERED                     1
+#define USBD_DEBUG_LEVEL                      0
+/* Mass storage: bytes per SD card command of a SCSI read or write */
+#define MSC_MEDIA_PACKET                      4096U
+
+/* Exported macro ------------------------------------------------------------*/
+/* Memory management macros */
+#define USBD_malloc               malloc
+#define USBD_free                 free
+#define USBD_memset               memset
+#define USBD_memcpy               memcpy
+
+/* DEBUG macros */
+#define USBD_UsrLog(...)
+#define USBD_ErrLog(...)
+#define USBD_DbgLog(...)
+
+#endif /* __USBD_CONF_H */